@@ -0,0 +1,1522 @@
+#define _GNU_SOURCE
+
+#include "../src/BinaryLog.h"
+#include "../src/BlobFinder.h"
+#include "../src/Camera.h"
+#include "../src/Convert.h"
+#include "../src/EventLoop.h"
+#include "../src/FeatureDetector.h"
+#include "../src/FrameView.h"
+#include "../src/Fusion.h"
+#include "../src/Integral.h"
+#include "../src/Remap.h"
+#include "../src/Segmenter.h"
+#include "../src/Serial.h"
+#include "../src/Stereo.h"
+#include "../src/TaskPool.h"
+#include "../src/Timer.h"
+#include "../src/Timestamp.h"
+
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_RESULT_COUNT_MAX 128
+#define BENCH_NAME_LENGTH 64
+#define BENCH_REPLAY_SIZE_X 640
+#define BENCH_REPLAY_SIZE_Y 480
+#define BENCH_REPLAY_FRAME_COUNT 4
+#define BENCH_DEVICE_COUNT 8
+
+/********************----- STRUCT: BenchResult -----********************/
+struct BenchResult_s
+{
+	char m_name[BENCH_NAME_LENGTH];
+	char const *m_unit;
+	double m_value;
+	int m_lowerIsBetter;
+	int m_baselineFound;
+	double m_baselineValue;
+};
+typedef struct BenchResult_s BenchResult;
+/**************************************************/
+
+/********************----- Global Variables -----********************/
+static BenchResult g_results[BENCH_RESULT_COUNT_MAX];
+static size_t g_resultCount = 0;
+static char const *g_filter = NULL;
+static uint64_t g_scale = 10;
+static volatile uint64_t g_sink = 0;
+static int g_failures = 0;
+/**************************************************/
+
+/********************----- Allocation Counting -----********************/
+/* The library is linked statically, so these replace malloc for it too and forward to glibc */
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t i_sizeBytes);
+extern void *__libc_calloc(size_t i_count, size_t i_sizeBytes);
+extern void *__libc_realloc(void *i_memory, size_t i_sizeBytes);
+extern void __libc_free(void *i_memory);
+
+static uint64_t g_allocationCount = 0;
+
+void *malloc(size_t i_sizeBytes)
+{
+	__atomic_add_fetch(&g_allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(i_sizeBytes);
+}
+
+void *calloc(size_t i_count, size_t i_sizeBytes)
+{
+	__atomic_add_fetch(&g_allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(i_count, i_sizeBytes);
+}
+
+void *realloc(void *i_memory, size_t i_sizeBytes)
+{
+	__atomic_add_fetch(&g_allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(i_memory, i_sizeBytes);
+}
+
+void free(void *i_memory)
+{
+	__libc_free(i_memory);
+}
+
+#define BENCH_ALLOCATIONS() __atomic_load_n(&g_allocationCount, __ATOMIC_RELAXED)
+#else
+#define BENCH_ALLOCATIONS() ((uint64_t)0)
+#endif
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static int bench_enabled(char const * const i_group)
+{
+	return g_filter == NULL || strstr(i_group, g_filter) != NULL || strstr(g_filter, i_group) != NULL;
+}
+
+static void bench_record(char const * const i_name, char const * const i_unit, double const i_value, int const i_lowerIsBetter)
+{
+	BenchResult *result = NULL;
+	size_t resultIndex = 0;
+
+	/***** Repeated runs keep the best value seen *****/
+	for(resultIndex=0; resultIndex<g_resultCount; ++resultIndex)
+	{
+		result = &g_results[resultIndex];
+		if(strcmp(result->m_name, i_name) == 0)
+		{
+			if(i_lowerIsBetter ? (i_value < result->m_value) : (i_value > result->m_value))
+			{
+				result->m_value = i_value;
+			}
+			return;
+		}
+	}
+
+	if(g_resultCount >= BENCH_RESULT_COUNT_MAX)
+	{
+		return;
+	}
+	result = &g_results[g_resultCount++];
+	snprintf(result->m_name, sizeof(result->m_name), "%s", i_name);
+	result->m_unit = i_unit;
+	result->m_value = i_value;
+	result->m_lowerIsBetter = i_lowerIsBetter;
+	result->m_baselineFound = 0;
+	result->m_baselineValue = 0.0;
+
+	fprintf(stderr, "%-44s %14.2f %s\n", result->m_name, result->m_value, result->m_unit);
+}
+
+/* Steady-state paths must not touch the heap; any allocation fails the run */
+static void bench_record_allocations(char const * const i_name, uint64_t const i_allocations)
+{
+	bench_record(i_name, "allocations", (double)i_allocations, 1);
+	if(i_allocations != 0)
+	{
+		fprintf(stderr, "%s: expected no heap allocations\n", i_name);
+		++g_failures;
+	}
+}
+
+static double bench_per(Timestamp const i_elapsed, uint64_t const i_count)
+{
+	return (i_count > 0) ? (double)i_elapsed/(double)i_count : 0.0;
+}
+
+static uint64_t bench_context_switches(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64_t)usage.ru_nvcsw + (uint64_t)usage.ru_nivcsw;
+}
+/**************************************************/
+
+/********************----- Timing -----********************/
+static void bench_timing(void)
+{
+	uint64_t const iterations = g_scale*1000000;
+	TimestampSource const sources[] = {TIMESTAMP_SOURCE_MONOTONIC, TIMESTAMP_SOURCE_MONOTONIC_COARSE, TIMESTAMP_SOURCE_TSC};
+	char const * const sourceNames[] = {"timestamp.monotonic", "timestamp.monotonic_coarse", "timestamp.tsc"};
+	size_t sourceIndex = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	Timer timer;
+
+	/***** Clock read cost per source *****/
+	for(sourceIndex=0; sourceIndex<sizeof(sources)/sizeof(sources[0]); ++sourceIndex)
+	{
+		if(sources[sourceIndex] == TIMESTAMP_SOURCE_TSC && timestamp_source_set(TIMESTAMP_SOURCE_TSC) != R_SUCCESS)
+		{
+			continue;
+		}
+		timeStart = timestamp_read(TIMESTAMP_SOURCE_MONOTONIC);
+		for(index=0; index<iterations; ++index)
+		{
+			g_sink += timestamp_read(sources[sourceIndex]);
+		}
+		bench_record(sourceNames[sourceIndex], "ns/read", bench_per(timestamp_read(TIMESTAMP_SOURCE_MONOTONIC) - timeStart, iterations), 1);
+	}
+	timestamp_source_set(TIMESTAMP_SOURCE_MONOTONIC);
+
+	/***** timer_start/timer_stop pair *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		timer_start(&timer);
+		timer_stop(&timer);
+		g_sink += timer_total_nanoseconds(&timer);
+	}
+	bench_record("timer.start_stop", "ns/pair", bench_per(timestamp_now() - timeStart, iterations), 1);
+}
+/**************************************************/
+
+/********************----- Capture -----********************/
+static void bench_frame_touch(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, void * const i_callbackData)
+{
+	g_sink += i_frameData[i_frameSizeBytes/2];
+}
+
+/* Fills a mkstemp replay file with BENCH_REPLAY_FRAME_COUNT flat YUYV frames; io_frame is scratch of one frame */
+static int bench_replay_write(char * const io_pathname, uint8_t * const io_frame, size_t const i_frameSizeBytes)
+{
+	uint64_t index = 0;
+	int fileHandle = mkstemp(io_pathname);
+
+	if(fileHandle < 0)
+	{
+		return -1;
+	}
+	for(index=0; index<BENCH_REPLAY_FRAME_COUNT; ++index)
+	{
+		memset(io_frame, (int)(16 + index*32), i_frameSizeBytes);
+		if(write(fileHandle, io_frame, i_frameSizeBytes) != (ssize_t)i_frameSizeBytes)
+		{
+			close(fileHandle);
+			return -1;
+		}
+	}
+	close(fileHandle);
+
+	return 0;
+}
+
+static void bench_capture(void)
+{
+	char pathname[] = "/tmp/carl_bench_replay_XXXXXX";
+	size_t const frameSizeBytes = (size_t)BENCH_REPLAY_SIZE_X*BENCH_REPLAY_SIZE_Y*2;
+	uint64_t const iterations = g_scale*10000;
+	uint8_t *frame = NULL;
+	Camera *cameraHandle = NULL;
+	uint64_t allocations = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	Timestamp elapsed = 0;
+
+	/***** Synthetic YUYV replay file *****/
+	frame = (uint8_t *)malloc(frameSizeBytes);
+	if(frame == NULL || bench_replay_write(pathname, frame, frameSizeBytes) != 0)
+	{
+		fprintf(stderr, "capture: unable to create replay file\n");
+		goto end;
+	}
+
+	if(camera_create_replay(pathname, CAMERA_PIXELFORMAT_YUYV, BENCH_REPLAY_SIZE_X, BENCH_REPLAY_SIZE_Y, &cameraHandle) != R_SUCCESS || camera_start(cameraHandle) != R_SUCCESS)
+	{
+		fprintf(stderr, "capture: unable to start replay camera\n");
+		goto end;
+	}
+
+	/***** Dequeue, callback, requeue *****/
+	camera_capture_callback(bench_frame_touch, NULL, cameraHandle);
+	allocations = BENCH_ALLOCATIONS();
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		camera_capture_callback(bench_frame_touch, NULL, cameraHandle);
+	}
+	elapsed = timestamp_now() - timeStart;
+	bench_record("camera.capture_callback", "ns/frame", bench_per(elapsed, iterations), 1);
+
+	/***** Same plus a full frame copy *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations/10; ++index)
+	{
+		camera_capture_copy(frameSizeBytes, frame, cameraHandle);
+	}
+	elapsed = timestamp_now() - timeStart;
+	bench_record("camera.capture_copy", "ns/frame", bench_per(elapsed, iterations/10), 1);
+	bench_record("camera.capture_copy.throughput", "MB/s", (elapsed > 0) ? (double)frameSizeBytes*(iterations/10)*1e3/elapsed : 0.0, 0);
+	bench_record_allocations("camera.steady_state_allocations", BENCH_ALLOCATIONS() - allocations);
+
+end:
+	if(cameraHandle != NULL)
+	{
+		camera_stop(cameraHandle);
+		camera_destroy(&cameraHandle);
+	}
+	unlink(pathname);
+	free(frame);
+}
+/**************************************************/
+
+/********************----- Serial -----********************/
+static int bench_pty_open(char * const o_slavePathname, size_t const i_slavePathnameSizeBytes)
+{
+	int masterHandle = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if(masterHandle < 0 || grantpt(masterHandle) != 0 || unlockpt(masterHandle) != 0 || ptsname_r(masterHandle, o_slavePathname, i_slavePathnameSizeBytes) != 0)
+	{
+		if(masterHandle >= 0)
+		{
+			close(masterHandle);
+		}
+		return -1;
+	}
+
+	return masterHandle;
+}
+
+static int bench_fd_read_exact(int const i_fileHandle, uint8_t * const o_buffer, size_t const i_sizeBytes)
+{
+	size_t readBytes = 0;
+	ssize_t readResult = 0;
+	Timestamp const timeLimit = timestamp_now() + TIMESTAMP_NS_PER_SECOND;
+
+	while(readBytes < i_sizeBytes && timestamp_now() < timeLimit)
+	{
+		readResult = read(i_fileHandle, o_buffer + readBytes, i_sizeBytes - readBytes);
+		if(readResult > 0)
+		{
+			readBytes += (size_t)readResult;
+		}
+		else if(readResult < 0 && errno != EAGAIN)
+		{
+			return -1;
+		}
+	}
+
+	return (readBytes == i_sizeBytes) ? 0 : -1;
+}
+
+/* Waits up to a second for input, so a nonblocking read never comes back empty */
+static int bench_fd_wait(int const i_fileHandle)
+{
+	struct pollfd pollHandle;
+
+	pollHandle.fd = i_fileHandle;
+	pollHandle.events = POLLIN;
+	pollHandle.revents = 0;
+
+	return (poll(&pollHandle, 1, 1000) == 1 && (pollHandle.revents & POLLIN)) ? 0 : -1;
+}
+
+static void bench_serial(void)
+{
+	char slavePathname[128];
+	uint8_t chunk[1024];
+	uint8_t reply[1024];
+	uint64_t const iterations = g_scale*1000;
+	Serial *serialHandle = NULL;
+	uint64_t allocations = 0;
+	uint64_t index = 0;
+	size_t transferred = 0;
+	size_t received = 0;
+	Timestamp timeStart = 0;
+	Timestamp elapsed = 0;
+	int masterHandle = -1;
+	int serialFd = -1;
+
+	masterHandle = bench_pty_open(slavePathname, sizeof(slavePathname));
+	if(masterHandle < 0 || serial_create_path(slavePathname, SERIAL_BAUDRATE_115200, SERIAL_MODE_ARDUINO, &serialHandle) != R_SUCCESS || serial_fd(serialHandle, &serialFd) != R_SUCCESS)
+	{
+		fprintf(stderr, "serial: unable to open pty pair\n");
+		goto end;
+	}
+	memset(chunk, 'a', sizeof(chunk));
+
+	/***** serial_write throughput, drained from the master side *****/
+	allocations = BENCH_ALLOCATIONS();
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		if(serial_write(sizeof(chunk), chunk, &transferred, serialHandle) != R_SUCCESS || bench_fd_read_exact(masterHandle, reply, transferred) != 0)
+		{
+			fprintf(stderr, "serial: write path failed\n");
+			goto end;
+		}
+	}
+	elapsed = timestamp_now() - timeStart;
+	bench_record("serial.write_throughput", "MB/s", (elapsed > 0) ? (double)sizeof(chunk)*iterations*1e3/elapsed : 0.0, 0);
+
+	/***** 16 byte request/response round trip *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		if(serial_write(16, chunk, &transferred, serialHandle) != R_SUCCESS || transferred != 16 || bench_fd_read_exact(masterHandle, reply, 16) != 0 || write(masterHandle, reply, 16) != 16)
+		{
+			fprintf(stderr, "serial: round trip failed\n");
+			goto end;
+		}
+
+		/***** Poll first, so serial_read only runs when the reply is there and a failure is a real one *****/
+		received = 0;
+		while(received < 16)
+		{
+			transferred = 0;
+			if(bench_fd_wait(serialFd) != 0 || serial_read(16 - received, reply + received, &transferred, serialHandle) != R_SUCCESS)
+			{
+				fprintf(stderr, "serial: read path failed\n");
+				goto end;
+			}
+			received += transferred;
+		}
+	}
+	elapsed = timestamp_now() - timeStart;
+	bench_record("serial.round_trip_16", "ns/round_trip", bench_per(elapsed, iterations), 1);
+	bench_record_allocations("serial.steady_state_allocations", BENCH_ALLOCATIONS() - allocations);
+
+end:
+	serial_destroy(&serialHandle);
+	if(masterHandle >= 0)
+	{
+		close(masterHandle);
+	}
+}
+/**************************************************/
+
+/********************----- Logging -----********************/
+static void bench_logging(void)
+{
+	char pathname[] = "/tmp/carl_bench_log_XXXXXX";
+	uint64_t const iterations = g_scale*10000;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	Timestamp elapsed = 0;
+	int stderrHandle = -1;
+	int nullHandle = -1;
+	int fileHandle = -1;
+
+	/***** Text goes to /dev/null so the terminal is not what gets measured *****/
+	fflush(stderr);
+	stderrHandle = dup(STDERR_FILENO);
+	nullHandle = open("/dev/null", O_WRONLY);
+	if(stderrHandle < 0 || nullHandle < 0)
+	{
+		fprintf(stderr, "logging: unable to redirect stderr\n");
+		goto end;
+	}
+	dup2(nullHandle, STDERR_FILENO);
+	carl_log_rate_limit_set(0);
+
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		CARL_ERROR("bench %llu of %d", (unsigned long long)index, 42);
+	}
+	fflush(stderr);
+	dup2(stderrHandle, STDERR_FILENO);
+	bench_record("log.error_text_sync", "ns/call", bench_per(timestamp_now() - timeStart, iterations), 1);
+	dup2(nullHandle, STDERR_FILENO);
+
+	/***** Producer side of the async logger *****/
+	carl_log_start(65536, LOG_OVERFLOW_BLOCK);
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		CARL_ERROR("bench %llu of %d", (unsigned long long)index, 42);
+	}
+	elapsed = timestamp_now() - timeStart;
+	carl_log_stop();
+	dup2(stderrHandle, STDERR_FILENO);
+	bench_record("log.error_text_async", "ns/call", bench_per(elapsed, iterations), 1);
+	dup2(nullHandle, STDERR_FILENO);
+
+	/***** Binary records *****/
+	fileHandle = mkstemp(pathname);
+	if(fileHandle >= 0 && carl_log_binary_start(pathname) == R_SUCCESS)
+	{
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			CARL_ERROR("bench %llu of %d", (unsigned long long)index, 42);
+		}
+		carl_log_binary_stop();
+		dup2(stderrHandle, STDERR_FILENO);
+		bench_record("log.error_binary_sync", "ns/call", bench_per(timestamp_now() - timeStart, iterations), 1);
+	}
+
+end:
+	if(stderrHandle >= 0)
+	{
+		dup2(stderrHandle, STDERR_FILENO);
+		close(stderrHandle);
+	}
+	if(nullHandle >= 0)
+	{
+		close(nullHandle);
+	}
+	if(fileHandle >= 0)
+	{
+		close(fileHandle);
+		unlink(pathname);
+	}
+	carl_log_rate_limit_set(20);
+}
+/**************************************************/
+
+/********************----- Task Pool Scaling -----********************/
+struct BenchImage_s
+{
+	uint8_t *m_pixels;
+	size_t m_sizeX;
+};
+typedef struct BenchImage_s BenchImage;
+
+static void bench_image_tile(size_t const i_beginX, size_t const i_beginY, size_t const i_endX, size_t const i_endY, void * const i_taskData)
+{
+	BenchImage * const image = (BenchImage *)i_taskData;
+	size_t x = 0;
+	size_t y = 0;
+
+	for(y=i_beginY; y<i_endY; ++y)
+	{
+		uint8_t * const row = image->m_pixels + y*image->m_sizeX;
+
+		for(x=i_beginX; x<i_endX; ++x)
+		{
+			row[x] = (uint8_t)((row[x]*7 + (row[x] >> 3) + 13) ^ (uint8_t)x);
+		}
+	}
+}
+
+static void bench_task_pool(void)
+{
+	size_t const sizeX = 1920;
+	size_t const sizeY = 1080;
+	uint64_t const iterations = g_scale*20;
+	long const cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t const threadMax = (size_t)((cpuCount > 1) ? cpuCount : 2);
+	BenchImage image;
+	TaskPool *poolHandle = NULL;
+	char name[BENCH_NAME_LENGTH];
+	double timeSingle = 0.0;
+	double timeFrame = 0.0;
+	size_t threadCount = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+
+	image.m_sizeX = sizeX;
+	image.m_pixels = (uint8_t *)calloc(sizeX*sizeY, 1);
+	if(image.m_pixels == NULL)
+	{
+		return;
+	}
+
+	/***** 1, 2, 4 ... threads up to the CPU count *****/
+	for(threadCount=1; threadCount<=threadMax; threadCount=(threadCount*2 <= threadMax || threadCount == threadMax) ? threadCount*2 : threadMax)
+	{
+		if(task_pool_create(threadCount, NULL, &poolHandle) != R_SUCCESS)
+		{
+			break;
+		}
+		task_pool_parallel_for_tiles(sizeX, sizeY, 256, 64, bench_image_tile, &image, poolHandle);
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			task_pool_parallel_for_tiles(sizeX, sizeY, 256, 64, bench_image_tile, &image, poolHandle);
+		}
+		timeFrame = bench_per(timestamp_now() - timeStart, iterations);
+		task_pool_destroy(&poolHandle);
+
+		timeSingle = (threadCount == 1) ? timeFrame : timeSingle;
+		snprintf(name, sizeof(name), "task_pool.tiles_1080p.threads_%zu", threadCount);
+		bench_record(name, "ns/frame", timeFrame, 1);
+		snprintf(name, sizeof(name), "task_pool.speedup.threads_%zu", threadCount);
+		bench_record(name, "x", (timeFrame > 0.0) ? timeSingle/timeFrame : 0.0, 0);
+	}
+	g_sink += image.m_pixels[sizeX*sizeY/2];
+	free(image.m_pixels);
+}
+/**************************************************/
+
+/********************----- Vision -----********************/
+/* YUYV test scene: textured background with i_blobCount colored rectangles */
+static void bench_scene_yuyv(size_t const i_sizeX, size_t const i_sizeY, size_t const i_blobCount, uint8_t * const o_frame)
+{
+	size_t blobIndex = 0;
+	size_t x = 0;
+	size_t y = 0;
+	uint32_t seed = 12345;
+
+	for(y=0; y<i_sizeY; ++y)
+	{
+		for(x=0; x<i_sizeX; x+=2)
+		{
+			uint8_t * const macropixel = o_frame + (y*i_sizeX + x)*2;
+
+			seed = seed*1103515245 + 12345;
+			macropixel[0] = (uint8_t)(96 + ((seed >> 16) & 31));
+			macropixel[1] = (uint8_t)(120 + ((seed >> 21) & 15));
+			macropixel[2] = (uint8_t)(96 + ((seed >> 24) & 31));
+			macropixel[3] = (uint8_t)(120 + ((seed >> 12) & 15));
+		}
+	}
+
+	for(blobIndex=0; blobIndex<i_blobCount; ++blobIndex)
+	{
+		size_t const blobX = (blobIndex*7919 % (i_sizeX - 32)) & ~(size_t)1;
+		size_t const blobY = blobIndex*104729 % (i_sizeY - 24);
+		size_t const blobSizeX = 8 + (blobIndex*13 % 24);
+		size_t const blobSizeY = 6 + (blobIndex*17 % 18);
+
+		for(y=blobY; y<blobY+blobSizeY; ++y)
+		{
+			for(x=blobX; x<blobX+blobSizeX; x+=2)
+			{
+				uint8_t * const macropixel = o_frame + (y*i_sizeX + x)*2;
+
+				macropixel[0] = 160;
+				macropixel[1] = (blobIndex % 2 == 0) ? 60 : 200;
+				macropixel[2] = 160;
+				macropixel[3] = (blobIndex % 2 == 0) ? 200 : 60;
+			}
+		}
+	}
+}
+
+static void bench_segmenter(void)
+{
+	size_t const sizeX = 640;
+	size_t const sizeY = 480;
+	size_t const frameSizeBytes = sizeX*sizeY*2;
+	uint64_t const iterations = g_scale*100;
+	SegmenterClass const classes[] = {{128, 255, 40, 90, 180, 230}, {128, 255, 180, 230, 40, 90}, {0, 64, 0, 255, 0, 255}, {230, 255, 100, 156, 100, 156}};
+	uint8_t *frame = NULL;
+	uint8_t *mask = NULL;
+	Segmenter *segmenterHandle = NULL;
+	SegmenterRuns runs;
+	TaskPool *poolHandle = NULL;
+	size_t classIndex = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	Timestamp elapsed = 0;
+
+	CLEAR(runs);
+	frame = (uint8_t *)malloc(frameSizeBytes);
+	mask = (uint8_t *)malloc(sizeX*sizeY);
+	if(frame == NULL || mask == NULL || segmenter_create(CAMERA_PIXELFORMAT_YUYV, sizeX, sizeY, 0, &segmenterHandle) != R_SUCCESS || segmenter_runs_map(sizeX*sizeY/4, sizeY, &runs) != R_SUCCESS)
+	{
+		fprintf(stderr, "segmenter: setup failed\n");
+		goto end;
+	}
+	for(classIndex=0; classIndex<sizeof(classes)/sizeof(classes[0]); ++classIndex)
+	{
+		segmenter_class_add(&classes[classIndex], NULL, segmenterHandle);
+	}
+	bench_scene_yuyv(sizeX, sizeY, 64, frame);
+
+	/***** Four classes, one mask byte per pixel *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		segmenter_mask(frame, frameSizeBytes, mask, NULL, segmenterHandle);
+	}
+	elapsed = timestamp_now() - timeStart;
+	bench_record("segmenter.mask_640x480", "ns/frame", bench_per(elapsed, iterations), 1);
+	bench_record("segmenter.mask_640x480.throughput", "Mpixel/s", (elapsed > 0) ? (double)sizeX*sizeY*iterations*1e3/elapsed : 0.0, 0);
+
+	/***** Straight to runs, serial and on a pool *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		segmenter_runs(frame, frameSizeBytes, &runs, NULL, segmenterHandle);
+	}
+	bench_record("segmenter.runs_640x480", "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+
+	if(task_pool_create(0, NULL, &poolHandle) == R_SUCCESS)
+	{
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			segmenter_runs(frame, frameSizeBytes, &runs, poolHandle, segmenterHandle);
+		}
+		bench_record("segmenter.runs_640x480.pool", "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+		task_pool_destroy(&poolHandle);
+	}
+
+end:
+	segmenter_runs_unmap(&runs);
+	segmenter_destroy(&segmenterHandle);
+	free(mask);
+	free(frame);
+}
+static void bench_blob_finder(void)
+{
+	size_t const sizes[][2] = {{640, 480}, {1280, 720}};
+	size_t const blobCounts[] = {16, 256};
+	SegmenterClass const classes[] = {{128, 255, 40, 90, 180, 230}, {128, 255, 180, 230, 40, 90}};
+	uint64_t const iterations = g_scale*100;
+	Blob blobs[64];
+	char name[BENCH_NAME_LENGTH];
+	uint8_t *frame = NULL;
+	Segmenter *segmenterHandle = NULL;
+	BlobFinder *finderHandle = NULL;
+	SegmenterRuns runs;
+	size_t sizeIndex = 0;
+	size_t countIndex = 0;
+	size_t blobCount = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+
+	for(sizeIndex=0; sizeIndex<sizeof(sizes)/sizeof(sizes[0]); ++sizeIndex)
+	{
+		size_t const sizeX = sizes[sizeIndex][0];
+		size_t const sizeY = sizes[sizeIndex][1];
+
+		CLEAR(runs);
+		frame = (uint8_t *)malloc(sizeX*sizeY*2);
+		if(frame == NULL || segmenter_create(CAMERA_PIXELFORMAT_YUYV, sizeX, sizeY, 0, &segmenterHandle) != R_SUCCESS || segmenter_runs_map(sizeX*sizeY/4, sizeY, &runs) != R_SUCCESS || blob_finder_create(sizeX*sizeY/4, &finderHandle) != R_SUCCESS)
+		{
+			fprintf(stderr, "blob_finder: setup failed\n");
+			goto next;
+		}
+		segmenter_class_add(&classes[0], NULL, segmenterHandle);
+		segmenter_class_add(&classes[1], NULL, segmenterHandle);
+
+		/***** Labeling and statistics only; the runs are made once *****/
+		for(countIndex=0; countIndex<sizeof(blobCounts)/sizeof(blobCounts[0]); ++countIndex)
+		{
+			bench_scene_yuyv(sizeX, sizeY, blobCounts[countIndex], frame);
+			segmenter_runs(frame, sizeX*sizeY*2, &runs, NULL, segmenterHandle);
+
+			timeStart = timestamp_now();
+			for(index=0; index<iterations; ++index)
+			{
+				blob_finder_find(&runs, 0x03, 4, blobs, sizeof(blobs)/sizeof(blobs[0]), &blobCount, NULL, finderHandle);
+			}
+			snprintf(name, sizeof(name), "blob_finder.%zux%zu.blobs_%zu", sizeX, sizeY, blobCounts[countIndex]);
+			bench_record(name, "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+			g_sink += blobCount;
+		}
+
+next:
+		blob_finder_destroy(&finderHandle);
+		segmenter_runs_unmap(&runs);
+		segmenter_destroy(&segmenterHandle);
+		free(frame);
+		frame = NULL;
+	}
+}
+static void bench_remap(void)
+{
+	size_t const sizeX = 1280;
+	size_t const sizeY = 720;
+	RemapIntrinsics const intrinsics = {700.0, 700.0, 640.0, 360.0, -0.28, 0.07, 0.0005, -0.0003, 0.0};
+	RemapInterpolation const interpolations[] = {REMAP_INTERPOLATION_NEAREST, REMAP_INTERPOLATION_BILINEAR};
+	char const * const interpolationNames[] = {"nearest", "bilinear"};
+	uint64_t const iterations = g_scale*20;
+	char name[BENCH_NAME_LENGTH];
+	uint8_t *frame = NULL;
+	uint8_t *output = NULL;
+	Remap *remapHandle = NULL;
+	size_t interpolationIndex = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+
+	frame = (uint8_t *)malloc(sizeX*sizeY*2);
+	output = (uint8_t *)malloc(sizeX*sizeY*2);
+	if(frame == NULL || output == NULL)
+	{
+		goto end;
+	}
+	bench_scene_yuyv(sizeX, sizeY, 64, frame);
+
+	for(interpolationIndex=0; interpolationIndex<sizeof(interpolations)/sizeof(interpolations[0]); ++interpolationIndex)
+	{
+		if(remap_create_undistort(&intrinsics, sizeX, sizeY, interpolations[interpolationIndex], 1, &remapHandle) != R_SUCCESS)
+		{
+			fprintf(stderr, "remap: setup failed\n");
+			goto end;
+		}
+
+		/***** Luma plane, then the packed frame it came from *****/
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			remap_luma(frame, sizeX*sizeY*2, 0, output, NULL, remapHandle);
+		}
+		snprintf(name, sizeof(name), "remap.luma_1280x720.%s", interpolationNames[interpolationIndex]);
+		bench_record(name, "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			remap_packed(frame, sizeX*sizeY*2, 0, CAMERA_PIXELFORMAT_YUYV, output, NULL, remapHandle);
+		}
+		snprintf(name, sizeof(name), "remap.yuyv_1280x720.%s", interpolationNames[interpolationIndex]);
+		bench_record(name, "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+		remap_destroy(&remapHandle);
+	}
+
+end:
+	remap_destroy(&remapHandle);
+	free(output);
+	free(frame);
+}
+/* Times are also reported as a share of the 33.3ms frame period at 30fps */
+static void bench_features(void)
+{
+	size_t const sizeX = 1280;
+	size_t const sizeY = 720;
+	size_t const cornerCountMax = 2000;
+	double const framePeriodNs = 1e9/30.0;
+	uint64_t const iterations = g_scale*20;
+	uint8_t *frame = NULL;
+	uint8_t *luma = NULL;
+	uint8_t *output = NULL;
+	uint32_t *integral = NULL;
+	FeatureCorner *corners = NULL;
+	FeatureDetector *detectorHandle = NULL;
+	size_t cornerCount = 0;
+	size_t pixel = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	double fastNs = 0.0;
+	double integralNs = 0.0;
+	double boxNs = 0.0;
+
+	frame = (uint8_t *)malloc(sizeX*sizeY*2);
+	luma = (uint8_t *)malloc(sizeX*sizeY);
+	output = (uint8_t *)malloc(sizeX*sizeY);
+	integral = (uint32_t *)malloc((sizeX + 1)*(sizeY + 1)*sizeof(uint32_t));
+	corners = (FeatureCorner *)malloc(cornerCountMax*sizeof(FeatureCorner));
+	if(frame == NULL || luma == NULL || output == NULL || integral == NULL || corners == NULL || feature_detector_create(sizeX, sizeY, 32, 4, &detectorHandle) != R_SUCCESS)
+	{
+		fprintf(stderr, "features: setup failed\n");
+		goto end;
+	}
+	bench_scene_yuyv(sizeX, sizeY, 64, frame);
+	for(pixel=0; pixel<sizeX*sizeY; ++pixel)
+	{
+		luma[pixel] = frame[2*pixel];
+	}
+
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		feature_detector_fast(luma, sizeX, 20, corners, cornerCountMax, &cornerCount, NULL, detectorHandle);
+	}
+	fastNs = bench_per(timestamp_now() - timeStart, iterations);
+	bench_record("features.fast9_1280x720", "ns/frame", fastNs, 1);
+	bench_record("features.fast9_1280x720.corners", "count", (double)cornerCount, 0);
+
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		integral_image(luma, sizeX, sizeX, sizeY, integral);
+	}
+	integralNs = bench_per(timestamp_now() - timeStart, iterations);
+	bench_record("features.integral_1280x720", "ns/frame", integralNs, 1);
+
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		integral_box_filter(integral, sizeX, sizeY, 3, output, NULL);
+	}
+	boxNs = bench_per(timestamp_now() - timeStart, iterations);
+	bench_record("features.box7x7_1280x720", "ns/frame", boxNs, 1);
+	bench_record("features.frame_budget_30fps", "%", 100.0*(fastNs + integralNs + boxNs)/framePeriodNs, 1);
+	g_sink += cornerCount + output[sizeX*sizeY/2];
+
+end:
+	feature_detector_destroy(&detectorHandle);
+	free(corners);
+	free(integral);
+	free(output);
+	free(luma);
+	free(frame);
+}
+/* 640x480 pair with the right view shifted 8 pixels, swept over the disparity search range */
+static void bench_stereo(void)
+{
+	size_t const sizeX = 640;
+	size_t const sizeY = 480;
+	uint32_t const disparityCounts[] = {32, 64, 128};
+	StereoCost const costs[] = {STEREO_COST_SAD, STEREO_COST_CENSUS};
+	char const * const costNames[] = {"sad", "census"};
+	uint64_t const iterations = MAX(g_scale/2, 1);
+	char name[BENCH_NAME_LENGTH];
+	uint8_t *frame = NULL;
+	uint8_t *left = NULL;
+	uint8_t *right = NULL;
+	int16_t *disparity = NULL;
+	Stereo *stereoHandle = NULL;
+	size_t costIndex = 0;
+	size_t countIndex = 0;
+	size_t pixel = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+	double frameNs = 0.0;
+
+	frame = (uint8_t *)malloc(sizeX*sizeY*2);
+	left = (uint8_t *)malloc(sizeX*sizeY);
+	right = (uint8_t *)malloc(sizeX*sizeY);
+	disparity = (int16_t *)malloc(sizeX*sizeY*sizeof(int16_t));
+	if(frame == NULL || left == NULL || right == NULL || disparity == NULL)
+	{
+		goto end;
+	}
+	bench_scene_yuyv(sizeX, sizeY, 64, frame);
+	for(pixel=0; pixel<sizeX*sizeY; ++pixel)
+	{
+		left[pixel] = frame[2*pixel];
+		right[pixel] = (pixel%sizeX + 8 < sizeX) ? frame[2*(pixel + 8)] : 0;
+	}
+
+	for(costIndex=0; costIndex<sizeof(costs)/sizeof(costs[0]); ++costIndex)
+	{
+		for(countIndex=0; countIndex<sizeof(disparityCounts)/sizeof(disparityCounts[0]); ++countIndex)
+		{
+			if(stereo_create(sizeX, sizeY, disparityCounts[countIndex], 3, costs[costIndex], 1, &stereoHandle) != R_SUCCESS)
+			{
+				fprintf(stderr, "stereo: setup failed\n");
+				goto end;
+			}
+
+			timeStart = timestamp_now();
+			for(index=0; index<iterations; ++index)
+			{
+				stereo_disparity(left, right, sizeX, disparity, NULL, stereoHandle);
+			}
+			frameNs = bench_per(timestamp_now() - timeStart, iterations);
+			snprintf(name, sizeof(name), "stereo.%s_640x480.disparities_%u", costNames[costIndex], disparityCounts[countIndex]);
+			bench_record(name, "ns/frame", frameNs, 1);
+			snprintf(name, sizeof(name), "stereo.%s_640x480.disparities_%u.fps", costNames[costIndex], disparityCounts[countIndex]);
+			bench_record(name, "fps", 1e9/frameNs, 0);
+			g_sink += (uint64_t)disparity[sizeX*sizeY/2];
+			stereo_destroy(&stereoHandle);
+		}
+	}
+
+end:
+	stereo_destroy(&stereoHandle);
+	free(disparity);
+	free(right);
+	free(left);
+	free(frame);
+}
+/* 1kHz IMU samples in a 4096 ring; frames look up times spread over the last second */
+static void bench_fusion(void)
+{
+	size_t const sampleCount = 4096;
+	uint64_t const iterations = g_scale*100000;
+	Fusion *fusionHandle = NULL;
+	FusionSample sample;
+	uint64_t index = 0;
+	uint64_t allocations = 0;
+	Timestamp timeStart = 0;
+
+	if(fusion_create(sampleCount, FUSION_OFFSET_MINIMUM, 32, &fusionHandle) != R_SUCCESS)
+	{
+		fprintf(stderr, "fusion: setup failed\n");
+		return;
+	}
+	CLEAR(sample);
+
+	allocations = BENCH_ALLOCATIONS();
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		sample.m_timestamp = (index + 1)*TIMESTAMP_NS_PER_MS;
+		sample.m_values[0] = (float)index;
+		fusion_push(&sample, fusionHandle);
+	}
+	bench_record("fusion.push", "ns/sample", bench_per(timestamp_now() - timeStart, iterations), 1);
+
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		fusion_offset_observe(index*33*TIMESTAMP_NS_PER_MS, index*33*TIMESTAMP_NS_PER_MS + 4*TIMESTAMP_NS_PER_MS, fusionHandle);
+		fusion_interpolate((iterations - 1000 + index%997)*TIMESTAMP_NS_PER_MS + 500, &sample, fusionHandle);
+		g_sink += (uint64_t)sample.m_values[0];
+	}
+	bench_record("fusion.observe_interpolate", "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+	bench_record_allocations("fusion.steady_state_allocations", BENCH_ALLOCATIONS() - allocations);
+
+	fusion_destroy(&fusionHandle);
+}
+/* 720p luma and packed conversions from each capture format; GREY in place is the zero-copy baseline */
+static void bench_convert(void)
+{
+	uint32_t const sizeX = 1280;
+	uint32_t const sizeY = 720;
+	PixelFormat const formats[] = {CAMERA_PIXELFORMAT_YUYV, CAMERA_PIXELFORMAT_GREY, CAMERA_PIXELFORMAT_Y16, CAMERA_PIXELFORMAT_NV12};
+	char const * const formatNames[] = {"yuyv", "grey", "y16", "nv12"};
+	uint64_t const iterations = g_scale*50;
+	char name[BENCH_NAME_LENGTH];
+	CameraFrameLayout layout;
+	uint8_t *frame = NULL;
+	uint8_t *output = NULL;
+	size_t formatIndex = 0;
+	size_t pixel = 0;
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+
+	frame = (uint8_t *)malloc((size_t)sizeX*sizeY*2);
+	output = (uint8_t *)malloc((size_t)sizeX*sizeY*2);
+	if(frame == NULL || output == NULL)
+	{
+		goto end;
+	}
+	for(pixel=0; pixel<(size_t)sizeX*sizeY*2; ++pixel)
+	{
+		frame[pixel] = (uint8_t)(pixel*7);
+	}
+
+	for(formatIndex=0; formatIndex<sizeof(formats)/sizeof(formats[0]); ++formatIndex)
+	{
+		if(camera_frame_layout(formats[formatIndex], sizeX, sizeY, 0, &layout) != R_SUCCESS)
+		{
+			fprintf(stderr, "convert: setup failed\n");
+			goto end;
+		}
+		snprintf(name, sizeof(name), "convert.%s_720p.frame_bytes", formatNames[formatIndex]);
+		bench_record(name, "bytes", (double)layout.m_sizeBytes, 1);
+
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			convert_luma(frame, layout.m_sizeBytes, &layout, output, NULL);
+		}
+		snprintf(name, sizeof(name), "convert.%s_720p.luma", formatNames[formatIndex]);
+		bench_record(name, "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			convert_yuyv(frame, layout.m_sizeBytes, &layout, output, NULL);
+		}
+		snprintf(name, sizeof(name), "convert.%s_720p.yuyv", formatNames[formatIndex]);
+		bench_record(name, "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+		g_sink += output[sizeX*sizeY/2];
+	}
+
+end:
+	free(output);
+	free(frame);
+}
+/* Four consumers per 720p YUYV frame (two tracking luma, display RGB, recording half) with and without the shared view */
+static void bench_frame_view_consumers(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, FrameView * const io_viewHandle, void * const i_callbackData)
+{
+	uint8_t const *data = NULL;
+	FrameViewFormat const formats[] = {FRAME_VIEW_LUMA, FRAME_VIEW_LUMA, FRAME_VIEW_RGB, FRAME_VIEW_HALF};
+	size_t index = 0;
+
+	(void)i_frameData;
+	(void)i_frameSizeBytes;
+	(void)i_callbackData;
+	for(index=0; index<sizeof(formats)/sizeof(formats[0]); ++index)
+	{
+		if(frame_view_get(formats[index], &data, NULL, io_viewHandle) == R_SUCCESS)
+		{
+			g_sink += data[0];
+		}
+	}
+}
+
+static void bench_frame_view(void)
+{
+	uint32_t const sizeX = 1280;
+	uint32_t const sizeY = 720;
+	uint64_t const iterations = g_scale*20;
+	CameraFrameLayout layout;
+	FrameView *viewHandle = NULL;
+	uint8_t *frame = NULL;
+	uint8_t *luma = NULL;
+	uint8_t *rgb = NULL;
+	uint8_t *half = NULL;
+	uint64_t index = 0;
+	uint64_t allocations = 0;
+	Timestamp timeStart = 0;
+
+	frame = (uint8_t *)malloc((size_t)sizeX*sizeY*2);
+	luma = (uint8_t *)malloc((size_t)sizeX*sizeY);
+	rgb = (uint8_t *)malloc((size_t)sizeX*sizeY*3);
+	half = (uint8_t *)malloc((size_t)sizeX*sizeY/4);
+	if(frame == NULL || luma == NULL || rgb == NULL || half == NULL || camera_frame_layout(CAMERA_PIXELFORMAT_YUYV, sizeX, sizeY, 0, &layout) != R_SUCCESS || frame_view_create(&layout, FRAME_VIEW_FORMAT_BIT(FRAME_VIEW_LUMA) | FRAME_VIEW_FORMAT_BIT(FRAME_VIEW_RGB) | FRAME_VIEW_FORMAT_BIT(FRAME_VIEW_HALF), 2, bench_frame_view_consumers, NULL, &viewHandle) != R_SUCCESS)
+	{
+		fprintf(stderr, "frame_view: setup failed\n");
+		goto end;
+	}
+	bench_scene_yuyv(sizeX, sizeY, 64, frame);
+
+	/***** Every consumer converts the raw frame itself *****/
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		convert_luma(frame, layout.m_sizeBytes, &layout, luma, NULL);
+		convert_luma(frame, layout.m_sizeBytes, &layout, luma, NULL);
+		convert_rgb(frame, layout.m_sizeBytes, &layout, rgb, NULL);
+		convert_luma(frame, layout.m_sizeBytes, &layout, luma, NULL);
+		convert_half(luma, sizeX, sizeX, sizeY, half, NULL);
+		g_sink += luma[0] + rgb[0] + half[0];
+	}
+	bench_record("frame_view.per_consumer_720p", "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+
+	allocations = BENCH_ALLOCATIONS();
+	timeStart = timestamp_now();
+	for(index=0; index<iterations; ++index)
+	{
+		frame_view_camera_callback(frame, layout.m_sizeBytes, viewHandle);
+	}
+	bench_record("frame_view.shared_720p", "ns/frame", bench_per(timestamp_now() - timeStart, iterations), 1);
+	bench_record_allocations("frame_view.steady_state_allocations", BENCH_ALLOCATIONS() - allocations);
+
+end:
+	frame_view_destroy(&viewHandle);
+	free(half);
+	free(rgb);
+	free(luma);
+	free(frame);
+}
+/**************************************************/
+
+/********************----- C++ Wrapper -----********************/
+/* bench/carl_bench_cpp.cpp runs the same loops through carl.hpp */
+extern Timestamp bench_cpp_capture(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations, uint64_t volatile * const io_sink);
+extern Timestamp bench_cpp_create(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations);
+
+static void bench_cpp(void)
+{
+	char pathname[] = "/tmp/carl_bench_replay_XXXXXX";
+	size_t const frameSizeBytes = (size_t)BENCH_REPLAY_SIZE_X*BENCH_REPLAY_SIZE_Y*2;
+	uint64_t const iterations = g_scale*10000;
+	uint64_t const createIterations = g_scale*10;
+	uint8_t *frame = NULL;
+	Camera *cameraHandle = NULL;
+	uint64_t index = 0;
+	uint64_t round = 0;
+	Timestamp timeStart = 0;
+	Timestamp bestC = UINT64_MAX;
+	Timestamp bestCpp = UINT64_MAX;
+	Timestamp createC = UINT64_MAX;
+	Timestamp createCpp = UINT64_MAX;
+
+	frame = (uint8_t *)malloc(frameSizeBytes);
+	if(frame == NULL || bench_replay_write(pathname, frame, frameSizeBytes) != 0)
+	{
+		fprintf(stderr, "cpp: unable to create replay file\n");
+		goto end;
+	}
+	if(camera_create_replay(pathname, CAMERA_PIXELFORMAT_YUYV, BENCH_REPLAY_SIZE_X, BENCH_REPLAY_SIZE_Y, &cameraHandle) != R_SUCCESS || camera_start(cameraHandle) != R_SUCCESS)
+	{
+		fprintf(stderr, "cpp: unable to start replay camera\n");
+		goto end;
+	}
+
+	/***** Rounds alternate so both sides see the same machine state; best of each is kept *****/
+	camera_capture_callback(bench_frame_touch, NULL, cameraHandle);
+	for(round=0; round<3; ++round)
+	{
+		timeStart = timestamp_now();
+		for(index=0; index<iterations; ++index)
+		{
+			camera_capture_callback(bench_frame_touch, NULL, cameraHandle);
+		}
+		bestC = MIN(bestC, timestamp_now() - timeStart);
+		bestCpp = MIN(bestCpp, bench_cpp_capture(pathname, BENCH_REPLAY_SIZE_X, BENCH_REPLAY_SIZE_Y, iterations, &g_sink));
+
+		timeStart = timestamp_now();
+		for(index=0; index<createIterations; ++index)
+		{
+			Camera *createHandle = NULL;
+
+			camera_create_replay(pathname, CAMERA_PIXELFORMAT_YUYV, BENCH_REPLAY_SIZE_X, BENCH_REPLAY_SIZE_Y, &createHandle);
+			camera_destroy(&createHandle);
+		}
+		createC = MIN(createC, timestamp_now() - timeStart);
+		createCpp = MIN(createCpp, bench_cpp_create(pathname, BENCH_REPLAY_SIZE_X, BENCH_REPLAY_SIZE_Y, createIterations));
+	}
+	bench_record("cpp.capture_c", "ns/frame", bench_per(bestC, iterations), 1);
+	bench_record("cpp.capture_wrapper", "ns/frame", bench_per(bestCpp, iterations), 1);
+	bench_record("cpp.create_destroy_c", "ns/camera", bench_per(createC, createIterations), 1);
+	bench_record("cpp.create_destroy_wrapper", "ns/camera", bench_per(createCpp, createIterations), 1);
+
+end:
+	if(cameraHandle != NULL)
+	{
+		camera_stop(cameraHandle);
+		camera_destroy(&cameraHandle);
+	}
+	unlink(pathname);
+	free(frame);
+}
+/**************************************************/
+
+/********************----- Reactor vs Thread Per Device -----********************/
+struct BenchDevice_s
+{
+	int m_timerHandle;
+	uint64_t m_events;
+	uint64_t m_eventsMax;
+};
+typedef struct BenchDevice_s BenchDevice;
+
+static int bench_device_timer(Timestamp const i_period)
+{
+	struct itimerspec timerSpec;
+	int const timerHandle = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+	if(timerHandle >= 0)
+	{
+		CLEAR(timerSpec);
+		timestamp_to_timespec(i_period, &timerSpec.it_value);
+		timestamp_to_timespec(i_period, &timerSpec.it_interval);
+		timerfd_settime(timerHandle, 0, &timerSpec, NULL);
+	}
+
+	return timerHandle;
+}
+
+static void *bench_device_thread(void *io_data)
+{
+	BenchDevice * const device = (BenchDevice *)io_data;
+	uint64_t expirations = 0;
+
+	while(device->m_events < device->m_eventsMax && read(device->m_timerHandle, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations))
+	{
+		device->m_events += expirations;
+	}
+
+	return NULL;
+}
+
+static void bench_device_event(uint64_t const i_expirations, void * const i_callbackData)
+{
+	uint64_t * const events = (uint64_t *)i_callbackData;
+
+	(*events) += i_expirations;
+}
+
+static void bench_reactor(void)
+{
+	Timestamp const period = TIMESTAMP_NS_PER_MS;
+	uint64_t const eventsPerDevice = g_scale*20;
+	BenchDevice devices[BENCH_DEVICE_COUNT];
+	pthread_t threads[BENCH_DEVICE_COUNT];
+	EventLoop *loopHandle = NULL;
+	uint64_t switches = 0;
+	uint64_t events = 0;
+	size_t deviceIndex = 0;
+
+	/***** One blocking thread per device *****/
+	switches = bench_context_switches();
+	for(deviceIndex=0; deviceIndex<BENCH_DEVICE_COUNT; ++deviceIndex)
+	{
+		devices[deviceIndex].m_timerHandle = bench_device_timer(period);
+		devices[deviceIndex].m_events = 0;
+		devices[deviceIndex].m_eventsMax = eventsPerDevice;
+		pthread_create(&threads[deviceIndex], NULL, bench_device_thread, &devices[deviceIndex]);
+	}
+	for(deviceIndex=0; deviceIndex<BENCH_DEVICE_COUNT; ++deviceIndex)
+	{
+		pthread_join(threads[deviceIndex], NULL);
+		events += devices[deviceIndex].m_events;
+		close(devices[deviceIndex].m_timerHandle);
+	}
+	switches = bench_context_switches() - switches;
+	bench_record("reactor.thread_per_device.threads", "threads", BENCH_DEVICE_COUNT, 1);
+	bench_record("reactor.thread_per_device.switches_per_event", "switches/event", (double)switches/(double)MAX(events, 1), 1);
+
+	/***** The same devices on one event loop *****/
+	if(event_loop_create(&loopHandle) != R_SUCCESS)
+	{
+		return;
+	}
+	events = 0;
+	for(deviceIndex=0; deviceIndex<BENCH_DEVICE_COUNT; ++deviceIndex)
+	{
+		event_loop_timer_add(period, bench_device_event, &events, NULL, loopHandle);
+	}
+	switches = bench_context_switches();
+	while(events < eventsPerDevice*BENCH_DEVICE_COUNT)
+	{
+		event_loop_run_once(-1, loopHandle);
+	}
+	switches = bench_context_switches() - switches;
+	event_loop_destroy(&loopHandle);
+	bench_record("reactor.event_loop.threads", "threads", 1, 1);
+	bench_record("reactor.event_loop.switches_per_event", "switches/event", (double)switches/(double)MAX(events, 1), 1);
+}
+/**************************************************/
+
+/********************----- Output -----********************/
+static void bench_baseline_load(char const * const i_pathname)
+{
+	FILE *fileHandle = fopen(i_pathname, "r");
+	char line[512];
+	char name[BENCH_NAME_LENGTH];
+	char *field = NULL;
+	size_t nameLength = 0;
+	size_t resultIndex = 0;
+
+	if(fileHandle == NULL)
+	{
+		fprintf(stderr, "baseline: unable to open %s\n", i_pathname);
+		return;
+	}
+
+	/***** One result per line, as bench_write emits them *****/
+	while(fgets(line, sizeof(line), fileHandle) != NULL)
+	{
+		field = strstr(line, "\"name\": \"");
+		if(field == NULL)
+		{
+			continue;
+		}
+		field += strlen("\"name\": \"");
+		nameLength = strcspn(field, "\"");
+		if(nameLength >= sizeof(name))
+		{
+			continue;
+		}
+		memcpy(name, field, nameLength);
+		name[nameLength] = '\0';
+
+		field = strstr(line, "\"value\": ");
+		if(field == NULL)
+		{
+			continue;
+		}
+		for(resultIndex=0; resultIndex<g_resultCount; ++resultIndex)
+		{
+			if(strcmp(g_results[resultIndex].m_name, name) == 0)
+			{
+				g_results[resultIndex].m_baselineFound = 1;
+				g_results[resultIndex].m_baselineValue = strtod(field + strlen("\"value\": "), NULL);
+			}
+		}
+	}
+	fclose(fileHandle);
+}
+
+static int bench_compare(double const i_thresholdPercent)
+{
+	BenchResult const *result = NULL;
+	size_t resultIndex = 0;
+	double change = 0.0;
+	int regressions = 0;
+
+	fprintf(stderr, "\n%-44s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+	for(resultIndex=0; resultIndex<g_resultCount; ++resultIndex)
+	{
+		result = &g_results[resultIndex];
+		if(!result->m_baselineFound)
+		{
+			fprintf(stderr, "%-44s %14s %14.2f %9s\n", result->m_name, "-", result->m_value, "new");
+			continue;
+		}
+
+		/***** Positive change is always an improvement *****/
+		change = (result->m_baselineValue != 0.0) ? (result->m_value - result->m_baselineValue)/result->m_baselineValue*100.0 : 0.0;
+		change = result->m_lowerIsBetter ? -change : change;
+		if(result->m_baselineValue == 0.0 && result->m_lowerIsBetter && result->m_value > 0.0)
+		{
+			change = -100.0;
+		}
+		fprintf(stderr, "%-44s %14.2f %14.2f %+8.1f%%%s\n", result->m_name, result->m_baselineValue, result->m_value, change, (change < -i_thresholdPercent) ? "  REGRESSION" : "");
+		regressions += (change < -i_thresholdPercent);
+	}
+
+	return regressions;
+}
+
+static int bench_write(char const * const i_pathname)
+{
+	FILE *fileHandle = stdout;
+	BenchResult const *result = NULL;
+	size_t resultIndex = 0;
+
+	if(i_pathname != NULL)
+	{
+		fileHandle = fopen(i_pathname, "w");
+		if(fileHandle == NULL)
+		{
+			perror(i_pathname);
+			return -1;
+		}
+	}
+
+	fprintf(fileHandle, "{\n  \"timestamp_source\": \"monotonic\",\n  \"scale\": %llu,\n  \"benchmarks\": [\n", (unsigned long long)g_scale);
+	for(resultIndex=0; resultIndex<g_resultCount; ++resultIndex)
+	{
+		result = &g_results[resultIndex];
+		fprintf(fileHandle, "    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.4f, \"lower_is_better\": %s", result->m_name, result->m_unit, result->m_value, result->m_lowerIsBetter ? "true" : "false");
+		if(result->m_baselineFound)
+		{
+			fprintf(fileHandle, ", \"baseline\": %.4f", result->m_baselineValue);
+		}
+		fprintf(fileHandle, "}%s\n", (resultIndex+1 < g_resultCount) ? "," : "");
+	}
+	fprintf(fileHandle, "  ]\n}\n");
+
+	if(fileHandle != stdout)
+	{
+		fclose(fileHandle);
+	}
+
+	return 0;
+}
+/**************************************************/
+
+int main(int argc, char **argv)
+{
+	char const *outputPathname = NULL;
+	char const *baselinePathname = NULL;
+	double thresholdPercent = 10.0;
+	long repeatCount = 1;
+	long repeatIndex = 0;
+	int argumentIndex = 0;
+	int regressions = 0;
+
+	for(argumentIndex=1; argumentIndex<argc; ++argumentIndex)
+	{
+		if(strcmp(argv[argumentIndex], "--output") == 0 && argumentIndex+1 < argc)
+		{
+			outputPathname = argv[++argumentIndex];
+		}
+		else if(strcmp(argv[argumentIndex], "--baseline") == 0 && argumentIndex+1 < argc)
+		{
+			baselinePathname = argv[++argumentIndex];
+		}
+		else if(strcmp(argv[argumentIndex], "--threshold") == 0 && argumentIndex+1 < argc)
+		{
+			thresholdPercent = strtod(argv[++argumentIndex], NULL);
+		}
+		else if(strcmp(argv[argumentIndex], "--filter") == 0 && argumentIndex+1 < argc)
+		{
+			g_filter = argv[++argumentIndex];
+		}
+		else if(strcmp(argv[argumentIndex], "--repeat") == 0 && argumentIndex+1 < argc)
+		{
+			repeatCount = strtol(argv[++argumentIndex], NULL, 10);
+			repeatCount = MAX(repeatCount, 1);
+		}
+		else if(strcmp(argv[argumentIndex], "--quick") == 0)
+		{
+			g_scale = 1;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--output results.json] [--baseline baseline.json] [--threshold percent] [--filter group] [--repeat count] [--quick]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for(repeatIndex=0; repeatIndex<repeatCount; ++repeatIndex)
+	{
+		if(bench_enabled("timing"))
+		{
+			bench_timing();
+		}
+		if(bench_enabled("camera"))
+		{
+			bench_capture();
+		}
+		if(bench_enabled("serial"))
+		{
+			bench_serial();
+		}
+		if(bench_enabled("log"))
+		{
+			bench_logging();
+		}
+		if(bench_enabled("task_pool"))
+		{
+			bench_task_pool();
+		}
+		if(bench_enabled("segmenter"))
+		{
+			bench_segmenter();
+		}
+		if(bench_enabled("blob_finder"))
+		{
+			bench_blob_finder();
+		}
+		if(bench_enabled("remap"))
+		{
+			bench_remap();
+		}
+		if(bench_enabled("features"))
+		{
+			bench_features();
+		}
+		if(bench_enabled("stereo"))
+		{
+			bench_stereo();
+		}
+		if(bench_enabled("fusion"))
+		{
+			bench_fusion();
+		}
+		if(bench_enabled("convert"))
+		{
+			bench_convert();
+		}
+		if(bench_enabled("frame_view"))
+		{
+			bench_frame_view();
+		}
+		if(bench_enabled("cpp"))
+		{
+			bench_cpp();
+		}
+		if(bench_enabled("reactor"))
+		{
+			bench_reactor();
+		}
+	}
+
+	if(baselinePathname != NULL)
+	{
+		bench_baseline_load(baselinePathname);
+		regressions = bench_compare(thresholdPercent);
+	}
+	if(bench_write(outputPathname) != 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	return (regressions > 0 || g_failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+#include "../src/carl.hpp"
+#include "../src/Timestamp.h"
+
+/* The same loops as the C side of the "cpp" group, written against carl.hpp; built as C++ and linked into carl_bench */
+
+/********************----- Internal Functions -----********************/
+extern "C" Timestamp bench_cpp_capture(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations, uint64_t volatile * const io_sink);
+extern "C" Timestamp bench_cpp_create(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations);
+/**************************************************/
+
+Timestamp bench_cpp_capture(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations, uint64_t volatile * const io_sink)
+{
+	carl::Camera camera;
+	auto const touch = [io_sink](carl::Frame const &i_frame)
+	{
+		(*io_sink) += i_frame.data()[i_frame.size()/2];
+	};
+	uint64_t index = 0;
+	Timestamp timeStart = 0;
+
+	if(carl::Camera::create_replay(i_pathname, CAMERA_PIXELFORMAT_YUYV, i_sizeX, i_sizeY, camera) != R_SUCCESS || camera.start() != R_SUCCESS)
+	{
+		return 0;
+	}
+
+	camera.capture(touch);
+	timeStart = timestamp_now();
+	for(index=0; index<i_iterations; ++index)
+	{
+		camera.capture(touch);
+	}
+
+	return timestamp_now() - timeStart;
+}
+
+Timestamp bench_cpp_create(char const * const i_pathname, uint32_t const i_sizeX, uint32_t const i_sizeY, uint64_t const i_iterations)
+{
+	uint64_t index = 0;
+	Timestamp timeStart = timestamp_now();
+
+	for(index=0; index<i_iterations; ++index)
+	{
+		carl::Camera camera;
+
+		if(carl::Camera::create_replay(i_pathname, CAMERA_PIXELFORMAT_YUYV, i_sizeX, i_sizeY, camera) != R_SUCCESS)
+		{
+			return 0;
+		}
+	}
+
+	return timestamp_now() - timeStart;
+}
@@ -0,0 +1,128 @@
+#include "Arena.h"
+
+#include <stdlib.h>
+
+/********************----- STRUCT: Arena -----********************/
+struct Arena_s
+{
+	MemoryRegion m_region;
+	uint8_t *m_memory;
+	size_t m_capacityBytes;
+	uint64_t m_usedBytes;
+};
+/**************************************************/
+
+Result arena_alloc(	size_t const i_sizeBytes,
+							size_t const i_alignment,
+							void ** const o_memory,
+							Arena * const io_arenaHandle)
+{
+	size_t const alignment = (i_alignment > MEMORY_CACHE_LINE_BYTES) ? i_alignment : MEMORY_CACHE_LINE_BYTES;
+	uint64_t used = 0;
+	uint64_t begin = 0;
+
+	if(io_arenaHandle == NULL || o_memory == NULL || (alignment & (alignment-1)) != 0)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Align the start to at least a cache line so parallel users never share one *****/
+	used = __atomic_load_n(&io_arenaHandle->m_usedBytes, __ATOMIC_RELAXED);
+	do
+	{
+		begin = (used + alignment - 1) & ~(uint64_t)(alignment-1);
+		if(begin + i_sizeBytes > io_arenaHandle->m_capacityBytes)
+		{
+			(*o_memory) = NULL;
+			return R_MEMORYALLOCATIONERROR;
+		}
+	} while(!__atomic_compare_exchange_n(&io_arenaHandle->m_usedBytes, &used, begin + i_sizeBytes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	(*o_memory) = io_arenaHandle->m_memory + begin;
+
+	return R_SUCCESS;
+}
+
+Result arena_create(	size_t const i_capacityBytes,
+							uint32_t const i_memoryFlags,
+							Arena ** const o_arenaHandle)
+{
+	Arena *arenaHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Create arena structure *****/
+	arenaHandle = (Arena *)calloc(1, sizeof(Arena));
+	if(arenaHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+
+	result = memory_region_map(i_capacityBytes, i_memoryFlags, &arenaHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	arenaHandle->m_memory = (uint8_t *)arenaHandle->m_region.m_memory;
+	arenaHandle->m_capacityBytes = arenaHandle->m_region.m_sizeBytes;
+
+	if(o_arenaHandle != NULL)
+	{
+		(*o_arenaHandle) = arenaHandle;
+	}
+	else
+	{
+		arena_destroy(&arenaHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("arena_create(%zu, 0x%x, %p)", i_capacityBytes, i_memoryFlags, o_arenaHandle);
+	arena_destroy(&arenaHandle);
+
+	return result;
+}
+
+Result arena_destroy(Arena ** const io_arenaHandle)
+{
+	Arena *arenaHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_arenaHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	arenaHandle = (*io_arenaHandle);
+	if(arenaHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&arenaHandle->m_region);
+	free(arenaHandle);
+	(*io_arenaHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result arena_reset(Arena * const io_arenaHandle)
+{
+	if(io_arenaHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+
+	io_arenaHandle->m_usedBytes = 0;
+
+	return R_SUCCESS;
+}
+
+size_t arena_used(Arena const * const i_arenaHandle)
+{
+	return (i_arenaHandle != NULL) ? (size_t)__atomic_load_n(&i_arenaHandle->m_usedBytes, __ATOMIC_RELAXED) : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/********************----- STRUCT: Arena -----********************/
+struct Arena_s;
+typedef struct Arena_s Arena;
+/**************************************************/
+
+/* Bump allocator for per-frame scratch; arena_alloc may race with itself, arena_reset must not race with anything */
+Result arena_alloc(	size_t const i_sizeBytes,
+							size_t const i_alignment,
+							void ** const o_memory,
+							Arena * const io_arenaHandle);
+Result arena_create(	size_t const i_capacityBytes,
+							uint32_t const i_memoryFlags,
+							Arena ** const o_arenaHandle);
+Result arena_destroy(Arena ** const io_arenaHandle);
+Result arena_reset(Arena * const io_arenaHandle);
+size_t arena_used(Arena const * const i_arenaHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _ARENA_H_ */
@@ -0,0 +1,74 @@
+#ifndef _BINARYLOG_H_
+#define _BINARYLOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stdint.h>
+
+/********************----- Binary Log Format -----********************/
+/*
+ * File: BinaryLogHeader, then records in native byte order, each starting
+ * with a one byte BinaryLogRecordType.
+ *
+ * BINARYLOG_RECORD_FORMAT:  u32 id, u8 stream, u16 length + function name,
+ *                           u16 length + format string, u8 argument count,
+ *                           argument type codes
+ * BINARYLOG_RECORD_MESSAGE: u32 id, u64 monotonic ns, i32 errno (-1 none),
+ *                           u16 payload length, packed arguments
+ *
+ * Integer and pointer arguments are packed as 8 bytes, floating point as
+ * an 8 byte double, strings as u16 length + up to BINARYLOG_STRING_LENGTH
+ * bytes.
+ */
+#define BINARYLOG_MAGIC "CARLBLOG"
+#define BINARYLOG_VERSION 1
+#define BINARYLOG_ARGUMENTS_MAX 16
+#define BINARYLOG_NAME_LENGTH 64
+#define BINARYLOG_STRING_LENGTH 64
+
+enum BinaryLogRecordType_e
+{
+	BINARYLOG_RECORD_FORMAT=1,
+	BINARYLOG_RECORD_MESSAGE=2
+};
+typedef enum BinaryLogRecordType_e BinaryLogRecordType;
+
+enum BinaryLogArgument_e
+{
+	BINARYLOG_ARGUMENT_INT='i',
+	BINARYLOG_ARGUMENT_LONG='l',
+	BINARYLOG_ARGUMENT_LONGLONG='L',
+	BINARYLOG_ARGUMENT_SIZE='z',
+	BINARYLOG_ARGUMENT_INTMAX='j',
+	BINARYLOG_ARGUMENT_PTRDIFF='t',
+	BINARYLOG_ARGUMENT_DOUBLE='d',
+	BINARYLOG_ARGUMENT_LONGDOUBLE='D',
+	BINARYLOG_ARGUMENT_POINTER='p',
+	BINARYLOG_ARGUMENT_STRING='s'
+};
+typedef enum BinaryLogArgument_e BinaryLogArgument;
+
+struct BinaryLogHeader_s
+{
+	char m_magic[8];
+	uint32_t m_version;
+	uint32_t m_reserved;
+	uint64_t m_monotonicAnchor;
+	uint64_t m_realtimeAnchor;
+	char m_programName[BINARYLOG_NAME_LENGTH];
+};
+typedef struct BinaryLogHeader_s BinaryLogHeader;
+/**************************************************/
+
+Result carl_log_binary_start(char const * const i_pathname);
+Result carl_log_binary_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _BINARYLOG_H_ */
@@ -0,0 +1,332 @@
+#include "BlobFinder.h"
+#include "Memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/********************----- STRUCT: BlobSums -----********************/
+/* Raw sums for one component, kept at the index of its root run */
+struct BlobSums_s
+{
+	uint64_t m_sumX;
+	uint64_t m_sumY;
+	uint64_t m_sumXX;
+	uint64_t m_sumYY;
+	uint64_t m_sumXY;
+	uint32_t m_area;
+	uint16_t m_minX;
+	uint16_t m_minY;
+	uint16_t m_maxX;
+	uint16_t m_maxY;
+};
+typedef struct BlobSums_s BlobSums;
+/**************************************************/
+
+/********************----- STRUCT: BlobFinder -----********************/
+/* Union-find over run indices; a root is always the lowest run index in its component */
+struct BlobFinder_s
+{
+	MemoryRegion m_region;
+	uint32_t *m_parent;
+	BlobSums *m_sums;
+	size_t m_runCountMax;
+};
+/**************************************************/
+
+/********************----- STRUCT: BlobFinderJob -----********************/
+struct BlobFinderJob_s
+{
+	SegmenterRuns const *m_runs;
+	BlobFinder *m_finder;
+	uint8_t m_classMask;
+};
+typedef struct BlobFinderJob_s BlobFinderJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint32_t blob_finder_root(uint32_t * const io_parent, uint32_t i_run)
+{
+	while(io_parent[i_run] != i_run)
+	{
+		io_parent[i_run] = io_parent[io_parent[i_run]];
+		i_run = io_parent[i_run];
+	}
+
+	return i_run;
+}
+
+static void blob_finder_union(uint32_t * const io_parent, uint32_t const i_runA, uint32_t const i_runB)
+{
+	uint32_t const rootA = blob_finder_root(io_parent, i_runA);
+	uint32_t const rootB = blob_finder_root(io_parent, i_runB);
+
+	if(rootA < rootB)
+	{
+		io_parent[rootB] = rootA;
+	}
+	else if(rootB < rootA)
+	{
+		io_parent[rootA] = rootB;
+	}
+}
+
+/* Joins each run on row i_row to the overlapping runs of the row above */
+static void blob_finder_rows_join(BlobFinderJob const * const i_job, size_t const i_row)
+{
+	SegmenterRun const * const runs = i_job->m_runs->m_runs;
+	uint32_t * const parent = i_job->m_finder->m_parent;
+	uint32_t above = i_job->m_runs->m_rowStart[i_row-1];
+	uint32_t const aboveEnd = i_job->m_runs->m_rowStart[i_row];
+	uint32_t current = i_job->m_runs->m_rowStart[i_row];
+	uint32_t const currentEnd = i_job->m_runs->m_rowStart[i_row+1];
+
+	while(above < aboveEnd && current < currentEnd)
+	{
+		uint32_t const aboveStop = (uint32_t)runs[above].m_x + runs[above].m_length;
+		uint32_t const currentStop = (uint32_t)runs[current].m_x + runs[current].m_length;
+
+		if(aboveStop > runs[current].m_x && currentStop > runs[above].m_x && runs[above].m_mask == runs[current].m_mask && (runs[current].m_mask & i_job->m_classMask) != 0)
+		{
+			blob_finder_union(parent, above, current);
+		}
+
+		/***** Advance whichever run ends first *****/
+		if(aboveStop < currentStop)
+		{
+			++above;
+		}
+		else
+		{
+			++current;
+		}
+	}
+}
+
+/* Bands only touch their own runs, so they label in parallel; band seams are joined afterwards */
+static void blob_finder_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	BlobFinderJob const * const job = (BlobFinderJob const *)i_taskData;
+	uint32_t * const parent = job->m_finder->m_parent;
+	uint32_t run = 0;
+	size_t row = 0;
+
+	for(run=job->m_runs->m_rowStart[i_rowBegin]; run<job->m_runs->m_rowStart[i_rowEnd]; ++run)
+	{
+		parent[run] = run;
+	}
+	for(row=i_rowBegin+1; row<i_rowEnd; ++row)
+	{
+		blob_finder_rows_join(job, row);
+	}
+}
+
+static void blob_finder_sums_add(SegmenterRun const * const i_run, BlobSums * const io_sums)
+{
+	uint64_t const x = i_run->m_x;
+	uint64_t const y = i_run->m_y;
+	uint64_t const length = i_run->m_length;
+	uint64_t const sumX = length*x + length*(length - 1)/2;
+
+	io_sums->m_area += (uint32_t)length;
+	io_sums->m_sumX += sumX;
+	io_sums->m_sumY += length*y;
+	io_sums->m_sumXX += length*x*x + x*length*(length - 1) + (length - 1)*length*(2*length - 1)/6;
+	io_sums->m_sumYY += length*y*y;
+	io_sums->m_sumXY += sumX*y;
+	io_sums->m_minX = MIN(io_sums->m_minX, i_run->m_x);
+	io_sums->m_maxX = MAX(io_sums->m_maxX, (uint16_t)(i_run->m_x + i_run->m_length - 1));
+	io_sums->m_minY = MIN(io_sums->m_minY, i_run->m_y);
+	io_sums->m_maxY = MAX(io_sums->m_maxY, i_run->m_y);
+}
+
+static void blob_finder_blob_fill(BlobSums const * const i_sums, uint8_t const i_mask, Blob * const o_blob)
+{
+	double const area = (double)i_sums->m_area;
+	double const centroidX = (double)i_sums->m_sumX/area;
+	double const centroidY = (double)i_sums->m_sumY/area;
+
+	o_blob->m_area = i_sums->m_area;
+	o_blob->m_minX = i_sums->m_minX;
+	o_blob->m_minY = i_sums->m_minY;
+	o_blob->m_maxX = i_sums->m_maxX;
+	o_blob->m_maxY = i_sums->m_maxY;
+	o_blob->m_mask = i_mask;
+	o_blob->m_centroidX = (float)centroidX;
+	o_blob->m_centroidY = (float)centroidY;
+	o_blob->m_moment20 = (float)((double)i_sums->m_sumXX/area - centroidX*centroidX);
+	o_blob->m_moment02 = (float)((double)i_sums->m_sumYY/area - centroidY*centroidY);
+	o_blob->m_moment11 = (float)((double)i_sums->m_sumXY/area - centroidX*centroidY);
+}
+/**************************************************/
+
+Result blob_finder_create(size_t const i_runCountMax, BlobFinder ** const o_finderHandle)
+{
+	BlobFinder *finderHandle = NULL;
+	size_t parentSizeBytes = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_runCountMax == 0 || i_runCountMax > UINT32_MAX)
+	{
+		CARL_ERROR("Blob finder needs 1 to %u runs.", UINT32_MAX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create blob finder structure *****/
+	finderHandle = (BlobFinder *)calloc(1, sizeof(BlobFinder));
+	if(finderHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	finderHandle->m_runCountMax = i_runCountMax;
+
+	/***** Per-run sums, then parent links, in one mapping *****/
+	parentSizeBytes = i_runCountMax*sizeof(uint32_t);
+	result = memory_region_map(i_runCountMax*sizeof(BlobSums) + parentSizeBytes, MEMORY_FLAG_PREFAULT, &finderHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	finderHandle->m_sums = (BlobSums *)finderHandle->m_region.m_memory;
+	finderHandle->m_parent = (uint32_t *)(finderHandle->m_sums + i_runCountMax);
+
+	if(o_finderHandle != NULL)
+	{
+		(*o_finderHandle) = finderHandle;
+	}
+	else
+	{
+		blob_finder_destroy(&finderHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("blob_finder_create(%zu, %p)", i_runCountMax, o_finderHandle);
+	blob_finder_destroy(&finderHandle);
+
+	return result;
+}
+
+Result blob_finder_destroy(BlobFinder ** const io_finderHandle)
+{
+	BlobFinder *finderHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_finderHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	finderHandle = (*io_finderHandle);
+	if(finderHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&finderHandle->m_region);
+	free(finderHandle);
+	(*io_finderHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result blob_finder_find(	SegmenterRuns const * const i_runs,
+									uint8_t const i_classMask,
+									uint32_t const i_areaMin,
+									Blob * const o_blobs,
+									size_t const i_blobCountMax,
+									size_t * const o_blobCount,
+									TaskPool * const io_poolHandle,
+									BlobFinder * const io_finderHandle)
+{
+	BlobFinderJob job;
+	SegmenterRun const *run = NULL;
+	BlobSums *sums = NULL;
+	size_t blobCount = 0;
+	size_t blobIndex = 0;
+	size_t row = 0;
+	uint32_t runIndex = 0;
+	uint32_t root = 0;
+	Result result = R_FAILURE;
+
+	if(io_finderHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_runs == NULL || i_runs->m_runs == NULL || (o_blobs == NULL && i_blobCountMax > 0) || o_blobCount == NULL)
+	{
+		return R_INPUTBAD;
+	}
+	if(i_runs->m_runCount > io_finderHandle->m_runCountMax)
+	{
+		CARL_ERROR("%zu runs exceed the blob finder's %zu.", i_runs->m_runCount, io_finderHandle->m_runCountMax);
+		return R_INPUTBAD;
+	}
+	(*o_blobCount) = 0;
+
+	/***** Label bands in parallel, then join the seams between them *****/
+	job.m_runs = i_runs;
+	job.m_finder = io_finderHandle;
+	job.m_classMask = i_classMask;
+	result = task_pool_parallel_for(i_runs->m_sizeY, BLOB_FINDER_BAND_ROWS, blob_finder_band, &job, io_poolHandle);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	for(row=BLOB_FINDER_BAND_ROWS; row<i_runs->m_sizeY; row+=BLOB_FINDER_BAND_ROWS)
+	{
+		blob_finder_rows_join(&job, row);
+	}
+
+	/***** Roots come before their members, so one pass both starts and fills the sums *****/
+	for(runIndex=0; runIndex<i_runs->m_runCount; ++runIndex)
+	{
+		run = &i_runs->m_runs[runIndex];
+		if((run->m_mask & i_classMask) == 0)
+		{
+			continue;
+		}
+		root = blob_finder_root(io_finderHandle->m_parent, runIndex);
+		sums = &io_finderHandle->m_sums[root];
+		if(root == runIndex)
+		{
+			CLEAR(*sums);
+			sums->m_minX = UINT16_MAX;
+			sums->m_minY = UINT16_MAX;
+		}
+		blob_finder_sums_add(run, sums);
+	}
+
+	/***** Keep the largest blobs, sorted by insertion into the small output *****/
+	for(runIndex=0; runIndex<i_runs->m_runCount && i_blobCountMax > 0; ++runIndex)
+	{
+		run = &i_runs->m_runs[runIndex];
+		if((run->m_mask & i_classMask) == 0 || io_finderHandle->m_parent[runIndex] != runIndex)
+		{
+			continue;
+		}
+		sums = &io_finderHandle->m_sums[runIndex];
+		if(sums->m_area < i_areaMin || (blobCount == i_blobCountMax && sums->m_area <= o_blobs[blobCount-1].m_area))
+		{
+			continue;
+		}
+
+		blobIndex = (blobCount < i_blobCountMax) ? blobCount++ : blobCount-1;
+		while(blobIndex > 0 && o_blobs[blobIndex-1].m_area < sums->m_area)
+		{
+			o_blobs[blobIndex] = o_blobs[blobIndex-1];
+			--blobIndex;
+		}
+		blob_finder_blob_fill(sums, run->m_mask, &o_blobs[blobIndex]);
+	}
+	(*o_blobCount) = blobCount;
+
+	return R_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#ifndef _BLOBFINDER_H_
+#define _BLOBFINDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Segmenter.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOB_FINDER_BAND_ROWS 64
+
+/********************----- STRUCT: BlobFinder -----********************/
+struct BlobFinder_s;
+typedef struct BlobFinder_s BlobFinder;
+/**************************************************/
+
+/********************----- STRUCT: Blob -----********************/
+/* Bounds are inclusive; moments are central second moments divided by area */
+struct Blob_s
+{
+	uint32_t m_area;
+	uint16_t m_minX;
+	uint16_t m_minY;
+	uint16_t m_maxX;
+	uint16_t m_maxY;
+	uint8_t m_mask;
+	float m_centroidX;
+	float m_centroidY;
+	float m_moment20;
+	float m_moment02;
+	float m_moment11;
+};
+typedef struct Blob_s Blob;
+/**************************************************/
+
+/* All labeling memory is mapped at create; finding never allocates */
+Result blob_finder_create(size_t const i_runCountMax, BlobFinder ** const o_finderHandle);
+Result blob_finder_destroy(BlobFinder ** const io_finderHandle);
+/* 4-connected runs with the same mask form a blob; the largest i_blobCountMax of at least i_areaMin pixels are returned, biggest first */
+Result blob_finder_find(	SegmenterRuns const * const i_runs,
+									uint8_t const i_classMask,
+									uint32_t const i_areaMin,
+									Blob * const o_blobs,
+									size_t const i_blobCountMax,
+									size_t * const o_blobCount,
+									TaskPool * const io_poolHandle,
+									BlobFinder * const io_finderHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _BLOBFINDER_H_ */
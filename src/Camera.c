@@ -1,7 +1,10 @@
 #include "Camera.h"
+#include "Memory.h"
+#include "Trace.h"
 
 #include <linux/limits.h>
 #include <linux/videodev2.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
@@ -27,6 +30,43 @@ struct Buffer_s
 typedef struct Buffer_s Buffer;
 /**************************************************/
 
+/********************----- STRUCT: CameraReplay -----********************/
+/* In-memory stand-in for the driver: every frame of the file is a buffer, queued FIFO like V4L2 */
+struct CameraReplay_s
+{
+	MemoryRegion m_region;
+	uint32_t *m_queue;
+	size_t m_queueHead;
+	size_t m_queueCount;
+	size_t m_frameCount;
+	size_t m_frameSizeBytes;
+	uint32_t m_sequence;
+	int m_streaming;
+};
+typedef struct CameraReplay_s CameraReplay;
+/**************************************************/
+
+/********************----- ENUM: CameraMetric -----********************/
+enum CameraMetric_e
+{
+	CAMERA_METRIC_FRAMES,
+	CAMERA_METRIC_DEQUEUE_RETRIES,
+	CAMERA_METRIC_DEQUEUE_NS,
+	CAMERA_METRIC_ENQUEUE_NS,
+	CAMERA_METRIC_CALLBACK_NS,
+	CAMERA_METRIC_CALLBACK_NS_MAX,
+	CAMERA_METRIC_SEQUENCE_GAPS,
+	CAMERA_METRIC_ERRORS,
+	CAMERA_METRIC_LAST_FRAME,
+	CAMERA_METRIC_OPEN_NS,
+	CAMERA_METRIC_FIRST_FRAME_NS,
+	CAMERA_METRIC_COUNT
+};
+/* Values that are set or maxed rather than counted */
+static uint32_t const CAMERA_METRIC_GAUGES = (1u << CAMERA_METRIC_CALLBACK_NS_MAX) | (1u << CAMERA_METRIC_LAST_FRAME) | (1u << CAMERA_METRIC_OPEN_NS) | (1u << CAMERA_METRIC_FIRST_FRAME_NS);
+static char const * const CAMERA_METRIC_NAMES[CAMERA_METRIC_COUNT] = {"frames", "dequeue_retries", "dequeue_ns", "enqueue_ns", "callback_ns", "callback_ns_max", "sequence_gaps", "errors", "last_frame_ns", "open_ns", "first_frame_ns"};
+/**************************************************/
+
 /********************----- STRUCT: Camera -----********************/
 struct Camera_s
 {
@@ -34,9 +74,21 @@ struct Camera_s
 	size_t m_bufferCount;
 	size_t m_bufferCountMax;
 	int m_deviceHandle;
+	CameraReplay *m_replay;
 	struct v4l2_format m_format;
+	PixelFormat m_pixelFormat;
 	struct v4l2_captureparm m_parameters;
 	enum v4l2_priority m_priority;
+	Timestamp m_timestamp;
+	Timestamp m_createTimestamp;
+	Histogram *m_latencyHistogram;
+	Recorder *m_recorder;
+	uint16_t m_recorderSource;
+	uint32_t m_sequence;
+	int m_sequenceValid;
+	uint64_t *m_metrics;
+	uint64_t m_metricsLocal[CAMERA_METRIC_COUNT];
+	MetricsPage *m_metricsPage;
 };
 /**************************************************/
 
@@ -51,6 +103,165 @@ static inline int xioctl(int const i_fileHandle, int const i_request, void * con
 	return ioResult;
 }
 
+static int camera_replay_ioctl(CameraReplay * const io_replay, unsigned long const i_request, void * const i_argument)
+{
+	struct v4l2_buffer * const buffer = (struct v4l2_buffer *)i_argument;
+
+	switch(i_request)
+	{
+		case VIDIOC_DQBUF:
+			if(!io_replay->m_streaming || io_replay->m_queueCount == 0)
+			{
+				errno = io_replay->m_streaming ? EAGAIN : EINVAL;
+				return -1;
+			}
+			buffer->index = io_replay->m_queue[io_replay->m_queueHead];
+			buffer->bytesused = (uint32_t)io_replay->m_frameSizeBytes;
+			buffer->sequence = io_replay->m_sequence++;
+			buffer->flags = 0;
+			io_replay->m_queueHead = (io_replay->m_queueHead + 1) % io_replay->m_frameCount;
+			--io_replay->m_queueCount;
+			return 0;
+
+		case VIDIOC_QBUF:
+			if(buffer->index >= io_replay->m_frameCount || io_replay->m_queueCount >= io_replay->m_frameCount)
+			{
+				errno = EINVAL;
+				return -1;
+			}
+			io_replay->m_queue[(io_replay->m_queueHead + io_replay->m_queueCount) % io_replay->m_frameCount] = buffer->index;
+			++io_replay->m_queueCount;
+			return 0;
+
+		case VIDIOC_STREAMON:
+		case VIDIOC_STREAMOFF:
+			io_replay->m_streaming = (i_request == VIDIOC_STREAMON);
+			return 0;
+
+		default:
+			errno = ENOTTY;
+			return -1;
+	}
+}
+
+static inline int camera_ioctl(Camera * const io_cameraHandle, unsigned long const i_request, void * const i_argument)
+{
+	if(io_cameraHandle->m_replay != NULL)
+	{
+		return camera_replay_ioctl(io_cameraHandle->m_replay, i_request, i_argument);
+	}
+
+	return xioctl(io_cameraHandle->m_deviceHandle, i_request, i_argument);
+}
+
+static Result camera_v4l2_pixel_format(PixelFormat const i_pixelFormat, uint32_t * const o_devicePixelFormat)
+{
+	switch(i_pixelFormat)
+	{
+		case CAMERA_PIXELFORMAT_MJPEG:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_MJPEG;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_UYVY:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_UYVY;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_YUYV:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_YUYV;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_GREY:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_GREY;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_Y10:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_Y10;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_Y16:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_Y16;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_NV12:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_NV12;
+			return R_SUCCESS;
+		case CAMERA_PIXELFORMAT_NV21:
+			(*o_devicePixelFormat) = V4L2_PIX_FMT_NV21;
+			return R_SUCCESS;
+		default:
+			return R_INPUTBAD;
+	}
+}
+
+/* Matches the device's current format against what it negotiated for this mode last time */
+static int camera_format_current(CameraCacheEntry const * const i_entry, Camera * const io_cameraHandle)
+{
+	struct v4l2_format format;
+
+	CLEAR(format);
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if(camera_ioctl(io_cameraHandle, VIDIOC_G_FMT, &format) == -1)
+	{
+		return 0;
+	}
+	if(format.fmt.pix.pixelformat != i_entry->m_fourcc || format.fmt.pix.width != i_entry->m_sizeX || format.fmt.pix.height != i_entry->m_sizeY || format.fmt.pix.field != DEVICE_FIELD || format.fmt.pix.bytesperline != i_entry->m_strideBytes || format.fmt.pix.sizeimage != i_entry->m_sizeBytes)
+	{
+		return 0;
+	}
+	memcpy(&io_cameraHandle->m_format, &format, sizeof(format));
+
+	return 1;
+}
+
+/* Identifies the device behind the port as well as the port, so another camera plugged in there gets its own entries */
+static void camera_cache_key(struct v4l2_capability const * const i_capability, uint32_t const i_fourcc, uint32_t const i_sizeX, uint32_t const i_sizeY, CameraCacheEntry * const o_entry)
+{
+	CLEAR(*o_entry);
+	memcpy(o_entry->m_busInfo, i_capability->bus_info, MIN(sizeof(o_entry->m_busInfo), sizeof(i_capability->bus_info))-1);
+	memcpy(o_entry->m_driver, i_capability->driver, MIN(sizeof(o_entry->m_driver), sizeof(i_capability->driver))-1);
+	memcpy(o_entry->m_card, i_capability->card, MIN(sizeof(o_entry->m_card), sizeof(i_capability->card))-1);
+	o_entry->m_capabilities = i_capability->capabilities;
+	o_entry->m_fourcc = i_fourcc;
+	o_entry->m_sizeX = i_sizeX;
+	o_entry->m_sizeY = i_sizeY;
+}
+
+static void camera_cache_record(struct v4l2_capability const * const i_capability, uint32_t const i_fourcc, uint32_t const i_sizeX, uint32_t const i_sizeY, int const i_accepted, Camera const * const i_cameraHandle, CameraCache * const io_cacheHandle)
+{
+	CameraCacheEntry entry;
+
+	if(io_cacheHandle == NULL)
+	{
+		return;
+	}
+
+	camera_cache_key(i_capability, i_fourcc, i_sizeX, i_sizeY, &entry);
+	entry.m_strideBytes = i_cameraHandle->m_format.fmt.pix.bytesperline;
+	entry.m_sizeBytes = i_cameraHandle->m_format.fmt.pix.sizeimage;
+	entry.m_accepted = i_accepted;
+	camera_cache_store(&entry, io_cacheHandle);
+}
+
+/********************----- STRUCT: CameraCreateJob -----********************/
+struct CameraCreateJob_s
+{
+	CameraRequest const *m_requests;
+	CameraCache *m_cacheHandle;
+	Camera **m_cameraHandles;
+	Result *m_results;
+};
+typedef struct CameraCreateJob_s CameraCreateJob;
+/**************************************************/
+
+/* Each device's ioctl chain mostly waits on its own driver, so devices come up side by side */
+static void camera_create_range(size_t const i_begin, size_t const i_end, void * const i_taskData)
+{
+	CameraCreateJob const * const job = (CameraCreateJob const *)i_taskData;
+	size_t index = 0;
+
+	for(index=i_begin; index<i_end; ++index)
+	{
+		CameraRequest const * const request = &job->m_requests[index];
+
+		job->m_cameraHandles[index] = NULL;
+		job->m_results[index] = camera_create_cached(request->m_deviceID, request->m_pixelFormat, request->m_sizeX, request->m_sizeY, job->m_cacheHandle, &job->m_cameraHandles[index]);
+	}
+}
+
 struct camera_capture_data_t
 {
 	size_t m_outputSizeBytesMax;
@@ -76,13 +287,17 @@ Result camera_capture_copy(size_t const i_outputSizeBytesMax, uint8_t * const o_
 	return camera_capture_callback(camera_capture_data_callback, (void*)(&capData), io_cameraHandle);
 }
 
-Result camera_capture_callback(CameraCallback i_callback, void *i_callbackData, Camera * const io_cameraHandle)
+static Result camera_capture_dequeue(CameraCallback i_callback, void *i_callbackData, int const i_wait, Camera * const io_cameraHandle)
 {
 	fd_set fds;
 	struct timeval tv;
 	int selectResult = -1;
 	Result result = R_FAILURE;
 	struct v4l2_buffer buffer;
+	uint64_t * metrics = NULL;
+	Timestamp timeCallback = 0;
+	Timestamp timeDequeue = 0;
+	Timestamp timeEnqueue = 0;
 	int xioResult=-1;
 
 	if(io_cameraHandle == NULL)
@@ -92,8 +307,11 @@ Result camera_capture_callback(CameraCallback i_callback, void *i_callbackData,
 		result = R_OBJECTNOTEXTANT;
 		goto end;
 	}
+	metrics = __atomic_load_n(&io_cameraHandle->m_metrics, __ATOMIC_ACQUIRE);
 
 	/***** Dequeue Buffer *****/
+	CARL_TRACE_BEGIN("camera.dqbuf");
+	timeDequeue = timestamp_now();
 	for(;;)
 	{
 		/*
@@ -117,17 +335,28 @@ Result camera_capture_callback(CameraCallback i_callback, void *i_callbackData,
 		buffer.memory = V4L2_MEMORY_MMAP;
 
 		errno = 0;
-		xioResult = xioctl(io_cameraHandle->m_deviceHandle, VIDIOC_DQBUF, &buffer);
+		xioResult = camera_ioctl(io_cameraHandle, VIDIOC_DQBUF, &buffer);
 		if(xioResult != -1)
 		{
 			break;
 		}
-		else if(errno == EAGAIN)
+		else if(errno == EAGAIN && i_wait)
 		{
+			metrics_add(&metrics[CAMERA_METRIC_DEQUEUE_RETRIES], 1);
 			continue;
 		}
+		else if(errno == EAGAIN)
+		{
+			CARL_TRACE_END("camera.dqbuf");
+
+			result = R_DEVICENOTREADY;
+			goto end;
+		}
 		else
 		{
+			CARL_TRACE_END("camera.dqbuf");
+			metrics_add(&metrics[CAMERA_METRIC_ERRORS], 1);
+			recorder_append(RECORDER_EVENT_ERROR, io_cameraHandle->m_recorderSource, (uint32_t)R_BUFFERDEQUEUEFAILED, (uint64_t)errno, io_cameraHandle->m_recorder);
 			CARL_ERROR("Unable to dequeue buffer - \"%s\"", strerror(errno));
 
 			result = R_BUFFERDEQUEUEFAILED;
@@ -135,29 +364,105 @@ Result camera_capture_callback(CameraCallback i_callback, void *i_callbackData,
 		}
 	}
 
+	CARL_TRACE_END("camera.dqbuf");
+	timeCallback = timestamp_now();
+	metrics_add(&metrics[CAMERA_METRIC_DEQUEUE_NS], timeCallback - timeDequeue);
+	if(io_cameraHandle->m_sequenceValid && buffer.sequence != io_cameraHandle->m_sequence+1)
+	{
+		metrics_add(&metrics[CAMERA_METRIC_SEQUENCE_GAPS], 1);
+	}
+
+	/***** Flight recorder *****/
+	if(io_cameraHandle->m_recorder != NULL)
+	{
+		if(io_cameraHandle->m_sequenceValid && buffer.sequence != io_cameraHandle->m_sequence+1)
+		{
+			recorder_append(RECORDER_EVENT_SEQUENCE_GAP, io_cameraHandle->m_recorderSource, buffer.sequence - io_cameraHandle->m_sequence - 1, buffer.sequence, io_cameraHandle->m_recorder);
+		}
+		recorder_append(RECORDER_EVENT_FRAME_DEQUEUED, io_cameraHandle->m_recorderSource, buffer.index, buffer.sequence, io_cameraHandle->m_recorder);
+	}
+	io_cameraHandle->m_sequence = buffer.sequence;
+	io_cameraHandle->m_sequenceValid = 1;
+
+	/***** Frame timestamp on the carl time base *****/
+	if((buffer.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+	{
+		io_cameraHandle->m_timestamp = timestamp_from_timeval(&buffer.timestamp);
+
+		/***** Driver timestamp to dequeue latency *****/
+		if(io_cameraHandle->m_latencyHistogram != NULL)
+		{
+			histogram_record(timeCallback > io_cameraHandle->m_timestamp ? timeCallback - io_cameraHandle->m_timestamp : 0, io_cameraHandle->m_latencyHistogram);
+		}
+	}
+	else
+	{
+		io_cameraHandle->m_timestamp = timeCallback;
+	}
+	metrics_set(&metrics[CAMERA_METRIC_LAST_FRAME], io_cameraHandle->m_timestamp);
+	if(__atomic_load_n(&metrics[CAMERA_METRIC_FIRST_FRAME_NS], __ATOMIC_RELAXED) == 0)
+	{
+		metrics_set(&metrics[CAMERA_METRIC_FIRST_FRAME_NS], MAX(timeCallback - io_cameraHandle->m_createTimestamp, 1));
+	}
+
 	/***** Copy the data *****/
 	if(i_callback != NULL)
 	{
+		CARL_TRACE_BEGIN("camera.callback");
 		i_callback(io_cameraHandle->m_buffers[buffer.index].m_start, buffer.bytesused, i_callbackData);
+		CARL_TRACE_END("camera.callback");
 	}
 
+	timeEnqueue = timestamp_now();
+	metrics_add(&metrics[CAMERA_METRIC_CALLBACK_NS], timeEnqueue - timeCallback);
+	metrics_max(&metrics[CAMERA_METRIC_CALLBACK_NS_MAX], timeEnqueue - timeCallback);
+
 	/***** Requeue buffer *****/
-	xioResult = xioctl(io_cameraHandle->m_deviceHandle, VIDIOC_QBUF, &buffer);
+	CARL_TRACE_BEGIN("camera.qbuf");
+	xioResult = camera_ioctl(io_cameraHandle, VIDIOC_QBUF, &buffer);
+	CARL_TRACE_END("camera.qbuf");
+	metrics_add(&metrics[CAMERA_METRIC_ENQUEUE_NS], timestamp_now() - timeEnqueue);
 	if(xioResult == -1)
 	{
+		metrics_add(&metrics[CAMERA_METRIC_ERRORS], 1);
+		recorder_append(RECORDER_EVENT_ERROR, io_cameraHandle->m_recorderSource, (uint32_t)R_BUFFERENQUEUEFAILED, (uint64_t)errno, io_cameraHandle->m_recorder);
 		CARL_ERROR("Unable to requeue buffer - \"%s\"", strerror(errno));
 
 		result = R_BUFFERENQUEUEFAILED;
 		goto end;
 	}
+	metrics_add(&metrics[CAMERA_METRIC_FRAMES], 1);
+
+	result = R_SUCCESS;
 
 end:
 	return result;
 }
-	
+
+Result camera_capture_callback(CameraCallback i_callback, void *i_callbackData, Camera * const io_cameraHandle)
+{
+	return camera_capture_dequeue(i_callback, i_callbackData, 1, io_cameraHandle);
+}
+
+Result camera_capture_try(CameraCallback i_callback, void *i_callbackData, Camera * const io_cameraHandle)
+{
+	return camera_capture_dequeue(i_callback, i_callbackData, 0, io_cameraHandle);
+}
+
 
 Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat, uint32_t const i_sizeX, uint32_t const i_sizeY, Camera ** const o_cameraHandle)
 {
+	return camera_create_cached(i_deviceID, i_pixelFormat, i_sizeX, i_sizeY, NULL, o_cameraHandle);
+}
+
+Result camera_create_cached(	int32_t const i_deviceID,
+										PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										CameraCache * const io_cacheHandle,
+										Camera ** const o_cameraHandle)
+{
+	Timestamp const timeStart = timestamp_now();
 	struct v4l2_buffer buffer;
 	size_t bufferIndex=0;
 	void *bufferMap=NULL;
@@ -166,6 +471,8 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 	struct v4l2_capability cap;
 	struct v4l2_control currentControl;
 	char devicePathname[PATH_MAX];
+	CameraCacheEntry cacheEntry;
+	int cacheFound = 0;
 	uint32_t devicePixelFormat = 0;
 	uint32_t deviceSizeX = 0;
 	uint32_t deviceSizeY = 0;
@@ -196,6 +503,17 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 	cameraHandle->m_bufferCount = 0;
 	cameraHandle->m_bufferCountMax = 0;
 	cameraHandle->m_deviceHandle = -1;
+	cameraHandle->m_replay = NULL;
+	cameraHandle->m_timestamp = 0;
+	cameraHandle->m_createTimestamp = timeStart;
+	cameraHandle->m_latencyHistogram = NULL;
+	cameraHandle->m_recorder = NULL;
+	cameraHandle->m_recorderSource = 0;
+	cameraHandle->m_sequence = 0;
+	cameraHandle->m_sequenceValid = 0;
+	CLEAR(cameraHandle->m_metricsLocal);
+	cameraHandle->m_metrics = cameraHandle->m_metricsLocal;
+	cameraHandle->m_metricsPage = NULL;
 	CLEAR(cameraHandle->m_format);
 
 	/***** Generate camera path *****/
@@ -246,23 +564,14 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 	/***** Prepare user desires *****/
 	deviceSizeX = i_sizeX;
 	deviceSizeY = i_sizeY;
-	switch(i_pixelFormat)
+	if(camera_v4l2_pixel_format(i_pixelFormat, &devicePixelFormat) != R_SUCCESS)
 	{
-		case CAMERA_PIXELFORMAT_MJPEG:
-			devicePixelFormat = V4L2_PIX_FMT_MJPEG;
-			break;
-		case CAMERA_PIXELFORMAT_UYVY:
-			devicePixelFormat = V4L2_PIX_FMT_UYVY;
-			break;
-		case CAMERA_PIXELFORMAT_YUYV:
-			devicePixelFormat = V4L2_PIX_FMT_YUYV;
-			break;
-		default:
-			CARL_ERROR("Unsupported pixel format %d specified", i_pixelFormat);
+		CARL_ERROR("Unsupported pixel format %d specified", i_pixelFormat);
 
-			result = R_INPUTBAD;
-			goto end;
+		result = R_INPUTBAD;
+		goto end;
 	}
+	cameraHandle->m_pixelFormat = i_pixelFormat;
 
 	/***** Stuff user desires into struct *****/
 	CLEAR(cameraHandle->m_format);
@@ -272,30 +581,44 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 	cameraHandle->m_format.fmt.pix.pixelformat = devicePixelFormat;
 	cameraHandle->m_format.fmt.pix.field = DEVICE_FIELD;
 
-	/***** Apply camera attributes *****/
-	xioResult = xioctl(cameraHandle->m_deviceHandle, VIDIOC_S_FMT, &(cameraHandle->m_format));
-	if(xioResult == -1)
+	/***** A refusal is only remembered, never trusted: firmware and settings change, so the driver is asked again *****/
+	if(io_cacheHandle != NULL)
 	{
-		CARL_ERROR("Attribute application failed - \"%s\"", strerror(errno));
-
-		result = R_DEVICEATTRIBUTESETFAILED;
-		goto end;
+		camera_cache_key(&cap, devicePixelFormat, deviceSizeX, deviceSizeY, &cacheEntry);
+		camera_cache_lookup(&cacheEntry, &cacheEntry, &cacheFound, io_cacheHandle);
 	}
 
-	/***** Check camera attributes *****/
-	if(cameraHandle->m_format.fmt.pix.pixelformat != devicePixelFormat)
+	/***** The format is device state, so a device still in an accepted cached mode skips S_FMT *****/
+	if(!cacheFound || !cacheEntry.m_accepted || !camera_format_current(&cacheEntry, cameraHandle))
 	{
-		CARL_ERROR("Driver set different pixel format (%u)", cameraHandle->m_format.fmt.pix.pixelformat);
+		/***** Apply camera attributes *****/
+		xioResult = xioctl(cameraHandle->m_deviceHandle, VIDIOC_S_FMT, &(cameraHandle->m_format));
+		if(xioResult == -1)
+		{
+			CARL_ERROR("Attribute application failed - \"%s\"", strerror(errno));
 
-		result = R_DEVICEPIXELFORMATFAILED;
-		goto end;
-	}
-	if(cameraHandle->m_format.fmt.pix.width != deviceSizeX || cameraHandle->m_format.fmt.pix.height != deviceSizeY)
-	{
-		CARL_ERROR("Driver set different resolution (%u x %u)", cameraHandle->m_format.fmt.pix.width, cameraHandle->m_format.fmt.pix.height);
+			result = R_DEVICEATTRIBUTESETFAILED;
+			goto end;
+		}
 
-		result = R_DEVICERESOLUTIONFAILED;
-		goto end;
+		/***** Check camera attributes *****/
+		if(cameraHandle->m_format.fmt.pix.pixelformat != devicePixelFormat)
+		{
+			CARL_ERROR("Driver set different pixel format (%u)", cameraHandle->m_format.fmt.pix.pixelformat);
+			camera_cache_record(&cap, devicePixelFormat, deviceSizeX, deviceSizeY, 0, cameraHandle, io_cacheHandle);
+
+			result = R_DEVICEPIXELFORMATFAILED;
+			goto end;
+		}
+		if(cameraHandle->m_format.fmt.pix.width != deviceSizeX || cameraHandle->m_format.fmt.pix.height != deviceSizeY)
+		{
+			CARL_ERROR("Driver set different resolution (%u x %u)", cameraHandle->m_format.fmt.pix.width, cameraHandle->m_format.fmt.pix.height);
+			camera_cache_record(&cap, devicePixelFormat, deviceSizeX, deviceSizeY, 0, cameraHandle, io_cacheHandle);
+
+			result = R_DEVICERESOLUTIONFAILED;
+			goto end;
+		}
+		camera_cache_record(&cap, devicePixelFormat, deviceSizeX, deviceSizeY, 1, cameraHandle, io_cacheHandle);
 	}
 
 	/***** Apply camera stream parameters *****/
@@ -466,6 +789,8 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 		}
 	}
 
+	metrics_set(&cameraHandle->m_metrics[CAMERA_METRIC_OPEN_NS], timestamp_now() - timeStart);
+
 	/***** Set output *****/
 	if(o_cameraHandle != NULL)
 	{
@@ -480,12 +805,192 @@ Result camera_create(int32_t const i_deviceID, PixelFormat const i_pixelFormat,
 	return R_SUCCESS;
 
 end:
-	CARL_ERROR("camera_create(%d, %d, %u, %u, %p)", i_deviceID, i_pixelFormat, i_sizeX, i_sizeY, o_cameraHandle);
+	CARL_ERROR("camera_create_cached(%d, %d, %u, %u, %p, %p)", i_deviceID, i_pixelFormat, i_sizeX, i_sizeY, (void *)io_cacheHandle, (void *)o_cameraHandle);
 	camera_destroy(&cameraHandle);
 
 	return result;
 };
 
+Result camera_create_many(	CameraRequest const * const i_requests,
+										size_t const i_requestCount,
+										CameraCache * const io_cacheHandle,
+										Camera ** const o_cameraHandles,
+										Result * const o_results,
+										TaskPool * const io_poolHandle)
+{
+	CameraCreateJob job;
+	size_t index = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_requests == NULL || i_requestCount == 0 || o_cameraHandles == NULL || o_results == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	job.m_requests = i_requests;
+	job.m_cacheHandle = io_cacheHandle;
+	job.m_cameraHandles = o_cameraHandles;
+	job.m_results = o_results;
+	result = task_pool_parallel_for(i_requestCount, 1, camera_create_range, &job, io_poolHandle);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	/***** First failure in request order, so the return does not depend on scheduling *****/
+	for(index=0; index<i_requestCount; ++index)
+	{
+		if(o_results[index] != R_SUCCESS)
+		{
+			return o_results[index];
+		}
+	}
+
+	return R_SUCCESS;
+}
+
+Result camera_create_replay(	char const * const i_pathname,
+										PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										Camera ** const o_cameraHandle)
+{
+	Timestamp const timeStart = timestamp_now();
+	Camera *cameraHandle = NULL;
+	CameraReplay *replay = NULL;
+	CameraFrameLayout layout;
+	FILE *fileHandle = NULL;
+	long fileSizeBytes = 0;
+	size_t frameSizeBytes = 0;
+	size_t frameIndex = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_pathname == NULL || camera_frame_layout(i_pixelFormat, i_sizeX, i_sizeY, 0, &layout) != R_SUCCESS)
+	{
+		CARL_ERROR("Replay needs a file and a fixed-size pixel format with a non-0 frame size.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create camera structure *****/
+	cameraHandle = (Camera*) calloc(1, sizeof(Camera));
+	replay = (CameraReplay *)calloc(1, sizeof(CameraReplay));
+	if(cameraHandle == NULL || replay == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		free(replay);
+		free(cameraHandle);
+		cameraHandle = NULL;
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	frameSizeBytes = layout.m_sizeBytes;
+	cameraHandle->m_deviceHandle = -1;
+	cameraHandle->m_replay = replay;
+	cameraHandle->m_createTimestamp = timeStart;
+	cameraHandle->m_metrics = cameraHandle->m_metricsLocal;
+	cameraHandle->m_format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	cameraHandle->m_format.fmt.pix.width = i_sizeX;
+	cameraHandle->m_format.fmt.pix.height = i_sizeY;
+	camera_v4l2_pixel_format(i_pixelFormat, &cameraHandle->m_format.fmt.pix.pixelformat);
+	cameraHandle->m_format.fmt.pix.field = DEVICE_FIELD;
+	cameraHandle->m_format.fmt.pix.bytesperline = (uint32_t)layout.m_strideBytes[0];
+	cameraHandle->m_format.fmt.pix.sizeimage = (uint32_t)frameSizeBytes;
+	cameraHandle->m_pixelFormat = i_pixelFormat;
+
+	/***** Load every whole frame of the file *****/
+	fileHandle = fopen(i_pathname, "rb");
+	if(fileHandle == NULL || fseek(fileHandle, 0, SEEK_END) != 0 || (fileSizeBytes = ftell(fileHandle)) < 0 || fseek(fileHandle, 0, SEEK_SET) != 0)
+	{
+		CARL_ERRORNO("Unable to open replay file \"%s\".", i_pathname);
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+	replay->m_frameSizeBytes = frameSizeBytes;
+	replay->m_frameCount = (size_t)fileSizeBytes/frameSizeBytes;
+	if(replay->m_frameCount == 0)
+	{
+		CARL_ERROR("Replay file \"%s\" holds no whole %zu byte frame.", i_pathname, frameSizeBytes);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+	result = memory_region_map(replay->m_frameCount*(frameSizeBytes + sizeof(uint32_t)), MEMORY_FLAG_PREFAULT, &replay->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	if(fread(replay->m_region.m_memory, frameSizeBytes, replay->m_frameCount, fileHandle) != replay->m_frameCount)
+	{
+		CARL_ERRORNO("Unable to read replay file \"%s\".", i_pathname);
+
+		result = R_DEVICEREADFAILED;
+		goto end;
+	}
+	fclose(fileHandle);
+	fileHandle = NULL;
+
+	/***** One buffer per frame, all queued *****/
+	cameraHandle->m_buffers = calloc(replay->m_frameCount, sizeof(*(cameraHandle->m_buffers)));
+	if(cameraHandle->m_buffers == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	replay->m_queue = (uint32_t *)((uint8_t *)replay->m_region.m_memory + replay->m_frameCount*frameSizeBytes);
+	for(frameIndex=0; frameIndex<replay->m_frameCount; ++frameIndex)
+	{
+		cameraHandle->m_buffers[frameIndex].m_start = (uint8_t *)replay->m_region.m_memory + frameIndex*frameSizeBytes;
+		cameraHandle->m_buffers[frameIndex].m_sizeBytes = frameSizeBytes;
+		replay->m_queue[frameIndex] = (uint32_t)frameIndex;
+	}
+	cameraHandle->m_bufferCount = replay->m_frameCount;
+	cameraHandle->m_bufferCountMax = replay->m_frameCount;
+	replay->m_queueCount = replay->m_frameCount;
+
+	/***** Always readable, so event loops poll it like a device with frames waiting *****/
+	cameraHandle->m_deviceHandle = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(cameraHandle->m_deviceHandle < 0)
+	{
+		CARL_ERRORNO("Unable to create replay eventfd.");
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+	metrics_set(&cameraHandle->m_metrics[CAMERA_METRIC_OPEN_NS], timestamp_now() - timeStart);
+
+	if(o_cameraHandle != NULL)
+	{
+		(*o_cameraHandle) = cameraHandle;
+	}
+	else
+	{
+		camera_destroy(&cameraHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("camera_create_replay(%s, %d, %u, %u, %p)", (i_pathname != NULL) ? i_pathname : "(null)", i_pixelFormat, i_sizeX, i_sizeY, o_cameraHandle);
+	if(fileHandle != NULL)
+	{
+		fclose(fileHandle);
+	}
+	if(cameraHandle != NULL)
+	{
+		camera_destroy(&cameraHandle);
+	}
+
+	return result;
+}
+
 Result camera_destroy(Camera **const io_cameraHandle)
 {
 	size_t bufferIndex=0;
@@ -506,6 +1011,15 @@ Result camera_destroy(Camera **const io_cameraHandle)
 		return R_OBJECTNOTEXTANT;
 	}
 
+	/***** Replay buffers all live in one region *****/
+	if(cameraHandle->m_replay != NULL)
+	{
+		memory_region_unmap(&cameraHandle->m_replay->m_region);
+		free(cameraHandle->m_replay);
+		cameraHandle->m_replay = NULL;
+		cameraHandle->m_bufferCount = 0;
+	}
+
 	/***** Free the buffers *****/
 	if(cameraHandle->m_buffers != NULL)
 	{
@@ -526,6 +1040,9 @@ Result camera_destroy(Camera **const io_cameraHandle)
 		cameraHandle->m_deviceHandle = -1;
 	}
 
+	/***** Give the metrics slot back so the page can be reused or destroyed *****/
+	camera_metrics_export(NULL, NULL, cameraHandle);
+
 	/***** Free camera structure *****/
 	free(cameraHandle);
 	(*io_cameraHandle) = NULL;
@@ -534,13 +1051,243 @@ Result camera_destroy(Camera **const io_cameraHandle)
 	return R_SUCCESS;
 }
 
+Result camera_recorder_set(	Recorder * const i_recorderHandle,
+									uint16_t const i_source,
+									Camera * const io_cameraHandle)
+{
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	io_cameraHandle->m_recorder = i_recorderHandle;
+	io_cameraHandle->m_recorderSource = i_source;
+
+	return R_SUCCESS;
+}
+
+Result camera_fd(Camera const * const i_cameraHandle, int * const o_fd)
+{
+	if(i_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_fd != NULL)
+	{
+		(*o_fd) = i_cameraHandle->m_deviceHandle;
+	}
+
+	return R_SUCCESS;
+}
+
+Result camera_frame_layout(	PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										size_t const i_strideBytes,
+										CameraFrameLayout * const o_layout)
+{
+	size_t bytesPerPixel = 1;
+	int evenX = 0;
+	int evenY = 0;
+
+	switch(i_pixelFormat)
+	{
+		case CAMERA_PIXELFORMAT_UYVY:
+		case CAMERA_PIXELFORMAT_YUYV:
+			bytesPerPixel = 2;
+			evenX = 1;
+			break;
+		case CAMERA_PIXELFORMAT_Y10:
+		case CAMERA_PIXELFORMAT_Y16:
+			bytesPerPixel = 2;
+			break;
+		case CAMERA_PIXELFORMAT_GREY:
+			break;
+		case CAMERA_PIXELFORMAT_NV12:
+		case CAMERA_PIXELFORMAT_NV21:
+			evenX = 1;
+			evenY = 1;
+			break;
+		default:
+			return R_INPUTBAD;
+	}
+	if(o_layout == NULL || i_sizeX == 0 || i_sizeY == 0 || (evenX && i_sizeX%2 != 0) || (evenY && i_sizeY%2 != 0) || (i_strideBytes != 0 && i_strideBytes < i_sizeX*bytesPerPixel))
+	{
+		return R_INPUTBAD;
+	}
+
+	CLEAR(*o_layout);
+	o_layout->m_pixelFormat = i_pixelFormat;
+	o_layout->m_sizeX = i_sizeX;
+	o_layout->m_sizeY = i_sizeY;
+	o_layout->m_planeCount = 1;
+	o_layout->m_strideBytes[0] = (i_strideBytes != 0) ? i_strideBytes : i_sizeX*bytesPerPixel;
+	o_layout->m_sizeBytes = o_layout->m_strideBytes[0]*i_sizeY;
+
+	/***** Semi-planar chroma follows luma at the same stride, one row per two *****/
+	if(i_pixelFormat == CAMERA_PIXELFORMAT_NV12 || i_pixelFormat == CAMERA_PIXELFORMAT_NV21)
+	{
+		o_layout->m_planeCount = 2;
+		o_layout->m_planeOffset[1] = o_layout->m_sizeBytes;
+		o_layout->m_strideBytes[1] = o_layout->m_strideBytes[0];
+		o_layout->m_sizeBytes += o_layout->m_strideBytes[1]*(i_sizeY/2);
+	}
+
+	return R_SUCCESS;
+}
+
+Result camera_histogram_set(Histogram * const i_latencyHistogram, Camera * const io_cameraHandle)
+{
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	io_cameraHandle->m_latencyHistogram = i_latencyHistogram;
+
+	return R_SUCCESS;
+}
+
+Result camera_layout(Camera const * const i_cameraHandle, CameraFrameLayout * const o_layout)
+{
+	if(i_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	return camera_frame_layout(i_cameraHandle->m_pixelFormat, i_cameraHandle->m_format.fmt.pix.width, i_cameraHandle->m_format.fmt.pix.height, i_cameraHandle->m_format.fmt.pix.bytesperline, o_layout);
+}
+
+Result camera_metrics(CameraMetrics * const o_metrics, Camera const * const i_cameraHandle)
+{
+	uint64_t values[CAMERA_METRIC_COUNT];
+
+	if(i_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	metrics_snapshot(__atomic_load_n(&i_cameraHandle->m_metrics, __ATOMIC_ACQUIRE), CAMERA_METRIC_COUNT, values);
+	if(o_metrics != NULL)
+	{
+		o_metrics->m_framesCaptured = values[CAMERA_METRIC_FRAMES];
+		o_metrics->m_dequeueRetries = values[CAMERA_METRIC_DEQUEUE_RETRIES];
+		o_metrics->m_dequeueNs = values[CAMERA_METRIC_DEQUEUE_NS];
+		o_metrics->m_enqueueNs = values[CAMERA_METRIC_ENQUEUE_NS];
+		o_metrics->m_callbackNs = values[CAMERA_METRIC_CALLBACK_NS];
+		o_metrics->m_callbackNsMax = values[CAMERA_METRIC_CALLBACK_NS_MAX];
+		o_metrics->m_sequenceGaps = values[CAMERA_METRIC_SEQUENCE_GAPS];
+		o_metrics->m_errors = values[CAMERA_METRIC_ERRORS];
+		o_metrics->m_lastFrameTimestamp = values[CAMERA_METRIC_LAST_FRAME];
+		o_metrics->m_openNs = values[CAMERA_METRIC_OPEN_NS];
+		o_metrics->m_firstFrameNs = values[CAMERA_METRIC_FIRST_FRAME_NS];
+	}
+
+	return R_SUCCESS;
+}
+
+Result camera_metrics_export(	char const * const i_name,
+										MetricsPage * const io_pageHandle,
+										Camera * const io_cameraHandle)
+{
+	Result result = R_FAILURE;
+	uint64_t *values = NULL;
+	uint64_t *previous = NULL;
+
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_pageHandle == NULL && io_cameraHandle->m_metricsPage == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	values = io_cameraHandle->m_metricsLocal;
+	if(io_pageHandle != NULL)
+	{
+		result = metrics_page_slot(i_name, "camera", CAMERA_METRIC_NAMES, CAMERA_METRIC_COUNT, &values, io_pageHandle);
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+	}
+
+	/***** Switch the writers over first, so whatever they count until then is still carried *****/
+	previous = __atomic_exchange_n(&io_cameraHandle->m_metrics, values, __ATOMIC_ACQ_REL);
+	metrics_carry(previous, values, CAMERA_METRIC_COUNT, CAMERA_METRIC_GAUGES);
+	if(io_cameraHandle->m_metricsPage != NULL)
+	{
+		metrics_page_release(previous, io_cameraHandle->m_metricsPage);
+	}
+	io_cameraHandle->m_metricsPage = io_pageHandle;
+
+	return R_SUCCESS;
+}
+
+Result camera_prefault(Camera * const io_cameraHandle)
+{
+	size_t bufferIndex = 0;
+	size_t offset = 0;
+	size_t const pageSizeBytes = (size_t)sysconf(_SC_PAGESIZE);
+	Result result = R_SUCCESS;
+	uint8_t sum = 0;
+
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	for(bufferIndex=0; bufferIndex<io_cameraHandle->m_bufferCount; ++bufferIndex)
+	{
+		/***** Touch every page so the first frames take no faults *****/
+		for(offset=0; offset<io_cameraHandle->m_buffers[bufferIndex].m_sizeBytes; offset+=pageSizeBytes)
+		{
+			sum += ((uint8_t volatile *)io_cameraHandle->m_buffers[bufferIndex].m_start)[offset];
+		}
+
+		/***** Keep them resident *****/
+		if(mlock(io_cameraHandle->m_buffers[bufferIndex].m_start, io_cameraHandle->m_buffers[bufferIndex].m_sizeBytes) == -1)
+		{
+			CARL_ERRORNO("Unable to lock buffer %zu - needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK.", bufferIndex);
+
+			result = R_MEMORYLOCKFAILED;
+		}
+	}
+	(void)sum;
+
+	return result;
+}
+
 Result camera_start(Camera *const io_cameraHandle)
 {
 	int xioResult = -1;
 	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
 	/***** Start capturing *****/
-	xioResult = xioctl(io_cameraHandle->m_deviceHandle, VIDIOC_STREAMON, &type);
+	xioResult = camera_ioctl(io_cameraHandle, VIDIOC_STREAMON, &type);
 	if(xioResult == -1)
 	{
 		CARL_ERROR("xioctl - \"%s\"", strerror(errno));
@@ -556,8 +1303,15 @@ Result camera_stop(Camera * const io_cameraHandle)
 	int xioResult = -1;
 	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
+	if(io_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
 	/***** Stop capturing *****/
-	xioResult = xioctl(io_cameraHandle->m_deviceHandle, VIDIOC_STREAMOFF, &type);
+	xioResult = camera_ioctl(io_cameraHandle, VIDIOC_STREAMOFF, &type);
 	if(xioResult == -1)
 	{
 		CARL_ERROR("xioctl - \"%s\"", strerror(errno));
@@ -568,3 +1322,19 @@ Result camera_stop(Camera * const io_cameraHandle)
 	return R_SUCCESS;
 }
 
+Result camera_timestamp(Camera const * const i_cameraHandle, Timestamp * const o_timestamp)
+{
+	if(i_cameraHandle == NULL)
+	{
+		CARL_ERROR("Camera not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_timestamp != NULL)
+	{
+		(*o_timestamp) = i_cameraHandle->m_timestamp;
+	}
+
+	return R_SUCCESS;
+}
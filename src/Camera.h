@@ -6,6 +6,12 @@ extern "C" {
 #endif
 
 #include "carl.h"
+#include "CameraCache.h"
+#include "Histogram.h"
+#include "Metrics.h"
+#include "Recorder.h"
+#include "TaskPool.h"
+#include "Timestamp.h"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -20,23 +26,114 @@ enum PixelFormat_e
 {
 	CAMERA_PIXELFORMAT_MJPEG,
 	CAMERA_PIXELFORMAT_UYVY,
-	CAMERA_PIXELFORMAT_YUYV
+	CAMERA_PIXELFORMAT_YUYV,
+	CAMERA_PIXELFORMAT_GREY,
+	CAMERA_PIXELFORMAT_Y10,
+	CAMERA_PIXELFORMAT_Y16,
+	CAMERA_PIXELFORMAT_NV12,
+	CAMERA_PIXELFORMAT_NV21
 };
 typedef enum PixelFormat_e PixelFormat;
 /**************************************************/
 
+/********************----- STRUCT: CameraFrameLayout -----********************/
+/* Where each plane of an uncompressed frame lives; Y10 and Y16 hold one little-endian 16-bit word per pixel */
+#define CAMERA_PLANE_COUNT_MAX 2
+struct CameraFrameLayout_s
+{
+	PixelFormat m_pixelFormat;
+	uint32_t m_sizeX;
+	uint32_t m_sizeY;
+	uint32_t m_planeCount;
+	size_t m_planeOffset[CAMERA_PLANE_COUNT_MAX];
+	size_t m_strideBytes[CAMERA_PLANE_COUNT_MAX];
+	size_t m_sizeBytes;
+};
+typedef struct CameraFrameLayout_s CameraFrameLayout;
+/**************************************************/
+
+/********************----- STRUCT: CameraMetrics -----********************/
+struct CameraMetrics_s
+{
+	uint64_t m_framesCaptured;
+	uint64_t m_dequeueRetries;
+	uint64_t m_dequeueNs;
+	uint64_t m_enqueueNs;
+	uint64_t m_callbackNs;
+	uint64_t m_callbackNsMax;
+	uint64_t m_sequenceGaps;
+	uint64_t m_errors;
+	Timestamp m_lastFrameTimestamp;
+	uint64_t m_openNs;
+	uint64_t m_firstFrameNs;
+};
+typedef struct CameraMetrics_s CameraMetrics;
+/**************************************************/
+
+/********************----- STRUCT: CameraRequest -----********************/
+struct CameraRequest_s
+{
+	int32_t m_deviceID;
+	PixelFormat m_pixelFormat;
+	uint32_t m_sizeX;
+	uint32_t m_sizeY;
+};
+typedef struct CameraRequest_s CameraRequest;
+/**************************************************/
+
 typedef void (*CameraCallback)(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, void * const i_callbackData);
 
 Result camera_capture_callback(CameraCallback i_callback, void * const i_callbackData, Camera * const io_cameraHandle);
 Result camera_capture_copy(size_t const i_outputSizeBytesMax, uint8_t * const o_outputBuffer, Camera * const io_cameraHandle);
+Result camera_capture_try(CameraCallback i_callback, void * const i_callbackData, Camera * const io_cameraHandle);
 Result camera_create(int32_t i_deviceID,
 							PixelFormat const i_pixelFormat,
 							uint32_t const i_sizeX,
 							uint32_t const i_sizeY,
 							Camera ** const o_cameraHandle);
+/* Reuses what this device negotiated for this mode before, keyed by port, driver, card and capabilities; a NULL cache behaves like camera_create */
+Result camera_create_cached(	int32_t const i_deviceID,
+										PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										CameraCache * const io_cacheHandle,
+										Camera ** const o_cameraHandle);
+/* Opens every request on the pool at once; each gets its own handle and result, and the first failure in request order is returned */
+Result camera_create_many(	CameraRequest const * const i_requests,
+										size_t const i_requestCount,
+										CameraCache * const io_cacheHandle,
+										Camera ** const o_cameraHandles,
+										Result * const o_results,
+										TaskPool * const io_poolHandle);
+/* Plays raw frames from a file in a loop through the normal capture path, for tests and benchmarks */
+Result camera_create_replay(	char const * const i_pathname,
+										PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										Camera ** const o_cameraHandle);
 Result camera_destroy(Camera **const io_cameraHandle);
+Result camera_metrics(CameraMetrics * const o_metrics, Camera const * const i_cameraHandle);
+/* Counts straight into a page slot; a NULL page, or destroy, moves the counts back into the handle and frees the slot */
+Result camera_metrics_export(	char const * const i_name,
+										MetricsPage * const io_pageHandle,
+										Camera * const io_cameraHandle);
+Result camera_prefault(Camera * const io_cameraHandle);
+Result camera_recorder_set(	Recorder * const i_recorderHandle,
+									uint16_t const i_source,
+									Camera * const io_cameraHandle);
+Result camera_fd(Camera const * const i_cameraHandle, int * const o_fd);
+/* A stride of 0 means rows are packed; MJPEG has no fixed layout */
+Result camera_frame_layout(	PixelFormat const i_pixelFormat,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										size_t const i_strideBytes,
+										CameraFrameLayout * const o_layout);
+Result camera_histogram_set(Histogram * const i_latencyHistogram, Camera * const io_cameraHandle);
+/* Layout with the stride the driver negotiated */
+Result camera_layout(Camera const * const i_cameraHandle, CameraFrameLayout * const o_layout);
 Result camera_start(Camera *const io_cameraHandle);
 Result camera_stop(Camera * const io_cameraHandle);
+Result camera_timestamp(Camera const * const i_cameraHandle, Timestamp * const o_timestamp);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,313 @@
+#include "CameraCache.h"
+
+#include <linux/limits.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char const * const CAMERA_CACHE_HEADER = "carl-camera-cache 2";
+
+/********************----- STRUCT: CameraCache -----********************/
+struct CameraCache_s
+{
+	pthread_mutex_t m_lock;
+	char m_pathname[PATH_MAX];
+	CameraCacheEntry m_entries[CAMERA_CACHE_ENTRY_MAX];
+	size_t m_entryCount;
+	int m_dirty;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+/* Driver-chosen strings; whitespace becomes '_' and empty becomes '-' so each is one token in the file */
+static void camera_cache_token(char const * const i_text, size_t const i_lengthMax, char * const o_token)
+{
+	size_t index = 0;
+
+	memset(o_token, 0, i_lengthMax);
+	for(index=0; index+1<i_lengthMax && i_text[index] != '\0'; ++index)
+	{
+		o_token[index] = isspace((unsigned char)i_text[index]) ? '_' : i_text[index];
+	}
+	if(index == 0)
+	{
+		o_token[0] = '-';
+	}
+}
+
+static void camera_cache_key(CameraCacheEntry const * const i_entry, CameraCacheEntry * const o_key)
+{
+	memcpy(o_key, i_entry, sizeof(CameraCacheEntry));
+	camera_cache_token(i_entry->m_busInfo, CAMERA_CACHE_BUS_INFO_LENGTH, o_key->m_busInfo);
+	camera_cache_token(i_entry->m_driver, CAMERA_CACHE_DRIVER_LENGTH, o_key->m_driver);
+	camera_cache_token(i_entry->m_card, CAMERA_CACHE_CARD_LENGTH, o_key->m_card);
+}
+
+/* Caller holds the lock */
+static CameraCacheEntry *camera_cache_find(CameraCacheEntry const * const i_key, CameraCache * const io_cacheHandle)
+{
+	size_t index = 0;
+
+	for(index=0; index<io_cacheHandle->m_entryCount; ++index)
+	{
+		CameraCacheEntry * const entry = &io_cacheHandle->m_entries[index];
+
+		if(entry->m_fourcc == i_key->m_fourcc && entry->m_sizeX == i_key->m_sizeX && entry->m_sizeY == i_key->m_sizeY && entry->m_capabilities == i_key->m_capabilities
+			&& memcmp(entry->m_busInfo, i_key->m_busInfo, CAMERA_CACHE_BUS_INFO_LENGTH) == 0 && memcmp(entry->m_driver, i_key->m_driver, CAMERA_CACHE_DRIVER_LENGTH) == 0 && memcmp(entry->m_card, i_key->m_card, CAMERA_CACHE_CARD_LENGTH) == 0)
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void camera_cache_load(CameraCache * const io_cacheHandle)
+{
+	FILE *fileHandle = NULL;
+	char line[256];
+	CameraCacheEntry entry;
+
+	fileHandle = fopen(io_cacheHandle->m_pathname, "r");
+	if(fileHandle == NULL)
+	{
+		return;
+	}
+
+	/***** A file from another version is ignored and rewritten on the next save *****/
+	if(fgets(line, sizeof(line), fileHandle) == NULL || strncmp(line, CAMERA_CACHE_HEADER, strlen(CAMERA_CACHE_HEADER)) != 0)
+	{
+		fclose(fileHandle);
+		return;
+	}
+	while(io_cacheHandle->m_entryCount < CAMERA_CACHE_ENTRY_MAX && fgets(line, sizeof(line), fileHandle) != NULL)
+	{
+		CLEAR(entry);
+		if(sscanf(line, "%31s %15s %31s %x %x %u %u %u %u %d", entry.m_busInfo, entry.m_driver, entry.m_card, &entry.m_capabilities, &entry.m_fourcc, &entry.m_sizeX, &entry.m_sizeY, &entry.m_strideBytes, &entry.m_sizeBytes, &entry.m_accepted) == 10)
+		{
+			memcpy(&io_cacheHandle->m_entries[io_cacheHandle->m_entryCount], &entry, sizeof(CameraCacheEntry));
+			++io_cacheHandle->m_entryCount;
+		}
+	}
+	fclose(fileHandle);
+}
+/**************************************************/
+
+size_t camera_cache_count(CameraCache * const io_cacheHandle)
+{
+	size_t count = 0;
+
+	if(io_cacheHandle == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&io_cacheHandle->m_lock);
+	count = io_cacheHandle->m_entryCount;
+	pthread_mutex_unlock(&io_cacheHandle->m_lock);
+
+	return count;
+}
+
+Result camera_cache_create(char const * const i_pathname, CameraCache ** const o_cacheHandle)
+{
+	CameraCache *cacheHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_pathname != NULL && strlen(i_pathname) >= PATH_MAX)
+	{
+		CARL_ERROR("Camera cache pathname is too long.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create cache structure *****/
+	cacheHandle = (CameraCache *)calloc(1, sizeof(CameraCache));
+	if(cacheHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	pthread_mutex_init(&cacheHandle->m_lock, NULL);
+
+	if(i_pathname != NULL)
+	{
+		strcpy(cacheHandle->m_pathname, i_pathname);
+		camera_cache_load(cacheHandle);
+	}
+
+	if(o_cacheHandle != NULL)
+	{
+		(*o_cacheHandle) = cacheHandle;
+	}
+	else
+	{
+		camera_cache_destroy(&cacheHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("camera_cache_create(%s, %p)", (i_pathname != NULL) ? i_pathname : "(null)", (void *)o_cacheHandle);
+	camera_cache_destroy(&cacheHandle);
+
+	return result;
+}
+
+Result camera_cache_destroy(CameraCache ** const io_cacheHandle)
+{
+	CameraCache *cacheHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_cacheHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	cacheHandle = (*io_cacheHandle);
+	if(cacheHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	pthread_mutex_destroy(&cacheHandle->m_lock);
+	free(cacheHandle);
+	(*io_cacheHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result camera_cache_lookup(	CameraCacheEntry const * const i_key,
+										CameraCacheEntry * const o_entry,
+										int * const o_found,
+										CameraCache * const io_cacheHandle)
+{
+	CameraCacheEntry key;
+	CameraCacheEntry const *entry = NULL;
+
+	if(io_cacheHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_key == NULL || o_entry == NULL || o_found == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	camera_cache_key(i_key, &key);
+	pthread_mutex_lock(&io_cacheHandle->m_lock);
+	entry = camera_cache_find(&key, io_cacheHandle);
+	if(entry != NULL)
+	{
+		memcpy(o_entry, entry, sizeof(CameraCacheEntry));
+	}
+	pthread_mutex_unlock(&io_cacheHandle->m_lock);
+	(*o_found) = (entry != NULL);
+
+	return R_SUCCESS;
+}
+
+Result camera_cache_save(CameraCache * const io_cacheHandle)
+{
+	char temporaryPathname[PATH_MAX + sizeof(".tmp")];
+	FILE *fileHandle = NULL;
+	size_t index = 0;
+	int writeFailed = 0;
+	Result result = R_SUCCESS;
+
+	if(io_cacheHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_cacheHandle->m_pathname[0] == '\0')
+	{
+		return R_SUCCESS;
+	}
+
+	pthread_mutex_lock(&io_cacheHandle->m_lock);
+	if(!io_cacheHandle->m_dirty)
+	{
+		pthread_mutex_unlock(&io_cacheHandle->m_lock);
+		return R_SUCCESS;
+	}
+
+	/***** Readers never see a half-written cache *****/
+	snprintf(temporaryPathname, sizeof(temporaryPathname), "%s.tmp", io_cacheHandle->m_pathname);
+	fileHandle = fopen(temporaryPathname, "w");
+	if(fileHandle == NULL)
+	{
+		CARL_ERRORNO("Unable to open camera cache \"%s\".", temporaryPathname);
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+	fprintf(fileHandle, "%s\n", CAMERA_CACHE_HEADER);
+	for(index=0; index<io_cacheHandle->m_entryCount; ++index)
+	{
+		CameraCacheEntry const * const entry = &io_cacheHandle->m_entries[index];
+
+		fprintf(fileHandle, "%s %s %s %08x %08x %u %u %u %u %d\n", entry->m_busInfo, entry->m_driver, entry->m_card, entry->m_capabilities, entry->m_fourcc, entry->m_sizeX, entry->m_sizeY, entry->m_strideBytes, entry->m_sizeBytes, entry->m_accepted);
+	}
+	writeFailed = ferror(fileHandle);
+	writeFailed |= (fclose(fileHandle) != 0);
+	if(writeFailed || rename(temporaryPathname, io_cacheHandle->m_pathname) != 0)
+	{
+		CARL_ERRORNO("Unable to write camera cache \"%s\".", io_cacheHandle->m_pathname);
+		remove(temporaryPathname);
+
+		result = R_DEVICEWRITEFAILED;
+		goto end;
+	}
+	io_cacheHandle->m_dirty = 0;
+
+end:
+	pthread_mutex_unlock(&io_cacheHandle->m_lock);
+
+	return result;
+}
+
+Result camera_cache_store(CameraCacheEntry const * const i_entry, CameraCache * const io_cacheHandle)
+{
+	CameraCacheEntry key;
+	CameraCacheEntry *entry = NULL;
+	Result result = R_SUCCESS;
+
+	if(io_cacheHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_entry == NULL || i_entry->m_busInfo[0] == '\0')
+	{
+		return R_INPUTBAD;
+	}
+
+	camera_cache_key(i_entry, &key);
+	pthread_mutex_lock(&io_cacheHandle->m_lock);
+	entry = camera_cache_find(&key, io_cacheHandle);
+	if(entry == NULL && io_cacheHandle->m_entryCount < CAMERA_CACHE_ENTRY_MAX)
+	{
+		entry = &io_cacheHandle->m_entries[io_cacheHandle->m_entryCount];
+		++io_cacheHandle->m_entryCount;
+	}
+	if(entry == NULL)
+	{
+		result = R_BUFFERFULL;
+	}
+	else if(memcmp(entry, &key, sizeof(CameraCacheEntry)) != 0)
+	{
+		memcpy(entry, &key, sizeof(CameraCacheEntry));
+		io_cacheHandle->m_dirty = 1;
+	}
+	pthread_mutex_unlock(&io_cacheHandle->m_lock);
+
+	return result;
+}
@@ -0,0 +1,58 @@
+#ifndef _CAMERACACHE_H_
+#define _CAMERACACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAMERA_CACHE_BUS_INFO_LENGTH 32
+#define CAMERA_CACHE_DRIVER_LENGTH 16
+#define CAMERA_CACHE_CARD_LENGTH 32
+#define CAMERA_CACHE_ENTRY_MAX 128
+
+/********************----- STRUCT: CameraCache -----********************/
+struct CameraCache_s;
+typedef struct CameraCache_s CameraCache;
+/**************************************************/
+
+/********************----- STRUCT: CameraCacheEntry -----********************/
+/* What one device negotiated for one requested mode; the device is identified by port, driver, card and capabilities, so a different camera on the same port never matches */
+struct CameraCacheEntry_s
+{
+	char m_busInfo[CAMERA_CACHE_BUS_INFO_LENGTH];
+	char m_driver[CAMERA_CACHE_DRIVER_LENGTH];
+	char m_card[CAMERA_CACHE_CARD_LENGTH];
+	uint32_t m_capabilities;
+	uint32_t m_fourcc;
+	uint32_t m_sizeX;
+	uint32_t m_sizeY;
+	uint32_t m_strideBytes;
+	uint32_t m_sizeBytes;
+	int32_t m_accepted;
+};
+typedef struct CameraCacheEntry_s CameraCacheEntry;
+/**************************************************/
+
+size_t camera_cache_count(CameraCache * const io_cacheHandle);
+/* Loads i_pathname if it exists; a NULL pathname keeps the cache in memory only */
+Result camera_cache_create(char const * const i_pathname, CameraCache ** const o_cacheHandle);
+Result camera_cache_destroy(CameraCache ** const io_cacheHandle);
+/* Matches on every field of i_key up to m_sizeY; lookup and store may be called from any thread */
+Result camera_cache_lookup(	CameraCacheEntry const * const i_key,
+										CameraCacheEntry * const o_entry,
+										int * const o_found,
+										CameraCache * const io_cacheHandle);
+/* Writes through a temporary file and a rename, and only when something changed */
+Result camera_cache_save(CameraCache * const io_cacheHandle);
+Result camera_cache_store(CameraCacheEntry const * const i_entry, CameraCache * const io_cacheHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _CAMERACACHE_H_ */
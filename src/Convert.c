@@ -0,0 +1,462 @@
+#include "Convert.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CONVERT_CHROMA_NEUTRAL 0x80
+
+/********************----- STRUCT: ConvertJob -----********************/
+struct ConvertJob_s
+{
+	uint8_t const *m_frameData;
+	CameraFrameLayout const *m_layout;
+	uint8_t *m_output;
+};
+typedef struct ConvertJob_s ConvertJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+/* Little-endian 16-bit words to bytes: (word >> shift) & mask, saturated */
+static void convert_words_row(uint8_t const * const i_row, size_t const i_sizeX, unsigned int const i_shift, uint16_t const i_mask, uint8_t * const o_output)
+{
+	size_t x = 0;
+
+#ifdef __SSE2__
+	{
+		__m128i const mask = _mm_set1_epi16((short)i_mask);
+		__m128i const shift = _mm_cvtsi32_si128((int)i_shift);
+
+		for(; x+16<=i_sizeX; x+=16)
+		{
+			__m128i const low = _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((__m128i const *)(i_row + 2*x)), shift), mask);
+			__m128i const high = _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((__m128i const *)(i_row + 2*x + 16)), shift), mask);
+
+			_mm_storeu_si128((__m128i *)(o_output + x), _mm_packus_epi16(low, high));
+		}
+	}
+#endif
+	for(; x<i_sizeX; ++x)
+	{
+		unsigned int const value = (((unsigned int)i_row[2*x] | ((unsigned int)i_row[2*x + 1] << 8)) >> i_shift) & i_mask;
+
+		o_output[x] = (uint8_t)MIN(value, 255);
+	}
+}
+
+static void convert_luma_row(uint8_t const * const i_row, CameraFrameLayout const * const i_layout, uint8_t * const o_luma)
+{
+	switch(i_layout->m_pixelFormat)
+	{
+		case CAMERA_PIXELFORMAT_YUYV:
+			convert_words_row(i_row, i_layout->m_sizeX, 0, 0x00FF, o_luma);
+			break;
+		case CAMERA_PIXELFORMAT_UYVY:
+		case CAMERA_PIXELFORMAT_Y16:
+			convert_words_row(i_row, i_layout->m_sizeX, 8, 0xFFFF, o_luma);
+			break;
+		case CAMERA_PIXELFORMAT_Y10:
+			convert_words_row(i_row, i_layout->m_sizeX, 2, 0xFFFF, o_luma);
+			break;
+		default:
+			memcpy(o_luma, i_row, i_layout->m_sizeX);
+			break;
+	}
+}
+
+/* Interleaves a luma row with a chroma row already in U,V order, or V,U when i_swap is set */
+static void convert_interleave_row(uint8_t const * const i_luma, uint8_t const * const i_chroma, int const i_swap, size_t const i_sizeX, uint8_t * const o_yuyv)
+{
+	size_t x = 0;
+
+#ifdef __SSE2__
+	for(; x+16<=i_sizeX; x+=16)
+	{
+		__m128i const luma = _mm_loadu_si128((__m128i const *)(i_luma + x));
+		__m128i chroma = _mm_loadu_si128((__m128i const *)(i_chroma + x));
+
+		if(i_swap)
+		{
+			chroma = _mm_or_si128(_mm_slli_epi16(chroma, 8), _mm_srli_epi16(chroma, 8));
+		}
+		_mm_storeu_si128((__m128i *)(o_yuyv + 2*x), _mm_unpacklo_epi8(luma, chroma));
+		_mm_storeu_si128((__m128i *)(o_yuyv + 2*x + 16), _mm_unpackhi_epi8(luma, chroma));
+	}
+#endif
+	for(; x<i_sizeX; x+=2)
+	{
+		o_yuyv[2*x] = i_luma[x];
+		o_yuyv[2*x + 1] = i_chroma[x + (i_swap ? 1 : 0)];
+		o_yuyv[2*x + 2] = i_luma[x + 1];
+		o_yuyv[2*x + 3] = i_chroma[x + (i_swap ? 0 : 1)];
+	}
+}
+
+static void convert_grey_row(uint8_t const * const i_luma, size_t const i_sizeX, uint8_t * const o_yuyv)
+{
+	size_t x = 0;
+
+#ifdef __SSE2__
+	{
+		__m128i const neutral = _mm_set1_epi8((char)CONVERT_CHROMA_NEUTRAL);
+
+		for(; x+16<=i_sizeX; x+=16)
+		{
+			__m128i const luma = _mm_loadu_si128((__m128i const *)(i_luma + x));
+
+			_mm_storeu_si128((__m128i *)(o_yuyv + 2*x), _mm_unpacklo_epi8(luma, neutral));
+			_mm_storeu_si128((__m128i *)(o_yuyv + 2*x + 16), _mm_unpackhi_epi8(luma, neutral));
+		}
+	}
+#endif
+	for(; x<i_sizeX; ++x)
+	{
+		o_yuyv[2*x] = i_luma[x];
+		o_yuyv[2*x + 1] = CONVERT_CHROMA_NEUTRAL;
+	}
+}
+
+static void convert_luma_rows(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	ConvertJob const * const job = (ConvertJob const *)i_taskData;
+	size_t row = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		convert_luma_row(job->m_frameData + row*job->m_layout->m_strideBytes[0], job->m_layout, job->m_output + row*job->m_layout->m_sizeX);
+	}
+}
+
+static void convert_yuyv_row(ConvertJob const * const i_job, size_t const i_row, uint8_t * const o_yuyv)
+{
+	CameraFrameLayout const * const layout = i_job->m_layout;
+	uint8_t const * const input = i_job->m_frameData + i_row*layout->m_strideBytes[0];
+	size_t const sizeX = layout->m_sizeX;
+	size_t x = 0;
+
+	switch(layout->m_pixelFormat)
+	{
+		case CAMERA_PIXELFORMAT_YUYV:
+			memcpy(o_yuyv, input, sizeX*2);
+			break;
+		case CAMERA_PIXELFORMAT_UYVY:
+#ifdef __SSE2__
+			for(; x+8<=sizeX; x+=8)
+			{
+				__m128i const pixels = _mm_loadu_si128((__m128i const *)(input + 2*x));
+
+				_mm_storeu_si128((__m128i *)(o_yuyv + 2*x), _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8)));
+			}
+#endif
+			for(; x<sizeX; ++x)
+			{
+				o_yuyv[2*x] = input[2*x + 1];
+				o_yuyv[2*x + 1] = input[2*x];
+			}
+			break;
+		case CAMERA_PIXELFORMAT_NV12:
+		case CAMERA_PIXELFORMAT_NV21:
+			convert_interleave_row(input, i_job->m_frameData + layout->m_planeOffset[1] + (i_row/2)*layout->m_strideBytes[1], layout->m_pixelFormat == CAMERA_PIXELFORMAT_NV21, sizeX, o_yuyv);
+			break;
+		default:
+			/***** Monochrome: 8-bit luma into the back half of the output row, then spread it forward *****/
+			convert_luma_row(input, layout, o_yuyv + sizeX);
+			convert_grey_row(o_yuyv + sizeX, sizeX, o_yuyv);
+			break;
+	}
+}
+
+static uint8_t convert_clamp(int const i_value)
+{
+	return (uint8_t)((i_value < 0) ? 0 : ((i_value > 255) ? 255 : i_value));
+}
+
+/* BT.601 limited range in 10.6 fixed point, which keeps every SSE2 term inside 16 bits; each chunk of pixels is read before its output overwrites it */
+static void convert_rgb_row(uint8_t const * const i_yuyv, size_t const i_sizeX, uint8_t * const o_rgb)
+{
+	size_t x = 0;
+
+#ifdef __SSE2__
+	{
+		__m128i const low = _mm_set1_epi16(0x00FF);
+		__m128i const lumaOffset = _mm_set1_epi16(16);
+		__m128i const chromaOffset = _mm_set1_epi16(128);
+		__m128i const lumaScale = _mm_set1_epi16(74);
+		__m128i const rounding = _mm_set1_epi16(32);
+		__m128i const redV = _mm_set1_epi16(102);
+		__m128i const greenU = _mm_set1_epi16(-25);
+		__m128i const greenV = _mm_set1_epi16(-52);
+		__m128i const blueU = _mm_set1_epi16(129);
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const pixelLow = _mm_set1_epi64x(0x0000000000FFFFFFll);
+		__m128i const pixelHigh = _mm_set1_epi64x(0x0000FFFFFF000000ll);
+		uint8_t planes[3][16];
+		size_t pixel = 0;
+
+		for(; x+16<=i_sizeX; x+=16)
+		{
+			__m128i const pixels0 = _mm_loadu_si128((__m128i const *)(i_yuyv + 2*x));
+			__m128i const pixels1 = _mm_loadu_si128((__m128i const *)(i_yuyv + 2*x + 16));
+			__m128i const chroma0 = _mm_sub_epi16(_mm_srli_epi16(pixels0, 8), chromaOffset);
+			__m128i const chroma1 = _mm_sub_epi16(_mm_srli_epi16(pixels1, 8), chromaOffset);
+			__m128i luma[2];
+			__m128i u[2];
+			__m128i v[2];
+			__m128i red[2];
+			__m128i green[2];
+			__m128i blue[2];
+			size_t half = 0;
+
+			luma[0] = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(pixels0, low), lumaOffset), lumaScale), rounding);
+			luma[1] = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(pixels1, low), lumaOffset), lumaScale), rounding);
+			/***** Lanes hold U,V pairs; spread each over its two pixels *****/
+			u[0] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+			v[0] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma0, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+			u[1] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma1, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+			v[1] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma1, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+			for(half=0; half<2; ++half)
+			{
+				red[half] = _mm_srai_epi16(_mm_adds_epi16(luma[half], _mm_mullo_epi16(v[half], redV)), 6);
+				green[half] = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(luma[half], _mm_mullo_epi16(u[half], greenU)), _mm_mullo_epi16(v[half], greenV)), 6);
+				blue[half] = _mm_srai_epi16(_mm_adds_epi16(luma[half], _mm_mullo_epi16(u[half], blueU)), 6);
+			}
+			red[0] = _mm_packus_epi16(red[0], red[1]);
+			green[0] = _mm_packus_epi16(green[0], green[1]);
+			blue[0] = _mm_packus_epi16(blue[0], blue[1]);
+
+			if(x+16 < i_sizeX)
+			{
+				/***** RGB0 per pixel, squeezed to 6 bytes per 64-bit lane; each 8-byte store's 2 spare bytes are overwritten by the next *****/
+				__m128i const redGreenLow = _mm_unpacklo_epi8(red[0], green[0]);
+				__m128i const redGreenHigh = _mm_unpackhi_epi8(red[0], green[0]);
+				__m128i const blueLow = _mm_unpacklo_epi8(blue[0], zero);
+				__m128i const blueHigh = _mm_unpackhi_epi8(blue[0], zero);
+				__m128i quads[4];
+				size_t quad = 0;
+
+				quads[0] = _mm_unpacklo_epi16(redGreenLow, blueLow);
+				quads[1] = _mm_unpackhi_epi16(redGreenLow, blueLow);
+				quads[2] = _mm_unpacklo_epi16(redGreenHigh, blueHigh);
+				quads[3] = _mm_unpackhi_epi16(redGreenHigh, blueHigh);
+				for(quad=0; quad<4; ++quad)
+				{
+					__m128i const packed = _mm_or_si128(_mm_and_si128(quads[quad], pixelLow), _mm_and_si128(_mm_srli_epi64(quads[quad], 8), pixelHigh));
+
+					_mm_storel_epi64((__m128i *)(o_rgb + 3*x + 12*quad), packed);
+					_mm_storel_epi64((__m128i *)(o_rgb + 3*x + 12*quad + 6), _mm_srli_si128(packed, 8));
+				}
+			}
+			else
+			{
+				/***** Last chunk of the row: no spare bytes past its end *****/
+				_mm_storeu_si128((__m128i *)planes[0], red[0]);
+				_mm_storeu_si128((__m128i *)planes[1], green[0]);
+				_mm_storeu_si128((__m128i *)planes[2], blue[0]);
+				for(pixel=0; pixel<16; ++pixel)
+				{
+					o_rgb[3*(x + pixel)] = planes[0][pixel];
+					o_rgb[3*(x + pixel) + 1] = planes[1][pixel];
+					o_rgb[3*(x + pixel) + 2] = planes[2][pixel];
+				}
+			}
+		}
+	}
+#endif
+	for(; x<i_sizeX; x+=2)
+	{
+		int const y0 = 74*((int)i_yuyv[2*x] - 16) + 32;
+		int const u = (int)i_yuyv[2*x + 1] - 128;
+		int const y1 = 74*((int)i_yuyv[2*x + 2] - 16) + 32;
+		int const v = (int)i_yuyv[2*x + 3] - 128;
+		int const red = 102*v;
+		int const green = -25*u - 52*v;
+		int const blue = 129*u;
+
+		o_rgb[3*x] = convert_clamp((y0 + red) >> 6);
+		o_rgb[3*x + 1] = convert_clamp((y0 + green) >> 6);
+		o_rgb[3*x + 2] = convert_clamp((y0 + blue) >> 6);
+		o_rgb[3*x + 3] = convert_clamp((y1 + red) >> 6);
+		o_rgb[3*x + 4] = convert_clamp((y1 + green) >> 6);
+		o_rgb[3*x + 5] = convert_clamp((y1 + blue) >> 6);
+	}
+}
+
+static void convert_yuyv_rows(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	ConvertJob const * const job = (ConvertJob const *)i_taskData;
+	size_t row = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		convert_yuyv_row(job, row, job->m_output + row*job->m_layout->m_sizeX*2);
+	}
+}
+
+static void convert_rgb_rows(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	ConvertJob const * const job = (ConvertJob const *)i_taskData;
+	size_t const sizeX = job->m_layout->m_sizeX;
+	size_t row = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		uint8_t * const output = job->m_output + row*sizeX*3;
+
+		/***** YUYV into the back two thirds of the output row, then expand it forward *****/
+		convert_yuyv_row(job, row, output + sizeX);
+		convert_rgb_row(output + sizeX, sizeX, output);
+	}
+}
+
+/* Rounded 2x2 means; output row i reads input rows 2i and 2i+1 */
+static void convert_half_rows(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	ConvertJob const * const job = (ConvertJob const *)i_taskData;
+	size_t const stride = job->m_layout->m_strideBytes[0];
+	size_t const halfX = job->m_layout->m_sizeX/2;
+	size_t row = 0;
+	size_t x = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		uint8_t const * const top = job->m_frameData + 2*row*stride;
+		uint8_t const * const bottom = top + stride;
+		uint8_t * const output = job->m_output + row*halfX;
+
+		x = 0;
+#ifdef __SSE2__
+		{
+			__m128i const low = _mm_set1_epi16(0x00FF);
+			__m128i const two = _mm_set1_epi16(2);
+
+			for(; x+16<=halfX; x+=16)
+			{
+				__m128i const top0 = _mm_loadu_si128((__m128i const *)(top + 2*x));
+				__m128i const top1 = _mm_loadu_si128((__m128i const *)(top + 2*x + 16));
+				__m128i const bottom0 = _mm_loadu_si128((__m128i const *)(bottom + 2*x));
+				__m128i const bottom1 = _mm_loadu_si128((__m128i const *)(bottom + 2*x + 16));
+				__m128i const sum0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(top0, low), _mm_srli_epi16(top0, 8)), _mm_add_epi16(_mm_and_si128(bottom0, low), _mm_srli_epi16(bottom0, 8)));
+				__m128i const sum1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(top1, low), _mm_srli_epi16(top1, 8)), _mm_add_epi16(_mm_and_si128(bottom1, low), _mm_srli_epi16(bottom1, 8)));
+
+				_mm_storeu_si128((__m128i *)(output + x), _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(sum0, two), 2), _mm_srli_epi16(_mm_add_epi16(sum1, two), 2)));
+			}
+		}
+#endif
+		for(; x<halfX; ++x)
+		{
+			output[x] = (uint8_t)(((unsigned int)top[2*x] + top[2*x + 1] + bottom[2*x] + bottom[2*x + 1] + 2) >> 2);
+		}
+	}
+}
+
+static Result convert_validate(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, CameraFrameLayout const * const i_layout, void const * const i_output)
+{
+	if(i_frameData == NULL || i_layout == NULL || i_output == NULL || i_layout->m_planeCount == 0 || i_frameSizeBytes < i_layout->m_sizeBytes)
+	{
+		return R_INPUTBAD;
+	}
+
+	return R_SUCCESS;
+}
+/**************************************************/
+
+Result convert_luma(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_luma,
+							TaskPool * const io_poolHandle)
+{
+	ConvertJob job;
+	Result result = convert_validate(i_frameData, i_frameSizeBytes, i_layout, o_luma);
+
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	job.m_frameData = i_frameData;
+	job.m_layout = i_layout;
+	job.m_output = o_luma;
+
+	return task_pool_parallel_for(i_layout->m_sizeY, CONVERT_BAND_ROWS, convert_luma_rows, &job, io_poolHandle);
+}
+
+Result convert_yuyv(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_yuyv,
+							TaskPool * const io_poolHandle)
+{
+	ConvertJob job;
+	Result result = convert_validate(i_frameData, i_frameSizeBytes, i_layout, o_yuyv);
+
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	if(i_layout->m_sizeX%2 != 0)
+	{
+		return R_INPUTBAD;
+	}
+
+	job.m_frameData = i_frameData;
+	job.m_layout = i_layout;
+	job.m_output = o_yuyv;
+
+	return task_pool_parallel_for(i_layout->m_sizeY, CONVERT_BAND_ROWS, convert_yuyv_rows, &job, io_poolHandle);
+}
+
+Result convert_rgb(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_rgb,
+							TaskPool * const io_poolHandle)
+{
+	ConvertJob job;
+	Result result = convert_validate(i_frameData, i_frameSizeBytes, i_layout, o_rgb);
+
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	if(i_layout->m_sizeX%2 != 0)
+	{
+		return R_INPUTBAD;
+	}
+
+	job.m_frameData = i_frameData;
+	job.m_layout = i_layout;
+	job.m_output = o_rgb;
+
+	return task_pool_parallel_for(i_layout->m_sizeY, CONVERT_BAND_ROWS, convert_rgb_rows, &job, io_poolHandle);
+}
+
+Result convert_half(	uint8_t const * const i_luma,
+							size_t const i_strideBytes,
+							uint32_t const i_sizeX,
+							uint32_t const i_sizeY,
+							uint8_t * const o_half,
+							TaskPool * const io_poolHandle)
+{
+	CameraFrameLayout layout;
+	ConvertJob job;
+
+	if(i_luma == NULL || o_half == NULL || i_sizeX < 2 || i_sizeY < 2 || i_strideBytes < i_sizeX)
+	{
+		return R_INPUTBAD;
+	}
+
+	CLEAR(layout);
+	layout.m_pixelFormat = CAMERA_PIXELFORMAT_GREY;
+	layout.m_sizeX = i_sizeX;
+	layout.m_sizeY = i_sizeY;
+	layout.m_planeCount = 1;
+	layout.m_strideBytes[0] = i_strideBytes;
+	job.m_frameData = i_luma;
+	job.m_layout = &layout;
+	job.m_output = o_half;
+
+	return task_pool_parallel_for(i_sizeY/2, CONVERT_BAND_ROWS, convert_half_rows, &job, io_poolHandle);
+}
@@ -0,0 +1,47 @@
+#ifndef _CONVERT_H_
+#define _CONVERT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Camera.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONVERT_BAND_ROWS 16
+
+/* Packed 8-bit luma from any uncompressed layout; Y10 and Y16 keep their top 8 bits */
+Result convert_luma(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_luma,
+							TaskPool * const io_poolHandle);
+/* Packed YUYV for the packed-only kernels; monochrome formats get neutral chroma, 4:2:0 chroma is repeated per row pair */
+Result convert_yuyv(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_yuyv,
+							TaskPool * const io_poolHandle);
+/* Packed RGB24 for display, BT.601 limited range */
+Result convert_rgb(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							CameraFrameLayout const * const i_layout,
+							uint8_t * const o_rgb,
+							TaskPool * const io_poolHandle);
+/* Packed (i_sizeX/2)x(i_sizeY/2) 8-bit plane of rounded 2x2 means; an odd last row or column is dropped */
+Result convert_half(	uint8_t const * const i_luma,
+							size_t const i_strideBytes,
+							uint32_t const i_sizeX,
+							uint32_t const i_sizeY,
+							uint8_t * const o_half,
+							TaskPool * const io_poolHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _CONVERT_H_ */
@@ -0,0 +1,713 @@
+#include "EventLoop.h"
+#include "Trace.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EVENT_LOOP_BATCH_COUNT 64
+#define EVENT_LOOP_CAMERA_DRAIN_MAX 8
+
+/********************----- ENUM: EventSourceKind -----********************/
+enum EventSourceKind_e
+{
+	EVENT_SOURCE_FD,
+	EVENT_SOURCE_CAMERA,
+	EVENT_SOURCE_SERIAL,
+	EVENT_SOURCE_TIMER
+};
+typedef enum EventSourceKind_e EventSourceKind;
+/**************************************************/
+
+/********************----- STRUCT: EventSource -----********************/
+struct EventSource_s
+{
+	int m_fd;
+	EventSourceKind m_kind;
+	int m_removed;
+	void *m_object;
+	EventLoopFdCallback m_fdCallback;
+	CameraCallback m_cameraCallback;
+	EventLoopSerialCallback m_serialCallback;
+	EventLoopTimerCallback m_timerCallback;
+	void *m_callbackData;
+	struct EventSource_s *m_next;
+};
+typedef struct EventSource_s EventSource;
+/**************************************************/
+
+/********************----- STRUCT: EventLoop -----********************/
+struct EventLoop_s
+{
+	int m_pollHandle;
+	int m_wakeHandle;
+	EventSource *m_sources;
+	/* run_once calls nested in callbacks deepen this; removed sources are freed only back at 0 */
+	int m_dispatchDepth;
+	int m_stopRequested;
+
+	/***** event_loop_start *****/
+	pthread_t m_thread;
+	int m_threadRunning;
+	RealtimeConfig m_config;
+	pthread_mutex_t m_startLock;
+	pthread_cond_t m_startCondition;
+	int m_startDone;
+	Result m_startResult;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint32_t event_loop_events_to_epoll(uint32_t const i_events)
+{
+	uint32_t events = 0;
+
+	events |= (i_events & EVENT_LOOP_READABLE) ? EPOLLIN : 0;
+	events |= (i_events & EVENT_LOOP_WRITABLE) ? EPOLLOUT : 0;
+
+	return events;
+}
+
+static uint32_t event_loop_events_from_epoll(uint32_t const i_events)
+{
+	uint32_t events = 0;
+
+	events |= (i_events & EPOLLIN) ? EVENT_LOOP_READABLE : 0;
+	events |= (i_events & EPOLLOUT) ? EVENT_LOOP_WRITABLE : 0;
+	events |= (i_events & EPOLLERR) ? EVENT_LOOP_ERROR : 0;
+	events |= (i_events & EPOLLHUP) ? EVENT_LOOP_HANGUP : 0;
+
+	return events;
+}
+
+static void event_source_free(EventSource * const io_source)
+{
+	if(io_source->m_kind == EVENT_SOURCE_TIMER && io_source->m_fd >= 0)
+	{
+		close(io_source->m_fd);
+	}
+	free(io_source);
+}
+
+static Result event_loop_source_add(	int const i_fd,
+													uint32_t const i_events,
+													EventSource * const io_source,
+													EventLoop * const io_loopHandle)
+{
+	struct epoll_event event;
+	EventSource *source = NULL;
+
+	for(source=io_loopHandle->m_sources; source!=NULL; source=source->m_next)
+	{
+		if(!source->m_removed && source->m_fd == i_fd)
+		{
+			CARL_ERROR("fd %d is already registered.", i_fd);
+			return R_INPUTBAD;
+		}
+	}
+
+	CLEAR(event);
+	event.events = i_events;
+	event.data.ptr = io_source;
+	if(epoll_ctl(io_loopHandle->m_pollHandle, EPOLL_CTL_ADD, i_fd, &event) == -1)
+	{
+		CARL_ERRORNO("Unable to register fd %d.", i_fd);
+		return R_EVENTLOOPFAILED;
+	}
+
+	io_source->m_fd = i_fd;
+	io_source->m_removed = 0;
+	io_source->m_next = io_loopHandle->m_sources;
+	io_loopHandle->m_sources = io_source;
+
+	return R_SUCCESS;
+}
+
+static EventSource *event_source_create(EventSourceKind const i_kind, void * const i_object, void * const i_callbackData)
+{
+	EventSource *source = (EventSource *)calloc(1, sizeof(EventSource));
+
+	if(source == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+		return NULL;
+	}
+	source->m_fd = -1;
+	source->m_kind = i_kind;
+	source->m_object = i_object;
+	source->m_callbackData = i_callbackData;
+
+	return source;
+}
+
+static void event_loop_sources_collect(EventLoop * const io_loopHandle)
+{
+	EventSource **link = &io_loopHandle->m_sources;
+
+	while((*link) != NULL)
+	{
+		EventSource * const source = (*link);
+
+		if(source->m_removed)
+		{
+			(*link) = source->m_next;
+			event_source_free(source);
+		}
+		else
+		{
+			link = &source->m_next;
+		}
+	}
+}
+
+static void event_loop_dispatch(EventSource * const io_source, uint32_t const i_events)
+{
+	Result result = R_FAILURE;
+	uint64_t expirations = 0;
+	size_t drained = 0;
+
+	switch(io_source->m_kind)
+	{
+		case EVENT_SOURCE_FD:
+			io_source->m_fdCallback(io_source->m_fd, event_loop_events_from_epoll(i_events), io_source->m_callbackData);
+			break;
+
+		case EVENT_SOURCE_CAMERA:
+			/***** Drain filled buffers, bounded so one camera cannot starve the other sources; the fd is level triggered *****/
+			do
+			{
+				result = camera_capture_try(io_source->m_cameraCallback, io_source->m_callbackData, (Camera *)io_source->m_object);
+			} while(result == R_SUCCESS && !io_source->m_removed && ++drained < EVENT_LOOP_CAMERA_DRAIN_MAX);
+			break;
+
+		case EVENT_SOURCE_SERIAL:
+			io_source->m_serialCallback((Serial *)io_source->m_object, io_source->m_callbackData);
+			break;
+
+		case EVENT_SOURCE_TIMER:
+			if(read(io_source->m_fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations))
+			{
+				io_source->m_timerCallback(expirations, io_source->m_callbackData);
+			}
+			break;
+	}
+}
+
+static void *event_loop_thread(void *io_data)
+{
+	EventLoop * const loopHandle = (EventLoop *)io_data;
+	Result result = R_FAILURE;
+
+	/***** Pin and prioritize from inside the thread, then report back *****/
+	result = realtime_setup(&loopHandle->m_config, NULL);
+	pthread_mutex_lock(&loopHandle->m_startLock);
+	loopHandle->m_startResult = result;
+	loopHandle->m_startDone = 1;
+	pthread_cond_signal(&loopHandle->m_startCondition);
+	pthread_mutex_unlock(&loopHandle->m_startLock);
+
+	if(result == R_SUCCESS)
+	{
+		trace_thread_name("event_loop");
+		event_loop_run(loopHandle);
+	}
+
+	return NULL;
+}
+/**************************************************/
+
+Result event_loop_create(EventLoop ** const o_loopHandle)
+{
+	struct epoll_event event;
+	EventLoop *loopHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Create loop structure *****/
+	loopHandle = (EventLoop *)malloc(sizeof(EventLoop));
+	if(loopHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	loopHandle->m_pollHandle = -1;
+	loopHandle->m_wakeHandle = -1;
+	loopHandle->m_sources = NULL;
+	loopHandle->m_dispatchDepth = 0;
+	loopHandle->m_stopRequested = 0;
+	loopHandle->m_threadRunning = 0;
+	realtime_config_default(&loopHandle->m_config);
+	pthread_mutex_init(&loopHandle->m_startLock, NULL);
+	pthread_cond_init(&loopHandle->m_startCondition, NULL);
+	loopHandle->m_startDone = 0;
+	loopHandle->m_startResult = R_FAILURE;
+
+	/***** epoll set and wakeup eventfd *****/
+	loopHandle->m_pollHandle = epoll_create1(EPOLL_CLOEXEC);
+	if(loopHandle->m_pollHandle < 0)
+	{
+		CARL_ERRORNO("Unable to create epoll set.");
+
+		result = R_EVENTLOOPFAILED;
+		goto end;
+	}
+	loopHandle->m_wakeHandle = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(loopHandle->m_wakeHandle < 0)
+	{
+		CARL_ERRORNO("Unable to create wakeup eventfd.");
+
+		result = R_EVENTLOOPFAILED;
+		goto end;
+	}
+	CLEAR(event);
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if(epoll_ctl(loopHandle->m_pollHandle, EPOLL_CTL_ADD, loopHandle->m_wakeHandle, &event) == -1)
+	{
+		CARL_ERRORNO("Unable to register wakeup eventfd.");
+
+		result = R_EVENTLOOPFAILED;
+		goto end;
+	}
+
+	if(o_loopHandle != NULL)
+	{
+		(*o_loopHandle) = loopHandle;
+	}
+	else
+	{
+		event_loop_destroy(&loopHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("event_loop_create(%p)", o_loopHandle);
+	event_loop_destroy(&loopHandle);
+
+	return result;
+}
+
+Result event_loop_destroy(EventLoop ** const io_loopHandle)
+{
+	EventLoop *loopHandle = NULL;
+	EventSource *source = NULL;
+
+	/***** Input Validation *****/
+	if(io_loopHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	loopHandle = (*io_loopHandle);
+	if(loopHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	event_loop_join(loopHandle);
+	while(loopHandle->m_sources != NULL)
+	{
+		source = loopHandle->m_sources;
+		loopHandle->m_sources = source->m_next;
+		event_source_free(source);
+	}
+	if(loopHandle->m_wakeHandle >= 0)
+	{
+		close(loopHandle->m_wakeHandle);
+	}
+	if(loopHandle->m_pollHandle >= 0)
+	{
+		close(loopHandle->m_pollHandle);
+	}
+	pthread_cond_destroy(&loopHandle->m_startCondition);
+	pthread_mutex_destroy(&loopHandle->m_startLock);
+	free(loopHandle);
+	(*io_loopHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result event_loop_camera_add(	Camera * const i_cameraHandle,
+										CameraCallback i_callback,
+										void * const i_callbackData,
+										EventLoop * const io_loopHandle)
+{
+	EventSource *source = NULL;
+	int fd = -1;
+	Result result = R_FAILURE;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_callback == NULL)
+	{
+		CARL_ERROR("Camera source needs a callback.");
+		return R_INPUTBAD;
+	}
+	result = camera_fd(i_cameraHandle, &fd);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	source = event_source_create(EVENT_SOURCE_CAMERA, i_cameraHandle, i_callbackData);
+	if(source == NULL)
+	{
+		return R_MEMORYALLOCATIONERROR;
+	}
+	source->m_cameraCallback = i_callback;
+
+	result = event_loop_source_add(fd, EPOLLIN, source, io_loopHandle);
+	if(result != R_SUCCESS)
+	{
+		free(source);
+	}
+
+	return result;
+}
+
+Result event_loop_fd_add(	int const i_fd,
+									uint32_t const i_events,
+									EventLoopFdCallback i_callback,
+									void * const i_callbackData,
+									EventLoop * const io_loopHandle)
+{
+	EventSource *source = NULL;
+	Result result = R_FAILURE;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_fd < 0 || i_callback == NULL || event_loop_events_to_epoll(i_events) == 0)
+	{
+		CARL_ERROR("fd source needs an fd, a callback and EVENT_LOOP_READABLE and/or EVENT_LOOP_WRITABLE.");
+		return R_INPUTBAD;
+	}
+
+	source = event_source_create(EVENT_SOURCE_FD, NULL, i_callbackData);
+	if(source == NULL)
+	{
+		return R_MEMORYALLOCATIONERROR;
+	}
+	source->m_fdCallback = i_callback;
+
+	result = event_loop_source_add(i_fd, event_loop_events_to_epoll(i_events), source, io_loopHandle);
+	if(result != R_SUCCESS)
+	{
+		free(source);
+	}
+
+	return result;
+}
+
+Result event_loop_join(EventLoop * const io_loopHandle)
+{
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(io_loopHandle->m_threadRunning)
+	{
+		event_loop_stop(io_loopHandle);
+		pthread_join(io_loopHandle->m_thread, NULL);
+		io_loopHandle->m_threadRunning = 0;
+	}
+
+	return R_SUCCESS;
+}
+
+Result event_loop_remove(int const i_fd, EventLoop * const io_loopHandle)
+{
+	EventSource *source = NULL;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	for(source=io_loopHandle->m_sources; source!=NULL; source=source->m_next)
+	{
+		if(!source->m_removed && source->m_fd == i_fd)
+		{
+			break;
+		}
+	}
+	if(source == NULL)
+	{
+		CARL_ERROR("fd %d is not registered.", i_fd);
+		return R_INPUTBAD;
+	}
+
+	/***** Events already fetched for this source are skipped; it is freed once the batch is done *****/
+	epoll_ctl(io_loopHandle->m_pollHandle, EPOLL_CTL_DEL, i_fd, NULL);
+	source->m_removed = 1;
+	if(io_loopHandle->m_dispatchDepth == 0)
+	{
+		event_loop_sources_collect(io_loopHandle);
+	}
+
+	return R_SUCCESS;
+}
+
+Result event_loop_run(EventLoop * const io_loopHandle)
+{
+	Result result = R_SUCCESS;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	while(result == R_SUCCESS && !__atomic_load_n(&io_loopHandle->m_stopRequested, __ATOMIC_ACQUIRE))
+	{
+		result = event_loop_run_once(-1, io_loopHandle);
+	}
+	__atomic_store_n(&io_loopHandle->m_stopRequested, 0, __ATOMIC_RELEASE);
+
+	return result;
+}
+
+Result event_loop_run_once(int const i_timeoutMs, EventLoop * const io_loopHandle)
+{
+	struct epoll_event events[EVENT_LOOP_BATCH_COUNT];
+	int eventCount = 0;
+	int eventIndex = 0;
+	uint64_t wakeCount = 0;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	eventCount = epoll_wait(io_loopHandle->m_pollHandle, events, EVENT_LOOP_BATCH_COUNT, i_timeoutMs);
+	if(eventCount < 0)
+	{
+		if(errno == EINTR)
+		{
+			return R_SUCCESS;
+		}
+		CARL_ERRORNO("epoll_wait failed.");
+		return R_EVENTLOOPFAILED;
+	}
+
+	CARL_TRACE_BEGIN("event_loop.dispatch");
+	++io_loopHandle->m_dispatchDepth;
+	for(eventIndex=0; eventIndex<eventCount; ++eventIndex)
+	{
+		EventSource * const source = (EventSource *)events[eventIndex].data.ptr;
+
+		if(source == NULL)
+		{
+			/***** Wakeup from event_loop_stop *****/
+			while(read(io_loopHandle->m_wakeHandle, &wakeCount, sizeof(wakeCount)) > 0)
+			{
+			}
+		}
+		else if(!source->m_removed)
+		{
+			event_loop_dispatch(source, events[eventIndex].events);
+		}
+	}
+	if(--io_loopHandle->m_dispatchDepth == 0)
+	{
+		event_loop_sources_collect(io_loopHandle);
+	}
+	CARL_TRACE_END("event_loop.dispatch");
+
+	return R_SUCCESS;
+}
+
+Result event_loop_serial_add(	Serial * const i_serialHandle,
+										EventLoopSerialCallback i_callback,
+										void * const i_callbackData,
+										EventLoop * const io_loopHandle)
+{
+	EventSource *source = NULL;
+	int fd = -1;
+	Result result = R_FAILURE;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_callback == NULL)
+	{
+		CARL_ERROR("Serial source needs a callback.");
+		return R_INPUTBAD;
+	}
+	result = serial_fd(i_serialHandle, &fd);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	source = event_source_create(EVENT_SOURCE_SERIAL, i_serialHandle, i_callbackData);
+	if(source == NULL)
+	{
+		return R_MEMORYALLOCATIONERROR;
+	}
+	source->m_serialCallback = i_callback;
+
+	result = event_loop_source_add(fd, EPOLLIN, source, io_loopHandle);
+	if(result != R_SUCCESS)
+	{
+		free(source);
+	}
+
+	return result;
+}
+
+Result event_loop_start(RealtimeConfig const * const i_config, EventLoop * const io_loopHandle)
+{
+	Result result = R_FAILURE;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_loopHandle->m_threadRunning)
+	{
+		CARL_ERROR("Event loop already started.");
+		return R_INPUTBAD;
+	}
+
+	if(i_config != NULL)
+	{
+		io_loopHandle->m_config = (*i_config);
+	}
+	else
+	{
+		realtime_config_default(&io_loopHandle->m_config);
+	}
+	io_loopHandle->m_startDone = 0;
+	if(pthread_create(&io_loopHandle->m_thread, NULL, event_loop_thread, io_loopHandle) != 0)
+	{
+		CARL_ERROR("Unable to create event loop thread.");
+		return R_EVENTLOOPFAILED;
+	}
+
+	/***** Wait for the thread's realtime setup *****/
+	pthread_mutex_lock(&io_loopHandle->m_startLock);
+	while(!io_loopHandle->m_startDone)
+	{
+		pthread_cond_wait(&io_loopHandle->m_startCondition, &io_loopHandle->m_startLock);
+	}
+	result = io_loopHandle->m_startResult;
+	pthread_mutex_unlock(&io_loopHandle->m_startLock);
+
+	if(result != R_SUCCESS)
+	{
+		pthread_join(io_loopHandle->m_thread, NULL);
+		return result;
+	}
+	io_loopHandle->m_threadRunning = 1;
+
+	return R_SUCCESS;
+}
+
+Result event_loop_stop(EventLoop * const io_loopHandle)
+{
+	uint64_t const wake = 1;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	__atomic_store_n(&io_loopHandle->m_stopRequested, 1, __ATOMIC_RELEASE);
+	if(write(io_loopHandle->m_wakeHandle, &wake, sizeof(wake)) != (ssize_t)sizeof(wake) && errno != EAGAIN)
+	{
+		CARL_ERRORNO("Unable to wake event loop.");
+		return R_EVENTLOOPFAILED;
+	}
+
+	return R_SUCCESS;
+}
+
+Result event_loop_timer_add(	Timestamp const i_period,
+										EventLoopTimerCallback i_callback,
+										void * const i_callbackData,
+										int * const o_timerFd,
+										EventLoop * const io_loopHandle)
+{
+	struct itimerspec timerSpec;
+	EventSource *source = NULL;
+	Result result = R_FAILURE;
+
+	if(io_loopHandle == NULL)
+	{
+		CARL_ERROR("Event loop not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_period == 0 || i_callback == NULL)
+	{
+		CARL_ERROR("Timer source needs a non-0 period and a callback.");
+		return R_INPUTBAD;
+	}
+
+	source = event_source_create(EVENT_SOURCE_TIMER, NULL, i_callbackData);
+	if(source == NULL)
+	{
+		return R_MEMORYALLOCATIONERROR;
+	}
+	source->m_timerCallback = i_callback;
+
+	/***** Periodic timerfd owned by the loop *****/
+	source->m_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if(source->m_fd < 0)
+	{
+		CARL_ERRORNO("Unable to create timer.");
+
+		result = R_TIMERFAILED;
+		goto end;
+	}
+	CLEAR(timerSpec);
+	timestamp_to_timespec(i_period, &timerSpec.it_value);
+	timestamp_to_timespec(i_period, &timerSpec.it_interval);
+	if(timerfd_settime(source->m_fd, 0, &timerSpec, NULL) == -1)
+	{
+		CARL_ERRORNO("Unable to arm timer.");
+
+		result = R_TIMERFAILED;
+		goto end;
+	}
+
+	result = event_loop_source_add(source->m_fd, EPOLLIN, source, io_loopHandle);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+
+	if(o_timerFd != NULL)
+	{
+		(*o_timerFd) = source->m_fd;
+	}
+
+	return R_SUCCESS;
+
+end:
+	event_source_free(source);
+
+	return result;
+}
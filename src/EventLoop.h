@@ -0,0 +1,68 @@
+#ifndef _EVENTLOOP_H_
+#define _EVENTLOOP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Camera.h"
+#include "Realtime.h"
+#include "Serial.h"
+#include "Timestamp.h"
+
+#include <stdint.h>
+
+/********************----- ENUM: EventLoopEvent -----********************/
+enum EventLoopEvent_e
+{
+	EVENT_LOOP_READABLE=0x01,
+	EVENT_LOOP_WRITABLE=0x02,
+	EVENT_LOOP_ERROR=0x04,
+	EVENT_LOOP_HANGUP=0x08
+};
+typedef enum EventLoopEvent_e EventLoopEvent;
+/**************************************************/
+
+/********************----- STRUCT: EventLoop -----********************/
+struct EventLoop_s;
+typedef struct EventLoop_s EventLoop;
+/**************************************************/
+
+typedef void (*EventLoopFdCallback)(int const i_fd, uint32_t const i_events, void * const i_callbackData);
+typedef void (*EventLoopSerialCallback)(Serial * const io_serialHandle, void * const i_callbackData);
+typedef void (*EventLoopTimerCallback)(uint64_t const i_expirations, void * const i_callbackData);
+
+/* Sources are added and removed from the loop's own thread (or before it runs); only event_loop_stop may be called from elsewhere */
+Result event_loop_create(EventLoop ** const o_loopHandle);
+Result event_loop_destroy(EventLoop ** const io_loopHandle);
+Result event_loop_camera_add(	Camera * const i_cameraHandle,
+										CameraCallback i_callback,
+										void * const i_callbackData,
+										EventLoop * const io_loopHandle);
+Result event_loop_fd_add(	int const i_fd,
+									uint32_t const i_events,
+									EventLoopFdCallback i_callback,
+									void * const i_callbackData,
+									EventLoop * const io_loopHandle);
+Result event_loop_join(EventLoop * const io_loopHandle);
+Result event_loop_remove(int const i_fd, EventLoop * const io_loopHandle);
+Result event_loop_run(EventLoop * const io_loopHandle);
+Result event_loop_run_once(int const i_timeoutMs, EventLoop * const io_loopHandle);
+Result event_loop_serial_add(	Serial * const i_serialHandle,
+										EventLoopSerialCallback i_callback,
+										void * const i_callbackData,
+										EventLoop * const io_loopHandle);
+Result event_loop_start(RealtimeConfig const * const i_config, EventLoop * const io_loopHandle);
+Result event_loop_stop(EventLoop * const io_loopHandle);
+Result event_loop_timer_add(	Timestamp const i_period,
+										EventLoopTimerCallback i_callback,
+										void * const i_callbackData,
+										int * const o_timerFd,
+										EventLoop * const io_loopHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _EVENTLOOP_H_ */
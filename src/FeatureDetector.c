@@ -0,0 +1,484 @@
+#include "FeatureDetector.h"
+#include "Memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define FEATURE_CIRCLE_SIZE 16
+#define FEATURE_ARC_LENGTH 9
+
+/********************----- Global Variables -----********************/
+/* Bresenham circle of radius 3, clockwise from the top */
+static int const g_circleX[FEATURE_CIRCLE_SIZE] = {0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+static int const g_circleY[FEATURE_CIRCLE_SIZE] = {-3, -3, -2, -1, 0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3};
+/**************************************************/
+
+/********************----- STRUCT: FeatureDetector -----********************/
+/* Scores, NMS survivors per band, and the per-cell top lists share one mapping */
+struct FeatureDetector_s
+{
+	MemoryRegion m_region;
+	uint16_t *m_score;
+	FeatureCorner *m_candidates;
+	uint32_t *m_bandCount;
+	FeatureCorner *m_cells;
+	uint32_t *m_cellCount;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_cellSize;
+	size_t m_cellsX;
+	size_t m_cellsY;
+	size_t m_cornersPerCell;
+	size_t m_bandCapacity;
+};
+/**************************************************/
+
+/********************----- STRUCT: FeatureJob -----********************/
+struct FeatureJob_s
+{
+	FeatureDetector *m_detector;
+	uint8_t const *m_luma;
+	size_t m_strideBytes;
+	ptrdiff_t m_circle[FEATURE_CIRCLE_SIZE];
+	uint8_t m_threshold;
+};
+typedef struct FeatureJob_s FeatureJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint16_t feature_score(uint8_t const * const i_pixel, ptrdiff_t const * const i_circle, uint8_t const i_threshold)
+{
+	int const brightLimit = (int)i_pixel[0] + i_threshold;
+	int const darkLimit = (int)i_pixel[0] - i_threshold;
+	int sumBright = 0;
+	int sumDark = 0;
+	size_t index = 0;
+
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		int const value = i_pixel[i_circle[index]];
+
+		if(value > brightLimit)
+		{
+			sumBright += value - brightLimit;
+		}
+		else if(value < darkLimit)
+		{
+			sumDark += darkLimit - value;
+		}
+	}
+
+	return (uint16_t)MAX(sumBright, sumDark);
+}
+
+/* Bit n set for circle pixel n; doubling the mask lets arcs wrap past pixel 15 */
+static int feature_arc_scalar(uint32_t const i_mask)
+{
+	uint32_t const wrapped = i_mask | (i_mask << FEATURE_CIRCLE_SIZE);
+	uint32_t const arc2 = wrapped & (wrapped >> 1);
+	uint32_t const arc4 = arc2 & (arc2 >> 2);
+	uint32_t const arc8 = arc4 & (arc4 >> 4);
+
+	return (arc8 & (wrapped >> 8) & 0xFFFF) != 0;
+}
+
+static int feature_corner_scalar(uint8_t const * const i_pixel, ptrdiff_t const * const i_circle, uint8_t const i_threshold)
+{
+	int const brightLimit = (int)i_pixel[0] + i_threshold;
+	int const darkLimit = (int)i_pixel[0] - i_threshold;
+	uint32_t bright = 0;
+	uint32_t dark = 0;
+	size_t index = 0;
+
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		int const value = i_pixel[i_circle[index]];
+
+		bright |= (uint32_t)(value > brightLimit) << index;
+		dark |= (uint32_t)(value < darkLimit) << index;
+	}
+
+	return feature_arc_scalar(bright) || feature_arc_scalar(dark);
+}
+
+#ifdef __SSE2__
+/* Lanes where circle masks i_masks[n..n+8] are all set for some n, wrapping */
+static __m128i feature_arc_sse2(__m128i const * const i_masks)
+{
+	__m128i arc2[FEATURE_CIRCLE_SIZE];
+	__m128i arc4[FEATURE_CIRCLE_SIZE];
+	__m128i found = _mm_setzero_si128();
+	size_t index = 0;
+
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		arc2[index] = _mm_and_si128(i_masks[index], i_masks[(index + 1) % FEATURE_CIRCLE_SIZE]);
+	}
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		arc4[index] = _mm_and_si128(arc2[index], arc2[(index + 2) % FEATURE_CIRCLE_SIZE]);
+	}
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		found = _mm_or_si128(found, _mm_and_si128(_mm_and_si128(arc4[index], arc4[(index + 4) % FEATURE_CIRCLE_SIZE]), i_masks[(index + 8) % FEATURE_CIRCLE_SIZE]));
+	}
+
+	return found;
+}
+
+/* Bit n of the result is set when pixel n of the 16 starting at i_pixel is a corner */
+static int feature_corners16(uint8_t const * const i_pixel, ptrdiff_t const * const i_circle, uint8_t const i_threshold)
+{
+	__m128i const flip = _mm_set1_epi8((char)0x80);
+	__m128i const threshold = _mm_set1_epi8((char)i_threshold);
+	__m128i const center = _mm_loadu_si128((__m128i const *)i_pixel);
+	__m128i const brightLimit = _mm_xor_si128(_mm_adds_epu8(center, threshold), flip);
+	__m128i const darkLimit = _mm_xor_si128(_mm_subs_epu8(center, threshold), flip);
+	__m128i bright[FEATURE_CIRCLE_SIZE];
+	__m128i dark[FEATURE_CIRCLE_SIZE];
+	__m128i possible;
+	size_t index = 0;
+
+	/***** Any 9-pixel arc covers two neighbouring compass points, so test those first *****/
+	for(index=0; index<FEATURE_CIRCLE_SIZE; index+=4)
+	{
+		__m128i const value = _mm_xor_si128(_mm_loadu_si128((__m128i const *)(i_pixel + i_circle[index])), flip);
+
+		bright[index] = _mm_cmpgt_epi8(value, brightLimit);
+		dark[index] = _mm_cmpgt_epi8(darkLimit, value);
+	}
+	possible = _mm_or_si128(	_mm_or_si128(_mm_and_si128(bright[0], bright[4]), _mm_and_si128(bright[4], bright[8])),
+										_mm_or_si128(_mm_and_si128(bright[8], bright[12]), _mm_and_si128(bright[12], bright[0])));
+	possible = _mm_or_si128(possible, _mm_or_si128(	_mm_or_si128(_mm_and_si128(dark[0], dark[4]), _mm_and_si128(dark[4], dark[8])),
+																	_mm_or_si128(_mm_and_si128(dark[8], dark[12]), _mm_and_si128(dark[12], dark[0]))));
+	if(_mm_movemask_epi8(possible) == 0)
+	{
+		return 0;
+	}
+
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		if(index % 4 != 0)
+		{
+			__m128i const value = _mm_xor_si128(_mm_loadu_si128((__m128i const *)(i_pixel + i_circle[index])), flip);
+
+			bright[index] = _mm_cmpgt_epi8(value, brightLimit);
+			dark[index] = _mm_cmpgt_epi8(darkLimit, value);
+		}
+	}
+
+	return _mm_movemask_epi8(_mm_or_si128(feature_arc_sse2(bright), feature_arc_sse2(dark)));
+}
+#endif
+
+static void feature_score_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	FeatureJob const * const job = (FeatureJob const *)i_taskData;
+	FeatureDetector * const detectorHandle = job->m_detector;
+	size_t const sizeX = detectorHandle->m_sizeX;
+	size_t const xEnd = sizeX - FEATURE_DETECTOR_BORDER;
+	size_t row = 0;
+	size_t x = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		uint16_t * const scores = detectorHandle->m_score + row*sizeX;
+		uint8_t const * const pixels = job->m_luma + row*job->m_strideBytes;
+
+		memset(scores, 0, sizeX*sizeof(uint16_t));
+		if(row < FEATURE_DETECTOR_BORDER || row >= detectorHandle->m_sizeY - FEATURE_DETECTOR_BORDER)
+		{
+			continue;
+		}
+
+		x = FEATURE_DETECTOR_BORDER;
+#ifdef __SSE2__
+		for(; x+16<=xEnd; x+=16)
+		{
+			int corners = feature_corners16(pixels + x, job->m_circle, job->m_threshold);
+
+			while(corners != 0)
+			{
+				int const lane = __builtin_ctz((unsigned int)corners);
+
+				scores[x+lane] = MAX(feature_score(pixels + x + lane, job->m_circle, job->m_threshold), 1);
+				corners &= corners - 1;
+			}
+		}
+#endif
+		for(; x<xEnd; ++x)
+		{
+			if(feature_corner_scalar(pixels + x, job->m_circle, job->m_threshold))
+			{
+				scores[x] = MAX(feature_score(pixels + x, job->m_circle, job->m_threshold), 1);
+			}
+		}
+	}
+}
+
+/* Earlier neighbours must be strictly weaker and later ones no stronger, so equal pairs keep exactly one */
+static void feature_suppress_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	FeatureJob const * const job = (FeatureJob const *)i_taskData;
+	FeatureDetector * const detectorHandle = job->m_detector;
+	size_t const sizeX = detectorHandle->m_sizeX;
+	size_t const bandIndex = i_rowBegin/FEATURE_DETECTOR_BAND_ROWS;
+	FeatureCorner * const candidates = detectorHandle->m_candidates + bandIndex*detectorHandle->m_bandCapacity;
+	size_t candidateCount = 0;
+	size_t row = 0;
+	size_t x = 0;
+	uint64_t word = 0;
+
+	for(row=MAX(i_rowBegin, FEATURE_DETECTOR_BORDER); row<MIN(i_rowEnd, detectorHandle->m_sizeY - FEATURE_DETECTOR_BORDER); ++row)
+	{
+		uint16_t const * const above = detectorHandle->m_score + (row-1)*sizeX;
+		uint16_t const * const scores = above + sizeX;
+		uint16_t const * const below = scores + sizeX;
+
+		for(x=FEATURE_DETECTOR_BORDER; x<sizeX-FEATURE_DETECTOR_BORDER; ++x)
+		{
+			uint16_t const score = scores[x];
+
+			/***** Skip four empty scores at a time *****/
+			if(score == 0)
+			{
+				if(x+4 <= sizeX-FEATURE_DETECTOR_BORDER)
+				{
+					memcpy(&word, scores + x, sizeof(word));
+					x += (word == 0) ? 3 : 0;
+				}
+				continue;
+			}
+			if(score > above[x-1] && score > above[x] && score > above[x+1] && score > scores[x-1] &&
+				score >= scores[x+1] && score >= below[x-1] && score >= below[x] && score >= below[x+1])
+			{
+				candidates[candidateCount].m_x = (uint16_t)x;
+				candidates[candidateCount].m_y = (uint16_t)row;
+				candidates[candidateCount].m_score = score;
+				candidates[candidateCount].m_reserved = 0;
+				++candidateCount;
+			}
+		}
+	}
+	detectorHandle->m_bandCount[bandIndex] = (uint32_t)candidateCount;
+}
+
+static void feature_cell_insert(FeatureCorner const * const i_corner, FeatureDetector * const io_detectorHandle)
+{
+	size_t const cell = (i_corner->m_y/io_detectorHandle->m_cellSize)*io_detectorHandle->m_cellsX + i_corner->m_x/io_detectorHandle->m_cellSize;
+	FeatureCorner * const corners = io_detectorHandle->m_cells + cell*io_detectorHandle->m_cornersPerCell;
+	size_t const count = io_detectorHandle->m_cellCount[cell];
+	size_t index = 0;
+
+	if(count == io_detectorHandle->m_cornersPerCell && corners[count-1].m_score >= i_corner->m_score)
+	{
+		return;
+	}
+
+	index = (count < io_detectorHandle->m_cornersPerCell) ? count : count-1;
+	io_detectorHandle->m_cellCount[cell] = (uint32_t)MIN(count+1, io_detectorHandle->m_cornersPerCell);
+	while(index > 0 && corners[index-1].m_score < i_corner->m_score)
+	{
+		corners[index] = corners[index-1];
+		--index;
+	}
+	corners[index] = (*i_corner);
+}
+/**************************************************/
+
+Result feature_detector_create(	uint32_t const i_sizeX,
+											uint32_t const i_sizeY,
+											uint32_t const i_cellSize,
+											uint32_t const i_cornersPerCell,
+											FeatureDetector ** const o_detectorHandle)
+{
+	FeatureDetector *detectorHandle = NULL;
+	size_t bandCount = 0;
+	size_t cellCount = 0;
+	size_t scoreSizeBytes = 0;
+	size_t candidatesSizeBytes = 0;
+	size_t cellsSizeBytes = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_sizeX <= 2*FEATURE_DETECTOR_BORDER || i_sizeY <= 2*FEATURE_DETECTOR_BORDER || i_sizeX > UINT16_MAX || i_sizeY > UINT16_MAX || i_cellSize == 0 || i_cornersPerCell == 0)
+	{
+		CARL_ERROR("Feature detector needs a size from 7 to %u and a non-0 cell size and corner count.", UINT16_MAX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create feature detector structure *****/
+	detectorHandle = (FeatureDetector *)calloc(1, sizeof(FeatureDetector));
+	if(detectorHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	detectorHandle->m_sizeX = i_sizeX;
+	detectorHandle->m_sizeY = i_sizeY;
+	detectorHandle->m_cellSize = i_cellSize;
+	detectorHandle->m_cellsX = (i_sizeX + i_cellSize - 1)/i_cellSize;
+	detectorHandle->m_cellsY = (i_sizeY + i_cellSize - 1)/i_cellSize;
+	detectorHandle->m_cornersPerCell = i_cornersPerCell;
+
+	/***** Suppression keeps at most one corner per 2x2, which bounds each band *****/
+	bandCount = ((size_t)i_sizeY + FEATURE_DETECTOR_BAND_ROWS - 1)/FEATURE_DETECTOR_BAND_ROWS;
+	detectorHandle->m_bandCapacity = (FEATURE_DETECTOR_BAND_ROWS + 1)/2*(((size_t)i_sizeX + 1)/2);
+	cellCount = detectorHandle->m_cellsX*detectorHandle->m_cellsY;
+	scoreSizeBytes = (size_t)i_sizeX*i_sizeY*sizeof(uint16_t);
+	candidatesSizeBytes = bandCount*detectorHandle->m_bandCapacity*sizeof(FeatureCorner);
+	cellsSizeBytes = cellCount*i_cornersPerCell*sizeof(FeatureCorner);
+	result = memory_region_map(scoreSizeBytes + candidatesSizeBytes + cellsSizeBytes + (bandCount + cellCount)*sizeof(uint32_t), MEMORY_FLAG_PREFAULT, &detectorHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	detectorHandle->m_candidates = (FeatureCorner *)detectorHandle->m_region.m_memory;
+	detectorHandle->m_cells = detectorHandle->m_candidates + bandCount*detectorHandle->m_bandCapacity;
+	detectorHandle->m_bandCount = (uint32_t *)(detectorHandle->m_cells + cellCount*i_cornersPerCell);
+	detectorHandle->m_cellCount = detectorHandle->m_bandCount + bandCount;
+	detectorHandle->m_score = (uint16_t *)(detectorHandle->m_cellCount + cellCount);
+
+	if(o_detectorHandle != NULL)
+	{
+		(*o_detectorHandle) = detectorHandle;
+	}
+	else
+	{
+		feature_detector_destroy(&detectorHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("feature_detector_create(%u, %u, %u, %u, %p)", i_sizeX, i_sizeY, i_cellSize, i_cornersPerCell, o_detectorHandle);
+	feature_detector_destroy(&detectorHandle);
+
+	return result;
+}
+
+Result feature_detector_destroy(FeatureDetector ** const io_detectorHandle)
+{
+	FeatureDetector *detectorHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_detectorHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	detectorHandle = (*io_detectorHandle);
+	if(detectorHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&detectorHandle->m_region);
+	free(detectorHandle);
+	(*io_detectorHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result feature_detector_fast(	uint8_t const * const i_luma,
+										size_t const i_strideBytes,
+										uint8_t const i_threshold,
+										FeatureCorner * const o_corners,
+										size_t const i_cornerCountMax,
+										size_t * const o_cornerCount,
+										TaskPool * const io_poolHandle,
+										FeatureDetector * const io_detectorHandle)
+{
+	FeatureJob job;
+	size_t const cellCount = (io_detectorHandle != NULL) ? io_detectorHandle->m_cellsX*io_detectorHandle->m_cellsY : 0;
+	size_t bandIndex = 0;
+	size_t candidateIndex = 0;
+	size_t cell = 0;
+	size_t cornerCount = 0;
+	size_t index = 0;
+	size_t rank = 0;
+	Result result = R_FAILURE;
+
+	if(io_detectorHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_luma == NULL || i_strideBytes < io_detectorHandle->m_sizeX || (o_corners == NULL && i_cornerCountMax > 0) || o_cornerCount == NULL)
+	{
+		return R_INPUTBAD;
+	}
+	(*o_cornerCount) = 0;
+
+	job.m_detector = io_detectorHandle;
+	job.m_luma = i_luma;
+	job.m_strideBytes = i_strideBytes;
+	job.m_threshold = i_threshold;
+	for(index=0; index<FEATURE_CIRCLE_SIZE; ++index)
+	{
+		job.m_circle[index] = (ptrdiff_t)g_circleY[index]*(ptrdiff_t)i_strideBytes + g_circleX[index];
+	}
+
+	/***** Score every pixel, then suppress once all neighbouring rows are scored *****/
+	result = task_pool_parallel_for(io_detectorHandle->m_sizeY, FEATURE_DETECTOR_BAND_ROWS, feature_score_band, &job, io_poolHandle);
+	if(result == R_SUCCESS)
+	{
+		result = task_pool_parallel_for(io_detectorHandle->m_sizeY, FEATURE_DETECTOR_BAND_ROWS, feature_suppress_band, &job, io_poolHandle);
+	}
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	/***** Bucket the survivors into cells *****/
+	memset(io_detectorHandle->m_cellCount, 0, cellCount*sizeof(uint32_t));
+	for(bandIndex=0; bandIndex*FEATURE_DETECTOR_BAND_ROWS<io_detectorHandle->m_sizeY; ++bandIndex)
+	{
+		FeatureCorner const * const candidates = io_detectorHandle->m_candidates + bandIndex*io_detectorHandle->m_bandCapacity;
+
+		for(candidateIndex=0; candidateIndex<io_detectorHandle->m_bandCount[bandIndex]; ++candidateIndex)
+		{
+			feature_cell_insert(&candidates[candidateIndex], io_detectorHandle);
+		}
+	}
+
+	/***** One corner per cell per round, strongest first, so a short budget still covers the whole image *****/
+	for(rank=0; rank<io_detectorHandle->m_cornersPerCell && cornerCount<i_cornerCountMax; ++rank)
+	{
+		size_t rankCount = 0;
+		size_t rankIndex = 0;
+		size_t takeCount = 0;
+
+		for(cell=0; cell<cellCount; ++cell)
+		{
+			rankCount += (io_detectorHandle->m_cellCount[cell] > rank);
+		}
+		takeCount = MIN(rankCount, i_cornerCountMax - cornerCount);
+
+		/***** A round that does not fit takes evenly spaced cells rather than the top rows *****/
+		for(cell=0; cell<cellCount && rankIndex<rankCount; ++cell)
+		{
+			if(io_detectorHandle->m_cellCount[cell] <= rank)
+			{
+				continue;
+			}
+			if((rankIndex+1)*takeCount/rankCount > rankIndex*takeCount/rankCount)
+			{
+				o_corners[cornerCount] = io_detectorHandle->m_cells[cell*io_detectorHandle->m_cornersPerCell + rank];
+				++cornerCount;
+			}
+			++rankIndex;
+		}
+	}
+	(*o_cornerCount) = cornerCount;
+
+	return R_SUCCESS;
+}
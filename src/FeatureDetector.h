@@ -0,0 +1,55 @@
+#ifndef _FEATUREDETECTOR_H_
+#define _FEATUREDETECTOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FEATURE_DETECTOR_BAND_ROWS 16
+#define FEATURE_DETECTOR_BORDER 3
+
+/********************----- STRUCT: FeatureDetector -----********************/
+struct FeatureDetector_s;
+typedef struct FeatureDetector_s FeatureDetector;
+/**************************************************/
+
+/********************----- STRUCT: FeatureCorner -----********************/
+/* Score is the larger of the summed bright and dark excess over the threshold on the circle */
+struct FeatureCorner_s
+{
+	uint16_t m_x;
+	uint16_t m_y;
+	uint16_t m_score;
+	uint16_t m_reserved;
+};
+typedef struct FeatureCorner_s FeatureCorner;
+/**************************************************/
+
+/* The image is split into i_cellSize squares that each keep their i_cornersPerCell strongest corners */
+Result feature_detector_create(	uint32_t const i_sizeX,
+											uint32_t const i_sizeY,
+											uint32_t const i_cellSize,
+											uint32_t const i_cornersPerCell,
+											FeatureDetector ** const o_detectorHandle);
+Result feature_detector_destroy(FeatureDetector ** const io_detectorHandle);
+/* FAST-9 with 3x3 non-max suppression on an 8-bit plane; corners come out rank by rank (every cell's strongest, then every cell's second...) so truncation stays spread over the grid */
+Result feature_detector_fast(	uint8_t const * const i_luma,
+										size_t const i_strideBytes,
+										uint8_t const i_threshold,
+										FeatureCorner * const o_corners,
+										size_t const i_cornerCountMax,
+										size_t * const o_cornerCount,
+										TaskPool * const io_poolHandle,
+										FeatureDetector * const io_detectorHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _FEATUREDETECTOR_H_ */
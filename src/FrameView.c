@@ -0,0 +1,345 @@
+#include "FrameView.h"
+#include "Convert.h"
+#include "Memory.h"
+#include "Pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Each pooled block starts with one cache line of header so the converted data keeps the block alignment */
+#define FRAME_VIEW_HEADER_BYTES MEMORY_CACHE_LINE_BYTES
+
+/********************----- STRUCT: FrameViewBuffer -----********************/
+struct FrameViewBuffer_s
+{
+	uint32_t m_references;
+	uint32_t m_format;
+};
+typedef struct FrameViewBuffer_s FrameViewBuffer;
+/**************************************************/
+
+/********************----- STRUCT: FrameView -----********************/
+/* m_cached holds the current frame's results; the view owns one reference to each until the frame ends */
+struct FrameView_s
+{
+	CameraFrameLayout m_layout;
+	Pool *m_pools[FRAME_VIEW_FORMAT_COUNT];
+	size_t m_sizeBytes[FRAME_VIEW_FORMAT_COUNT];
+	uint8_t *m_cached[FRAME_VIEW_FORMAT_COUNT];
+	uint8_t const *m_frameData;
+	size_t m_frameSizeBytes;
+	FrameViewCallback m_callback;
+	void *m_callbackData;
+	FrameViewMetrics m_metrics;
+	uint32_t m_outstanding;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static FrameViewBuffer *frame_view_buffer(uint8_t const * const i_data)
+{
+	return (FrameViewBuffer *)(i_data - FRAME_VIEW_HEADER_BYTES);
+}
+
+static Result frame_view_convert(FrameViewFormat const i_format, uint8_t * const o_data, TaskPool * const io_poolHandle, FrameView * const io_viewHandle)
+{
+	CameraFrameLayout const * const layout = &io_viewHandle->m_layout;
+	uint8_t const *luma = io_viewHandle->m_frameData;
+	size_t lumaStrideBytes = layout->m_strideBytes[0];
+	Result result = R_FAILURE;
+
+	switch(i_format)
+	{
+		case FRAME_VIEW_LUMA:
+			return convert_luma(io_viewHandle->m_frameData, io_viewHandle->m_frameSizeBytes, layout, o_data, io_poolHandle);
+		case FRAME_VIEW_YUYV:
+			return convert_yuyv(io_viewHandle->m_frameData, io_viewHandle->m_frameSizeBytes, layout, o_data, io_poolHandle);
+		case FRAME_VIEW_RGB:
+			return convert_rgb(io_viewHandle->m_frameData, io_viewHandle->m_frameSizeBytes, layout, o_data, io_poolHandle);
+		case FRAME_VIEW_HALF:
+			/***** GREY is downscaled straight from the frame, everything else from the shared luma *****/
+			if(layout->m_pixelFormat != CAMERA_PIXELFORMAT_GREY)
+			{
+				result = frame_view_get(FRAME_VIEW_LUMA, &luma, io_poolHandle, io_viewHandle);
+				if(result != R_SUCCESS)
+				{
+					return result;
+				}
+				lumaStrideBytes = layout->m_sizeX;
+			}
+			return convert_half(luma, lumaStrideBytes, layout->m_sizeX, layout->m_sizeY, o_data, io_poolHandle);
+		default:
+			return R_INPUTBAD;
+	}
+}
+
+/* Drops the view's references to the current frame's results before the camera reuses the buffer */
+static void frame_view_invalidate(FrameView * const io_viewHandle)
+{
+	size_t format = 0;
+
+	for(format=0; format<FRAME_VIEW_FORMAT_COUNT; ++format)
+	{
+		if(io_viewHandle->m_cached[format] != NULL)
+		{
+			frame_view_release(io_viewHandle->m_cached[format], io_viewHandle);
+			io_viewHandle->m_cached[format] = NULL;
+		}
+	}
+	io_viewHandle->m_frameData = NULL;
+	io_viewHandle->m_frameSizeBytes = 0;
+}
+/**************************************************/
+
+void frame_view_camera_callback(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, void * const i_callbackData)
+{
+	FrameView * const viewHandle = (FrameView *)i_callbackData;
+
+	if(viewHandle == NULL)
+	{
+		return;
+	}
+
+	viewHandle->m_frameData = i_frameData;
+	viewHandle->m_frameSizeBytes = i_frameSizeBytes;
+	++viewHandle->m_metrics.m_frames;
+	if(viewHandle->m_callback != NULL)
+	{
+		viewHandle->m_callback(i_frameData, i_frameSizeBytes, viewHandle, viewHandle->m_callbackData);
+	}
+	frame_view_invalidate(viewHandle);
+}
+
+Result frame_view_create(	CameraFrameLayout const * const i_layout,
+									uint32_t const i_formatMask,
+									size_t const i_bufferCount,
+									FrameViewCallback i_callback,
+									void * const i_callbackData,
+									FrameView ** const o_viewHandle)
+{
+	FrameView *viewHandle = NULL;
+	uint32_t formatMask = i_formatMask;
+	size_t format = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_layout == NULL || i_layout->m_planeCount == 0 || i_layout->m_sizeX%2 != 0 || i_layout->m_sizeY < 2 || i_bufferCount == 0 || formatMask == 0 || (formatMask >> FRAME_VIEW_FORMAT_COUNT) != 0)
+	{
+		CARL_ERROR("Frame view needs an uncompressed layout of even width, at least one format and at least one buffer.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create frame view structure *****/
+	viewHandle = (FrameView *)calloc(1, sizeof(FrameView));
+	if(viewHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	memcpy(&viewHandle->m_layout, i_layout, sizeof(CameraFrameLayout));
+	viewHandle->m_callback = i_callback;
+	viewHandle->m_callbackData = i_callbackData;
+	viewHandle->m_sizeBytes[FRAME_VIEW_LUMA] = (size_t)i_layout->m_sizeX*i_layout->m_sizeY;
+	viewHandle->m_sizeBytes[FRAME_VIEW_YUYV] = (size_t)i_layout->m_sizeX*i_layout->m_sizeY*2;
+	viewHandle->m_sizeBytes[FRAME_VIEW_RGB] = (size_t)i_layout->m_sizeX*i_layout->m_sizeY*3;
+	viewHandle->m_sizeBytes[FRAME_VIEW_HALF] = (size_t)(i_layout->m_sizeX/2)*(i_layout->m_sizeY/2);
+
+	/***** HALF is built from LUMA unless the frame already is 8-bit luma *****/
+	if((formatMask & FRAME_VIEW_FORMAT_BIT(FRAME_VIEW_HALF)) != 0 && i_layout->m_pixelFormat != CAMERA_PIXELFORMAT_GREY)
+	{
+		formatMask |= FRAME_VIEW_FORMAT_BIT(FRAME_VIEW_LUMA);
+	}
+
+	/***** One pool per enabled format *****/
+	for(format=0; format<FRAME_VIEW_FORMAT_COUNT; ++format)
+	{
+		if((formatMask & FRAME_VIEW_FORMAT_BIT(format)) == 0)
+		{
+			continue;
+		}
+		result = pool_create(FRAME_VIEW_HEADER_BYTES + viewHandle->m_sizeBytes[format], i_bufferCount, MEMORY_FLAG_PREFAULT, &viewHandle->m_pools[format]);
+		if(result != R_SUCCESS)
+		{
+			goto end;
+		}
+	}
+
+	if(o_viewHandle != NULL)
+	{
+		(*o_viewHandle) = viewHandle;
+	}
+	else
+	{
+		frame_view_destroy(&viewHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("frame_view_create(%p, 0x%x, %zu, %p, %p)", (void *)i_layout, i_formatMask, i_bufferCount, i_callbackData, (void *)o_viewHandle);
+	frame_view_destroy(&viewHandle);
+
+	return result;
+}
+
+Result frame_view_destroy(FrameView ** const io_viewHandle)
+{
+	FrameView *viewHandle = NULL;
+	size_t format = 0;
+
+	/***** Input Validation *****/
+	if(io_viewHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	viewHandle = (*io_viewHandle);
+	if(viewHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Pools stay until every retained block has been released *****/
+	frame_view_invalidate(viewHandle);
+	if(__atomic_load_n(&viewHandle->m_outstanding, __ATOMIC_ACQUIRE) != 0)
+	{
+		CARL_ERROR("%u retained frame view buffers not released.", __atomic_load_n(&viewHandle->m_outstanding, __ATOMIC_RELAXED));
+		return R_OBJECTINUSE;
+	}
+
+	for(format=0; format<FRAME_VIEW_FORMAT_COUNT; ++format)
+	{
+		pool_destroy(&viewHandle->m_pools[format]);
+	}
+	free(viewHandle);
+	(*io_viewHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result frame_view_get(	FrameViewFormat const i_format,
+								uint8_t const ** const o_data,
+								TaskPool * const io_poolHandle,
+								FrameView * const io_viewHandle)
+{
+	FrameViewBuffer *buffer = NULL;
+	void *block = NULL;
+	Result result = R_FAILURE;
+
+	if(io_viewHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(o_data == NULL || (unsigned int)i_format >= FRAME_VIEW_FORMAT_COUNT || io_viewHandle->m_pools[i_format] == NULL)
+	{
+		return R_INPUTBAD;
+	}
+	if(io_viewHandle->m_frameData == NULL)
+	{
+		return R_DEVICENOTREADY;
+	}
+
+	/***** Already converted this frame *****/
+	if(io_viewHandle->m_cached[i_format] != NULL)
+	{
+		++io_viewHandle->m_metrics.m_hits;
+		(*o_data) = io_viewHandle->m_cached[i_format];
+		return R_SUCCESS;
+	}
+
+	result = pool_alloc(&block, io_viewHandle->m_pools[i_format]);
+	if(result != R_SUCCESS)
+	{
+		++io_viewHandle->m_metrics.m_poolExhausted;
+		return result;
+	}
+	__atomic_add_fetch(&io_viewHandle->m_outstanding, 1, __ATOMIC_RELAXED);
+	buffer = (FrameViewBuffer *)block;
+	buffer->m_references = 1;
+	buffer->m_format = (uint32_t)i_format;
+
+	result = frame_view_convert(i_format, (uint8_t *)block + FRAME_VIEW_HEADER_BYTES, io_poolHandle, io_viewHandle);
+	if(result != R_SUCCESS)
+	{
+		pool_free(block, io_viewHandle->m_pools[i_format]);
+		__atomic_sub_fetch(&io_viewHandle->m_outstanding, 1, __ATOMIC_RELEASE);
+		return result;
+	}
+	++io_viewHandle->m_metrics.m_conversions;
+	io_viewHandle->m_cached[i_format] = (uint8_t *)block + FRAME_VIEW_HEADER_BYTES;
+	(*o_data) = io_viewHandle->m_cached[i_format];
+
+	return R_SUCCESS;
+}
+
+Result frame_view_metrics(FrameViewMetrics * const o_metrics, FrameView const * const i_viewHandle)
+{
+	if(i_viewHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(o_metrics == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	memcpy(o_metrics, &i_viewHandle->m_metrics, sizeof(FrameViewMetrics));
+
+	return R_SUCCESS;
+}
+
+Result frame_view_release(uint8_t const * const i_data, FrameView * const io_viewHandle)
+{
+	FrameViewBuffer *buffer = NULL;
+	Result result = R_SUCCESS;
+
+	if(io_viewHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_data == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	buffer = frame_view_buffer(i_data);
+	if(buffer->m_format >= FRAME_VIEW_FORMAT_COUNT || io_viewHandle->m_pools[buffer->m_format] == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Last reference hands the block back to its format's pool, and only then lets destroy proceed *****/
+	if(__atomic_sub_fetch(&buffer->m_references, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		result = pool_free(buffer, io_viewHandle->m_pools[buffer->m_format]);
+		__atomic_sub_fetch(&io_viewHandle->m_outstanding, 1, __ATOMIC_RELEASE);
+	}
+
+	return result;
+}
+
+Result frame_view_retain(uint8_t const * const i_data, FrameView * const io_viewHandle)
+{
+	if(io_viewHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_data == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	__atomic_add_fetch(&frame_view_buffer(i_data)->m_references, 1, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+size_t frame_view_size(FrameViewFormat const i_format, FrameView const * const i_viewHandle)
+{
+	return (i_viewHandle != NULL && (unsigned int)i_format < FRAME_VIEW_FORMAT_COUNT) ? i_viewHandle->m_sizeBytes[i_format] : 0;
+}
@@ -0,0 +1,74 @@
+#ifndef _FRAMEVIEW_H_
+#define _FRAMEVIEW_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Camera.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/********************----- STRUCT: FrameView -----********************/
+struct FrameView_s;
+typedef struct FrameView_s FrameView;
+/**************************************************/
+
+/********************----- ENUM: FrameViewFormat -----********************/
+/* Derived representations, all packed; HALF is the 2x2 downscale of LUMA */
+enum FrameViewFormat_e
+{
+	FRAME_VIEW_LUMA,
+	FRAME_VIEW_YUYV,
+	FRAME_VIEW_RGB,
+	FRAME_VIEW_HALF,
+	FRAME_VIEW_FORMAT_COUNT
+};
+typedef enum FrameViewFormat_e FrameViewFormat;
+#define FRAME_VIEW_FORMAT_BIT(format) (1u << (format))
+/**************************************************/
+
+/********************----- STRUCT: FrameViewMetrics -----********************/
+struct FrameViewMetrics_s
+{
+	uint64_t m_frames;
+	uint64_t m_conversions;
+	uint64_t m_hits;
+	uint64_t m_poolExhausted;
+};
+typedef struct FrameViewMetrics_s FrameViewMetrics;
+/**************************************************/
+
+typedef void (*FrameViewCallback)(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, FrameView * const io_viewHandle, void * const i_callbackData);
+
+/* CameraCallback that binds each frame to the view given as i_callbackData, runs its callback, then invalidates the frame before it is requeued */
+void frame_view_camera_callback(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, void * const i_callbackData);
+/* Each format in i_formatMask gets its own pool of i_bufferCount blocks, covering the current frame plus retained ones */
+Result frame_view_create(	CameraFrameLayout const * const i_layout,
+									uint32_t const i_formatMask,
+									size_t const i_bufferCount,
+									FrameViewCallback i_callback,
+									void * const i_callbackData,
+									FrameView ** const o_viewHandle);
+/* R_OBJECTINUSE, leaving the view intact, while any retained result is still unreleased */
+Result frame_view_destroy(FrameView ** const io_viewHandle);
+/* Converts on first use in a frame and returns the shared read-only result afterwards; capture thread only */
+Result frame_view_get(	FrameViewFormat const i_format,
+								uint8_t const ** const o_data,
+								TaskPool * const io_poolHandle,
+								FrameView * const io_viewHandle);
+Result frame_view_metrics(FrameViewMetrics * const o_metrics, FrameView const * const i_viewHandle);
+/* Keeps a result from frame_view_get alive past its frame until released, which must happen before destroy; retain and release may be called from any thread */
+Result frame_view_release(uint8_t const * const i_data, FrameView * const io_viewHandle);
+Result frame_view_retain(uint8_t const * const i_data, FrameView * const io_viewHandle);
+/* Size in bytes of one converted frame */
+size_t frame_view_size(FrameViewFormat const i_format, FrameView const * const i_viewHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _FRAMEVIEW_H_ */
@@ -0,0 +1,354 @@
+#include "Fusion.h"
+#include "Memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FUSION_READ_ATTEMPTS 4
+
+/********************----- STRUCT: Fusion -----********************/
+/* Overwriting ring indexed by a running count; slot i is readable while i + capacity > m_head */
+struct Fusion_s
+{
+	MemoryRegion m_region;
+	FusionSample *m_samples;
+	uint64_t *m_sequences;
+	int64_t *m_offsetDeltas;
+	uint64_t m_head;
+	uint64_t m_sampleMask;
+	uint64_t m_offsetCount;
+	size_t m_offsetWindow;
+	int64_t m_offset;
+	FusionOffset m_offsetMode;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+/* Per-slot seqlock: the slot holds sample i once its sequence reads 2i+2 both before and after the copy */
+static int fusion_sample_read(uint64_t const i_index, FusionSample * const o_sample, Fusion const * const i_fusionHandle)
+{
+	uint64_t const * const sequence = &i_fusionHandle->m_sequences[i_index & i_fusionHandle->m_sampleMask];
+	uint64_t const expected = 2*i_index + 2;
+
+	if(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != expected)
+	{
+		return 0;
+	}
+	memcpy(o_sample, &i_fusionHandle->m_samples[i_index & i_fusionHandle->m_sampleMask], sizeof(FusionSample));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(sequence, __ATOMIC_RELAXED) == expected;
+}
+
+/* Binary search for the first sample after i_time, then a check that the writer has not lapped the pair */
+static Result fusion_search(Timestamp const i_time, FusionSample * const o_before, FusionSample * const o_after, Fusion const * const i_fusionHandle)
+{
+	uint64_t const mask = i_fusionHandle->m_sampleMask;
+	FusionSample const * const samples = i_fusionHandle->m_samples;
+	uint64_t head = 0;
+	uint64_t low = 0;
+	uint64_t first = 0;
+	uint64_t count = 0;
+	uint64_t step = 0;
+	uint64_t before = 0;
+	size_t attempt = 0;
+
+	for(attempt=0; attempt<FUSION_READ_ATTEMPTS; ++attempt)
+	{
+		head = __atomic_load_n(&i_fusionHandle->m_head, __ATOMIC_ACQUIRE);
+		if(head == 0)
+		{
+			return R_DEVICENOTREADY;
+		}
+		low = (head > mask) ? head - mask : 0;
+
+		first = low;
+		count = head - low;
+		while(count > 0)
+		{
+			step = count/2;
+			if(samples[(first + step) & mask].m_timestamp <= i_time)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+
+		if(first == low)
+		{
+			return R_OUTOFRANGE;
+		}
+		before = first - 1;
+		if(first == head)
+		{
+			if(samples[before & mask].m_timestamp != i_time)
+			{
+				return R_DEVICENOTREADY;
+			}
+			first = before;
+		}
+
+		/***** Valid only if neither slot was being rewritten while it was copied, and the copies still bracket the time the search read off live slots *****/
+		if(fusion_sample_read(before, o_before, i_fusionHandle) && fusion_sample_read(first, o_after, i_fusionHandle))
+		{
+			if((first == before) ? (o_before->m_timestamp == i_time) : (o_before->m_timestamp <= i_time && i_time < o_after->m_timestamp))
+			{
+				return R_SUCCESS;
+			}
+		}
+	}
+
+	return R_OUTOFRANGE;
+}
+
+static Timestamp fusion_host_time(Timestamp const i_frameTimestamp, Fusion const * const i_fusionHandle)
+{
+	return (Timestamp)((int64_t)i_frameTimestamp + __atomic_load_n(&i_fusionHandle->m_offset, __ATOMIC_RELAXED));
+}
+/**************************************************/
+
+Result fusion_create(	size_t const i_sampleCount,
+								FusionOffset const i_offsetMode,
+								size_t const i_offsetWindow,
+								Fusion ** const o_fusionHandle)
+{
+	Fusion *fusionHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_sampleCount < 2 || (i_sampleCount & (i_sampleCount - 1)) != 0 || i_offsetWindow == 0 || i_offsetWindow > FUSION_OFFSET_WINDOW_MAX || (i_offsetMode != FUSION_OFFSET_FIXED && i_offsetMode != FUSION_OFFSET_MINIMUM && i_offsetMode != FUSION_OFFSET_MEAN))
+	{
+		CARL_ERROR("Fusion needs a power of two sample count and an offset window of 1 to %u.", FUSION_OFFSET_WINDOW_MAX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create fusion structure *****/
+	fusionHandle = (Fusion *)calloc(1, sizeof(Fusion));
+	if(fusionHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	fusionHandle->m_sampleMask = i_sampleCount - 1;
+	fusionHandle->m_offsetWindow = i_offsetWindow;
+	fusionHandle->m_offsetMode = i_offsetMode;
+
+	/***** Samples, their sequences, then the offset deltas, in one mapping *****/
+	result = memory_region_map(i_sampleCount*(sizeof(FusionSample) + sizeof(uint64_t)) + i_offsetWindow*sizeof(int64_t), MEMORY_FLAG_PREFAULT, &fusionHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	fusionHandle->m_samples = (FusionSample *)fusionHandle->m_region.m_memory;
+	fusionHandle->m_sequences = (uint64_t *)(fusionHandle->m_samples + i_sampleCount);
+	fusionHandle->m_offsetDeltas = (int64_t *)(fusionHandle->m_sequences + i_sampleCount);
+
+	if(o_fusionHandle != NULL)
+	{
+		(*o_fusionHandle) = fusionHandle;
+	}
+	else
+	{
+		fusion_destroy(&fusionHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("fusion_create(%zu, %d, %zu, %p)", i_sampleCount, i_offsetMode, i_offsetWindow, o_fusionHandle);
+	fusion_destroy(&fusionHandle);
+
+	return result;
+}
+
+Result fusion_destroy(Fusion ** const io_fusionHandle)
+{
+	Fusion *fusionHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_fusionHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	fusionHandle = (*io_fusionHandle);
+	if(fusionHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&fusionHandle->m_region);
+	free(fusionHandle);
+	(*io_fusionHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result fusion_push(FusionSample const * const i_sample, Fusion * const io_fusionHandle)
+{
+	uint64_t head = 0;
+	uint64_t *sequence = NULL;
+
+	if(io_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_sample == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Only this thread moves the head, so the previous sample is stable *****/
+	head = __atomic_load_n(&io_fusionHandle->m_head, __ATOMIC_RELAXED);
+	if(head > 0 && i_sample->m_timestamp < io_fusionHandle->m_samples[(head - 1) & io_fusionHandle->m_sampleMask].m_timestamp)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Odd sequence while the slot is rewritten, so a reader racing the copy retries *****/
+	sequence = &io_fusionHandle->m_sequences[head & io_fusionHandle->m_sampleMask];
+	__atomic_store_n(sequence, 2*head + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&io_fusionHandle->m_samples[head & io_fusionHandle->m_sampleMask], i_sample, sizeof(FusionSample));
+	__atomic_store_n(sequence, 2*head + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&io_fusionHandle->m_head, head + 1, __ATOMIC_RELEASE);
+
+	return R_SUCCESS;
+}
+
+Result fusion_offset_observe(	Timestamp const i_frameTimestamp,
+											Timestamp const i_receiveTimestamp,
+											Fusion * const io_fusionHandle)
+{
+	int64_t offset = 0;
+	size_t count = 0;
+	size_t index = 0;
+
+	if(io_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_fusionHandle->m_offsetMode == FUSION_OFFSET_FIXED)
+	{
+		return R_SUCCESS;
+	}
+
+	io_fusionHandle->m_offsetDeltas[io_fusionHandle->m_offsetCount % io_fusionHandle->m_offsetWindow] = (int64_t)i_receiveTimestamp - (int64_t)i_frameTimestamp;
+	++io_fusionHandle->m_offsetCount;
+	count = (size_t)MIN(io_fusionHandle->m_offsetCount, io_fusionHandle->m_offsetWindow);
+
+	/***** Transport only adds delay, so the smallest delta is the tightest bound on the offset *****/
+	offset = io_fusionHandle->m_offsetDeltas[0];
+	if(io_fusionHandle->m_offsetMode == FUSION_OFFSET_MINIMUM)
+	{
+		for(index=1; index<count; ++index)
+		{
+			offset = MIN(offset, io_fusionHandle->m_offsetDeltas[index]);
+		}
+	}
+	else
+	{
+		for(index=1; index<count; ++index)
+		{
+			offset += io_fusionHandle->m_offsetDeltas[index];
+		}
+		offset /= (int64_t)count;
+	}
+	__atomic_store_n(&io_fusionHandle->m_offset, offset, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+Result fusion_offset_get(Fusion const * const i_fusionHandle, int64_t * const o_offset)
+{
+	if(i_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(o_offset == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	(*o_offset) = __atomic_load_n(&i_fusionHandle->m_offset, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+Result fusion_offset_set(int64_t const i_offset, Fusion * const io_fusionHandle)
+{
+	if(io_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+
+	__atomic_store_n(&io_fusionHandle->m_offset, i_offset, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+Result fusion_bracket(	Timestamp const i_frameTimestamp,
+								FusionSample * const o_before,
+								FusionSample * const o_after,
+								Fusion const * const i_fusionHandle)
+{
+	if(i_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(o_before == NULL || o_after == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	return fusion_search(fusion_host_time(i_frameTimestamp, i_fusionHandle), o_before, o_after, i_fusionHandle);
+}
+
+Result fusion_interpolate(	Timestamp const i_frameTimestamp,
+									FusionSample * const o_sample,
+									Fusion const * const i_fusionHandle)
+{
+	FusionSample before;
+	FusionSample after;
+	Timestamp time = 0;
+	double weight = 0.0;
+	size_t index = 0;
+	Result result = R_FAILURE;
+
+	if(i_fusionHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(o_sample == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	time = fusion_host_time(i_frameTimestamp, i_fusionHandle);
+	result = fusion_search(time, &before, &after, i_fusionHandle);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	if(after.m_timestamp > before.m_timestamp)
+	{
+		weight = (double)(time - before.m_timestamp)/(double)(after.m_timestamp - before.m_timestamp);
+	}
+	o_sample->m_timestamp = time;
+	for(index=0; index<FUSION_VALUE_COUNT; ++index)
+	{
+		o_sample->m_values[index] = (float)(before.m_values[index] + weight*(after.m_values[index] - before.m_values[index]));
+	}
+
+	return R_SUCCESS;
+}
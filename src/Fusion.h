@@ -0,0 +1,71 @@
+#ifndef _FUSION_H_
+#define _FUSION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Timestamp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FUSION_VALUE_COUNT 6
+#define FUSION_OFFSET_WINDOW_MAX 256
+
+/********************----- ENUM: FusionOffset -----********************/
+/* How the frame clock to host clock offset is found: set by hand, or from recent (receive - frame) deltas */
+enum FusionOffset_e
+{
+	FUSION_OFFSET_FIXED,
+	FUSION_OFFSET_MINIMUM,
+	FUSION_OFFSET_MEAN
+};
+typedef enum FusionOffset_e FusionOffset;
+/**************************************************/
+
+/********************----- STRUCT: FusionSample -----********************/
+/* One IMU reading on the host time base, e.g. accelerometer then gyroscope axes */
+struct FusionSample_s
+{
+	Timestamp m_timestamp;
+	float m_values[FUSION_VALUE_COUNT];
+};
+typedef struct FusionSample_s FusionSample;
+/**************************************************/
+
+/********************----- STRUCT: Fusion -----********************/
+struct Fusion_s;
+typedef struct Fusion_s Fusion;
+/**************************************************/
+
+/* Sample count is a power of two; the offset window is how many frames the estimate looks back over */
+Result fusion_create(	size_t const i_sampleCount,
+								FusionOffset const i_offsetMode,
+								size_t const i_offsetWindow,
+								Fusion ** const o_fusionHandle);
+Result fusion_destroy(Fusion ** const io_fusionHandle);
+/* One writer, in timestamp order; readers on other threads never block it */
+Result fusion_push(FusionSample const * const i_sample, Fusion * const io_fusionHandle);
+/* Frame timestamp (e.g. camera_timestamp) against when the host received it; one caller thread */
+Result fusion_offset_observe(	Timestamp const i_frameTimestamp,
+											Timestamp const i_receiveTimestamp,
+											Fusion * const io_fusionHandle);
+Result fusion_offset_get(Fusion const * const i_fusionHandle, int64_t * const o_offset);
+Result fusion_offset_set(int64_t const i_offset, Fusion * const io_fusionHandle);
+/* Samples either side of the frame time plus offset; R_DEVICENOTREADY until a later sample arrives, R_OUTOFRANGE once overwritten */
+Result fusion_bracket(	Timestamp const i_frameTimestamp,
+								FusionSample * const o_before,
+								FusionSample * const o_after,
+								Fusion const * const i_fusionHandle);
+/* Linear interpolation between the bracketing samples, stamped with the host frame time */
+Result fusion_interpolate(	Timestamp const i_frameTimestamp,
+									FusionSample * const o_sample,
+									Fusion const * const i_fusionHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _FUSION_H_ */
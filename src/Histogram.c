@@ -0,0 +1,252 @@
+#include "Histogram.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* 2^7 linear sub-buckets per power of two keeps the error under 1% */
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKET_COUNT (1u << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKET_COUNT ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKET_COUNT)
+
+/********************----- STRUCT: Histogram -----********************/
+struct Histogram_s
+{
+	uint64_t m_count;
+	uint64_t m_sum;
+	uint64_t m_min;
+	uint64_t m_max;
+	uint64_t m_buckets[HISTOGRAM_BUCKET_COUNT];
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static inline size_t histogram_bucket_index(uint64_t const i_value)
+{
+	unsigned int magnitude = 0;
+
+	if(i_value < HISTOGRAM_SUB_BUCKET_COUNT)
+	{
+		return (size_t)i_value;
+	}
+
+	magnitude = 63 - __builtin_clzll(i_value);
+	return HISTOGRAM_SUB_BUCKET_COUNT*(magnitude - HISTOGRAM_SUB_BUCKET_BITS + 1) + (size_t)((i_value >> (magnitude - HISTOGRAM_SUB_BUCKET_BITS)) - HISTOGRAM_SUB_BUCKET_COUNT);
+}
+
+static inline uint64_t histogram_bucket_highest(size_t const i_bucketIndex)
+{
+	size_t shift = 0;
+	uint64_t subBucket = 0;
+
+	if(i_bucketIndex < HISTOGRAM_SUB_BUCKET_COUNT)
+	{
+		return (uint64_t)i_bucketIndex;
+	}
+
+	shift = i_bucketIndex/HISTOGRAM_SUB_BUCKET_COUNT - 1;
+	subBucket = HISTOGRAM_SUB_BUCKET_COUNT + i_bucketIndex%HISTOGRAM_SUB_BUCKET_COUNT;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+static inline void histogram_update_min(uint64_t const i_value, uint64_t * const io_min)
+{
+	uint64_t current = __atomic_load_n(io_min, __ATOMIC_RELAXED);
+
+	while(i_value < current && !__atomic_compare_exchange_n(io_min, &current, i_value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+static inline void histogram_update_max(uint64_t const i_value, uint64_t * const io_max)
+{
+	uint64_t current = __atomic_load_n(io_max, __ATOMIC_RELAXED);
+
+	while(i_value > current && !__atomic_compare_exchange_n(io_max, &current, i_value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+/**************************************************/
+
+Result histogram_create(Histogram ** const o_histogramHandle)
+{
+	Histogram *histogramHandle = NULL;
+
+	histogramHandle = (Histogram *)malloc(sizeof(Histogram));
+	if(histogramHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+		return R_MEMORYALLOCATIONERROR;
+	}
+	histogram_reset(histogramHandle);
+
+	if(o_histogramHandle != NULL)
+	{
+		(*o_histogramHandle) = histogramHandle;
+	}
+	else
+	{
+		histogram_destroy(&histogramHandle);
+	}
+
+	return R_SUCCESS;
+}
+
+Result histogram_destroy(Histogram ** const io_histogramHandle)
+{
+	if(io_histogramHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	free(*io_histogramHandle);
+	(*io_histogramHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result histogram_merge(Histogram const * const i_sourceHandle, Histogram * const io_histogramHandle)
+{
+	size_t bucketIndex = 0;
+	uint64_t bucketCount = 0;
+
+	if(i_sourceHandle == NULL || io_histogramHandle == NULL)
+	{
+		CARL_ERROR("Histogram not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	for(bucketIndex=0; bucketIndex<HISTOGRAM_BUCKET_COUNT; ++bucketIndex)
+	{
+		bucketCount = __atomic_load_n(&i_sourceHandle->m_buckets[bucketIndex], __ATOMIC_RELAXED);
+		if(bucketCount != 0)
+		{
+			__atomic_fetch_add(&io_histogramHandle->m_buckets[bucketIndex], bucketCount, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_fetch_add(&io_histogramHandle->m_sum, __atomic_load_n(&i_sourceHandle->m_sum, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	histogram_update_min(__atomic_load_n(&i_sourceHandle->m_min, __ATOMIC_RELAXED), &io_histogramHandle->m_min);
+	histogram_update_max(__atomic_load_n(&i_sourceHandle->m_max, __ATOMIC_RELAXED), &io_histogramHandle->m_max);
+	__atomic_fetch_add(&io_histogramHandle->m_count, __atomic_load_n(&i_sourceHandle->m_count, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+Result histogram_percentile(double const i_percentile, uint64_t * const o_value, Histogram const * const i_histogramHandle)
+{
+	size_t bucketIndex = 0;
+	uint64_t countRunning = 0;
+	uint64_t countTarget = 0;
+	uint64_t countTotal = 0;
+	uint64_t valueMax = 0;
+
+	if(i_histogramHandle == NULL)
+	{
+		CARL_ERROR("Histogram not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(!(i_percentile >= 0.0 && i_percentile <= 100.0))
+	{
+		CARL_ERROR("Percentile must be within [0, 100].");
+		return R_INPUTBAD;
+	}
+
+	/***** Sum buckets rather than trusting m_count while recorders run *****/
+	for(bucketIndex=0; bucketIndex<HISTOGRAM_BUCKET_COUNT; ++bucketIndex)
+	{
+		countTotal += __atomic_load_n(&i_histogramHandle->m_buckets[bucketIndex], __ATOMIC_RELAXED);
+	}
+	if(countTotal == 0)
+	{
+		if(o_value != NULL)
+		{
+			(*o_value) = 0;
+		}
+		return R_SUCCESS;
+	}
+
+	countTarget = (uint64_t)((i_percentile/100.0)*((double)countTotal) + 0.5);
+	countTarget = MAX(countTarget, 1);
+	for(bucketIndex=0; bucketIndex<HISTOGRAM_BUCKET_COUNT; ++bucketIndex)
+	{
+		countRunning += __atomic_load_n(&i_histogramHandle->m_buckets[bucketIndex], __ATOMIC_RELAXED);
+		if(countRunning >= countTarget)
+		{
+			break;
+		}
+	}
+
+	valueMax = __atomic_load_n(&i_histogramHandle->m_max, __ATOMIC_RELAXED);
+	if(o_value != NULL)
+	{
+		(*o_value) = MIN(histogram_bucket_highest(bucketIndex), valueMax);
+	}
+
+	return R_SUCCESS;
+}
+
+void histogram_record(uint64_t const i_value, Histogram * const io_histogramHandle)
+{
+	if(io_histogramHandle == NULL)
+	{
+		return;
+	}
+
+	__atomic_fetch_add(&io_histogramHandle->m_buckets[histogram_bucket_index(i_value)], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&io_histogramHandle->m_sum, i_value, __ATOMIC_RELAXED);
+	histogram_update_min(i_value, &io_histogramHandle->m_min);
+	histogram_update_max(i_value, &io_histogramHandle->m_max);
+	__atomic_fetch_add(&io_histogramHandle->m_count, 1, __ATOMIC_RELAXED);
+}
+
+Result histogram_reset(Histogram * const io_histogramHandle)
+{
+	size_t bucketIndex = 0;
+
+	if(io_histogramHandle == NULL)
+	{
+		CARL_ERROR("Histogram not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	for(bucketIndex=0; bucketIndex<HISTOGRAM_BUCKET_COUNT; ++bucketIndex)
+	{
+		__atomic_store_n(&io_histogramHandle->m_buckets[bucketIndex], 0, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&io_histogramHandle->m_count, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&io_histogramHandle->m_sum, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&io_histogramHandle->m_min, UINT64_MAX, __ATOMIC_RELAXED);
+	__atomic_store_n(&io_histogramHandle->m_max, 0, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
+
+Result histogram_summary(HistogramSummary * const o_summary, Histogram const * const i_histogramHandle)
+{
+	HistogramSummary summary;
+
+	if(i_histogramHandle == NULL)
+	{
+		CARL_ERROR("Histogram not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	CLEAR(summary);
+	summary.m_count = __atomic_load_n(&i_histogramHandle->m_count, __ATOMIC_RELAXED);
+	if(summary.m_count > 0)
+	{
+		summary.m_min = __atomic_load_n(&i_histogramHandle->m_min, __ATOMIC_RELAXED);
+		summary.m_max = __atomic_load_n(&i_histogramHandle->m_max, __ATOMIC_RELAXED);
+		summary.m_mean = ((double)__atomic_load_n(&i_histogramHandle->m_sum, __ATOMIC_RELAXED))/((double)summary.m_count);
+		histogram_percentile(50.0, &summary.m_p50, i_histogramHandle);
+		histogram_percentile(90.0, &summary.m_p90, i_histogramHandle);
+		histogram_percentile(99.0, &summary.m_p99, i_histogramHandle);
+		histogram_percentile(99.9, &summary.m_p999, i_histogramHandle);
+	}
+
+	if(o_summary != NULL)
+	{
+		(*o_summary) = summary;
+	}
+
+	return R_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stdint.h>
+
+/********************----- STRUCT: Histogram -----********************/
+struct Histogram_s;
+typedef struct Histogram_s Histogram;
+/**************************************************/
+
+/********************----- STRUCT: HistogramSummary -----********************/
+struct HistogramSummary_s
+{
+	uint64_t m_count;
+	uint64_t m_min;
+	uint64_t m_max;
+	double m_mean;
+	uint64_t m_p50;
+	uint64_t m_p90;
+	uint64_t m_p99;
+	uint64_t m_p999;
+};
+typedef struct HistogramSummary_s HistogramSummary;
+/**************************************************/
+
+Result histogram_create(Histogram ** const o_histogramHandle);
+Result histogram_destroy(Histogram ** const io_histogramHandle);
+Result histogram_merge(Histogram const * const i_sourceHandle, Histogram * const io_histogramHandle);
+Result histogram_percentile(double const i_percentile, uint64_t * const o_value, Histogram const * const i_histogramHandle);
+void histogram_record(uint64_t const i_value, Histogram * const io_histogramHandle);
+Result histogram_reset(Histogram * const io_histogramHandle);
+Result histogram_summary(HistogramSummary * const o_summary, Histogram const * const i_histogramHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _HISTOGRAM_H_ */
@@ -0,0 +1,176 @@
+#include "Integral.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/********************----- STRUCT: IntegralJob -----********************/
+struct IntegralJob_s
+{
+	uint32_t const *m_integral;
+	uint8_t *m_output;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_radius;
+	float m_inverseArea;
+};
+typedef struct IntegralJob_s IntegralJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint32_t integral_sum(uint32_t const * const i_integral, size_t const i_stride, size_t const i_x0, size_t const i_y0, size_t const i_x1, size_t const i_y1)
+{
+	return i_integral[i_y1*i_stride + i_x1] - i_integral[i_y0*i_stride + i_x1] - i_integral[i_y1*i_stride + i_x0] + i_integral[i_y0*i_stride + i_x0];
+}
+
+static uint8_t integral_box_clipped(IntegralJob const * const i_job, size_t const i_x, size_t const i_y0, size_t const i_y1)
+{
+	size_t const x0 = (i_x > i_job->m_radius) ? i_x - i_job->m_radius : 0;
+	size_t const x1 = MIN(i_x + i_job->m_radius + 1, i_job->m_sizeX);
+	uint32_t const area = (uint32_t)((x1 - x0)*(i_y1 - i_y0));
+
+	return (uint8_t)((integral_sum(i_job->m_integral, i_job->m_sizeX + 1, x0, i_y0, x1, i_y1) + area/2)/area);
+}
+
+/* Interior pixels all cover the full box, so they share one reciprocal; edges divide by their clipped area */
+static void integral_box_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	IntegralJob const * const job = (IntegralJob const *)i_taskData;
+	size_t const stride = job->m_sizeX + 1;
+	size_t const radius = job->m_radius;
+	size_t const interiorBegin = MIN(radius, job->m_sizeX);
+	size_t const interiorEnd = (job->m_sizeX > radius) ? MAX(job->m_sizeX - radius, interiorBegin) : interiorBegin;
+	size_t row = 0;
+	size_t x = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		size_t const y0 = (row > radius) ? row - radius : 0;
+		size_t const y1 = MIN(row + radius + 1, job->m_sizeY);
+		int const rowInterior = (row >= radius && row + radius < job->m_sizeY);
+		uint32_t const * const top = job->m_integral + y0*stride;
+		uint32_t const * const bottom = job->m_integral + y1*stride;
+		uint8_t * const output = job->m_output + row*job->m_sizeX;
+
+		for(x=0; x<interiorBegin || (!rowInterior && x<job->m_sizeX); ++x)
+		{
+			output[x] = integral_box_clipped(job, x, y0, y1);
+		}
+		if(rowInterior)
+		{
+#ifdef __SSE2__
+			{
+				__m128 const inverseArea = _mm_set1_ps(job->m_inverseArea);
+				__m128 const half = _mm_set1_ps(0.5f);
+
+				for(; x+8<=interiorEnd; x+=8)
+				{
+					__m128i const sumLow = _mm_add_epi32(	_mm_sub_epi32(_mm_loadu_si128((__m128i const *)(bottom + x + radius + 1)), _mm_loadu_si128((__m128i const *)(top + x + radius + 1))),
+																		_mm_sub_epi32(_mm_loadu_si128((__m128i const *)(top + x - radius)), _mm_loadu_si128((__m128i const *)(bottom + x - radius))));
+					__m128i const sumHigh = _mm_add_epi32(	_mm_sub_epi32(_mm_loadu_si128((__m128i const *)(bottom + x + radius + 5)), _mm_loadu_si128((__m128i const *)(top + x + radius + 5))),
+																		_mm_sub_epi32(_mm_loadu_si128((__m128i const *)(top + x - radius + 4)), _mm_loadu_si128((__m128i const *)(bottom + x - radius + 4))));
+					__m128i const meanLow = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sumLow), inverseArea), half));
+					__m128i const meanHigh = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sumHigh), inverseArea), half));
+					__m128i const mean = _mm_packs_epi32(meanLow, meanHigh);
+
+					_mm_storel_epi64((__m128i *)(output + x), _mm_packus_epi16(mean, mean));
+				}
+			}
+#endif
+			for(; x<interiorEnd; ++x)
+			{
+				uint32_t const sum = (bottom[x + radius + 1] - top[x + radius + 1]) + (top[x - radius] - bottom[x - radius]);
+
+				output[x] = (uint8_t)MIN((int)((float)sum*job->m_inverseArea + 0.5f), 255);
+			}
+		}
+		for(; x<job->m_sizeX; ++x)
+		{
+			output[x] = integral_box_clipped(job, x, y0, y1);
+		}
+	}
+}
+/**************************************************/
+
+Result integral_image(	uint8_t const * const i_luma,
+								size_t const i_strideBytes,
+								uint32_t const i_sizeX,
+								uint32_t const i_sizeY,
+								uint32_t * const o_integral)
+{
+	size_t const stride = (size_t)i_sizeX + 1;
+	size_t row = 0;
+	size_t x = 0;
+
+	if(i_luma == NULL || o_integral == NULL || i_strideBytes < i_sizeX || (uint64_t)i_sizeX*i_sizeY > UINT32_MAX/UINT8_MAX)
+	{
+		return R_INPUTBAD;
+	}
+
+	memset(o_integral, 0, stride*sizeof(uint32_t));
+	for(row=0; row<i_sizeY; ++row)
+	{
+		uint8_t const * const pixels = i_luma + row*i_strideBytes;
+		uint32_t const * const above = o_integral + row*stride + 1;
+		uint32_t * const sums = o_integral + (row + 1)*stride + 1;
+		uint32_t rowSum = 0;
+
+		sums[-1] = 0;
+		x = 0;
+#ifdef __SSE2__
+		{
+			__m128i const zero = _mm_setzero_si128();
+			__m128i carry = zero;
+
+			/***** Prefix sum within four lanes, plus the running row total and the row above *****/
+			for(; x+4<=i_sizeX; x+=4)
+			{
+				int32_t packed = 0;
+				__m128i value;
+
+				memcpy(&packed, pixels + x, sizeof(packed));
+				value = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+				value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+				value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+				value = _mm_add_epi32(value, carry);
+				carry = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+				_mm_storeu_si128((__m128i *)(sums + x), _mm_add_epi32(value, _mm_loadu_si128((__m128i const *)(above + x))));
+			}
+			rowSum = (uint32_t)_mm_cvtsi128_si32(carry);
+		}
+#endif
+		for(; x<i_sizeX; ++x)
+		{
+			rowSum += pixels[x];
+			sums[x] = rowSum + above[x];
+		}
+	}
+
+	return R_SUCCESS;
+}
+
+Result integral_box_filter(	uint32_t const * const i_integral,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										uint32_t const i_radius,
+										uint8_t * const o_output,
+										TaskPool * const io_poolHandle)
+{
+	IntegralJob job;
+
+	if(i_integral == NULL || o_output == NULL || i_sizeX == 0 || i_sizeY == 0)
+	{
+		return R_INPUTBAD;
+	}
+
+	job.m_integral = i_integral;
+	job.m_output = o_output;
+	job.m_sizeX = i_sizeX;
+	job.m_sizeY = i_sizeY;
+	job.m_radius = i_radius;
+	job.m_inverseArea = 1.0f/(float)((2*(size_t)i_radius + 1)*(2*(size_t)i_radius + 1));
+
+	return task_pool_parallel_for(i_sizeY, INTEGRAL_BAND_ROWS, integral_box_band, &job, io_poolHandle);
+}
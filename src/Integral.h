@@ -0,0 +1,34 @@
+#ifndef _INTEGRAL_H_
+#define _INTEGRAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTEGRAL_BAND_ROWS 16
+
+/* Sums are (sizeX+1) by (sizeY+1) with a zero first row and column; 8-bit inputs fit up to 16.8 million pixels */
+Result integral_image(	uint8_t const * const i_luma,
+								size_t const i_strideBytes,
+								uint32_t const i_sizeX,
+								uint32_t const i_sizeY,
+								uint32_t * const o_integral);
+/* Mean over the (2*radius+1) square around each pixel, clipped at the image edges */
+Result integral_box_filter(	uint32_t const * const i_integral,
+										uint32_t const i_sizeX,
+										uint32_t const i_sizeY,
+										uint32_t const i_radius,
+										uint8_t * const o_output,
+										TaskPool * const io_poolHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _INTEGRAL_H_ */
@@ -0,0 +1,108 @@
+#include "Memory.h"
+
+#include <sys/mman.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/********************----- Internal Functions -----********************/
+static size_t memory_round_up(size_t const i_sizeBytes, size_t const i_alignment)
+{
+	return (i_sizeBytes + i_alignment - 1)/i_alignment*i_alignment;
+}
+/**************************************************/
+
+Result memory_region_map(size_t const i_sizeBytes, uint32_t const i_flags, MemoryRegion * const o_region)
+{
+	long const pageSizeBytes = sysconf(_SC_PAGESIZE);
+	MemoryRegion region;
+
+	/***** Input Validation *****/
+	if(i_sizeBytes == 0 || o_region == NULL)
+	{
+		CARL_ERROR("Memory region needs a non-0 size and an output.");
+		return R_INPUTBAD;
+	}
+
+	region.m_memory = MAP_FAILED;
+	region.m_sizeBytes = 0;
+	region.m_hugepage = 0;
+	region.m_locked = 0;
+
+	/***** Explicit huge pages first, they need a reserved hugetlbfs pool *****/
+#ifdef MAP_HUGETLB
+	if(i_flags & MEMORY_FLAG_HUGEPAGE)
+	{
+		region.m_sizeBytes = memory_round_up(i_sizeBytes, MEMORY_HUGEPAGE_BYTES);
+		region.m_memory = mmap(NULL, region.m_sizeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		region.m_hugepage = (region.m_memory != MAP_FAILED);
+	}
+#endif
+	if(region.m_memory == MAP_FAILED)
+	{
+		region.m_sizeBytes = memory_round_up(i_sizeBytes, (pageSizeBytes > 0) ? (size_t)pageSizeBytes : 4096);
+		region.m_memory = mmap(NULL, region.m_sizeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(region.m_memory == MAP_FAILED)
+		{
+			CARL_ERRORNO("Unable to map %zu bytes.", region.m_sizeBytes);
+			return R_MEMORYALLOCATIONERROR;
+		}
+#ifdef MADV_HUGEPAGE
+		/***** Otherwise let transparent huge pages back it where they can *****/
+		if((i_flags & MEMORY_FLAG_HUGEPAGE) && region.m_sizeBytes >= MEMORY_HUGEPAGE_BYTES)
+		{
+			madvise(region.m_memory, region.m_sizeBytes, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	/***** Fault in now rather than on the first frame *****/
+	if(i_flags & MEMORY_FLAG_PREFAULT)
+	{
+		memset(region.m_memory, 0, region.m_sizeBytes);
+	}
+	if(i_flags & MEMORY_FLAG_LOCK)
+	{
+		if(mlock(region.m_memory, region.m_sizeBytes) == 0)
+		{
+			region.m_locked = 1;
+		}
+		else
+		{
+			CARL_WARNING("Unable to lock %zu bytes - \"%s\"", region.m_sizeBytes, strerror(errno));
+		}
+	}
+
+	(*o_region) = region;
+
+	return R_SUCCESS;
+}
+
+Result memory_region_unmap(MemoryRegion * const io_region)
+{
+	/***** Input Validation *****/
+	if(io_region == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already unmapped *****/
+	if(io_region->m_memory == NULL || io_region->m_memory == MAP_FAILED)
+	{
+		io_region->m_memory = NULL;
+		return R_SUCCESS;
+	}
+
+	if(io_region->m_locked)
+	{
+		munlock(io_region->m_memory, io_region->m_sizeBytes);
+	}
+	munmap(io_region->m_memory, io_region->m_sizeBytes);
+	io_region->m_memory = NULL;
+	io_region->m_sizeBytes = 0;
+	io_region->m_hugepage = 0;
+	io_region->m_locked = 0;
+
+	return R_SUCCESS;
+}
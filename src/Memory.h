@@ -0,0 +1,45 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MEMORY_CACHE_LINE_BYTES 64
+#define MEMORY_HUGEPAGE_BYTES (2*1024*1024)
+
+/********************----- ENUM: MemoryFlag -----********************/
+enum MemoryFlag_e
+{
+	MEMORY_FLAG_HUGEPAGE=0x01,
+	MEMORY_FLAG_LOCK=0x02,
+	MEMORY_FLAG_PREFAULT=0x04
+};
+typedef enum MemoryFlag_e MemoryFlag;
+/**************************************************/
+
+/********************----- STRUCT: MemoryRegion -----********************/
+/* Page-aligned anonymous mapping; m_hugepage is set when MAP_HUGETLB succeeded */
+struct MemoryRegion_s
+{
+	void *m_memory;
+	size_t m_sizeBytes;
+	int m_hugepage;
+	int m_locked;
+};
+typedef struct MemoryRegion_s MemoryRegion;
+/**************************************************/
+
+Result memory_region_map(size_t const i_sizeBytes, uint32_t const i_flags, MemoryRegion * const o_region);
+Result memory_region_unmap(MemoryRegion * const io_region);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _MEMORY_H_ */
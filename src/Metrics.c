@@ -0,0 +1,261 @@
+#include "Metrics.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/********************----- STRUCT: MetricsPage -----********************/
+struct MetricsPage_s
+{
+	char m_name[METRICS_NAME_LENGTH];
+	void *m_map;
+	size_t m_mapSizeBytes;
+	MetricsPageHeader *m_header;
+	MetricsSlot *m_slots;
+	size_t m_slotsHeld;
+	int m_fileHandle;
+	pthread_mutex_t m_lock;
+};
+/**************************************************/
+
+Result metrics_page_create(	char const * const i_name,
+										size_t const i_slotCount,
+										MetricsPage ** const o_pageHandle)
+{
+	MetricsPage *pageHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_name == NULL || i_name[0] != '/' || strlen(i_name) >= METRICS_NAME_LENGTH || i_slotCount == 0)
+	{
+		CARL_ERROR("Metrics page needs a \"/name\" shorter than %d and a non-0 slot count.", METRICS_NAME_LENGTH);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create page structure *****/
+	pageHandle = (MetricsPage *)malloc(sizeof(MetricsPage));
+	if(pageHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	strcpy(pageHandle->m_name, i_name);
+	pageHandle->m_map = MAP_FAILED;
+	pageHandle->m_mapSizeBytes = sizeof(MetricsPageHeader) + i_slotCount*sizeof(MetricsSlot);
+	pageHandle->m_slotsHeld = 0;
+	pageHandle->m_fileHandle = -1;
+	pthread_mutex_init(&pageHandle->m_lock, NULL);
+
+	/***** Shared memory object, locked for as long as it is open so a live page is never wiped *****/
+	pageHandle->m_fileHandle = shm_open(i_name, O_RDWR | O_CREAT, 0644);
+	if(pageHandle->m_fileHandle < 0)
+	{
+		CARL_ERRORNO("Unable to open shared memory \"%s\".", i_name);
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+	if(flock(pageHandle->m_fileHandle, LOCK_EX | LOCK_NB) == -1)
+	{
+		CARL_ERRORNO("Shared memory \"%s\" is in use by another process.", i_name);
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+
+	/***** A page left by a dead process is cleared before it is sized *****/
+	if(ftruncate(pageHandle->m_fileHandle, 0) == -1 || ftruncate(pageHandle->m_fileHandle, (off_t)pageHandle->m_mapSizeBytes) == -1)
+	{
+		CARL_ERRORNO("Unable to size shared memory \"%s\".", i_name);
+
+		result = R_DEVICEWRITEFAILED;
+		goto end;
+	}
+	pageHandle->m_map = mmap(NULL, pageHandle->m_mapSizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED, pageHandle->m_fileHandle, 0);
+	if(pageHandle->m_map == MAP_FAILED)
+	{
+		CARL_ERRORNO("Unable to map shared memory \"%s\".", i_name);
+
+		result = R_BUFFERMAPFAILED;
+		goto end;
+	}
+
+	/***** Header *****/
+	pageHandle->m_header = (MetricsPageHeader *)pageHandle->m_map;
+	pageHandle->m_slots = (MetricsSlot *)(pageHandle->m_header + 1);
+	memcpy(pageHandle->m_header->m_magic, METRICS_MAGIC, sizeof(pageHandle->m_header->m_magic));
+	pageHandle->m_header->m_version = METRICS_VERSION;
+	pageHandle->m_header->m_slotSizeBytes = sizeof(MetricsSlot);
+	pageHandle->m_header->m_slotCount = (uint32_t)i_slotCount;
+	__atomic_store_n(&pageHandle->m_header->m_slotUsed, 0, __ATOMIC_RELEASE);
+
+	if(o_pageHandle != NULL)
+	{
+		(*o_pageHandle) = pageHandle;
+	}
+	else
+	{
+		metrics_page_destroy(&pageHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("metrics_page_create(%s, %zu, %p)", (i_name != NULL) ? i_name : "(null)", i_slotCount, o_pageHandle);
+	metrics_page_destroy(&pageHandle);
+
+	return result;
+}
+
+Result metrics_page_destroy(MetricsPage ** const io_pageHandle)
+{
+	MetricsPage *pageHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_pageHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	pageHandle = (*io_pageHandle);
+	if(pageHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Handles still counting into the page would write to unmapped memory *****/
+	pthread_mutex_lock(&pageHandle->m_lock);
+	if(pageHandle->m_slotsHeld > 0)
+	{
+		pthread_mutex_unlock(&pageHandle->m_lock);
+		CARL_ERROR("Metrics page \"%s\" still has %zu exported handles.", pageHandle->m_name, pageHandle->m_slotsHeld);
+		return R_OBJECTINUSE;
+	}
+	pthread_mutex_unlock(&pageHandle->m_lock);
+
+	if(pageHandle->m_map != MAP_FAILED)
+	{
+		munmap(pageHandle->m_map, pageHandle->m_mapSizeBytes);
+		shm_unlink(pageHandle->m_name);
+	}
+	if(pageHandle->m_fileHandle >= 0)
+	{
+		close(pageHandle->m_fileHandle);
+	}
+	pthread_mutex_destroy(&pageHandle->m_lock);
+	free(pageHandle);
+	(*io_pageHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result metrics_page_slot(	char const * const i_name,
+									char const * const i_kind,
+									char const * const * const i_fieldNames,
+									size_t const i_fieldCount,
+									uint64_t ** const o_values,
+									MetricsPage * const io_pageHandle)
+{
+	size_t fieldIndex = 0;
+	MetricsSlot *slot = NULL;
+	uint32_t slotIndex = 0;
+	uint32_t slotUsed = 0;
+
+	if(io_pageHandle == NULL)
+	{
+		CARL_ERROR("Metrics page not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_name == NULL || i_kind == NULL || i_fieldNames == NULL || i_fieldCount > METRICS_FIELD_COUNT_MAX || o_values == NULL)
+	{
+		CARL_ERROR("Invalid metrics slot description.");
+		return R_INPUTBAD;
+	}
+
+	pthread_mutex_lock(&io_pageHandle->m_lock);
+	slotUsed = io_pageHandle->m_header->m_slotUsed;
+	for(slotIndex=0; slotIndex<slotUsed; ++slotIndex)
+	{
+		if(!io_pageHandle->m_slots[slotIndex].m_inUse)
+		{
+			break;
+		}
+	}
+	if(slotIndex >= io_pageHandle->m_header->m_slotCount)
+	{
+		pthread_mutex_unlock(&io_pageHandle->m_lock);
+		CARL_ERROR("Metrics page \"%s\" is full.", io_pageHandle->m_name);
+		return R_MEMORYALLOCATIONERROR;
+	}
+
+	/***** Describe the slot, then publish it to scrapers *****/
+	slot = &io_pageHandle->m_slots[slotIndex];
+	memset(slot, 0, sizeof(*slot));
+	strncpy(slot->m_name, i_name, sizeof(slot->m_name)-1);
+	strncpy(slot->m_kind, i_kind, sizeof(slot->m_kind)-1);
+	slot->m_fieldCount = (uint32_t)i_fieldCount;
+	for(fieldIndex=0; fieldIndex<i_fieldCount; ++fieldIndex)
+	{
+		strncpy(slot->m_fieldNames[fieldIndex], i_fieldNames[fieldIndex], METRICS_FIELD_NAME_LENGTH-1);
+	}
+	__atomic_store_n(&slot->m_inUse, 1, __ATOMIC_RELEASE);
+	if(slotIndex == slotUsed)
+	{
+		__atomic_store_n(&io_pageHandle->m_header->m_slotUsed, slotUsed+1, __ATOMIC_RELEASE);
+	}
+	++io_pageHandle->m_slotsHeld;
+	pthread_mutex_unlock(&io_pageHandle->m_lock);
+
+	(*o_values) = slot->m_values;
+
+	return R_SUCCESS;
+}
+
+Result metrics_page_release(uint64_t * const i_values, MetricsPage * const io_pageHandle)
+{
+	MetricsSlot *slot = NULL;
+	size_t slotIndex = 0;
+
+	if(io_pageHandle == NULL)
+	{
+		CARL_ERROR("Metrics page not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_values == NULL || (uint8_t *)i_values < (uint8_t *)io_pageHandle->m_slots)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Values must be the start of a slot this page handed out *****/
+	slotIndex = (size_t)((uint8_t *)i_values - (uint8_t *)io_pageHandle->m_slots)/sizeof(MetricsSlot);
+	slot = &io_pageHandle->m_slots[slotIndex];
+	if(slotIndex >= io_pageHandle->m_header->m_slotCount || slot->m_values != i_values)
+	{
+		CARL_ERROR("Values are not a slot of metrics page \"%s\".", io_pageHandle->m_name);
+		return R_INPUTBAD;
+	}
+
+	/***** Scrapers stop showing it at once; the next export reuses it *****/
+	pthread_mutex_lock(&io_pageHandle->m_lock);
+	if(slot->m_inUse)
+	{
+		__atomic_store_n(&slot->m_inUse, 0, __ATOMIC_RELEASE);
+		--io_pageHandle->m_slotsHeld;
+	}
+	pthread_mutex_unlock(&io_pageHandle->m_lock);
+
+	return R_SUCCESS;
+}
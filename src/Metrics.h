@@ -0,0 +1,119 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_MAGIC "CARLSTAT"
+#define METRICS_VERSION 2
+#define METRICS_NAME_LENGTH 48
+#define METRICS_FIELD_COUNT_MAX 16
+#define METRICS_FIELD_NAME_LENGTH 24
+
+/********************----- STRUCT: MetricsPage -----********************/
+struct MetricsPage_s;
+typedef struct MetricsPage_s MetricsPage;
+/**************************************************/
+
+/********************----- Shared Memory Layout -----********************/
+/* Header followed by m_slotCount slots; m_slotUsed is the high-water mark and only slots with m_inUse set are live */
+struct MetricsPageHeader_s
+{
+	char m_magic[8];
+	uint32_t m_version;
+	uint32_t m_slotSizeBytes;
+	uint32_t m_slotCount;
+	uint32_t m_slotUsed;
+	uint64_t m_reserved[2];
+};
+typedef struct MetricsPageHeader_s MetricsPageHeader;
+
+struct MetricsSlot_s
+{
+	char m_name[METRICS_NAME_LENGTH];
+	char m_kind[METRICS_FIELD_NAME_LENGTH];
+	uint32_t m_fieldCount;
+	uint32_t m_inUse;
+	char m_fieldNames[METRICS_FIELD_COUNT_MAX][METRICS_FIELD_NAME_LENGTH];
+	uint64_t m_values[METRICS_FIELD_COUNT_MAX];
+};
+typedef struct MetricsSlot_s MetricsSlot;
+/**************************************************/
+
+/* The page is locked to this process; a page left by a dead process is reused */
+Result metrics_page_create(	char const * const i_name,
+										size_t const i_slotCount,
+										MetricsPage ** const o_pageHandle);
+/* R_OBJECTINUSE, leaving the page mapped, while any slot is still held */
+Result metrics_page_destroy(MetricsPage ** const io_pageHandle);
+Result metrics_page_release(uint64_t * const i_values, MetricsPage * const io_pageHandle);
+/* Reuses a released slot before taking a new one */
+Result metrics_page_slot(	char const * const i_name,
+									char const * const i_kind,
+									char const * const * const i_fieldNames,
+									size_t const i_fieldCount,
+									uint64_t ** const o_values,
+									MetricsPage * const io_pageHandle);
+
+/********************----- Counter Helpers -----********************/
+static inline void metrics_add(uint64_t * const io_counter, uint64_t const i_value)
+{
+	__atomic_fetch_add(io_counter, i_value, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_set(uint64_t * const io_gauge, uint64_t const i_value)
+{
+	__atomic_store_n(io_gauge, i_value, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_max(uint64_t * const io_gauge, uint64_t const i_value)
+{
+	uint64_t current = __atomic_load_n(io_gauge, __ATOMIC_RELAXED);
+
+	while(i_value > current && !__atomic_compare_exchange_n(io_gauge, &current, i_value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+/* Moves counts to a new home after the writers were switched to it; counters add, fields in i_gaugeMask keep the larger value */
+static inline void metrics_carry(uint64_t * const io_from, uint64_t * const io_to, size_t const i_count, uint32_t const i_gaugeMask)
+{
+	size_t index = 0;
+	uint64_t value = 0;
+
+	for(index=0; index<i_count; ++index)
+	{
+		value = __atomic_exchange_n(&io_from[index], 0, __ATOMIC_RELAXED);
+		if((i_gaugeMask & (1u << index)) != 0)
+		{
+			metrics_max(&io_to[index], value);
+		}
+		else
+		{
+			metrics_add(&io_to[index], value);
+		}
+	}
+}
+
+static inline void metrics_snapshot(uint64_t const * const i_values, size_t const i_count, uint64_t * const o_values)
+{
+	size_t index = 0;
+
+	for(index=0; index<i_count; ++index)
+	{
+		o_values[index] = __atomic_load_n(&i_values[index], __ATOMIC_RELAXED);
+	}
+}
+/**************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _METRICS_H_ */
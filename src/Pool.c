@@ -0,0 +1,188 @@
+#include "Pool.h"
+
+#include <stdlib.h>
+
+#define POOL_INDEX_NONE 0xFFFFFFFFu
+
+/********************----- STRUCT: Pool -----********************/
+/* m_head packs an ABA tag in the high 32 bits over the first free block index */
+struct Pool_s
+{
+	MemoryRegion m_region;
+	uint8_t *m_blocks;
+	uint32_t *m_next;
+	size_t m_blockSizeBytes;
+	size_t m_blockCount;
+	uint64_t m_head;
+	uint64_t m_available;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint64_t pool_head_pack(uint32_t const i_tag, uint32_t const i_index)
+{
+	return ((uint64_t)i_tag << 32) | i_index;
+}
+/**************************************************/
+
+Result pool_alloc(void ** const o_block, Pool * const io_poolHandle)
+{
+	uint64_t head = 0;
+	uint64_t headNext = 0;
+	uint32_t index = 0;
+
+	if(io_poolHandle == NULL || o_block == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	head = __atomic_load_n(&io_poolHandle->m_head, __ATOMIC_ACQUIRE);
+	do
+	{
+		index = (uint32_t)head;
+		if(index == POOL_INDEX_NONE)
+		{
+			(*o_block) = NULL;
+			return R_MEMORYALLOCATIONERROR;
+		}
+		headNext = pool_head_pack((uint32_t)(head >> 32) + 1, __atomic_load_n(&io_poolHandle->m_next[index], __ATOMIC_RELAXED));
+	} while(!__atomic_compare_exchange_n(&io_poolHandle->m_head, &head, headNext, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	__atomic_sub_fetch(&io_poolHandle->m_available, 1, __ATOMIC_RELAXED);
+	(*o_block) = io_poolHandle->m_blocks + (size_t)index*io_poolHandle->m_blockSizeBytes;
+
+	return R_SUCCESS;
+}
+
+size_t pool_available(Pool const * const i_poolHandle)
+{
+	return (i_poolHandle != NULL) ? (size_t)__atomic_load_n(&i_poolHandle->m_available, __ATOMIC_RELAXED) : 0;
+}
+
+size_t pool_block_size(Pool const * const i_poolHandle)
+{
+	return (i_poolHandle != NULL) ? i_poolHandle->m_blockSizeBytes : 0;
+}
+
+Result pool_create(	size_t const i_blockSizeBytes,
+							size_t const i_blockCount,
+							uint32_t const i_memoryFlags,
+							Pool ** const o_poolHandle)
+{
+	Pool *poolHandle = NULL;
+	size_t blockIndex = 0;
+	size_t blocksSizeBytes = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_blockSizeBytes == 0 || i_blockCount == 0 || i_blockCount >= POOL_INDEX_NONE)
+	{
+		CARL_ERROR("Pool needs a non-0 block size and 1 to %u blocks.", POOL_INDEX_NONE-1);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create pool structure *****/
+	poolHandle = (Pool *)calloc(1, sizeof(Pool));
+	if(poolHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	poolHandle->m_blockSizeBytes = (i_blockSizeBytes + MEMORY_CACHE_LINE_BYTES - 1)/MEMORY_CACHE_LINE_BYTES*MEMORY_CACHE_LINE_BYTES;
+	poolHandle->m_blockCount = i_blockCount;
+
+	/***** Blocks, then the free list links, in one mapping *****/
+	blocksSizeBytes = poolHandle->m_blockSizeBytes*i_blockCount;
+	result = memory_region_map(blocksSizeBytes + i_blockCount*sizeof(uint32_t), i_memoryFlags, &poolHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	poolHandle->m_blocks = (uint8_t *)poolHandle->m_region.m_memory;
+	poolHandle->m_next = (uint32_t *)(poolHandle->m_blocks + blocksSizeBytes);
+	for(blockIndex=0; blockIndex<i_blockCount; ++blockIndex)
+	{
+		poolHandle->m_next[blockIndex] = (blockIndex+1 < i_blockCount) ? (uint32_t)(blockIndex+1) : POOL_INDEX_NONE;
+	}
+	poolHandle->m_head = pool_head_pack(0, 0);
+	poolHandle->m_available = i_blockCount;
+
+	if(o_poolHandle != NULL)
+	{
+		(*o_poolHandle) = poolHandle;
+	}
+	else
+	{
+		pool_destroy(&poolHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("pool_create(%zu, %zu, 0x%x, %p)", i_blockSizeBytes, i_blockCount, i_memoryFlags, o_poolHandle);
+	pool_destroy(&poolHandle);
+
+	return result;
+}
+
+Result pool_destroy(Pool ** const io_poolHandle)
+{
+	Pool *poolHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_poolHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	poolHandle = (*io_poolHandle);
+	if(poolHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&poolHandle->m_region);
+	free(poolHandle);
+	(*io_poolHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result pool_free(void * const i_block, Pool * const io_poolHandle)
+{
+	uint64_t head = 0;
+	size_t offset = 0;
+	uint32_t index = 0;
+
+	if(io_poolHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_block == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Reject pointers that are not block starts of this pool *****/
+	offset = (size_t)((uint8_t *)i_block - io_poolHandle->m_blocks);
+	if((uint8_t *)i_block < io_poolHandle->m_blocks || offset % io_poolHandle->m_blockSizeBytes != 0 || offset/io_poolHandle->m_blockSizeBytes >= io_poolHandle->m_blockCount)
+	{
+		CARL_ERROR("Block %p does not belong to pool %p.", i_block, (void *)io_poolHandle);
+		return R_INPUTBAD;
+	}
+	index = (uint32_t)(offset/io_poolHandle->m_blockSizeBytes);
+
+	head = __atomic_load_n(&io_poolHandle->m_head, __ATOMIC_RELAXED);
+	do
+	{
+		__atomic_store_n(&io_poolHandle->m_next[index], (uint32_t)head, __ATOMIC_RELAXED);
+	} while(!__atomic_compare_exchange_n(&io_poolHandle->m_head, &head, pool_head_pack((uint32_t)(head >> 32) + 1, index), 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	__atomic_add_fetch(&io_poolHandle->m_available, 1, __ATOMIC_RELAXED);
+
+	return R_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/********************----- STRUCT: Pool -----********************/
+struct Pool_s;
+typedef struct Pool_s Pool;
+/**************************************************/
+
+/* Fixed-size blocks, each cache-line aligned; alloc and free are lock-free and may be called from any thread */
+Result pool_alloc(void ** const o_block, Pool * const io_poolHandle);
+size_t pool_available(Pool const * const i_poolHandle);
+size_t pool_block_size(Pool const * const i_poolHandle);
+Result pool_create(	size_t const i_blockSizeBytes,
+							size_t const i_blockCount,
+							uint32_t const i_memoryFlags,
+							Pool ** const o_poolHandle);
+Result pool_destroy(Pool ** const io_poolHandle);
+Result pool_free(void * const i_block, Pool * const io_poolHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _POOL_H_ */
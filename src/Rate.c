@@ -0,0 +1,291 @@
+#include "Rate.h"
+
+#include <sys/timerfd.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/********************----- STRUCT: Rate -----********************/
+struct Rate_s
+{
+	Timestamp m_period;
+	Timestamp m_spin;
+	Timestamp m_deadline;
+	RateMode m_mode;
+	int m_timerHandle;
+	RateStatistics m_statistics;
+};
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+/* Deadlines are absolute CLOCK_MONOTONIC times for clock_nanosleep and the timerfd, whatever the global timestamp source is */
+static inline Timestamp rate_now(void)
+{
+	return timestamp_read(TIMESTAMP_SOURCE_MONOTONIC);
+}
+
+static Result rate_timer_arm(Rate * const io_rateHandle)
+{
+	struct itimerspec timerSpec;
+
+	CLEAR(timerSpec);
+	timestamp_to_timespec(io_rateHandle->m_deadline + io_rateHandle->m_period - io_rateHandle->m_spin, &timerSpec.it_value);
+	timestamp_to_timespec(io_rateHandle->m_period, &timerSpec.it_interval);
+	if(timerfd_settime(io_rateHandle->m_timerHandle, TFD_TIMER_ABSTIME, &timerSpec, NULL) == -1)
+	{
+		CARL_ERRORNO("Unable to arm timer.");
+		return R_TIMERFAILED;
+	}
+
+	return R_SUCCESS;
+}
+
+static void rate_jitter_record(Timestamp const i_jitter, Rate * const io_rateHandle)
+{
+	Timestamp jitterMicroseconds = i_jitter / TIMESTAMP_NS_PER_US;
+	size_t bucketIndex = 0;
+
+	while(jitterMicroseconds > 0 && bucketIndex < RATE_JITTER_BUCKET_COUNT-1)
+	{
+		jitterMicroseconds >>= 1;
+		++bucketIndex;
+	}
+
+	++io_rateHandle->m_statistics.m_jitterHistogram[bucketIndex];
+	io_rateHandle->m_statistics.m_jitterMax = MAX(io_rateHandle->m_statistics.m_jitterMax, i_jitter);
+}
+/**************************************************/
+
+Result rate_create(	Timestamp const i_period,
+							Timestamp const i_spin,
+							RateMode const i_mode,
+							Rate ** const o_rateHandle)
+{
+	Rate *rateHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_period == 0 || i_spin >= i_period)
+	{
+		CARL_ERROR("Period must be non-0 and longer than the spin time.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+	if(i_mode != RATE_MODE_NANOSLEEP && i_mode != RATE_MODE_TIMERFD)
+	{
+		CARL_ERROR("Invalid rate mode (%d).", i_mode);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create rate structure *****/
+	rateHandle = (Rate *)malloc(sizeof(Rate));
+	if(rateHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	rateHandle->m_period = i_period;
+	rateHandle->m_spin = i_spin;
+	rateHandle->m_mode = i_mode;
+	rateHandle->m_timerHandle = -1;
+
+	/***** Create timer *****/
+	if(i_mode == RATE_MODE_TIMERFD)
+	{
+		rateHandle->m_timerHandle = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if(rateHandle->m_timerHandle < 0)
+		{
+			CARL_ERRORNO("Unable to create timer.");
+
+			result = R_TIMERFAILED;
+			goto end;
+		}
+	}
+
+	/***** Start the first period *****/
+	result = rate_reset(rateHandle);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+
+	if(o_rateHandle != NULL)
+	{
+		(*o_rateHandle) = rateHandle;
+	}
+	else
+	{
+		rate_destroy(&rateHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("rate_create(%llu, %llu, %d, %p)", (unsigned long long)i_period, (unsigned long long)i_spin, i_mode, o_rateHandle);
+	if(rateHandle != NULL)
+	{
+		rate_destroy(&rateHandle);
+	}
+
+	return result;
+}
+
+Result rate_destroy(Rate ** const io_rateHandle)
+{
+	Rate *rateHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_rateHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	rateHandle = (*io_rateHandle);
+	if(rateHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Release timer *****/
+	if(rateHandle->m_timerHandle >= 0)
+	{
+		close(rateHandle->m_timerHandle);
+		rateHandle->m_timerHandle = -1;
+	}
+
+	free(rateHandle);
+	(*io_rateHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+int rate_fd(Rate const * const i_rateHandle)
+{
+	if(i_rateHandle == NULL)
+	{
+		return -1;
+	}
+
+	return i_rateHandle->m_timerHandle;
+}
+
+Result rate_reset(Rate * const io_rateHandle)
+{
+	if(io_rateHandle == NULL)
+	{
+		CARL_ERROR("Rate not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	CLEAR(io_rateHandle->m_statistics);
+	io_rateHandle->m_deadline = rate_now();
+
+	if(io_rateHandle->m_mode == RATE_MODE_TIMERFD)
+	{
+		return rate_timer_arm(io_rateHandle);
+	}
+
+	return R_SUCCESS;
+}
+
+Result rate_sleep(uint64_t * const o_deadlinesMissed, Rate * const io_rateHandle)
+{
+	Timestamp deadline = 0;
+	uint64_t deadlinesMissed = 0;
+	uint64_t expirations = 0;
+	ssize_t readResult = 0;
+	int sleepResult = 0;
+	Timestamp timeCurrent = 0;
+	struct timespec timeWake;
+
+	if(io_rateHandle == NULL)
+	{
+		CARL_ERROR("Rate not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	deadline = io_rateHandle->m_deadline + io_rateHandle->m_period;
+
+	/***** Coarse wait for the absolute deadline *****/
+	if(io_rateHandle->m_mode == RATE_MODE_TIMERFD)
+	{
+		do
+		{
+			readResult = read(io_rateHandle->m_timerHandle, &expirations, sizeof(expirations));
+		} while(readResult == -1 && errno == EINTR);
+		if(readResult != sizeof(expirations))
+		{
+			CARL_ERRORNO("Unable to wait on timer.");
+
+			return R_TIMERFAILED;
+		}
+	}
+	else
+	{
+		timestamp_to_timespec(deadline - io_rateHandle->m_spin, &timeWake);
+		do
+		{
+			sleepResult = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &timeWake, NULL);
+		} while(sleepResult == EINTR);
+		if(sleepResult != 0)
+		{
+			CARL_ERROR("Unable to sleep - \"%s\"", strerror(sleepResult));
+
+			return R_TIMERFAILED;
+		}
+	}
+
+	/***** Fine spin for the remainder *****/
+	do
+	{
+		timeCurrent = rate_now();
+	} while(timeCurrent < deadline);
+
+	/***** Skip whole periods that were missed, keeping the phase *****/
+	if(timeCurrent - deadline >= io_rateHandle->m_period)
+	{
+		deadlinesMissed = (timeCurrent - deadline) / io_rateHandle->m_period;
+		deadline += deadlinesMissed * io_rateHandle->m_period;
+	}
+
+	/***** Bookkeeping *****/
+	rate_jitter_record(timeCurrent - deadline, io_rateHandle);
+	io_rateHandle->m_deadline = deadline;
+	++io_rateHandle->m_statistics.m_cycles;
+	io_rateHandle->m_statistics.m_deadlinesMissed += deadlinesMissed;
+
+	if(o_deadlinesMissed != NULL)
+	{
+		(*o_deadlinesMissed) = deadlinesMissed;
+	}
+
+	return R_SUCCESS;
+}
+
+Result rate_statistics(RateStatistics * const o_statistics, Rate const * const i_rateHandle)
+{
+	if(i_rateHandle == NULL)
+	{
+		CARL_ERROR("Rate not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_statistics != NULL)
+	{
+		(*o_statistics) = i_rateHandle->m_statistics;
+	}
+
+	return R_SUCCESS;
+}
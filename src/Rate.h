@@ -0,0 +1,55 @@
+#ifndef _RATE_H_
+#define _RATE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Timestamp.h"
+
+#include <stdint.h>
+
+#define RATE_JITTER_BUCKET_COUNT 16
+
+/********************----- STRUCT: Rate -----********************/
+struct Rate_s;
+typedef struct Rate_s Rate;
+/**************************************************/
+
+/********************----- ENUM: RateMode -----********************/
+enum RateMode_e
+{
+	RATE_MODE_NANOSLEEP,
+	RATE_MODE_TIMERFD
+};
+typedef enum RateMode_e RateMode;
+/**************************************************/
+
+/********************----- STRUCT: RateStatistics -----********************/
+/* Bucket 0 counts wakeups under 1us late, bucket n counts [2^(n-1), 2^n) us */
+struct RateStatistics_s
+{
+	uint64_t m_cycles;
+	uint64_t m_deadlinesMissed;
+	Timestamp m_jitterMax;
+	uint64_t m_jitterHistogram[RATE_JITTER_BUCKET_COUNT];
+};
+typedef struct RateStatistics_s RateStatistics;
+/**************************************************/
+
+Result rate_create(	Timestamp const i_period,
+							Timestamp const i_spin,
+							RateMode const i_mode,
+							Rate ** const o_rateHandle);
+Result rate_destroy(Rate ** const io_rateHandle);
+int rate_fd(Rate const * const i_rateHandle);
+Result rate_reset(Rate * const io_rateHandle);
+Result rate_sleep(uint64_t * const o_deadlinesMissed, Rate * const io_rateHandle);
+Result rate_statistics(RateStatistics * const o_statistics, Rate const * const i_rateHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _RATE_H_ */
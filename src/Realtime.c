@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include "Realtime.h"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STACK_PREFAULT_CHUNK_BYTES (64*1024)
+#define STACK_GUARD_BYTES (256*1024)
+
+static char const * const ISOLATED_CPUS_PATHNAME = "/sys/devices/system/cpu/isolated";
+
+/********************----- Internal Functions -----********************/
+static int realtime_cpu_isolated(int const i_cpu)
+{
+	char cpuList[256];
+	char *cursor = NULL;
+	FILE *fileHandle = NULL;
+	long rangeFirst = 0;
+	long rangeLast = 0;
+
+	fileHandle = fopen(ISOLATED_CPUS_PATHNAME, "r");
+	if(fileHandle == NULL)
+	{
+		return 0;
+	}
+	if(fgets(cpuList, sizeof(cpuList), fileHandle) == NULL)
+	{
+		cpuList[0] = '\0';
+	}
+	fclose(fileHandle);
+
+	/***** Format is "2-3,5" *****/
+	cursor = cpuList;
+	while(*cursor >= '0' && *cursor <= '9')
+	{
+		rangeFirst = strtol(cursor, &cursor, 10);
+		rangeLast = rangeFirst;
+		if(*cursor == '-')
+		{
+			rangeLast = strtol(cursor+1, &cursor, 10);
+		}
+		if(i_cpu >= rangeFirst && i_cpu <= rangeLast)
+		{
+			return 1;
+		}
+		if(*cursor == ',')
+		{
+			++cursor;
+		}
+	}
+
+	return 0;
+}
+
+/* Bytes between the current frame and the low end of this thread's stack, less a guard margin for whatever runs after setup */
+static size_t realtime_stack_available(void)
+{
+	pthread_attr_t attributes;
+	void *stackLow = NULL;
+	size_t stackSizeBytes = 0;
+	unsigned char here = 0;
+	size_t availableBytes = 0;
+
+	if(pthread_getattr_np(pthread_self(), &attributes) != 0)
+	{
+		return 0;
+	}
+	if(pthread_attr_getstack(&attributes, &stackLow, &stackSizeBytes) == 0 && (uintptr_t)&here > (uintptr_t)stackLow)
+	{
+		availableBytes = (size_t)((uintptr_t)&here - (uintptr_t)stackLow);
+	}
+	pthread_attr_destroy(&attributes);
+
+	return (availableBytes > STACK_GUARD_BYTES) ? availableBytes - STACK_GUARD_BYTES : 0;
+}
+
+/* One fixed chunk per frame, nested until the request is covered; the chunk is touched after the call so the recursion is never a tail call */
+static __attribute__((noinline)) void realtime_stack_prefault(size_t const i_sizeBytes, size_t const i_pageSizeBytes)
+{
+	unsigned char chunk[STACK_PREFAULT_CHUNK_BYTES];
+	/***** Stores through a volatile pointer cannot be elided, and the frame is what gets faulted in *****/
+	volatile unsigned char * const touch = chunk;
+	size_t offset = 0;
+
+	if(i_sizeBytes > STACK_PREFAULT_CHUNK_BYTES)
+	{
+		realtime_stack_prefault(i_sizeBytes - STACK_PREFAULT_CHUNK_BYTES, i_pageSizeBytes);
+	}
+	for(offset=0; offset<MIN(i_sizeBytes, (size_t)STACK_PREFAULT_CHUNK_BYTES); offset+=i_pageSizeBytes)
+	{
+		touch[offset] = 0;
+	}
+}
+/**************************************************/
+
+void realtime_config_default(RealtimeConfig * const o_config)
+{
+	if(o_config == NULL)
+	{
+		return;
+	}
+
+	o_config->m_priority = 0;
+	o_config->m_cpu = -1;
+	o_config->m_lockMemory = 0;
+	o_config->m_stackPrefaultBytes = 0;
+}
+
+Result realtime_setup(RealtimeConfig const * const i_config, uint32_t * const o_status)
+{
+	Result result = R_FAILURE;
+	uint32_t status = 0;
+	size_t availableBytes = 0;
+
+	result = realtime_setup_thread(i_config, pthread_self(), &status);
+
+	/***** Stack can only be touched from the thread itself *****/
+	if(i_config != NULL && i_config->m_stackPrefaultBytes > 0)
+	{
+		availableBytes = realtime_stack_available();
+		if(i_config->m_stackPrefaultBytes > availableBytes)
+		{
+			CARL_ERROR("Stack prefault of %zu bytes exceeds the %zu this thread's stack has left.", i_config->m_stackPrefaultBytes, availableBytes);
+			if(result == R_SUCCESS)
+			{
+				result = R_INPUTBAD;
+			}
+		}
+		else
+		{
+			realtime_stack_prefault(i_config->m_stackPrefaultBytes, (size_t)sysconf(_SC_PAGESIZE));
+			status |= REALTIME_STATUS_STACK_PREFAULTED;
+		}
+	}
+
+	if(o_status != NULL)
+	{
+		(*o_status) = status;
+	}
+
+	return result;
+}
+
+Result realtime_setup_thread(	RealtimeConfig const * const i_config,
+										pthread_t const i_thread,
+										uint32_t * const o_status)
+{
+	cpu_set_t cpuSet;
+	struct rlimit priorityLimit;
+	Result result = R_SUCCESS;
+	struct sched_param schedulerParameters;
+	int setResult = 0;
+	uint32_t status = 0;
+
+	if(i_config == NULL)
+	{
+		CARL_ERROR("No realtime configuration given.");
+		return R_INPUTBAD;
+	}
+
+	/***** Each step is attempted, the first failure is returned *****/
+
+	/***** Scheduler *****/
+	if(i_config->m_priority > 0)
+	{
+		CLEAR(schedulerParameters);
+		schedulerParameters.sched_priority = i_config->m_priority;
+		setResult = pthread_setschedparam(i_thread, SCHED_FIFO, &schedulerParameters);
+		if(setResult == 0)
+		{
+			status |= REALTIME_STATUS_PRIORITY_SET;
+		}
+		else
+		{
+			if(setResult == EPERM)
+			{
+				CLEAR(priorityLimit);
+				getrlimit(RLIMIT_RTPRIO, &priorityLimit);
+				CARL_ERROR("SCHED_FIFO priority %d denied - needs CAP_SYS_NICE or RLIMIT_RTPRIO >= %d (currently %lu).", i_config->m_priority, i_config->m_priority, (unsigned long)priorityLimit.rlim_cur);
+			}
+			else
+			{
+				CARL_ERROR("Unable to set SCHED_FIFO priority %d - \"%s\"", i_config->m_priority, strerror(setResult));
+			}
+			result = (result == R_SUCCESS) ? R_SCHEDULERSETFAILED : result;
+		}
+	}
+
+	/***** Affinity *****/
+	if(i_config->m_cpu >= CPU_SETSIZE)
+	{
+		CARL_ERROR("CPU %d is beyond the %d a cpu_set_t can hold.", i_config->m_cpu, CPU_SETSIZE);
+		result = (result == R_SUCCESS) ? R_INPUTBAD : result;
+	}
+	else if(i_config->m_cpu >= 0)
+	{
+		CPU_ZERO(&cpuSet);
+		CPU_SET(i_config->m_cpu, &cpuSet);
+		setResult = pthread_setaffinity_np(i_thread, sizeof(cpuSet), &cpuSet);
+		if(setResult == 0)
+		{
+			status |= REALTIME_STATUS_AFFINITY_SET;
+		}
+		else
+		{
+			CARL_ERROR("Unable to pin thread to CPU %d - \"%s\"", i_config->m_cpu, strerror(setResult));
+			result = (result == R_SUCCESS) ? R_AFFINITYSETFAILED : result;
+		}
+
+		if(realtime_cpu_isolated(i_config->m_cpu))
+		{
+			status |= REALTIME_STATUS_CPU_ISOLATED;
+		}
+		else
+		{
+			CARL_INFO("CPU %d is not isolated; consider isolcpus=%d nohz_full=%d for lower jitter.", i_config->m_cpu, i_config->m_cpu, i_config->m_cpu);
+		}
+	}
+
+	/***** Memory locking is process wide *****/
+	if(i_config->m_lockMemory)
+	{
+		if(mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+		{
+			status |= REALTIME_STATUS_MEMORY_LOCKED;
+		}
+		else
+		{
+			if(errno == EPERM || errno == ENOMEM)
+			{
+				CLEAR(priorityLimit);
+				getrlimit(RLIMIT_MEMLOCK, &priorityLimit);
+				CARL_ERRORNO("mlockall denied - needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK (currently %lu bytes).", (unsigned long)priorityLimit.rlim_cur);
+			}
+			else
+			{
+				CARL_ERRORNO("Unable to lock memory.");
+			}
+			result = (result == R_SUCCESS) ? R_MEMORYLOCKFAILED : result;
+		}
+	}
+
+	if(o_status != NULL)
+	{
+		(*o_status) = status;
+	}
+
+	return result;
+}
@@ -0,0 +1,48 @@
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/********************----- ENUM: RealtimeStatus -----********************/
+enum RealtimeStatus_e
+{
+	REALTIME_STATUS_PRIORITY_SET=0x01,
+	REALTIME_STATUS_AFFINITY_SET=0x02,
+	REALTIME_STATUS_CPU_ISOLATED=0x04,
+	REALTIME_STATUS_MEMORY_LOCKED=0x08,
+	REALTIME_STATUS_STACK_PREFAULTED=0x10
+};
+typedef enum RealtimeStatus_e RealtimeStatus;
+/**************************************************/
+
+/********************----- STRUCT: RealtimeConfig -----********************/
+/* 0 priority and -1 CPU leave the scheduler and affinity untouched; the stack prefault must fit in what the calling thread's stack has left */
+struct RealtimeConfig_s
+{
+	int m_priority;
+	int m_cpu;
+	int m_lockMemory;
+	size_t m_stackPrefaultBytes;
+};
+typedef struct RealtimeConfig_s RealtimeConfig;
+/**************************************************/
+
+void realtime_config_default(RealtimeConfig * const o_config);
+Result realtime_setup(RealtimeConfig const * const i_config, uint32_t * const o_status);
+Result realtime_setup_thread(	RealtimeConfig const * const i_config,
+										pthread_t const i_thread,
+										uint32_t * const o_status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _REALTIME_H_ */
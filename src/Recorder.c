@@ -0,0 +1,186 @@
+#include "Recorder.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/********************----- STRUCT: Recorder -----********************/
+struct Recorder_s
+{
+	int m_fileHandle;
+	void *m_map;
+	size_t m_mapSizeBytes;
+	RecorderHeader *m_header;
+	RecorderRecord *m_records;
+	uint64_t m_recordCount;
+};
+/**************************************************/
+
+Result recorder_create(	char const * const i_pathname,
+								size_t const i_recordCount,
+								Recorder ** const o_recorderHandle)
+{
+	Recorder *recorderHandle = NULL;
+	Result result = R_FAILURE;
+	struct timespec timeCurrent;
+
+	/***** Input Validation *****/
+	if(i_pathname == NULL || i_recordCount == 0)
+	{
+		CARL_ERROR("Recorder needs a file and a non-0 record count.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create recorder structure *****/
+	recorderHandle = (Recorder *)malloc(sizeof(Recorder));
+	if(recorderHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	recorderHandle->m_fileHandle = -1;
+	recorderHandle->m_map = MAP_FAILED;
+	recorderHandle->m_recordCount = i_recordCount;
+	recorderHandle->m_mapSizeBytes = sizeof(RecorderHeader) + i_recordCount*sizeof(RecorderRecord);
+
+	/***** Open and size the backing file *****/
+	recorderHandle->m_fileHandle = open(i_pathname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(recorderHandle->m_fileHandle < 0)
+	{
+		CARL_ERRORNO("Unable to open recorder file \"%s\".", i_pathname);
+
+		result = R_DEVICEOPENFAILED;
+		goto end;
+	}
+	if(ftruncate(recorderHandle->m_fileHandle, (off_t)recorderHandle->m_mapSizeBytes) == -1)
+	{
+		CARL_ERRORNO("Unable to size recorder file \"%s\".", i_pathname);
+
+		result = R_DEVICEWRITEFAILED;
+		goto end;
+	}
+
+	/***** Shared mapping, so the kernel keeps the data if we crash *****/
+	recorderHandle->m_map = mmap(NULL, recorderHandle->m_mapSizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, recorderHandle->m_fileHandle, 0);
+	if(recorderHandle->m_map == MAP_FAILED)
+	{
+		CARL_ERRORNO("Unable to map recorder file \"%s\".", i_pathname);
+
+		result = R_BUFFERMAPFAILED;
+		goto end;
+	}
+	recorderHandle->m_header = (RecorderHeader *)recorderHandle->m_map;
+	recorderHandle->m_records = (RecorderRecord *)(recorderHandle->m_header + 1);
+
+	/***** Header *****/
+	memcpy(recorderHandle->m_header->m_magic, RECORDER_MAGIC, sizeof(recorderHandle->m_header->m_magic));
+	recorderHandle->m_header->m_version = RECORDER_VERSION;
+	recorderHandle->m_header->m_recordSizeBytes = sizeof(RecorderRecord);
+	recorderHandle->m_header->m_recordCount = i_recordCount;
+	recorderHandle->m_header->m_head = 0;
+	recorderHandle->m_header->m_monotonicAnchor = timestamp_now();
+	clock_gettime(CLOCK_REALTIME, &timeCurrent);
+	recorderHandle->m_header->m_realtimeAnchor = timestamp_from_timespec(&timeCurrent);
+
+	if(o_recorderHandle != NULL)
+	{
+		(*o_recorderHandle) = recorderHandle;
+	}
+	else
+	{
+		recorder_destroy(&recorderHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("recorder_create(%s, %zu, %p)", (i_pathname != NULL) ? i_pathname : "(null)", i_recordCount, o_recorderHandle);
+	recorder_destroy(&recorderHandle);
+
+	return result;
+}
+
+Result recorder_destroy(Recorder ** const io_recorderHandle)
+{
+	Recorder *recorderHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_recorderHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	recorderHandle = (*io_recorderHandle);
+	if(recorderHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	if(recorderHandle->m_map != MAP_FAILED)
+	{
+		munmap(recorderHandle->m_map, recorderHandle->m_mapSizeBytes);
+	}
+	if(recorderHandle->m_fileHandle >= 0)
+	{
+		close(recorderHandle->m_fileHandle);
+	}
+	free(recorderHandle);
+	(*io_recorderHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+void recorder_append(	uint16_t const i_event,
+								uint16_t const i_source,
+								uint32_t const i_value32,
+								uint64_t const i_value64,
+								Recorder * const io_recorderHandle)
+{
+	uint64_t position = 0;
+	RecorderRecord *record = NULL;
+
+	if(io_recorderHandle == NULL)
+	{
+		return;
+	}
+
+	/***** Claim a slot; plain stores into the shared mapping *****/
+	position = __atomic_fetch_add(&io_recorderHandle->m_header->m_head, 1, __ATOMIC_RELAXED);
+	record = &io_recorderHandle->m_records[position % io_recorderHandle->m_recordCount];
+	__atomic_store_n(&record->m_sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	record->m_timestamp = timestamp_now();
+	record->m_event = i_event;
+	record->m_source = i_source;
+	record->m_value32 = i_value32;
+	record->m_value64 = i_value64;
+	__atomic_store_n(&record->m_sequence, position+1, __ATOMIC_RELEASE);
+}
+
+Result recorder_sync(Recorder * const io_recorderHandle)
+{
+	if(io_recorderHandle == NULL)
+	{
+		CARL_ERROR("Recorder not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(msync(io_recorderHandle->m_map, io_recorderHandle->m_mapSizeBytes, MS_ASYNC) == -1)
+	{
+		CARL_ERRORNO("Unable to sync recorder.");
+		return R_DEVICEWRITEFAILED;
+	}
+
+	return R_SUCCESS;
+}
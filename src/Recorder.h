@@ -0,0 +1,79 @@
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Timestamp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECORDER_MAGIC "CARLFREC"
+#define RECORDER_VERSION 1
+
+/********************----- STRUCT: Recorder -----********************/
+struct Recorder_s;
+typedef struct Recorder_s Recorder;
+/**************************************************/
+
+/********************----- ENUM: RecorderEvent -----********************/
+enum RecorderEvent_e
+{
+	RECORDER_EVENT_FRAME_DEQUEUED=1,
+	RECORDER_EVENT_SEQUENCE_GAP=2,
+	RECORDER_EVENT_BYTES_READ=3,
+	RECORDER_EVENT_BYTES_WRITTEN=4,
+	RECORDER_EVENT_ERROR=5,
+	RECORDER_EVENT_USER=256
+};
+typedef enum RecorderEvent_e RecorderEvent;
+/**************************************************/
+
+/********************----- STRUCT: RecorderRecord -----********************/
+/* m_sequence is written last; 0 marks a slot that is empty or torn */
+struct RecorderRecord_s
+{
+	uint64_t m_sequence;
+	Timestamp m_timestamp;
+	uint16_t m_event;
+	uint16_t m_source;
+	uint32_t m_value32;
+	uint64_t m_value64;
+};
+typedef struct RecorderRecord_s RecorderRecord;
+/**************************************************/
+
+/********************----- STRUCT: RecorderHeader -----********************/
+struct RecorderHeader_s
+{
+	char m_magic[8];
+	uint32_t m_version;
+	uint32_t m_recordSizeBytes;
+	uint64_t m_recordCount;
+	uint64_t m_head;
+	uint64_t m_monotonicAnchor;
+	uint64_t m_realtimeAnchor;
+	uint64_t m_reserved[2];
+};
+typedef struct RecorderHeader_s RecorderHeader;
+/**************************************************/
+
+Result recorder_create(	char const * const i_pathname,
+								size_t const i_recordCount,
+								Recorder ** const o_recorderHandle);
+Result recorder_destroy(Recorder ** const io_recorderHandle);
+void recorder_append(	uint16_t const i_event,
+								uint16_t const i_source,
+								uint32_t const i_value32,
+								uint64_t const i_value64,
+								Recorder * const io_recorderHandle);
+Result recorder_sync(Recorder * const io_recorderHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _RECORDER_H_ */
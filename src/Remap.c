@@ -0,0 +1,616 @@
+#include "Remap.h"
+#include "Memory.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define REMAP_OFFSET_OUTSIDE 0xFFFFFFFFu
+#define REMAP_OFFSET(x, y) ((uint32_t)(((size_t)(y) << 16) | (size_t)(x)))
+
+/********************----- STRUCT: Remap -----********************/
+/* Per output pixel: source row and column of the top-left tap packed 16:16, and 8-bit X and Y weights of the taps to its right and below */
+struct Remap_s
+{
+	MemoryRegion m_region;
+	uint32_t *m_offset;
+	uint16_t *m_fraction;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_sourceSizeX;
+	size_t m_sourceSizeY;
+	size_t m_offsetX;
+	size_t m_offsetY;
+	RemapInterpolation m_interpolation;
+};
+/**************************************************/
+
+/********************----- STRUCT: RemapJob -----********************/
+struct RemapJob_s
+{
+	Remap const *m_remap;
+	uint8_t const *m_source;
+	uint8_t *m_output;
+	size_t m_bytesPerPixel;
+	size_t m_strideBytes;
+	size_t m_lumaByte;
+	int m_packed;
+};
+typedef struct RemapJob_s RemapJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static inline size_t remap_address(uint32_t const i_offset, size_t const i_bytesPerPixel, size_t const i_strideBytes)
+{
+	return (size_t)(i_offset >> 16)*i_strideBytes + (size_t)(i_offset & 0xFFFF)*i_bytesPerPixel;
+}
+
+static Result remap_table_build(	float const * const i_mapX,
+											float const * const i_mapY,
+											size_t const i_mapStride,
+											size_t const i_beginX,
+											size_t const i_beginY,
+											size_t const i_sizeX,
+											size_t const i_sizeY,
+											size_t const i_sourceSizeX,
+											size_t const i_sourceSizeY,
+											RemapInterpolation const i_interpolation,
+											Remap ** const o_remapHandle)
+{
+	Remap *remapHandle = NULL;
+	size_t const pixelCount = i_sizeX*i_sizeY;
+	size_t x = 0;
+	size_t y = 0;
+	Result result = R_FAILURE;
+
+	/***** Create remap structure *****/
+	remapHandle = (Remap *)calloc(1, sizeof(Remap));
+	if(remapHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	remapHandle->m_sizeX = i_sizeX;
+	remapHandle->m_sizeY = i_sizeY;
+	remapHandle->m_sourceSizeX = i_sourceSizeX;
+	remapHandle->m_sourceSizeY = i_sourceSizeY;
+	remapHandle->m_offsetX = i_beginX;
+	remapHandle->m_offsetY = i_beginY;
+	remapHandle->m_interpolation = i_interpolation;
+
+	/***** Offsets, then weights, in one mapping *****/
+	result = memory_region_map(pixelCount*(sizeof(uint32_t) + sizeof(uint16_t)), MEMORY_FLAG_PREFAULT, &remapHandle->m_region);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	remapHandle->m_offset = (uint32_t *)remapHandle->m_region.m_memory;
+	remapHandle->m_fraction = (uint16_t *)(remapHandle->m_offset + pixelCount);
+
+	for(y=0; y<i_sizeY; ++y)
+	{
+		for(x=0; x<i_sizeX; ++x)
+		{
+			size_t const mapIndex = (i_beginY + y)*i_mapStride + i_beginX + x;
+			size_t const index = y*i_sizeX + x;
+			double const sourceX = i_mapX[mapIndex];
+			double const sourceY = i_mapY[mapIndex];
+			double baseX = 0.0;
+			double baseY = 0.0;
+			long fractionX = 0;
+			long fractionY = 0;
+
+			remapHandle->m_offset[index] = REMAP_OFFSET_OUTSIDE;
+			remapHandle->m_fraction[index] = 0;
+			if(i_interpolation == REMAP_INTERPOLATION_NEAREST)
+			{
+				baseX = floor(sourceX + 0.5);
+				baseY = floor(sourceY + 0.5);
+				if(baseX >= 0.0 && baseY >= 0.0 && baseX < (double)i_sourceSizeX && baseY < (double)i_sourceSizeY)
+				{
+					remapHandle->m_offset[index] = REMAP_OFFSET(baseX, baseY);
+				}
+				continue;
+			}
+
+			/***** Bilinear needs the tap to the right and below inside too; a sample exactly on the last column or row takes the pair before it at full weight *****/
+			baseX = floor(sourceX);
+			baseY = floor(sourceY);
+			if(i_sourceSizeX > 1 && sourceX == (double)(i_sourceSizeX - 1))
+			{
+				baseX -= 1.0;
+			}
+			if(i_sourceSizeY > 1 && sourceY == (double)(i_sourceSizeY - 1))
+			{
+				baseY -= 1.0;
+			}
+			if(baseX >= 0.0 && baseY >= 0.0 && baseX + 1.0 < (double)i_sourceSizeX && baseY + 1.0 < (double)i_sourceSizeY)
+			{
+				fractionX = lround((sourceX - baseX)*256.0);
+				fractionY = lround((sourceY - baseY)*256.0);
+				remapHandle->m_offset[index] = REMAP_OFFSET(baseX, baseY);
+				remapHandle->m_fraction[index] = (uint16_t)(MIN(fractionX, 255) | (MIN(fractionY, 255) << 8));
+			}
+		}
+	}
+
+	(*o_remapHandle) = remapHandle;
+
+	return R_SUCCESS;
+
+end:
+	remap_destroy(&remapHandle);
+
+	return result;
+}
+
+static uint8_t remap_bilinear(	uint8_t const * const i_sourceLuma,
+											uint32_t const i_offset,
+											uint16_t const i_fraction,
+											size_t const i_bytesPerPixel,
+											size_t const i_sourceStride)
+{
+	uint32_t const weightX = i_fraction & 0xFF;
+	uint32_t const weightY = i_fraction >> 8;
+	uint8_t const *tap = NULL;
+	uint32_t top = 0;
+	uint32_t bottom = 0;
+
+	if(i_offset == REMAP_OFFSET_OUTSIDE)
+	{
+		return 0;
+	}
+	tap = i_sourceLuma + remap_address(i_offset, i_bytesPerPixel, i_sourceStride);
+	top = ((uint32_t)tap[0]*(256 - weightX) + (uint32_t)tap[i_bytesPerPixel]*weightX + 128) >> 8;
+	bottom = ((uint32_t)tap[i_sourceStride]*(256 - weightX) + (uint32_t)tap[i_sourceStride + i_bytesPerPixel]*weightX + 128) >> 8;
+
+	return (uint8_t)((top*(256 - weightY) + bottom*weightY + 128) >> 8);
+}
+
+#ifdef __SSE2__
+/* Taps go straight into vector lanes; outside pixels read the first source pixel and are masked to 0 */
+#define REMAP_LANE(lane) \
+	{ \
+		uint32_t const offset = i_offsets[lane]; \
+		uint8_t const * const tap = i_sourceLuma + ((offset != REMAP_OFFSET_OUTSIDE) ? remap_address(offset, i_bytesPerPixel, i_sourceStride) : 0); \
+		tap00 = _mm_insert_epi16(tap00, tap[0], lane); \
+		tap01 = _mm_insert_epi16(tap01, tap[i_bytesPerPixel], lane); \
+		tap10 = _mm_insert_epi16(tap10, tap[i_sourceStride], lane); \
+		tap11 = _mm_insert_epi16(tap11, tap[i_sourceStride + i_bytesPerPixel], lane); \
+		fraction = _mm_insert_epi16(fraction, i_fractions[lane], lane); \
+		inside = _mm_insert_epi16(inside, (offset != REMAP_OFFSET_OUTSIDE) ? 0xFFFF : 0, lane); \
+	}
+
+/* Same rounding as remap_bilinear, eight pixels at a time */
+static __m128i remap_bilinear8(	uint8_t const * const i_sourceLuma,
+											uint32_t const * const i_offsets,
+											uint16_t const * const i_fractions,
+											size_t const i_bytesPerPixel,
+											size_t const i_sourceStride)
+{
+	__m128i const full = _mm_set1_epi16(256);
+	__m128i const half = _mm_set1_epi16(128);
+	__m128i tap00 = _mm_setzero_si128();
+	__m128i tap01 = _mm_setzero_si128();
+	__m128i tap10 = _mm_setzero_si128();
+	__m128i tap11 = _mm_setzero_si128();
+	__m128i fraction = _mm_setzero_si128();
+	__m128i inside = _mm_setzero_si128();
+	__m128i weightX;
+	__m128i weightY;
+	__m128i top;
+	__m128i bottom;
+
+	REMAP_LANE(0)
+	REMAP_LANE(1)
+	REMAP_LANE(2)
+	REMAP_LANE(3)
+	REMAP_LANE(4)
+	REMAP_LANE(5)
+	REMAP_LANE(6)
+	REMAP_LANE(7)
+
+	weightX = _mm_and_si128(fraction, _mm_set1_epi16(0xFF));
+	weightY = _mm_srli_epi16(fraction, 8);
+	top = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tap00, _mm_sub_epi16(full, weightX)), _mm_mullo_epi16(tap01, weightX)), half), 8);
+	bottom = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tap10, _mm_sub_epi16(full, weightX)), _mm_mullo_epi16(tap11, weightX)), half), 8);
+
+	return _mm_and_si128(_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(top, _mm_sub_epi16(full, weightY)), _mm_mullo_epi16(bottom, weightY)), half), 8), inside);
+}
+#endif
+
+static void remap_tile(	size_t const i_beginX,
+								size_t const i_beginY,
+								size_t const i_endX,
+								size_t const i_endY,
+								void * const i_taskData)
+{
+	RemapJob const * const job = (RemapJob const *)i_taskData;
+	Remap const * const remapHandle = job->m_remap;
+	size_t const bytesPerPixel = job->m_bytesPerPixel;
+	size_t const sourceStride = job->m_strideBytes;
+	uint8_t const * const sourceLuma = job->m_source + job->m_lumaByte;
+	size_t x = 0;
+	size_t y = 0;
+
+	for(y=i_beginY; y<i_endY; ++y)
+	{
+		uint32_t const * const offsets = remapHandle->m_offset + y*remapHandle->m_sizeX;
+		uint16_t const * const fractions = remapHandle->m_fraction + y*remapHandle->m_sizeX;
+		uint8_t * const outputRow = job->m_output + y*remapHandle->m_sizeX*bytesPerPixel;
+		uint8_t * const outputLuma = outputRow + job->m_lumaByte;
+
+		/***** Luma *****/
+		if(remapHandle->m_interpolation == REMAP_INTERPOLATION_NEAREST)
+		{
+			for(x=i_beginX; x<i_endX; ++x)
+			{
+				outputLuma[x*bytesPerPixel] = (offsets[x] != REMAP_OFFSET_OUTSIDE) ? sourceLuma[remap_address(offsets[x], bytesPerPixel, sourceStride)] : 0;
+			}
+		}
+		else
+		{
+			x = i_beginX;
+#ifdef __SSE2__
+			for(; x+8<=i_endX; x+=8)
+			{
+				__m128i const blended = remap_bilinear8(sourceLuma, offsets + x, fractions + x, bytesPerPixel, sourceStride);
+
+				if(bytesPerPixel == 1)
+				{
+					_mm_storel_epi64((__m128i *)(outputLuma + x), _mm_packus_epi16(blended, blended));
+				}
+				else
+				{
+					outputLuma[x*2] = (uint8_t)_mm_extract_epi16(blended, 0);
+					outputLuma[x*2 + 2] = (uint8_t)_mm_extract_epi16(blended, 1);
+					outputLuma[x*2 + 4] = (uint8_t)_mm_extract_epi16(blended, 2);
+					outputLuma[x*2 + 6] = (uint8_t)_mm_extract_epi16(blended, 3);
+					outputLuma[x*2 + 8] = (uint8_t)_mm_extract_epi16(blended, 4);
+					outputLuma[x*2 + 10] = (uint8_t)_mm_extract_epi16(blended, 5);
+					outputLuma[x*2 + 12] = (uint8_t)_mm_extract_epi16(blended, 6);
+					outputLuma[x*2 + 14] = (uint8_t)_mm_extract_epi16(blended, 7);
+				}
+			}
+#endif
+			for(; x<i_endX; ++x)
+			{
+				outputLuma[x*bytesPerPixel] = remap_bilinear(sourceLuma, offsets[x], fractions[x], bytesPerPixel, sourceStride);
+			}
+		}
+
+		/***** Chroma: each output macropixel copies the source macropixel nearest its first pixel; bilinear rounds its top-left tap by the weights *****/
+		if(job->m_packed)
+		{
+			size_t const chromaByte = 1 - job->m_lumaByte;
+
+			for(x=i_beginX; x<i_endX; x+=2)
+			{
+				uint8_t * const macropixel = outputRow + x*2 + chromaByte;
+
+				if(offsets[x] == REMAP_OFFSET_OUTSIDE)
+				{
+					macropixel[0] = 128;
+					macropixel[2] = 128;
+				}
+				else
+				{
+					uint32_t const nearest = offsets[x] + ((fractions[x] & 0x80) ? 1 : 0) + ((fractions[x] & 0x8000) ? 0x10000 : 0);
+					uint8_t const * const sourceMacropixel = job->m_source + remap_address(nearest & ~(uint32_t)1, 2, sourceStride) + chromaByte;
+
+					macropixel[0] = sourceMacropixel[0];
+					macropixel[2] = sourceMacropixel[2];
+				}
+			}
+		}
+	}
+}
+
+static Result remap_run(	uint8_t const * const i_frameData,
+									size_t const i_frameSizeBytes,
+									size_t const i_strideBytes,
+									size_t const i_bytesPerPixel,
+									size_t const i_lumaByte,
+									uint8_t * const o_output,
+									TaskPool * const io_poolHandle,
+									Remap const * const i_remapHandle)
+{
+	RemapJob job;
+	size_t strideBytes = i_strideBytes;
+
+	if(i_remapHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(strideBytes == 0)
+	{
+		strideBytes = i_remapHandle->m_sourceSizeX*i_bytesPerPixel;
+	}
+	if(i_frameData == NULL || o_output == NULL || strideBytes < i_remapHandle->m_sourceSizeX*i_bytesPerPixel || i_frameSizeBytes < strideBytes*i_remapHandle->m_sourceSizeY)
+	{
+		CARL_ERROR("Remap needs an output and a %zux%zu frame with a %zu byte stride.", i_remapHandle->m_sourceSizeX, i_remapHandle->m_sourceSizeY, strideBytes);
+		return R_INPUTBAD;
+	}
+
+	job.m_remap = i_remapHandle;
+	job.m_source = i_frameData;
+	job.m_output = o_output;
+	job.m_bytesPerPixel = i_bytesPerPixel;
+	job.m_strideBytes = strideBytes;
+	job.m_lumaByte = i_lumaByte;
+	job.m_packed = (i_bytesPerPixel == 2);
+
+	return task_pool_parallel_for_tiles(i_remapHandle->m_sizeX, i_remapHandle->m_sizeY, REMAP_TILE_X, REMAP_TILE_Y, remap_tile, &job, io_poolHandle);
+}
+
+static int remap_valid(Remap const * const i_remapHandle, size_t const i_x, size_t const i_y)
+{
+	return i_remapHandle->m_offset[i_y*i_remapHandle->m_sizeX + i_x] != REMAP_OFFSET_OUTSIDE;
+}
+/**************************************************/
+
+Result remap_create(	float const * const i_mapX,
+							float const * const i_mapY,
+							uint32_t const i_sizeX,
+							uint32_t const i_sizeY,
+							uint32_t const i_sourceSizeX,
+							uint32_t const i_sourceSizeY,
+							RemapInterpolation const i_interpolation,
+							Remap ** const o_remapHandle)
+{
+	Remap *remapHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_mapX == NULL || i_mapY == NULL || i_sizeX == 0 || i_sizeY == 0 || i_sourceSizeX < 2 || i_sourceSizeY < 2 || i_sourceSizeX >= 0xFFFF || i_sourceSizeY >= 0xFFFF)
+	{
+		CARL_ERROR("Remap needs both maps, an output size and a source from 2x2 to 65534x65534.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	result = remap_table_build(i_mapX, i_mapY, i_sizeX, 0, 0, i_sizeX, i_sizeY, i_sourceSizeX, i_sourceSizeY, i_interpolation, &remapHandle);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+
+	if(o_remapHandle != NULL)
+	{
+		(*o_remapHandle) = remapHandle;
+	}
+	else
+	{
+		remap_destroy(&remapHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("remap_create(%p, %p, %u, %u, %u, %u, %d, %p)", (void *)i_mapX, (void *)i_mapY, i_sizeX, i_sizeY, i_sourceSizeX, i_sourceSizeY, i_interpolation, o_remapHandle);
+
+	return result;
+}
+
+Result remap_create_undistort(	RemapIntrinsics const * const i_intrinsics,
+											uint32_t const i_sizeX,
+											uint32_t const i_sizeY,
+											RemapInterpolation const i_interpolation,
+											int const i_cropValid,
+											Remap ** const o_remapHandle)
+{
+	Remap *remapHandle = NULL;
+	float *mapX = NULL;
+	float *mapY = NULL;
+	size_t beginX = 0;
+	size_t beginY = 0;
+	size_t endX = i_sizeX;
+	size_t endY = i_sizeY;
+	size_t x = 0;
+	size_t y = 0;
+	int shrunk = 1;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_intrinsics == NULL || i_intrinsics->m_focalX <= 0.0 || i_intrinsics->m_focalY <= 0.0 || i_sizeX < 2 || i_sizeY < 2 || i_sizeX >= 0xFFFF || i_sizeY >= 0xFFFF)
+	{
+		CARL_ERROR("Undistortion needs positive focal lengths and a size from 2x2 to 65534x65534.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	mapX = (float *)malloc((size_t)i_sizeX*i_sizeY*sizeof(float));
+	mapY = (float *)malloc((size_t)i_sizeX*i_sizeY*sizeof(float));
+	if(mapX == NULL || mapY == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+
+	/***** Project each ideal pixel through the distortion model *****/
+	for(y=0; y<i_sizeY; ++y)
+	{
+		for(x=0; x<i_sizeX; ++x)
+		{
+			double const idealX = ((double)x - i_intrinsics->m_centerX)/i_intrinsics->m_focalX;
+			double const idealY = ((double)y - i_intrinsics->m_centerY)/i_intrinsics->m_focalY;
+			double const radius2 = idealX*idealX + idealY*idealY;
+			double const radial = 1.0 + radius2*(i_intrinsics->m_k1 + radius2*(i_intrinsics->m_k2 + radius2*i_intrinsics->m_k3));
+			double const distortedX = idealX*radial + 2.0*i_intrinsics->m_p1*idealX*idealY + i_intrinsics->m_p2*(radius2 + 2.0*idealX*idealX);
+			double const distortedY = idealY*radial + i_intrinsics->m_p1*(radius2 + 2.0*idealY*idealY) + 2.0*i_intrinsics->m_p2*idealX*idealY;
+
+			mapX[y*i_sizeX + x] = (float)(distortedX*i_intrinsics->m_focalX + i_intrinsics->m_centerX);
+			mapY[y*i_sizeX + x] = (float)(distortedY*i_intrinsics->m_focalY + i_intrinsics->m_centerY);
+		}
+	}
+
+	result = remap_table_build(mapX, mapY, i_sizeX, 0, 0, i_sizeX, i_sizeY, i_sizeX, i_sizeY, i_interpolation, &remapHandle);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+
+	if(i_cropValid)
+	{
+		/***** Pull in every edge that still has an outside sample *****/
+		while(shrunk && beginX < endX && beginY < endY)
+		{
+			int edgeTop = 0;
+			int edgeBottom = 0;
+			int edgeLeft = 0;
+			int edgeRight = 0;
+
+			for(x=beginX; x<endX; ++x)
+			{
+				edgeTop |= !remap_valid(remapHandle, x, beginY);
+				edgeBottom |= !remap_valid(remapHandle, x, endY-1);
+			}
+			for(y=beginY; y<endY; ++y)
+			{
+				edgeLeft |= !remap_valid(remapHandle, beginX, y);
+				edgeRight |= !remap_valid(remapHandle, endX-1, y);
+			}
+			beginY += edgeTop;
+			endY -= edgeBottom;
+			beginX += edgeLeft;
+			endX -= edgeRight;
+			shrunk = edgeTop | edgeBottom | edgeLeft | edgeRight;
+		}
+
+		/***** Even start and width keep packed macropixels whole *****/
+		beginX = (beginX + 1) & ~(size_t)1;
+		endX = (endX > beginX) ? beginX + ((endX - beginX) & ~(size_t)1) : beginX;
+		if(endX <= beginX || endY <= beginY)
+		{
+			CARL_ERROR("Distortion leaves no fully valid region to crop to.");
+
+			result = R_INPUTBAD;
+			goto end;
+		}
+		remap_destroy(&remapHandle);
+		result = remap_table_build(mapX, mapY, i_sizeX, beginX, beginY, endX - beginX, endY - beginY, i_sizeX, i_sizeY, i_interpolation, &remapHandle);
+		if(result != R_SUCCESS)
+		{
+			goto end;
+		}
+	}
+
+	free(mapX);
+	free(mapY);
+
+	if(o_remapHandle != NULL)
+	{
+		(*o_remapHandle) = remapHandle;
+	}
+	else
+	{
+		remap_destroy(&remapHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("remap_create_undistort(%p, %u, %u, %d, %d, %p)", (void *)i_intrinsics, i_sizeX, i_sizeY, i_interpolation, i_cropValid, o_remapHandle);
+	remap_destroy(&remapHandle);
+	free(mapX);
+	free(mapY);
+
+	return result;
+}
+
+Result remap_destroy(Remap ** const io_remapHandle)
+{
+	Remap *remapHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_remapHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	remapHandle = (*io_remapHandle);
+	if(remapHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&remapHandle->m_region);
+	free(remapHandle);
+	(*io_remapHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result remap_luma(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							size_t const i_strideBytes,
+							uint8_t * const o_output,
+							TaskPool * const io_poolHandle,
+							Remap const * const i_remapHandle)
+{
+	return remap_run(i_frameData, i_frameSizeBytes, i_strideBytes, 1, 0, o_output, io_poolHandle, i_remapHandle);
+}
+
+Result remap_packed(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							size_t const i_strideBytes,
+							PixelFormat const i_pixelFormat,
+							uint8_t * const o_output,
+							TaskPool * const io_poolHandle,
+							Remap const * const i_remapHandle)
+{
+	if(i_pixelFormat != CAMERA_PIXELFORMAT_YUYV && i_pixelFormat != CAMERA_PIXELFORMAT_UYVY)
+	{
+		CARL_ERROR("Packed remap only reads YUYV or UYVY.");
+		return R_INPUTBAD;
+	}
+	if(i_remapHandle != NULL && (i_remapHandle->m_sizeX % 2 != 0 || i_remapHandle->m_sourceSizeX % 2 != 0))
+	{
+		CARL_ERROR("Packed remap needs even widths.");
+		return R_INPUTBAD;
+	}
+
+	return remap_run(i_frameData, i_frameSizeBytes, i_strideBytes, 2, (i_pixelFormat == CAMERA_PIXELFORMAT_UYVY) ? 1 : 0, o_output, io_poolHandle, i_remapHandle);
+}
+
+Result remap_size(	Remap const * const i_remapHandle,
+							uint32_t * const o_sizeX,
+							uint32_t * const o_sizeY,
+							uint32_t * const o_offsetX,
+							uint32_t * const o_offsetY)
+{
+	if(i_remapHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_sizeX != NULL)
+	{
+		(*o_sizeX) = (uint32_t)i_remapHandle->m_sizeX;
+	}
+	if(o_sizeY != NULL)
+	{
+		(*o_sizeY) = (uint32_t)i_remapHandle->m_sizeY;
+	}
+	if(o_offsetX != NULL)
+	{
+		(*o_offsetX) = (uint32_t)i_remapHandle->m_offsetX;
+	}
+	if(o_offsetY != NULL)
+	{
+		(*o_offsetY) = (uint32_t)i_remapHandle->m_offsetY;
+	}
+
+	return R_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#ifndef _REMAP_H_
+#define _REMAP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Camera.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REMAP_TILE_X 64
+#define REMAP_TILE_Y 16
+
+/********************----- ENUM: RemapInterpolation -----********************/
+enum RemapInterpolation_e
+{
+	REMAP_INTERPOLATION_NEAREST,
+	REMAP_INTERPOLATION_BILINEAR
+};
+typedef enum RemapInterpolation_e RemapInterpolation;
+/**************************************************/
+
+/********************----- STRUCT: RemapIntrinsics -----********************/
+/* Pinhole camera with Brown-Conrady distortion, in the usual k1 k2 p1 p2 k3 order */
+struct RemapIntrinsics_s
+{
+	double m_focalX;
+	double m_focalY;
+	double m_centerX;
+	double m_centerY;
+	double m_k1;
+	double m_k2;
+	double m_p1;
+	double m_p2;
+	double m_k3;
+};
+typedef struct RemapIntrinsics_s RemapIntrinsics;
+/**************************************************/
+
+/********************----- STRUCT: Remap -----********************/
+struct Remap_s;
+typedef struct Remap_s Remap;
+/**************************************************/
+
+/* Source coordinates per output pixel; outside samples read as black */
+Result remap_create(	float const * const i_mapX,
+							float const * const i_mapY,
+							uint32_t const i_sizeX,
+							uint32_t const i_sizeY,
+							uint32_t const i_sourceSizeX,
+							uint32_t const i_sourceSizeY,
+							RemapInterpolation const i_interpolation,
+							Remap ** const o_remapHandle);
+/* Undistorts with the same camera matrix; cropping shrinks the output to the rectangle with no outside samples */
+Result remap_create_undistort(	RemapIntrinsics const * const i_intrinsics,
+											uint32_t const i_sizeX,
+											uint32_t const i_sizeY,
+											RemapInterpolation const i_interpolation,
+											int const i_cropValid,
+											Remap ** const o_remapHandle);
+Result remap_destroy(Remap ** const io_remapHandle);
+/* 8-bit single plane in, 8-bit single plane out; a source stride of 0 means rows are packed, the output always is */
+Result remap_luma(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							size_t const i_strideBytes,
+							uint8_t * const o_output,
+							TaskPool * const io_poolHandle,
+							Remap const * const i_remapHandle);
+/* Packed YUYV or UYVY in and out, strided as remap_luma; chroma takes the source macropixel nearest the sample point */
+Result remap_packed(	uint8_t const * const i_frameData,
+							size_t const i_frameSizeBytes,
+							size_t const i_strideBytes,
+							PixelFormat const i_pixelFormat,
+							uint8_t * const o_output,
+							TaskPool * const io_poolHandle,
+							Remap const * const i_remapHandle);
+/* Output size, plus where the output starts in the uncropped image */
+Result remap_size(	Remap const * const i_remapHandle,
+							uint32_t * const o_sizeX,
+							uint32_t * const o_sizeY,
+							uint32_t * const o_offsetX,
+							uint32_t * const o_offsetY);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _REMAP_H_ */
@@ -0,0 +1,530 @@
+#include "Segmenter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/********************----- STRUCT: Segmenter -----********************/
+/* Class bounds are packed per 4-byte macropixel in the frame's own byte order */
+struct Segmenter_s
+{
+	PixelFormat m_pixelFormat;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_strideBytes;
+	size_t m_classCount;
+	SegmenterClass m_classes[SEGMENTER_CLASS_COUNT_MAX];
+	uint32_t m_classMin[SEGMENTER_CLASS_COUNT_MAX];
+	uint32_t m_classMax[SEGMENTER_CLASS_COUNT_MAX];
+	MemoryRegion m_lutRegion;
+	uint8_t const *m_lut;
+};
+/**************************************************/
+
+/********************----- STRUCT: SegmenterJob -----********************/
+struct SegmenterJob_s
+{
+	Segmenter const *m_segmenter;
+	uint8_t const *m_frameData;
+	uint8_t *m_mask;
+	SegmenterRuns *m_runs;
+	int m_full;
+};
+typedef struct SegmenterJob_s SegmenterJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static uint32_t segmenter_macropixel_pack(PixelFormat const i_pixelFormat, uint8_t const i_y, uint8_t const i_u, uint8_t const i_v)
+{
+	if(i_pixelFormat == CAMERA_PIXELFORMAT_UYVY)
+	{
+		return (uint32_t)i_u | ((uint32_t)i_y << 8) | ((uint32_t)i_v << 16) | ((uint32_t)i_y << 24);
+	}
+
+	return (uint32_t)i_y | ((uint32_t)i_u << 8) | ((uint32_t)i_y << 16) | ((uint32_t)i_v << 24);
+}
+
+/* Pixels from i_pixelBegin on; i_pixelBegin is even */
+static void segmenter_row_classify_scalar(	Segmenter const * const i_segmenterHandle,
+															uint8_t const * const i_rowData,
+															size_t const i_pixelBegin,
+															uint8_t * const o_mask)
+{
+	int const uyvy = (i_segmenterHandle->m_pixelFormat == CAMERA_PIXELFORMAT_UYVY);
+	size_t pixel = 0;
+	size_t classIndex = 0;
+
+	for(pixel=i_pixelBegin; pixel<i_segmenterHandle->m_sizeX; pixel+=2)
+	{
+		uint8_t const * const macropixel = i_rowData + pixel*2;
+		uint8_t const y0 = uyvy ? macropixel[1] : macropixel[0];
+		uint8_t const y1 = uyvy ? macropixel[3] : macropixel[2];
+		uint8_t const u = uyvy ? macropixel[0] : macropixel[1];
+		uint8_t const v = uyvy ? macropixel[2] : macropixel[3];
+		uint8_t mask0 = 0;
+		uint8_t mask1 = 0;
+
+		for(classIndex=0; classIndex<i_segmenterHandle->m_classCount; ++classIndex)
+		{
+			SegmenterClass const * const colorClass = &i_segmenterHandle->m_classes[classIndex];
+
+			if(u >= colorClass->m_uMin && u <= colorClass->m_uMax && v >= colorClass->m_vMin && v <= colorClass->m_vMax)
+			{
+				mask0 |= (uint8_t)((y0 >= colorClass->m_yMin && y0 <= colorClass->m_yMax) << classIndex);
+				mask1 |= (uint8_t)((y1 >= colorClass->m_yMin && y1 <= colorClass->m_yMax) << classIndex);
+			}
+		}
+		o_mask[pixel] = mask0;
+		o_mask[pixel+1] = mask1;
+	}
+}
+
+static void segmenter_row_classify(Segmenter const * const i_segmenterHandle, uint8_t const * const i_rowData, uint8_t * const o_mask)
+{
+	size_t pixel = 0;
+
+#ifdef __SSE2__
+	/***** 16 pixels per step: test all bytes against the class box, then AND each Y with its shared U and V *****/
+	{
+		int const uyvy = (i_segmenterHandle->m_pixelFormat == CAMERA_PIXELFORMAT_UYVY);
+		__m128i const chromaMask = _mm_set1_epi32(uyvy ? 0x00FF00FF : (int)0xFF00FF00);
+		__m128i const lumaMask = _mm_set1_epi32(uyvy ? (int)0xFF00FF00 : 0x00FF00FF);
+		__m128i const zero = _mm_setzero_si128();
+		__m128i classMin[SEGMENTER_CLASS_COUNT_MAX];
+		__m128i classMax[SEGMENTER_CLASS_COUNT_MAX];
+		__m128i classBit[SEGMENTER_CLASS_COUNT_MAX];
+		size_t classIndex = 0;
+
+		for(classIndex=0; classIndex<i_segmenterHandle->m_classCount; ++classIndex)
+		{
+			classMin[classIndex] = _mm_set1_epi32((int)i_segmenterHandle->m_classMin[classIndex]);
+			classMax[classIndex] = _mm_set1_epi32((int)i_segmenterHandle->m_classMax[classIndex]);
+			classBit[classIndex] = _mm_set1_epi8((char)(1 << classIndex));
+		}
+
+		for(pixel=0; pixel+16<=i_segmenterHandle->m_sizeX; pixel+=16)
+		{
+			__m128i const data0 = _mm_loadu_si128((__m128i const *)(i_rowData + pixel*2));
+			__m128i const data1 = _mm_loadu_si128((__m128i const *)(i_rowData + pixel*2 + 16));
+			__m128i mask0 = zero;
+			__m128i mask1 = zero;
+
+			for(classIndex=0; classIndex<i_segmenterHandle->m_classCount; ++classIndex)
+			{
+				__m128i const inside0 = _mm_cmpeq_epi8(_mm_or_si128(_mm_subs_epu8(classMin[classIndex], data0), _mm_subs_epu8(data0, classMax[classIndex])), zero);
+				__m128i const inside1 = _mm_cmpeq_epi8(_mm_or_si128(_mm_subs_epu8(classMin[classIndex], data1), _mm_subs_epu8(data1, classMax[classIndex])), zero);
+				__m128i const chroma0 = _mm_cmpeq_epi32(_mm_and_si128(inside0, chromaMask), chromaMask);
+				__m128i const chroma1 = _mm_cmpeq_epi32(_mm_and_si128(inside1, chromaMask), chromaMask);
+
+				mask0 = _mm_or_si128(mask0, _mm_and_si128(_mm_and_si128(inside0, chroma0), classBit[classIndex]));
+				mask1 = _mm_or_si128(mask1, _mm_and_si128(_mm_and_si128(inside1, chroma1), classBit[classIndex]));
+			}
+
+			/***** Keep the luma bytes and pack them to one byte per pixel *****/
+			mask0 = _mm_and_si128(mask0, lumaMask);
+			mask1 = _mm_and_si128(mask1, lumaMask);
+			if(uyvy)
+			{
+				mask0 = _mm_srli_epi16(mask0, 8);
+				mask1 = _mm_srli_epi16(mask1, 8);
+			}
+			_mm_storeu_si128((__m128i *)(o_mask + pixel), _mm_packus_epi16(mask0, mask1));
+		}
+	}
+#endif
+
+	segmenter_row_classify_scalar(i_segmenterHandle, i_rowData, pixel, o_mask);
+
+	/***** The lookup table adds arbitrary color shapes on top of the boxes *****/
+	if(i_segmenterHandle->m_lut != NULL)
+	{
+		int const uyvy = (i_segmenterHandle->m_pixelFormat == CAMERA_PIXELFORMAT_UYVY);
+
+		for(pixel=0; pixel<i_segmenterHandle->m_sizeX; pixel+=2)
+		{
+			uint8_t const * const macropixel = i_rowData + pixel*2;
+			uint8_t const u = uyvy ? macropixel[0] : macropixel[1];
+			uint8_t const v = uyvy ? macropixel[2] : macropixel[3];
+
+			o_mask[pixel] |= i_segmenterHandle->m_lut[SEGMENTER_LUT_INDEX(uyvy ? macropixel[1] : macropixel[0], u, v)];
+			o_mask[pixel+1] |= i_segmenterHandle->m_lut[SEGMENTER_LUT_INDEX(uyvy ? macropixel[3] : macropixel[2], u, v)];
+		}
+	}
+}
+
+static void segmenter_mask_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	SegmenterJob const * const job = (SegmenterJob const *)i_taskData;
+	Segmenter const * const segmenterHandle = job->m_segmenter;
+	size_t row = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		segmenter_row_classify(segmenterHandle, job->m_frameData + row*segmenterHandle->m_strideBytes, job->m_mask + row*segmenterHandle->m_sizeX);
+	}
+}
+
+/* Each band fills its own slice of the run buffer, sized by its share of the rows */
+static void segmenter_runs_band(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	SegmenterJob * const job = (SegmenterJob *)i_taskData;
+	Segmenter const * const segmenterHandle = job->m_segmenter;
+	SegmenterRuns * const runs = job->m_runs;
+	size_t const sizeX = segmenterHandle->m_sizeX;
+	size_t const runBegin = runs->m_runCountMax*i_rowBegin/segmenterHandle->m_sizeY;
+	size_t const runEnd = runs->m_runCountMax*i_rowEnd/segmenterHandle->m_sizeY;
+	uint8_t rowMask[SEGMENTER_SIZE_X_MAX + 8];
+	size_t runIndex = runBegin;
+	size_t row = 0;
+	size_t x = 0;
+	size_t xEnd = 0;
+	uint64_t word = 0;
+	int full = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		runs->m_rowStart[row] = (uint32_t)runIndex;
+		if(full)
+		{
+			continue;
+		}
+		segmenter_row_classify(segmenterHandle, job->m_frameData + row*segmenterHandle->m_strideBytes, rowMask);
+		memset(rowMask + sizeX, 0, 8);
+
+		/***** Skip background eight pixels at a time *****/
+		x = 0;
+		while(x < sizeX)
+		{
+			memcpy(&word, rowMask + x, sizeof(word));
+			if(word == 0)
+			{
+				x += 8;
+				continue;
+			}
+			if(rowMask[x] == 0)
+			{
+				++x;
+				continue;
+			}
+
+			if(runIndex == runEnd)
+			{
+				full = 1;
+				break;
+			}
+			for(xEnd=x+1; xEnd<sizeX && rowMask[xEnd] == rowMask[x]; ++xEnd)
+			{
+			}
+			runs->m_runs[runIndex].m_x = (uint16_t)x;
+			runs->m_runs[runIndex].m_y = (uint16_t)row;
+			runs->m_runs[runIndex].m_length = (uint16_t)(xEnd - x);
+			runs->m_runs[runIndex].m_mask = rowMask[x];
+			runs->m_runs[runIndex].m_reserved = 0;
+			++runIndex;
+			x = xEnd;
+		}
+	}
+
+	runs->m_bandCount[i_rowBegin/SEGMENTER_BAND_ROWS] = (uint32_t)(runIndex - runBegin);
+	if(full)
+	{
+		__atomic_store_n(&job->m_full, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static Result segmenter_frame_check(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, Segmenter const * const i_segmenterHandle)
+{
+	if(i_segmenterHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_frameData == NULL || i_frameSizeBytes < i_segmenterHandle->m_strideBytes*(i_segmenterHandle->m_sizeY-1) + i_segmenterHandle->m_sizeX*2)
+	{
+		CARL_ERROR("Frame of %zu bytes is smaller than %zux%zu.", i_frameSizeBytes, i_segmenterHandle->m_sizeX, i_segmenterHandle->m_sizeY);
+		return R_INPUTBAD;
+	}
+
+	return R_SUCCESS;
+}
+/**************************************************/
+
+Result segmenter_create(	PixelFormat const i_pixelFormat,
+									uint32_t const i_sizeX,
+									uint32_t const i_sizeY,
+									size_t const i_strideBytes,
+									Segmenter ** const o_segmenterHandle)
+{
+	Segmenter *segmenterHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_pixelFormat != CAMERA_PIXELFORMAT_YUYV && i_pixelFormat != CAMERA_PIXELFORMAT_UYVY)
+	{
+		CARL_ERROR("Segmenter only reads packed YUYV or UYVY frames.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+	if(i_sizeX == 0 || i_sizeX % 2 != 0 || i_sizeX > SEGMENTER_SIZE_X_MAX || i_sizeY == 0 || i_sizeY > SEGMENTER_SIZE_Y_MAX)
+	{
+		CARL_ERROR("Segmenter needs an even width up to %d and a height up to %d.", SEGMENTER_SIZE_X_MAX, SEGMENTER_SIZE_Y_MAX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+	if(i_strideBytes != 0 && i_strideBytes < (size_t)i_sizeX*2)
+	{
+		CARL_ERROR("Stride of %zu bytes is shorter than a %u pixel row.", i_strideBytes, i_sizeX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create segmenter structure *****/
+	segmenterHandle = (Segmenter *)calloc(1, sizeof(Segmenter));
+	if(segmenterHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	segmenterHandle->m_pixelFormat = i_pixelFormat;
+	segmenterHandle->m_sizeX = i_sizeX;
+	segmenterHandle->m_sizeY = i_sizeY;
+	segmenterHandle->m_strideBytes = (i_strideBytes != 0) ? i_strideBytes : (size_t)i_sizeX*2;
+
+	if(o_segmenterHandle != NULL)
+	{
+		(*o_segmenterHandle) = segmenterHandle;
+	}
+	else
+	{
+		segmenter_destroy(&segmenterHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("segmenter_create(%d, %u, %u, %zu, %p)", i_pixelFormat, i_sizeX, i_sizeY, i_strideBytes, (void *)o_segmenterHandle);
+	segmenter_destroy(&segmenterHandle);
+
+	return result;
+}
+
+Result segmenter_destroy(Segmenter ** const io_segmenterHandle)
+{
+	Segmenter *segmenterHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_segmenterHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	segmenterHandle = (*io_segmenterHandle);
+	if(segmenterHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	memory_region_unmap(&segmenterHandle->m_lutRegion);
+	free(segmenterHandle);
+	(*io_segmenterHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result segmenter_class_add(	SegmenterClass const * const i_class,
+										size_t * const o_class,
+										Segmenter * const io_segmenterHandle)
+{
+	size_t classIndex = 0;
+
+	if(io_segmenterHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_class == NULL || i_class->m_yMin > i_class->m_yMax || i_class->m_uMin > i_class->m_uMax || i_class->m_vMin > i_class->m_vMax)
+	{
+		CARL_ERROR("Color class needs min <= max on every channel.");
+		return R_INPUTBAD;
+	}
+	if(io_segmenterHandle->m_classCount >= SEGMENTER_CLASS_COUNT_MAX)
+	{
+		CARL_ERROR("Segmenter already has %d classes.", SEGMENTER_CLASS_COUNT_MAX);
+		return R_BUFFERFULL;
+	}
+
+	classIndex = io_segmenterHandle->m_classCount++;
+	io_segmenterHandle->m_classes[classIndex] = (*i_class);
+	io_segmenterHandle->m_classMin[classIndex] = segmenter_macropixel_pack(io_segmenterHandle->m_pixelFormat, i_class->m_yMin, i_class->m_uMin, i_class->m_vMin);
+	io_segmenterHandle->m_classMax[classIndex] = segmenter_macropixel_pack(io_segmenterHandle->m_pixelFormat, i_class->m_yMax, i_class->m_uMax, i_class->m_vMax);
+	if(o_class != NULL)
+	{
+		(*o_class) = classIndex;
+	}
+
+	return R_SUCCESS;
+}
+
+Result segmenter_lut_set(uint8_t const * const i_lut, Segmenter * const io_segmenterHandle)
+{
+	Result result = R_FAILURE;
+
+	if(io_segmenterHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_lut == NULL)
+	{
+		io_segmenterHandle->m_lut = NULL;
+		return memory_region_unmap(&io_segmenterHandle->m_lutRegion);
+	}
+
+	if(io_segmenterHandle->m_lutRegion.m_memory == NULL)
+	{
+		result = memory_region_map(SEGMENTER_LUT_SIZE, MEMORY_FLAG_PREFAULT, &io_segmenterHandle->m_lutRegion);
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+	}
+	memcpy(io_segmenterHandle->m_lutRegion.m_memory, i_lut, SEGMENTER_LUT_SIZE);
+	io_segmenterHandle->m_lut = (uint8_t const *)io_segmenterHandle->m_lutRegion.m_memory;
+
+	return R_SUCCESS;
+}
+
+Result segmenter_mask(	uint8_t const * const i_frameData,
+								size_t const i_frameSizeBytes,
+								uint8_t * const o_mask,
+								TaskPool * const io_poolHandle,
+								Segmenter const * const i_segmenterHandle)
+{
+	SegmenterJob job;
+	Result result = segmenter_frame_check(i_frameData, i_frameSizeBytes, i_segmenterHandle);
+
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	if(o_mask == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	CLEAR(job);
+	job.m_segmenter = i_segmenterHandle;
+	job.m_frameData = i_frameData;
+	job.m_mask = o_mask;
+
+	return task_pool_parallel_for(i_segmenterHandle->m_sizeY, SEGMENTER_BAND_ROWS, segmenter_mask_band, &job, io_poolHandle);
+}
+
+Result segmenter_runs(	uint8_t const * const i_frameData,
+								size_t const i_frameSizeBytes,
+								SegmenterRuns * const io_runs,
+								TaskPool * const io_poolHandle,
+								Segmenter const * const i_segmenterHandle)
+{
+	SegmenterJob job;
+	size_t const sizeY = (i_segmenterHandle != NULL) ? i_segmenterHandle->m_sizeY : 0;
+	size_t bandIndex = 0;
+	size_t runDestination = 0;
+	size_t runSource = 0;
+	size_t row = 0;
+	Result result = segmenter_frame_check(i_frameData, i_frameSizeBytes, i_segmenterHandle);
+
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	if(io_runs == NULL || io_runs->m_runs == NULL || io_runs->m_sizeY != sizeY)
+	{
+		CARL_ERROR("Run buffer is missing or not mapped for %zu rows.", sizeY);
+		return R_INPUTBAD;
+	}
+
+	CLEAR(job);
+	job.m_segmenter = i_segmenterHandle;
+	job.m_frameData = i_frameData;
+	job.m_runs = io_runs;
+	result = task_pool_parallel_for(sizeY, SEGMENTER_BAND_ROWS, segmenter_runs_band, &job, io_poolHandle);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+
+	/***** Close the gaps between band slices *****/
+	for(bandIndex=0; bandIndex*SEGMENTER_BAND_ROWS<sizeY; ++bandIndex)
+	{
+		size_t const rowBegin = bandIndex*SEGMENTER_BAND_ROWS;
+		size_t const rowEnd = MIN(rowBegin + SEGMENTER_BAND_ROWS, sizeY);
+
+		runSource = io_runs->m_runCountMax*rowBegin/sizeY;
+		if(runSource != runDestination)
+		{
+			memmove(io_runs->m_runs + runDestination, io_runs->m_runs + runSource, io_runs->m_bandCount[bandIndex]*sizeof(SegmenterRun));
+			for(row=rowBegin; row<rowEnd; ++row)
+			{
+				io_runs->m_rowStart[row] -= (uint32_t)(runSource - runDestination);
+			}
+		}
+		runDestination += io_runs->m_bandCount[bandIndex];
+	}
+	io_runs->m_rowStart[sizeY] = (uint32_t)runDestination;
+	io_runs->m_runCount = runDestination;
+
+	return job.m_full ? R_BUFFERFULL : R_SUCCESS;
+}
+
+Result segmenter_runs_map(	size_t const i_runCountMax,
+									uint32_t const i_sizeY,
+									SegmenterRuns * const o_runs)
+{
+	size_t const bandCount = ((size_t)i_sizeY + SEGMENTER_BAND_ROWS - 1)/SEGMENTER_BAND_ROWS;
+	size_t const runsSizeBytes = i_runCountMax*sizeof(SegmenterRun);
+	size_t const rowStartSizeBytes = ((size_t)i_sizeY + 1)*sizeof(uint32_t);
+	Result result = R_FAILURE;
+
+	if(o_runs == NULL || i_runCountMax == 0 || i_runCountMax > UINT32_MAX || i_sizeY == 0 || i_sizeY > SEGMENTER_SIZE_Y_MAX)
+	{
+		CARL_ERROR("Run buffer needs an output, 1 to %u runs and 1 to %d rows.", UINT32_MAX, SEGMENTER_SIZE_Y_MAX);
+		return R_INPUTBAD;
+	}
+
+	/***** Runs, row starts and band counts in one mapping *****/
+	CLEAR(*o_runs);
+	result = memory_region_map(runsSizeBytes + rowStartSizeBytes + bandCount*sizeof(uint32_t), MEMORY_FLAG_PREFAULT, &o_runs->m_region);
+	if(result != R_SUCCESS)
+	{
+		return result;
+	}
+	o_runs->m_runs = (SegmenterRun *)o_runs->m_region.m_memory;
+	o_runs->m_rowStart = (uint32_t *)((uint8_t *)o_runs->m_region.m_memory + runsSizeBytes);
+	o_runs->m_bandCount = o_runs->m_rowStart + i_sizeY + 1;
+	o_runs->m_runCountMax = i_runCountMax;
+	o_runs->m_sizeY = i_sizeY;
+
+	return R_SUCCESS;
+}
+
+Result segmenter_runs_unmap(SegmenterRuns * const io_runs)
+{
+	Result result = R_SUCCESS;
+
+	if(io_runs == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	result = memory_region_unmap(&io_runs->m_region);
+	CLEAR(*io_runs);
+
+	return result;
+}
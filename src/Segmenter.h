@@ -0,0 +1,108 @@
+#ifndef _SEGMENTER_H_
+#define _SEGMENTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Camera.h"
+#include "Memory.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SEGMENTER_CLASS_COUNT_MAX 8
+#define SEGMENTER_SIZE_X_MAX 4096
+#define SEGMENTER_SIZE_Y_MAX 4096
+#define SEGMENTER_BAND_ROWS 16
+
+/* Color lookup table over Y, U and V quantized to 6 bits each; each entry is a class bitmask */
+#define SEGMENTER_LUT_SHIFT 2
+#define SEGMENTER_LUT_SIZE ((size_t)1 << (3*(8-SEGMENTER_LUT_SHIFT)))
+#define SEGMENTER_LUT_INDEX(y, u, v) ((((size_t)(y) >> SEGMENTER_LUT_SHIFT) << (2*(8-SEGMENTER_LUT_SHIFT))) | \
+												(((size_t)(u) >> SEGMENTER_LUT_SHIFT) << (8-SEGMENTER_LUT_SHIFT)) | \
+												((size_t)(v) >> SEGMENTER_LUT_SHIFT))
+
+/********************----- STRUCT: Segmenter -----********************/
+struct Segmenter_s;
+typedef struct Segmenter_s Segmenter;
+/**************************************************/
+
+/********************----- STRUCT: SegmenterClass -----********************/
+/* Inclusive YUV box; pixel class n sets bit (1 << n) in the mask */
+struct SegmenterClass_s
+{
+	uint8_t m_yMin;
+	uint8_t m_yMax;
+	uint8_t m_uMin;
+	uint8_t m_uMax;
+	uint8_t m_vMin;
+	uint8_t m_vMax;
+};
+typedef struct SegmenterClass_s SegmenterClass;
+/**************************************************/
+
+/********************----- STRUCT: SegmenterRun -----********************/
+/* Horizontal span of pixels with the same non-0 class mask */
+struct SegmenterRun_s
+{
+	uint16_t m_x;
+	uint16_t m_y;
+	uint16_t m_length;
+	uint8_t m_mask;
+	uint8_t m_reserved;
+};
+typedef struct SegmenterRun_s SegmenterRun;
+/**************************************************/
+
+/********************----- STRUCT: SegmenterRuns -----********************/
+/* Caller-owned run buffer; row y holds runs m_rowStart[y] up to m_rowStart[y+1] */
+struct SegmenterRuns_s
+{
+	MemoryRegion m_region;
+	SegmenterRun *m_runs;
+	uint32_t *m_rowStart;
+	uint32_t *m_bandCount;
+	size_t m_runCount;
+	size_t m_runCountMax;
+	size_t m_sizeY;
+};
+typedef struct SegmenterRuns_s SegmenterRuns;
+/**************************************************/
+
+/* Works directly on packed YUYV or UYVY frames, e.g. inside a CameraCallback with the stride from camera_layout() (0 means unpadded); a NULL pool runs on the calling thread */
+Result segmenter_create(	PixelFormat const i_pixelFormat,
+									uint32_t const i_sizeX,
+									uint32_t const i_sizeY,
+									size_t const i_strideBytes,
+									Segmenter ** const o_segmenterHandle);
+Result segmenter_destroy(Segmenter ** const io_segmenterHandle);
+Result segmenter_class_add(	SegmenterClass const * const i_class,
+										size_t * const o_class,
+										Segmenter * const io_segmenterHandle);
+/* Copies SEGMENTER_LUT_SIZE class masks, ORed with the box classes; NULL removes the table */
+Result segmenter_lut_set(uint8_t const * const i_lut, Segmenter * const io_segmenterHandle);
+/* One class mask byte per pixel */
+Result segmenter_mask(	uint8_t const * const i_frameData,
+								size_t const i_frameSizeBytes,
+								uint8_t * const o_mask,
+								TaskPool * const io_poolHandle,
+								Segmenter const * const i_segmenterHandle);
+/* Returns R_BUFFERFULL when a band ran out of room; the runs that fit are still valid */
+Result segmenter_runs(	uint8_t const * const i_frameData,
+								size_t const i_frameSizeBytes,
+								SegmenterRuns * const io_runs,
+								TaskPool * const io_poolHandle,
+								Segmenter const * const i_segmenterHandle);
+Result segmenter_runs_map(	size_t const i_runCountMax,
+									uint32_t const i_sizeY,
+									SegmenterRuns * const o_runs);
+Result segmenter_runs_unmap(SegmenterRuns * const io_runs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _SEGMENTER_H_ */
@@ -1,4 +1,5 @@
 #include "Serial.h"
+#include "Trace.h"
 
 #include <fcntl.h>
 #include <termios.h>
@@ -8,10 +9,35 @@
 #include <stdio.h>
 #include <linux/limits.h>
 
+/********************----- ENUM: SerialMetric -----********************/
+enum SerialMetric_e
+{
+	SERIAL_METRIC_BYTES_READ,
+	SERIAL_METRIC_BYTES_WRITTEN,
+	SERIAL_METRIC_READS,
+	SERIAL_METRIC_WRITES,
+	SERIAL_METRIC_READ_NS,
+	SERIAL_METRIC_WRITE_NS,
+	SERIAL_METRIC_READ_ERRORS,
+	SERIAL_METRIC_WRITE_ERRORS,
+	SERIAL_METRIC_COUNT
+};
+static char const * const SERIAL_METRIC_NAMES[SERIAL_METRIC_COUNT] = {"bytes_read", "bytes_written", "reads", "writes", "read_ns", "write_ns", "read_errors", "write_errors"};
+/**************************************************/
+
 /********************----- STRUCT: Serial -----********************/
 struct Serial_t
 {
 	int m_deviceHandle;
+	Timestamp m_timestampRead;
+	Timestamp m_timestampWrite;
+	Histogram *m_roundTripHistogram;
+	int m_roundTripPending;
+	Recorder *m_recorder;
+	uint16_t m_recorderSource;
+	uint64_t *m_metrics;
+	uint64_t m_metricsLocal[SERIAL_METRIC_COUNT];
+	MetricsPage *m_metricsPage;
 };
 /**************************************************/
 
@@ -19,15 +45,36 @@ Result serial_create(int const i_deviceID,
 							BaudRate const i_baudRate,
 							SerialMode const i_serialMode,
 							Serial ** const o_serialHandle)
+{
+	char serialPathname[PATH_MAX];
+
+	/***** Setup serial pathname *****/
+	snprintf(serialPathname, sizeof(serialPathname), "/dev/ttyUSB%d", i_deviceID);
+
+	return serial_create_path(serialPathname, i_baudRate, i_serialMode, o_serialHandle);
+}
+
+Result serial_create_path(	char const * const i_pathname,
+									BaudRate const i_baudRate,
+									SerialMode const i_serialMode,
+									Serial ** const o_serialHandle)
 {
 	int cfResult = 0;
 	int deviceBaudRate = 0;
    Result result = R_FAILURE;
 	struct termios serialAttributes;
 	Serial *serialHandle = NULL;
-	char serialPathname[PATH_MAX];
 	int tcResult = 0;
 
+	/***** Input Validation *****/
+	if(i_pathname == NULL)
+	{
+		CARL_ERROR("No serial device path given.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
 	/***** Get baud rate *****/
    switch(i_baudRate)
    {
@@ -76,12 +123,18 @@ Result serial_create(int const i_deviceID,
 		goto end;
 	}
 	serialHandle->m_deviceHandle = -1;
-
-	/***** Setup serial pathname *****/
-	snprintf(serialPathname, sizeof(serialPathname), "/dev/ttyUSB%d", i_deviceID);
+	serialHandle->m_timestampRead = 0;
+	serialHandle->m_timestampWrite = 0;
+	serialHandle->m_roundTripHistogram = NULL;
+	serialHandle->m_roundTripPending = 0;
+	serialHandle->m_recorder = NULL;
+	serialHandle->m_recorderSource = 0;
+	memset(serialHandle->m_metricsLocal, 0, sizeof(serialHandle->m_metricsLocal));
+	serialHandle->m_metrics = serialHandle->m_metricsLocal;
+	serialHandle->m_metricsPage = NULL;
 
 	/***** Open serial port *****/
-	serialHandle->m_deviceHandle = open(serialPathname, O_RDWR | O_NOCTTY | O_NDELAY);
+	serialHandle->m_deviceHandle = open(i_pathname, O_RDWR | O_NOCTTY | O_NDELAY);
 	if(serialHandle->m_deviceHandle < 0)
 	{
 		CARL_ERRORNO("Unable to open serial device.");
@@ -171,7 +224,7 @@ Result serial_create(int const i_deviceID,
 	return R_SUCCESS;
 
 end:
-	CARL_ERROR("serial_create(%d, %d, %p)", i_deviceID, i_baudRate, o_serialHandle);
+	CARL_ERROR("serial_create_path(%s, %d, %p)", (i_pathname != NULL) ? i_pathname : "(null)", i_baudRate, o_serialHandle);
 	serial_destroy(&serialHandle);
 
    return result;
@@ -180,12 +233,14 @@ end:
 Result serial_read(  size_t const i_bytesToRead,
                      uint8_t * const o_outputBuffer,
                      size_t * const o_bytesRead,
-                     Serial const * const i_serialHandle)
+                     Serial * const io_serialHandle)
 {
 	Result result = R_FAILURE;
+	uint64_t * metrics = NULL;
+	Timestamp timeStart = 0;
 	ssize_t readResult = 0;
 
-	if(i_serialHandle == NULL)
+	if(io_serialHandle == NULL)
 	{
 		CARL_ERROR("Handle not created.");
 
@@ -193,14 +248,35 @@ Result serial_read(  size_t const i_bytesToRead,
 		goto end;
 	}
 
-	readResult = read(i_serialHandle->m_deviceHandle, o_outputBuffer, i_bytesToRead);
+	metrics = __atomic_load_n(&io_serialHandle->m_metrics, __ATOMIC_ACQUIRE);
+	timeStart = timestamp_now();
+	CARL_TRACE_BEGIN("serial.read");
+	readResult = read(io_serialHandle->m_deviceHandle, o_outputBuffer, i_bytesToRead);
+	CARL_TRACE_END("serial.read");
 	if(readResult < 0)
 	{
+		metrics_add(&metrics[SERIAL_METRIC_READ_ERRORS], 1);
+		recorder_append(RECORDER_EVENT_ERROR, io_serialHandle->m_recorderSource, (uint32_t)R_DEVICEREADFAILED, (uint64_t)errno, io_serialHandle->m_recorder);
 		CARL_ERRORNO("IO Error");
 
 		result = R_DEVICEREADFAILED;
 		goto end;
 	}
+	io_serialHandle->m_timestampRead = timestamp_now();
+	metrics_add(&metrics[SERIAL_METRIC_READS], 1);
+	metrics_add(&metrics[SERIAL_METRIC_READ_NS], io_serialHandle->m_timestampRead - timeStart);
+	metrics_add(&metrics[SERIAL_METRIC_BYTES_READ], (uint64_t)readResult);
+	if(readResult > 0)
+	{
+		recorder_append(RECORDER_EVENT_BYTES_READ, io_serialHandle->m_recorderSource, (uint32_t)readResult, 0, io_serialHandle->m_recorder);
+	}
+
+	/***** First reply after a write closes the round trip *****/
+	if(readResult > 0 && io_serialHandle->m_roundTripPending)
+	{
+		histogram_record(io_serialHandle->m_timestampRead - io_serialHandle->m_timestampWrite, io_serialHandle->m_roundTripHistogram);
+		io_serialHandle->m_roundTripPending = 0;
+	}
 
 	if(o_bytesRead != NULL)
 	{
@@ -210,19 +286,21 @@ Result serial_read(  size_t const i_bytesToRead,
 	return R_SUCCESS;
 
 end:
-	CARL_ERROR("serial_read(%zu, %p, %p, %p)", i_bytesToRead, o_outputBuffer, o_bytesRead, i_serialHandle);
+	CARL_ERROR("serial_read(%zu, %p, %p, %p)", i_bytesToRead, o_outputBuffer, o_bytesRead, io_serialHandle);
 	return result;
 }
 
 Result serial_write( size_t const i_bytesToWrite,
                      uint8_t const * const i_data,
                      size_t * const o_bytesWritten,
-                     Serial const * const i_serialHandle)
+                     Serial * const io_serialHandle)
 {
 	Result result = R_FAILURE;
+	uint64_t * metrics = NULL;
+	Timestamp timeStart = 0;
 	ssize_t writeResult = 0;
 
-	if(i_serialHandle == NULL)
+	if(io_serialHandle == NULL)
 	{
 		CARL_ERROR("Handle not created.");
 
@@ -230,14 +308,29 @@ Result serial_write( size_t const i_bytesToWrite,
 		goto end;
 	}
 
-	writeResult = write(i_serialHandle->m_deviceHandle, i_data, i_bytesToWrite);
+	metrics = __atomic_load_n(&io_serialHandle->m_metrics, __ATOMIC_ACQUIRE);
+	timeStart = timestamp_now();
+	CARL_TRACE_BEGIN("serial.write");
+	writeResult = write(io_serialHandle->m_deviceHandle, i_data, i_bytesToWrite);
+	CARL_TRACE_END("serial.write");
 	if(writeResult < 0)
 	{
+		metrics_add(&metrics[SERIAL_METRIC_WRITE_ERRORS], 1);
+		recorder_append(RECORDER_EVENT_ERROR, io_serialHandle->m_recorderSource, (uint32_t)R_DEVICEWRITEFAILED, (uint64_t)errno, io_serialHandle->m_recorder);
 		CARL_ERRORNO("IO Error.");
 
 		result = R_DEVICEWRITEFAILED;
 		goto end;
 	}
+	io_serialHandle->m_timestampWrite = timestamp_now();
+	metrics_add(&metrics[SERIAL_METRIC_WRITES], 1);
+	metrics_add(&metrics[SERIAL_METRIC_WRITE_NS], io_serialHandle->m_timestampWrite - timeStart);
+	metrics_add(&metrics[SERIAL_METRIC_BYTES_WRITTEN], (uint64_t)writeResult);
+	if(writeResult > 0)
+	{
+		recorder_append(RECORDER_EVENT_BYTES_WRITTEN, io_serialHandle->m_recorderSource, (uint32_t)writeResult, 0, io_serialHandle->m_recorder);
+	}
+	io_serialHandle->m_roundTripPending = (io_serialHandle->m_roundTripHistogram != NULL && writeResult > 0);
 
 	if(o_bytesWritten != NULL)
 	{
@@ -247,13 +340,14 @@ Result serial_write( size_t const i_bytesToWrite,
 	return R_SUCCESS;
 
 end:
-	CARL_ERROR("serial_write(%zu, %p, %p, %p)", i_bytesToWrite, i_data, o_bytesWritten, i_serialHandle);
+	CARL_ERROR("serial_write(%zu, %p, %p, %p)", i_bytesToWrite, i_data, o_bytesWritten, io_serialHandle);
 	return result;
 }
 
 Result serial_destroy(Serial ** const io_serialHandle)
 {
 	int closeResult = 0;
+	Result result = R_SUCCESS;
 	Serial * serialHandle = NULL;
 
 	/***** Input Validation *****/
@@ -270,15 +364,174 @@ Result serial_destroy(Serial ** const io_serialHandle)
 	}
 
 	/***** Close handle *****/
-	closeResult = close(serialHandle->m_deviceHandle);
-	if(closeResult < 0)
+	if(serialHandle->m_deviceHandle >= 0)
 	{
-		CARL_ERRORNO("Error closing port");
-	
-		return R_DEVICECLOSEFAILED;
+		closeResult = close(serialHandle->m_deviceHandle);
+		if(closeResult < 0)
+		{
+			CARL_ERRORNO("Error closing port");
+
+			result = R_DEVICECLOSEFAILED;
+		}
 	}
 
+	/***** Give the metrics slot back so the page can be reused or destroyed *****/
+	serial_metrics_export(NULL, NULL, serialHandle);
+	free(serialHandle);
+	(*io_serialHandle) = NULL;
+
 	/***** Return *****/
+	return result;
+}
+
+Result serial_fd(Serial const * const i_serialHandle, int * const o_fd)
+{
+	if(i_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_fd != NULL)
+	{
+		(*o_fd) = i_serialHandle->m_deviceHandle;
+	}
+
+	return R_SUCCESS;
+}
+
+Result serial_histogram_set(	Histogram * const i_roundTripHistogram,
+										Serial * const io_serialHandle)
+{
+	if(io_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	io_serialHandle->m_roundTripHistogram = i_roundTripHistogram;
+	io_serialHandle->m_roundTripPending = 0;
+
+	return R_SUCCESS;
+}
+
+Result serial_metrics(SerialMetrics * const o_metrics, Serial const * const i_serialHandle)
+{
+	uint64_t values[SERIAL_METRIC_COUNT];
+
+	if(i_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	metrics_snapshot(__atomic_load_n(&i_serialHandle->m_metrics, __ATOMIC_ACQUIRE), SERIAL_METRIC_COUNT, values);
+	if(o_metrics != NULL)
+	{
+		o_metrics->m_bytesRead = values[SERIAL_METRIC_BYTES_READ];
+		o_metrics->m_bytesWritten = values[SERIAL_METRIC_BYTES_WRITTEN];
+		o_metrics->m_reads = values[SERIAL_METRIC_READS];
+		o_metrics->m_writes = values[SERIAL_METRIC_WRITES];
+		o_metrics->m_readNs = values[SERIAL_METRIC_READ_NS];
+		o_metrics->m_writeNs = values[SERIAL_METRIC_WRITE_NS];
+		o_metrics->m_readErrors = values[SERIAL_METRIC_READ_ERRORS];
+		o_metrics->m_writeErrors = values[SERIAL_METRIC_WRITE_ERRORS];
+	}
+
 	return R_SUCCESS;
 }
 
+Result serial_metrics_export(	char const * const i_name,
+										MetricsPage * const io_pageHandle,
+										Serial * const io_serialHandle)
+{
+	Result result = R_FAILURE;
+	uint64_t *values = NULL;
+	uint64_t *previous = NULL;
+
+	if(io_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_pageHandle == NULL && io_serialHandle->m_metricsPage == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	values = io_serialHandle->m_metricsLocal;
+	if(io_pageHandle != NULL)
+	{
+		result = metrics_page_slot(i_name, "serial", SERIAL_METRIC_NAMES, SERIAL_METRIC_COUNT, &values, io_pageHandle);
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+	}
+
+	/***** Switch the writers over first, so whatever they count until then is still carried *****/
+	previous = __atomic_exchange_n(&io_serialHandle->m_metrics, values, __ATOMIC_ACQ_REL);
+	metrics_carry(previous, values, SERIAL_METRIC_COUNT, 0);
+	if(io_serialHandle->m_metricsPage != NULL)
+	{
+		metrics_page_release(previous, io_serialHandle->m_metricsPage);
+	}
+	io_serialHandle->m_metricsPage = io_pageHandle;
+
+	return R_SUCCESS;
+}
+
+Result serial_recorder_set(	Recorder * const i_recorderHandle,
+										uint16_t const i_source,
+										Serial * const io_serialHandle)
+{
+	if(io_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	io_serialHandle->m_recorder = i_recorderHandle;
+	io_serialHandle->m_recorderSource = i_source;
+
+	return R_SUCCESS;
+}
+
+Result serial_timestamp_read(Serial const * const i_serialHandle, Timestamp * const o_timestamp)
+{
+	if(i_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_timestamp != NULL)
+	{
+		(*o_timestamp) = i_serialHandle->m_timestampRead;
+	}
+
+	return R_SUCCESS;
+}
+
+Result serial_timestamp_write(Serial const * const i_serialHandle, Timestamp * const o_timestamp)
+{
+	if(i_serialHandle == NULL)
+	{
+		CARL_ERROR("Handle not created.");
+
+		return R_OBJECTNOTEXTANT;
+	}
+
+	if(o_timestamp != NULL)
+	{
+		(*o_timestamp) = i_serialHandle->m_timestampWrite;
+	}
+
+	return R_SUCCESS;
+}
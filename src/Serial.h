@@ -6,6 +6,10 @@ extern "C" {
 #endif
 
 #include "carl.h"
+#include "Histogram.h"
+#include "Metrics.h"
+#include "Recorder.h"
+#include "Timestamp.h"
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -39,19 +43,51 @@ struct Serial_t;
 typedef struct Serial_t Serial;
 /**************************************************/
 
+/********************----- STRUCT: SerialMetrics -----********************/
+struct SerialMetrics_s
+{
+	uint64_t m_bytesRead;
+	uint64_t m_bytesWritten;
+	uint64_t m_reads;
+	uint64_t m_writes;
+	uint64_t m_readNs;
+	uint64_t m_writeNs;
+	uint64_t m_readErrors;
+	uint64_t m_writeErrors;
+};
+typedef struct SerialMetrics_s SerialMetrics;
+/**************************************************/
+
 Result serial_create(int const i_deviceID,
 							BaudRate const i_baudRate,
 							SerialMode const i_serialMode,
 							Serial ** const o_serialHandle);
+Result serial_create_path(	char const * const i_pathname,
+									BaudRate const i_baudRate,
+									SerialMode const i_serialMode,
+									Serial ** const o_serialHandle);
 Result serial_read(	size_t const i_bytesToRead,
 							uint8_t * const o_outputBuffer,
 							size_t * const o_bytesRead,
-							Serial const * const i_serialHandle);
+							Serial * const io_serialHandle);
 Result serial_write(	size_t const i_bytesToWrite,
 							uint8_t const * const i_data,
 							size_t * const o_bytesWritten,
-							Serial const * const i_serialHandle);
+							Serial * const io_serialHandle);
 Result serial_destroy(Serial ** const io_serialHandle);
+Result serial_fd(Serial const * const i_serialHandle, int * const o_fd);
+Result serial_histogram_set(	Histogram * const i_roundTripHistogram,
+										Serial * const io_serialHandle);
+Result serial_metrics(SerialMetrics * const o_metrics, Serial const * const i_serialHandle);
+/* Counts straight into a page slot; a NULL page, or destroy, moves the counts back into the handle and frees the slot */
+Result serial_metrics_export(	char const * const i_name,
+										MetricsPage * const io_pageHandle,
+										Serial * const io_serialHandle);
+Result serial_recorder_set(	Recorder * const i_recorderHandle,
+										uint16_t const i_source,
+										Serial * const io_serialHandle);
+Result serial_timestamp_read(Serial const * const i_serialHandle, Timestamp * const o_timestamp);
+Result serial_timestamp_write(Serial const * const i_serialHandle, Timestamp * const o_timestamp);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,668 @@
+#include "Stereo.h"
+#include "Arena.h"
+#include "Memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define STEREO_ALIGN(x) (((x) + 15) & ~(size_t)15)
+#define STEREO_SCRATCH_ALIGN(x) (((x) + MEMORY_CACHE_LINE_BYTES - 1) & ~(size_t)(MEMORY_CACHE_LINE_BYTES - 1))
+#define STEREO_CENSUS_RADIUS 2
+#define STEREO_CENSUS_ROWS 16
+
+/********************----- STRUCT: StereoBand -----********************/
+/* Scratch for one row band; costs are laid out [x][disparity] so every step vectorises over disparity, and
+ * the per-pixel costs of the rows inside the block are kept in a ring so each row is costed once */
+struct StereoBand_s
+{
+	int16_t *m_columnCost;
+	int16_t *m_blockCost;
+	int16_t *m_rightCost;
+	int16_t *m_rightDisparity;
+	int16_t *m_leftDisparity;
+	uint8_t *m_rowCost;
+	uint8_t *m_reversed;
+};
+typedef struct StereoBand_s StereoBand;
+/**************************************************/
+
+/********************----- STRUCT: Stereo -----********************/
+/* Band scratch and census planes are per-frame, carved from the arena at the start of each stereo_disparity */
+struct Stereo_s
+{
+	Arena *m_scratch;
+	StereoBand m_bands[STEREO_BAND_COUNT_MAX];
+	uint32_t *m_censusLeft;
+	uint32_t *m_censusRight;
+	size_t m_bandSizeBytes;
+	size_t m_censusSizeBytes;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_disparityCount;
+	size_t m_blockRadius;
+	size_t m_bandCount;
+	StereoCost m_cost;
+	int m_leftRightMax;
+};
+/**************************************************/
+
+/********************----- STRUCT: StereoJob -----********************/
+struct StereoJob_s
+{
+	Stereo *m_stereo;
+	uint8_t const *m_left;
+	uint8_t const *m_right;
+	size_t m_strideBytes;
+	int16_t *m_output;
+};
+typedef struct StereoJob_s StereoJob;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static size_t stereo_clamp(ptrdiff_t const i_value, size_t const i_size)
+{
+	return (i_value < 0) ? 0 : MIN((size_t)i_value, i_size - 1);
+}
+
+/* Size of one band's scratch; with memory, also points the band at its pieces */
+static size_t stereo_band_layout(size_t const i_sizeX, size_t const i_disparityCount, size_t const i_blockRadius, uint8_t * const i_memory, StereoBand * const o_band)
+{
+	size_t const columnSizeBytes = STEREO_ALIGN(i_sizeX*i_disparityCount*sizeof(int16_t));
+	size_t const blockSizeBytes = STEREO_ALIGN(i_disparityCount*sizeof(int16_t));
+	size_t const rightSizeBytes = STEREO_ALIGN((i_sizeX + i_disparityCount)*sizeof(int16_t));
+	size_t const leftSizeBytes = STEREO_ALIGN(i_sizeX*sizeof(int16_t));
+	size_t const reversedSizeBytes = STEREO_ALIGN((i_sizeX + i_disparityCount)*sizeof(uint32_t));
+	size_t const ringSizeBytes = (2*i_blockRadius + 1)*i_sizeX*i_disparityCount;
+
+	if(i_memory != NULL)
+	{
+		o_band->m_columnCost = (int16_t *)i_memory;
+		o_band->m_blockCost = (int16_t *)(i_memory + columnSizeBytes);
+		o_band->m_rightCost = (int16_t *)((uint8_t *)o_band->m_blockCost + blockSizeBytes);
+		o_band->m_rightDisparity = (int16_t *)((uint8_t *)o_band->m_rightCost + rightSizeBytes);
+		o_band->m_leftDisparity = (int16_t *)((uint8_t *)o_band->m_rightDisparity + rightSizeBytes);
+		o_band->m_reversed = (uint8_t *)o_band->m_leftDisparity + leftSizeBytes;
+		o_band->m_rowCost = o_band->m_reversed + reversedSizeBytes;
+	}
+
+	return columnSizeBytes + blockSizeBytes + 2*rightSizeBytes + leftSizeBytes + reversedSizeBytes + ringSizeBytes;
+}
+
+/* 5x5 census: bit n is set when neighbour n, in raster order without the centre, is darker than the centre */
+static uint32_t stereo_census_pixel(uint8_t const * const i_plane, size_t const i_strideBytes, size_t const i_sizeX, size_t const i_sizeY, size_t const i_x, size_t const i_y)
+{
+	uint8_t const center = i_plane[i_y*i_strideBytes + i_x];
+	uint32_t census = 0;
+	uint32_t bit = 0;
+	ptrdiff_t offsetX = 0;
+	ptrdiff_t offsetY = 0;
+
+	for(offsetY=-STEREO_CENSUS_RADIUS; offsetY<=STEREO_CENSUS_RADIUS; ++offsetY)
+	{
+		for(offsetX=-STEREO_CENSUS_RADIUS; offsetX<=STEREO_CENSUS_RADIUS; ++offsetX)
+		{
+			if(offsetX == 0 && offsetY == 0)
+			{
+				continue;
+			}
+			census |= (uint32_t)(i_plane[stereo_clamp((ptrdiff_t)i_y + offsetY, i_sizeY)*i_strideBytes + stereo_clamp((ptrdiff_t)i_x + offsetX, i_sizeX)] < center) << bit;
+			++bit;
+		}
+	}
+
+	return census;
+}
+
+static void stereo_census_plane(uint8_t const * const i_plane, size_t const i_strideBytes, size_t const i_sizeX, size_t const i_sizeY, size_t const i_row, uint32_t * const o_census)
+{
+	size_t x = 0;
+
+#ifdef __SSE2__
+	if(i_row >= STEREO_CENSUS_RADIUS && i_row + STEREO_CENSUS_RADIUS < i_sizeY)
+	{
+		__m128i const flip = _mm_set1_epi8((char)0x80);
+		__m128i const zero = _mm_setzero_si128();
+
+		for(x=0; x<STEREO_CENSUS_RADIUS; ++x)
+		{
+			o_census[x] = stereo_census_pixel(i_plane, i_strideBytes, i_sizeX, i_sizeY, x, i_row);
+		}
+
+		/***** Sixteen pixels at a time, one byte of census bits per eight neighbours *****/
+		for(; x+16+STEREO_CENSUS_RADIUS<=i_sizeX; x+=16)
+		{
+			uint8_t const * const pixel = i_plane + i_row*i_strideBytes + x;
+			__m128i const center = _mm_xor_si128(_mm_loadu_si128((__m128i const *)pixel), flip);
+			__m128i bits[3];
+			__m128i low;
+			__m128i high;
+			ptrdiff_t offsetX = 0;
+			ptrdiff_t offsetY = 0;
+			uint32_t bit = 0;
+
+			bits[0] = bits[1] = bits[2] = zero;
+			for(offsetY=-STEREO_CENSUS_RADIUS; offsetY<=STEREO_CENSUS_RADIUS; ++offsetY)
+			{
+				for(offsetX=-STEREO_CENSUS_RADIUS; offsetX<=STEREO_CENSUS_RADIUS; ++offsetX)
+				{
+					__m128i neighbour;
+
+					if(offsetX == 0 && offsetY == 0)
+					{
+						continue;
+					}
+					neighbour = _mm_xor_si128(_mm_loadu_si128((__m128i const *)(pixel + offsetY*(ptrdiff_t)i_strideBytes + offsetX)), flip);
+					bits[bit/8] = _mm_or_si128(bits[bit/8], _mm_and_si128(_mm_cmpgt_epi8(center, neighbour), _mm_set1_epi8((char)(1 << (bit%8)))));
+					++bit;
+				}
+			}
+
+			low = _mm_unpacklo_epi8(bits[0], bits[1]);
+			high = _mm_unpackhi_epi8(bits[0], bits[1]);
+			_mm_storeu_si128((__m128i *)(o_census + x), _mm_unpacklo_epi16(low, _mm_unpacklo_epi8(bits[2], zero)));
+			_mm_storeu_si128((__m128i *)(o_census + x + 4), _mm_unpackhi_epi16(low, _mm_unpacklo_epi8(bits[2], zero)));
+			_mm_storeu_si128((__m128i *)(o_census + x + 8), _mm_unpacklo_epi16(high, _mm_unpackhi_epi8(bits[2], zero)));
+			_mm_storeu_si128((__m128i *)(o_census + x + 12), _mm_unpackhi_epi16(high, _mm_unpackhi_epi8(bits[2], zero)));
+		}
+	}
+#endif
+	for(; x<i_sizeX; ++x)
+	{
+		o_census[x] = stereo_census_pixel(i_plane, i_strideBytes, i_sizeX, i_sizeY, x, i_row);
+	}
+}
+
+static void stereo_census_rows(size_t const i_rowBegin, size_t const i_rowEnd, void * const i_taskData)
+{
+	StereoJob const * const job = (StereoJob const *)i_taskData;
+	Stereo * const stereoHandle = job->m_stereo;
+	size_t row = 0;
+
+	for(row=i_rowBegin; row<i_rowEnd; ++row)
+	{
+		stereo_census_plane(job->m_left, job->m_strideBytes, stereoHandle->m_sizeX, stereoHandle->m_sizeY, row, stereoHandle->m_censusLeft + row*stereoHandle->m_sizeX);
+		stereo_census_plane(job->m_right, job->m_strideBytes, stereoHandle->m_sizeX, stereoHandle->m_sizeY, row, stereoHandle->m_censusRight + row*stereoHandle->m_sizeX);
+	}
+}
+
+#ifdef __SSE2__
+static __m128i stereo_popcount_sse2(__m128i i_value)
+{
+	i_value = _mm_sub_epi32(i_value, _mm_and_si128(_mm_srli_epi32(i_value, 1), _mm_set1_epi32(0x55555555)));
+	i_value = _mm_add_epi32(_mm_and_si128(i_value, _mm_set1_epi32(0x33333333)), _mm_and_si128(_mm_srli_epi32(i_value, 2), _mm_set1_epi32(0x33333333)));
+	i_value = _mm_and_si128(_mm_add_epi32(i_value, _mm_srli_epi32(i_value, 4)), _mm_set1_epi32(0x0F0F0F0F));
+	i_value = _mm_add_epi32(i_value, _mm_srli_epi32(i_value, 8));
+	i_value = _mm_add_epi32(i_value, _mm_srli_epi32(i_value, 16));
+
+	return _mm_and_si128(i_value, _mm_set1_epi32(0x3F));
+}
+#endif
+
+/* The right row is stored reversed so the samples for disparities d..d+n of pixel x are contiguous */
+static void stereo_reverse_row(StereoJob const * const i_job, size_t const i_row, uint8_t * const o_reversed)
+{
+	Stereo const * const stereoHandle = i_job->m_stereo;
+	size_t const sizeX = stereoHandle->m_sizeX;
+	size_t x = 0;
+
+	if(stereoHandle->m_cost == STEREO_COST_CENSUS)
+	{
+		uint32_t const * const census = stereoHandle->m_censusRight + i_row*sizeX;
+		uint32_t * const reversed = (uint32_t *)o_reversed;
+
+		for(x=0; x<sizeX; ++x)
+		{
+			reversed[x] = census[sizeX - 1 - x];
+		}
+	}
+	else
+	{
+		uint8_t const * const pixels = i_job->m_right + i_row*i_job->m_strideBytes;
+
+		for(x=0; x<sizeX; ++x)
+		{
+			o_reversed[x] = pixels[sizeX - 1 - x];
+		}
+	}
+}
+
+#ifdef __SSE2__
+/* Hamming distances for sixteen disparities, saturated into bytes */
+static __m128i stereo_census_cost16(uint32_t const * const i_reversed, __m128i const i_left)
+{
+	__m128i const low = _mm_packs_epi32(	stereo_popcount_sse2(_mm_xor_si128(_mm_loadu_si128((__m128i const *)i_reversed), i_left)),
+														stereo_popcount_sse2(_mm_xor_si128(_mm_loadu_si128((__m128i const *)(i_reversed + 4)), i_left)));
+	__m128i const high = _mm_packs_epi32(	stereo_popcount_sse2(_mm_xor_si128(_mm_loadu_si128((__m128i const *)(i_reversed + 8)), i_left)),
+														stereo_popcount_sse2(_mm_xor_si128(_mm_loadu_si128((__m128i const *)(i_reversed + 12)), i_left)));
+
+	return _mm_packus_epi16(low, high);
+}
+#endif
+
+/* Row i_row's pixel costs go into ring slot i_slot; the column sums gain them and, when replacing, lose the slot's old row */
+static void stereo_cost_row(StereoJob const * const i_job, StereoBand * const io_band, size_t const i_row, size_t const i_slot, int const i_replace)
+{
+	Stereo const * const stereoHandle = i_job->m_stereo;
+	size_t const sizeX = stereoHandle->m_sizeX;
+	size_t const disparityCount = stereoHandle->m_disparityCount;
+	int const census = (stereoHandle->m_cost == STEREO_COST_CENSUS);
+	uint8_t * const ring = io_band->m_rowCost + i_slot*sizeX*disparityCount;
+	uint8_t const * const pixels = i_job->m_left + i_row*i_job->m_strideBytes;
+	uint32_t const * const censusLeft = census ? stereoHandle->m_censusLeft + i_row*sizeX : NULL;
+	size_t x = 0;
+	size_t disparity = 0;
+
+	stereo_reverse_row(i_job, i_row, io_band->m_reversed);
+	for(x=0; x<sizeX; ++x)
+	{
+		uint8_t const * const reversedPixels = io_band->m_reversed + sizeX - 1 - x;
+		uint32_t const * const reversedCensus = (uint32_t const *)io_band->m_reversed + sizeX - 1 - x;
+		uint8_t * const costs = ring + x*disparityCount;
+		int16_t * const column = io_band->m_columnCost + x*disparityCount;
+
+		disparity = 0;
+#ifdef __SSE2__
+		{
+			__m128i const zero = _mm_setzero_si128();
+			__m128i const leftPixel = _mm_set1_epi8((char)pixels[x]);
+			__m128i const leftCensus = census ? _mm_set1_epi32((int)censusLeft[x]) : zero;
+
+			for(; disparity<disparityCount; disparity+=16)
+			{
+				__m128i cost;
+				__m128i previous = zero;
+
+				if(census)
+				{
+					cost = stereo_census_cost16(reversedCensus + disparity, leftCensus);
+				}
+				else
+				{
+					__m128i const right = _mm_loadu_si128((__m128i const *)(reversedPixels + disparity));
+
+					cost = _mm_or_si128(_mm_subs_epu8(leftPixel, right), _mm_subs_epu8(right, leftPixel));
+				}
+				if(i_replace)
+				{
+					previous = _mm_load_si128((__m128i const *)(costs + disparity));
+				}
+				_mm_store_si128((__m128i *)(costs + disparity), cost);
+				_mm_store_si128((__m128i *)(column + disparity), _mm_add_epi16(_mm_load_si128((__m128i const *)(column + disparity)), _mm_sub_epi16(_mm_unpacklo_epi8(cost, zero), _mm_unpacklo_epi8(previous, zero))));
+				_mm_store_si128((__m128i *)(column + disparity + 8), _mm_add_epi16(_mm_load_si128((__m128i const *)(column + disparity + 8)), _mm_sub_epi16(_mm_unpackhi_epi8(cost, zero), _mm_unpackhi_epi8(previous, zero))));
+			}
+		}
+#endif
+		for(; disparity<disparityCount; ++disparity)
+		{
+			int const cost = census ? __builtin_popcount(reversedCensus[disparity] ^ censusLeft[x]) : abs((int)pixels[x] - (int)reversedPixels[disparity]);
+			int const previous = i_replace ? costs[disparity] : 0;
+
+			costs[disparity] = (uint8_t)cost;
+			column[disparity] = (int16_t)(column[disparity] + cost - previous);
+		}
+	}
+}
+
+/* Lowest block cost over disparities 0..i_disparityLast; ties go to the smaller disparity */
+static size_t stereo_best(int16_t const * const i_blockCost, size_t const i_disparityLast, size_t const i_disparityCount)
+{
+	size_t best = 0;
+	size_t disparity = 0;
+
+#ifdef __SSE2__
+	if(i_disparityLast + 1 == i_disparityCount)
+	{
+		__m128i const step = _mm_set1_epi16(8);
+		__m128i minimum = _mm_load_si128((__m128i const *)i_blockCost);
+		__m128i index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+		__m128i bestIndex = index;
+		int16_t lanes[8];
+		int16_t laneIndex[8];
+		size_t lane = 0;
+
+		for(disparity=8; disparity<i_disparityCount; disparity+=8)
+		{
+			__m128i const cost = _mm_load_si128((__m128i const *)(i_blockCost + disparity));
+			__m128i const lower = _mm_cmplt_epi16(cost, minimum);
+
+			index = _mm_add_epi16(index, step);
+			minimum = _mm_min_epi16(cost, minimum);
+			bestIndex = _mm_or_si128(_mm_and_si128(lower, index), _mm_andnot_si128(lower, bestIndex));
+		}
+		_mm_storeu_si128((__m128i *)lanes, minimum);
+		_mm_storeu_si128((__m128i *)laneIndex, bestIndex);
+		best = (size_t)laneIndex[0];
+		for(lane=1; lane<8; ++lane)
+		{
+			if(lanes[lane] < i_blockCost[best] || (lanes[lane] == i_blockCost[best] && (size_t)laneIndex[lane] < best))
+			{
+				best = (size_t)laneIndex[lane];
+			}
+		}
+
+		return best;
+	}
+#endif
+	for(disparity=1; disparity<=i_disparityLast; ++disparity)
+	{
+		if(i_blockCost[disparity] < i_blockCost[best])
+		{
+			best = disparity;
+		}
+	}
+
+	return best;
+}
+
+/* Right pixel x-d sees left pixel x at disparity d; reversed indexing keeps those slots contiguous */
+static void stereo_right_update(int16_t const * const i_blockCost, size_t const i_disparityCount, int16_t * const io_rightCost, int16_t * const io_rightDisparity)
+{
+	size_t disparity = 0;
+
+#ifdef __SSE2__
+	{
+		__m128i const step = _mm_set1_epi16(8);
+		__m128i index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+		for(; disparity<i_disparityCount; disparity+=8)
+		{
+			__m128i const cost = _mm_load_si128((__m128i const *)(i_blockCost + disparity));
+			__m128i const previous = _mm_loadu_si128((__m128i const *)(io_rightCost + disparity));
+			__m128i const lower = _mm_cmplt_epi16(cost, previous);
+			__m128i const previousDisparity = _mm_loadu_si128((__m128i const *)(io_rightDisparity + disparity));
+
+			_mm_storeu_si128((__m128i *)(io_rightCost + disparity), _mm_min_epi16(cost, previous));
+			_mm_storeu_si128((__m128i *)(io_rightDisparity + disparity), _mm_or_si128(_mm_and_si128(lower, index), _mm_andnot_si128(lower, previousDisparity)));
+			index = _mm_add_epi16(index, step);
+		}
+	}
+#endif
+	for(; disparity<i_disparityCount; ++disparity)
+	{
+		if(i_blockCost[disparity] < io_rightCost[disparity])
+		{
+			io_rightCost[disparity] = i_blockCost[disparity];
+			io_rightDisparity[disparity] = (int16_t)disparity;
+		}
+	}
+}
+
+/* Slides the block along the row, picks the best disparity each way, then cross-checks left against right */
+static void stereo_row(StereoJob const * const i_job, StereoBand * const io_band, size_t const i_row)
+{
+	Stereo const * const stereoHandle = i_job->m_stereo;
+	size_t const sizeX = stereoHandle->m_sizeX;
+	size_t const disparityCount = stereoHandle->m_disparityCount;
+	size_t const radius = stereoHandle->m_blockRadius;
+	int16_t const * const column = io_band->m_columnCost;
+	int16_t * const block = io_band->m_blockCost;
+	int16_t * const output = i_job->m_output + i_row*sizeX;
+	size_t x = 0;
+	size_t disparity = 0;
+	size_t offset = 0;
+	size_t best = 0;
+
+	/***** Block costs at x=0, with the edge column repeated *****/
+	for(disparity=0; disparity<disparityCount; ++disparity)
+	{
+		int sum = (int)(radius + 1)*column[disparity];
+
+		for(offset=1; offset<=radius; ++offset)
+		{
+			sum += column[MIN(offset, sizeX - 1)*disparityCount + disparity];
+		}
+		block[disparity] = (int16_t)sum;
+	}
+	for(x=0; x<sizeX+disparityCount; ++x)
+	{
+		io_band->m_rightCost[x] = INT16_MAX;
+		io_band->m_rightDisparity[x] = 0;
+	}
+
+	for(x=0; x<sizeX; ++x)
+	{
+		if(x > 0)
+		{
+			int16_t const * const entering = column + MIN(x + radius, sizeX - 1)*disparityCount;
+			int16_t const * const leaving = column + ((x > radius) ? x - radius - 1 : 0)*disparityCount;
+
+			disparity = 0;
+#ifdef __SSE2__
+			for(; disparity<disparityCount; disparity+=8)
+			{
+				__m128i const sum = _mm_add_epi16(_mm_load_si128((__m128i const *)(block + disparity)), _mm_load_si128((__m128i const *)(entering + disparity)));
+
+				_mm_store_si128((__m128i *)(block + disparity), _mm_sub_epi16(sum, _mm_load_si128((__m128i const *)(leaving + disparity))));
+			}
+#endif
+			for(; disparity<disparityCount; ++disparity)
+			{
+				block[disparity] = (int16_t)(block[disparity] + entering[disparity] - leaving[disparity]);
+			}
+		}
+
+		best = stereo_best(block, MIN(disparityCount - 1, x), disparityCount);
+		stereo_right_update(block, disparityCount, io_band->m_rightCost + sizeX - 1 - x, io_band->m_rightDisparity + sizeX - 1 - x);
+		io_band->m_leftDisparity[x] = (int16_t)best;
+
+		/***** Parabola through the neighbouring costs for the sub-pixel offset *****/
+		output[x] = (int16_t)(best*STEREO_DISPARITY_SCALE);
+		if(best > 0 && best < MIN(disparityCount - 1, x))
+		{
+			int const before = block[best-1];
+			int const after = block[best+1];
+			int const curvature = before - 2*block[best] + after;
+
+			if(curvature > 0)
+			{
+				output[x] = (int16_t)(output[x] + (before - after)*STEREO_DISPARITY_SCALE/(2*curvature));
+			}
+		}
+	}
+
+	if(stereoHandle->m_leftRightMax < 0)
+	{
+		return;
+	}
+	for(x=0; x<sizeX; ++x)
+	{
+		int const left = io_band->m_leftDisparity[x];
+		int const right = io_band->m_rightDisparity[sizeX - 1 - (x - (size_t)left)];
+
+		if(abs(left - right) > stereoHandle->m_leftRightMax)
+		{
+			output[x] = STEREO_DISPARITY_INVALID;
+		}
+	}
+}
+
+static void stereo_bands(size_t const i_bandBegin, size_t const i_bandEnd, void * const i_taskData)
+{
+	StereoJob const * const job = (StereoJob const *)i_taskData;
+	Stereo * const stereoHandle = job->m_stereo;
+	ptrdiff_t const radius = (ptrdiff_t)stereoHandle->m_blockRadius;
+	size_t bandIndex = 0;
+	ptrdiff_t offset = 0;
+	size_t row = 0;
+
+	for(bandIndex=i_bandBegin; bandIndex<i_bandEnd; ++bandIndex)
+	{
+		StereoBand * const band = &stereoHandle->m_bands[bandIndex];
+		size_t const rowBegin = bandIndex*stereoHandle->m_sizeY/stereoHandle->m_bandCount;
+		size_t const rowEnd = (bandIndex + 1)*stereoHandle->m_sizeY/stereoHandle->m_bandCount;
+
+		/***** Prime the column sums with the block around the first row, then slide down *****/
+		memset(band->m_columnCost, 0, stereoHandle->m_sizeX*stereoHandle->m_disparityCount*sizeof(int16_t));
+		for(offset=-radius; offset<=radius; ++offset)
+		{
+			stereo_cost_row(job, band, stereo_clamp((ptrdiff_t)rowBegin + offset, stereoHandle->m_sizeY), (size_t)(offset + radius), 0);
+		}
+		for(row=rowBegin; row<rowEnd; ++row)
+		{
+			if(row > rowBegin)
+			{
+				stereo_cost_row(job, band, stereo_clamp((ptrdiff_t)row + radius, stereoHandle->m_sizeY), (row - rowBegin - 1)%(size_t)(2*radius + 1), 1);
+			}
+			stereo_row(job, band, row);
+		}
+	}
+}
+/**************************************************/
+
+Result stereo_create(	uint32_t const i_sizeX,
+								uint32_t const i_sizeY,
+								uint32_t const i_disparityCount,
+								uint32_t const i_blockRadius,
+								StereoCost const i_cost,
+								int const i_leftRightMax,
+								Stereo ** const o_stereoHandle)
+{
+	Stereo *stereoHandle = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_sizeX == 0 || i_sizeY == 0 || i_disparityCount == 0 || i_disparityCount % 16 != 0 || i_disparityCount > STEREO_DISPARITY_COUNT_MAX || i_blockRadius > STEREO_BLOCK_RADIUS_MAX || (i_cost != STEREO_COST_SAD && i_cost != STEREO_COST_CENSUS))
+	{
+		CARL_ERROR("Stereo needs a non-0 size, a disparity count that is a multiple of 16 up to %u and a block radius up to %u.", STEREO_DISPARITY_COUNT_MAX, STEREO_BLOCK_RADIUS_MAX);
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create stereo structure *****/
+	stereoHandle = (Stereo *)calloc(1, sizeof(Stereo));
+	if(stereoHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	stereoHandle->m_sizeX = i_sizeX;
+	stereoHandle->m_sizeY = i_sizeY;
+	stereoHandle->m_disparityCount = i_disparityCount;
+	stereoHandle->m_blockRadius = i_blockRadius;
+	stereoHandle->m_cost = i_cost;
+	stereoHandle->m_leftRightMax = i_leftRightMax;
+	stereoHandle->m_bandCount = MIN(STEREO_BAND_COUNT_MAX, MAX(i_sizeY/(4*(2*i_blockRadius + 1)), 1));
+
+	/***** Arena sized for every band's scratch and both census planes, each starting on its own cache line *****/
+	stereoHandle->m_bandSizeBytes = stereo_band_layout(i_sizeX, i_disparityCount, i_blockRadius, NULL, NULL);
+	stereoHandle->m_censusSizeBytes = (i_cost == STEREO_COST_CENSUS) ? (size_t)i_sizeX*i_sizeY*sizeof(uint32_t) : 0;
+	result = arena_create(stereoHandle->m_bandCount*STEREO_SCRATCH_ALIGN(stereoHandle->m_bandSizeBytes) + 2*STEREO_SCRATCH_ALIGN(stereoHandle->m_censusSizeBytes), MEMORY_FLAG_PREFAULT, &stereoHandle->m_scratch);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+
+	if(o_stereoHandle != NULL)
+	{
+		(*o_stereoHandle) = stereoHandle;
+	}
+	else
+	{
+		stereo_destroy(&stereoHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("stereo_create(%u, %u, %u, %u, %d, %d, %p)", i_sizeX, i_sizeY, i_disparityCount, i_blockRadius, i_cost, i_leftRightMax, o_stereoHandle);
+	stereo_destroy(&stereoHandle);
+
+	return result;
+}
+
+Result stereo_destroy(Stereo ** const io_stereoHandle)
+{
+	Stereo *stereoHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_stereoHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	stereoHandle = (*io_stereoHandle);
+	if(stereoHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	arena_destroy(&stereoHandle->m_scratch);
+	free(stereoHandle);
+	(*io_stereoHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result stereo_disparity(	uint8_t const * const i_left,
+									uint8_t const * const i_right,
+									size_t const i_strideBytes,
+									int16_t * const o_disparity,
+									TaskPool * const io_poolHandle,
+									Stereo * const io_stereoHandle)
+{
+	StereoJob job;
+	void *memory = NULL;
+	size_t bandIndex = 0;
+	Result result = R_FAILURE;
+
+	if(io_stereoHandle == NULL)
+	{
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_left == NULL || i_right == NULL || i_strideBytes < io_stereoHandle->m_sizeX || o_disparity == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	job.m_stereo = io_stereoHandle;
+	job.m_left = i_left;
+	job.m_right = i_right;
+	job.m_strideBytes = i_strideBytes;
+	job.m_output = o_disparity;
+
+	/***** Frame scratch; the same requests each frame hand back the same prefaulted memory *****/
+	arena_reset(io_stereoHandle->m_scratch);
+	for(bandIndex=0; bandIndex<io_stereoHandle->m_bandCount; ++bandIndex)
+	{
+		result = arena_alloc(io_stereoHandle->m_bandSizeBytes, 16, &memory, io_stereoHandle->m_scratch);
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+		stereo_band_layout(io_stereoHandle->m_sizeX, io_stereoHandle->m_disparityCount, io_stereoHandle->m_blockRadius, (uint8_t *)memory, &io_stereoHandle->m_bands[bandIndex]);
+	}
+	if(io_stereoHandle->m_censusSizeBytes > 0)
+	{
+		result = arena_alloc(io_stereoHandle->m_censusSizeBytes, sizeof(uint32_t), &memory, io_stereoHandle->m_scratch);
+		if(result == R_SUCCESS)
+		{
+			io_stereoHandle->m_censusLeft = (uint32_t *)memory;
+			result = arena_alloc(io_stereoHandle->m_censusSizeBytes, sizeof(uint32_t), &memory, io_stereoHandle->m_scratch);
+		}
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+		io_stereoHandle->m_censusRight = (uint32_t *)memory;
+	}
+
+	/***** Census planes are shared by every band, so they finish first *****/
+	if(io_stereoHandle->m_cost == STEREO_COST_CENSUS)
+	{
+		result = task_pool_parallel_for(io_stereoHandle->m_sizeY, STEREO_CENSUS_ROWS, stereo_census_rows, &job, io_poolHandle);
+		if(result != R_SUCCESS)
+		{
+			return result;
+		}
+	}
+
+	return task_pool_parallel_for(io_stereoHandle->m_bandCount, 1, stereo_bands, &job, io_poolHandle);
+}
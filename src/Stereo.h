@@ -0,0 +1,55 @@
+#ifndef _STEREO_H_
+#define _STEREO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "TaskPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STEREO_BAND_COUNT_MAX 16
+#define STEREO_BLOCK_RADIUS_MAX 5
+#define STEREO_DISPARITY_COUNT_MAX 256
+#define STEREO_DISPARITY_INVALID (-1)
+#define STEREO_DISPARITY_SCALE 16
+
+/********************----- ENUM: StereoCost -----********************/
+enum StereoCost_e
+{
+	STEREO_COST_SAD,
+	STEREO_COST_CENSUS
+};
+typedef enum StereoCost_e StereoCost;
+/**************************************************/
+
+/********************----- STRUCT: Stereo -----********************/
+struct Stereo_s;
+typedef struct Stereo_s Stereo;
+/**************************************************/
+
+/* Disparity count is a multiple of 16; a negative left-right tolerance skips the consistency check */
+Result stereo_create(	uint32_t const i_sizeX,
+								uint32_t const i_sizeY,
+								uint32_t const i_disparityCount,
+								uint32_t const i_blockRadius,
+								StereoCost const i_cost,
+								int const i_leftRightMax,
+								Stereo ** const o_stereoHandle);
+Result stereo_destroy(Stereo ** const io_stereoHandle);
+/* Rectified 8-bit planes in; left-image disparity out in 1/STEREO_DISPARITY_SCALE pixels */
+Result stereo_disparity(	uint8_t const * const i_left,
+									uint8_t const * const i_right,
+									size_t const i_strideBytes,
+									int16_t * const o_disparity,
+									TaskPool * const io_poolHandle,
+									Stereo * const io_stereoHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _STEREO_H_ */
@@ -0,0 +1,930 @@
+#include "TaskPool.h"
+#include "Memory.h"
+#include "Trace.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TASK_POOL_QUEUE_CAPACITY 1024
+#define TASK_POOL_SPIN_COUNT 64
+
+/********************----- STRUCT: Task -----********************/
+struct Task_s
+{
+	TaskFunction m_function;
+	void *m_taskData;
+	TaskGroup *m_group;
+};
+typedef struct Task_s Task;
+/**************************************************/
+
+/********************----- STRUCT: TaskQueue -----********************/
+/* Owner pushes and pops at the tail, thieves take from the head */
+struct TaskQueue_s
+{
+	pthread_mutex_t m_lock;
+	size_t m_head;
+	size_t m_tail;
+	Task m_tasks[TASK_POOL_QUEUE_CAPACITY];
+} __attribute__((aligned(MEMORY_CACHE_LINE_BYTES)));
+typedef struct TaskQueue_s TaskQueue;
+/**************************************************/
+
+/********************----- STRUCT: TaskWorker -----********************/
+struct TaskWorker_s
+{
+	TaskPool *m_pool;
+	size_t m_index;
+	pthread_t m_thread;
+	int m_threadCreated;
+	uint32_t m_random;
+};
+typedef struct TaskWorker_s TaskWorker;
+/**************************************************/
+
+/********************----- STRUCT: TaskPool -----********************/
+struct TaskPool_s
+{
+	MemoryRegion m_queueRegion;
+	TaskQueue *m_queues;
+	TaskWorker *m_workers;
+	size_t m_threadCount;
+	RealtimeConfig m_config;
+	int m_configSet;
+	size_t m_cpuCount;
+	uint64_t m_queued;
+	uint64_t m_submitNext;
+	int m_stop;
+
+	/***** Idle workers sleep here *****/
+	pthread_mutex_t m_sleepLock;
+	pthread_cond_t m_sleepCondition;
+	uint64_t m_sleepers;
+};
+/**************************************************/
+
+/********************----- STRUCT: TaskGraph -----********************/
+struct TaskGraphStage_s
+{
+	TaskStageFunction m_function;
+	void *m_stageData;
+	uint32_t m_dependencyCount;
+	uint32_t m_successorCount;
+	uint8_t m_successors[TASK_GRAPH_STAGE_COUNT_MAX];
+};
+typedef struct TaskGraphStage_s TaskGraphStage;
+
+struct TaskGraphRun_s;
+
+struct TaskGraphStageTask_s
+{
+	struct TaskGraphRun_s *m_run;
+	size_t m_stage;
+};
+typedef struct TaskGraphStageTask_s TaskGraphStageTask;
+
+struct TaskGraphRun_s
+{
+	TaskGraph *m_graph;
+	TaskPool *m_pool;
+	void *m_frameData;
+	uint64_t m_sequence;
+	int m_busy;
+	int m_done;
+	uint32_t m_stagesRemaining;
+	uint32_t m_dependenciesRemaining[TASK_GRAPH_STAGE_COUNT_MAX];
+	TaskGraphStageTask m_stageTasks[TASK_GRAPH_STAGE_COUNT_MAX];
+};
+typedef struct TaskGraphRun_s TaskGraphRun;
+
+struct TaskGraph_s
+{
+	TaskGraphStage m_stages[TASK_GRAPH_STAGE_COUNT_MAX];
+	size_t m_stageCount;
+	TaskGraphRun *m_runs;
+	size_t m_inFlightMax;
+	int m_ordered;
+	TaskGraphCompletion m_completion;
+	void *m_completionData;
+	uint64_t m_sequenceNext;
+	uint64_t m_sequenceDelivered;
+	pthread_mutex_t m_deliverLock;
+};
+/**************************************************/
+
+/********************----- STRUCT: TaskRange -----********************/
+struct TaskRange_s
+{
+	size_t m_count;
+	size_t m_grain;
+	size_t m_chunkCount;
+	uint64_t m_chunkNext;
+	TaskRangeFunction m_function;
+	void *m_taskData;
+};
+typedef struct TaskRange_s TaskRange;
+
+struct TaskTiles_s
+{
+	size_t m_sizeX;
+	size_t m_sizeY;
+	size_t m_tileX;
+	size_t m_tileY;
+	size_t m_tilesPerRow;
+	TaskTileFunction m_function;
+	void *m_taskData;
+};
+typedef struct TaskTiles_s TaskTiles;
+/**************************************************/
+
+static __thread TaskWorker *t_taskWorker = NULL;
+
+/********************----- Internal Functions -----********************/
+static int task_queue_push(Task const * const i_task, TaskQueue * const io_queue)
+{
+	int pushed = 0;
+
+	pthread_mutex_lock(&io_queue->m_lock);
+	if(io_queue->m_tail - io_queue->m_head < TASK_POOL_QUEUE_CAPACITY)
+	{
+		io_queue->m_tasks[io_queue->m_tail % TASK_POOL_QUEUE_CAPACITY] = (*i_task);
+		__atomic_store_n(&io_queue->m_tail, io_queue->m_tail+1, __ATOMIC_RELAXED);
+		pushed = 1;
+	}
+	pthread_mutex_unlock(&io_queue->m_lock);
+
+	return pushed;
+}
+
+static int task_queue_pop(Task * const o_task, TaskQueue * const io_queue)
+{
+	int popped = 0;
+
+	pthread_mutex_lock(&io_queue->m_lock);
+	if(io_queue->m_tail != io_queue->m_head)
+	{
+		__atomic_store_n(&io_queue->m_tail, io_queue->m_tail-1, __ATOMIC_RELAXED);
+		(*o_task) = io_queue->m_tasks[io_queue->m_tail % TASK_POOL_QUEUE_CAPACITY];
+		popped = 1;
+	}
+	pthread_mutex_unlock(&io_queue->m_lock);
+
+	return popped;
+}
+
+static int task_queue_steal(Task * const o_task, TaskQueue * const io_queue)
+{
+	int stolen = 0;
+
+	/***** Skip empty queues without touching the lock *****/
+	if(__atomic_load_n(&io_queue->m_tail, __ATOMIC_RELAXED) == __atomic_load_n(&io_queue->m_head, __ATOMIC_RELAXED))
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&io_queue->m_lock);
+	if(io_queue->m_tail != io_queue->m_head)
+	{
+		(*o_task) = io_queue->m_tasks[io_queue->m_head % TASK_POOL_QUEUE_CAPACITY];
+		__atomic_store_n(&io_queue->m_head, io_queue->m_head+1, __ATOMIC_RELAXED);
+		stolen = 1;
+	}
+	pthread_mutex_unlock(&io_queue->m_lock);
+
+	return stolen;
+}
+
+static void task_run(Task const * const i_task)
+{
+	i_task->m_function(i_task->m_taskData);
+	if(i_task->m_group != NULL)
+	{
+		__atomic_sub_fetch(&i_task->m_group->m_pending, 1, __ATOMIC_ACQ_REL);
+	}
+}
+
+/* Runs one queued task: the calling worker's own newest first, otherwise the oldest from a victim */
+static int task_pool_help(TaskPool * const io_poolHandle)
+{
+	Task task;
+	TaskWorker * const worker = (t_taskWorker != NULL && t_taskWorker->m_pool == io_poolHandle) ? t_taskWorker : NULL;
+	size_t start = 0;
+	size_t offset = 0;
+
+	if(worker != NULL && task_queue_pop(&task, &io_poolHandle->m_queues[worker->m_index]))
+	{
+		__atomic_sub_fetch(&io_poolHandle->m_queued, 1, __ATOMIC_SEQ_CST);
+		task_run(&task);
+		return 1;
+	}
+
+	if(worker != NULL)
+	{
+		worker->m_random = worker->m_random*1103515245u + 12345u;
+		start = (worker->m_random >> 16) % io_poolHandle->m_threadCount;
+	}
+	for(offset=0; offset<io_poolHandle->m_threadCount; ++offset)
+	{
+		if(task_queue_steal(&task, &io_poolHandle->m_queues[(start + offset) % io_poolHandle->m_threadCount]))
+		{
+			__atomic_sub_fetch(&io_poolHandle->m_queued, 1, __ATOMIC_SEQ_CST);
+			task_run(&task);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void *task_pool_worker(void *io_data)
+{
+	TaskWorker * const worker = (TaskWorker *)io_data;
+	TaskPool * const poolHandle = worker->m_pool;
+	RealtimeConfig config;
+	Result result = R_FAILURE;
+	size_t spin = 0;
+
+	t_taskWorker = worker;
+	if(poolHandle->m_configSet)
+	{
+		/***** Workers past the last CPU wrap around to the first *****/
+		config = poolHandle->m_config;
+		if(config.m_cpu >= 0)
+		{
+			config.m_cpu = (int)(((size_t)config.m_cpu + worker->m_index) % poolHandle->m_cpuCount);
+		}
+		result = realtime_setup(&config, NULL);
+		if(result != R_SUCCESS)
+		{
+			CARL_ERROR("Realtime setup of task pool worker %zu on CPU %d failed (%d).", worker->m_index, config.m_cpu, result);
+		}
+	}
+	trace_thread_name("task_pool");
+
+	while(!__atomic_load_n(&poolHandle->m_stop, __ATOMIC_ACQUIRE))
+	{
+		if(task_pool_help(poolHandle))
+		{
+			spin = 0;
+			continue;
+		}
+		if(++spin < TASK_POOL_SPIN_COUNT)
+		{
+			sched_yield();
+			continue;
+		}
+
+		/***** Sleep until a submission sees us; both sides use seq_cst so one of them notices the other *****/
+		pthread_mutex_lock(&poolHandle->m_sleepLock);
+		__atomic_add_fetch(&poolHandle->m_sleepers, 1, __ATOMIC_SEQ_CST);
+		while(__atomic_load_n(&poolHandle->m_queued, __ATOMIC_SEQ_CST) == 0 && !__atomic_load_n(&poolHandle->m_stop, __ATOMIC_SEQ_CST))
+		{
+			pthread_cond_wait(&poolHandle->m_sleepCondition, &poolHandle->m_sleepLock);
+		}
+		__atomic_sub_fetch(&poolHandle->m_sleepers, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&poolHandle->m_sleepLock);
+		spin = 0;
+	}
+
+	t_taskWorker = NULL;
+
+	return NULL;
+}
+
+static void task_range_run(void * const i_taskData)
+{
+	TaskRange * const range = (TaskRange *)i_taskData;
+	size_t chunk = 0;
+
+	for(;;)
+	{
+		chunk = (size_t)__atomic_fetch_add(&range->m_chunkNext, 1, __ATOMIC_RELAXED);
+		if(chunk >= range->m_chunkCount)
+		{
+			break;
+		}
+		range->m_function(chunk*range->m_grain, MIN((chunk+1)*range->m_grain, range->m_count), range->m_taskData);
+	}
+}
+
+static void task_tiles_run(size_t const i_begin, size_t const i_end, void * const i_taskData)
+{
+	TaskTiles const * const tiles = (TaskTiles const *)i_taskData;
+	size_t tile = 0;
+
+	for(tile=i_begin; tile<i_end; ++tile)
+	{
+		size_t const beginX = (tile % tiles->m_tilesPerRow)*tiles->m_tileX;
+		size_t const beginY = (tile / tiles->m_tilesPerRow)*tiles->m_tileY;
+
+		tiles->m_function(beginX, beginY, MIN(beginX + tiles->m_tileX, tiles->m_sizeX), MIN(beginY + tiles->m_tileY, tiles->m_sizeY), tiles->m_taskData);
+	}
+}
+
+static void task_graph_run_complete(TaskGraphRun * const io_run)
+{
+	TaskGraph * const graphHandle = io_run->m_graph;
+	TaskGraphRun *run = NULL;
+
+	if(!graphHandle->m_ordered)
+	{
+		if(graphHandle->m_completion != NULL)
+		{
+			graphHandle->m_completion(io_run->m_frameData, io_run->m_sequence, graphHandle->m_completionData);
+		}
+		__atomic_store_n(&io_run->m_busy, 0, __ATOMIC_RELEASE);
+		return;
+	}
+
+	/***** Deliver every consecutive finished frame, oldest first *****/
+	__atomic_store_n(&io_run->m_done, 1, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&graphHandle->m_deliverLock);
+	for(;;)
+	{
+		run = &graphHandle->m_runs[graphHandle->m_sequenceDelivered % graphHandle->m_inFlightMax];
+		if(!__atomic_load_n(&run->m_busy, __ATOMIC_ACQUIRE) || !__atomic_load_n(&run->m_done, __ATOMIC_ACQUIRE) || run->m_sequence != graphHandle->m_sequenceDelivered)
+		{
+			break;
+		}
+		if(graphHandle->m_completion != NULL)
+		{
+			graphHandle->m_completion(run->m_frameData, run->m_sequence, graphHandle->m_completionData);
+		}
+		++graphHandle->m_sequenceDelivered;
+		__atomic_store_n(&run->m_busy, 0, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&graphHandle->m_deliverLock);
+}
+
+static void task_graph_stage_run(void * const i_taskData)
+{
+	TaskGraphStageTask * const stageTask = (TaskGraphStageTask *)i_taskData;
+	TaskGraphRun * const run = stageTask->m_run;
+	TaskGraphStage const * const stage = &run->m_graph->m_stages[stageTask->m_stage];
+	size_t successorIndex = 0;
+
+	stage->m_function(run->m_frameData, stage->m_stageData);
+
+	/***** Release successors whose last dependency this was *****/
+	for(successorIndex=0; successorIndex<stage->m_successorCount; ++successorIndex)
+	{
+		size_t const successor = stage->m_successors[successorIndex];
+
+		if(__atomic_sub_fetch(&run->m_dependenciesRemaining[successor], 1, __ATOMIC_ACQ_REL) == 0)
+		{
+			task_pool_submit(task_graph_stage_run, &run->m_stageTasks[successor], NULL, run->m_pool);
+		}
+	}
+
+	if(__atomic_sub_fetch(&run->m_stagesRemaining, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		task_graph_run_complete(run);
+	}
+}
+/**************************************************/
+
+Result task_pool_create(	size_t const i_threadCount,
+									RealtimeConfig const * const i_config,
+									TaskPool ** const o_poolHandle)
+{
+	TaskPool *poolHandle = NULL;
+	size_t threadIndex = 0;
+	long cpuCount = 0;
+	Result result = R_FAILURE;
+
+	/***** Create pool structure *****/
+	poolHandle = (TaskPool *)calloc(1, sizeof(TaskPool));
+	if(poolHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+	poolHandle->m_cpuCount = (cpuCount > 0) ? (size_t)cpuCount : 1;
+	poolHandle->m_threadCount = i_threadCount;
+	if(poolHandle->m_threadCount == 0)
+	{
+		poolHandle->m_threadCount = poolHandle->m_cpuCount;
+	}
+	if(i_config != NULL)
+	{
+		poolHandle->m_config = (*i_config);
+		poolHandle->m_configSet = 1;
+	}
+	pthread_mutex_init(&poolHandle->m_sleepLock, NULL);
+	pthread_cond_init(&poolHandle->m_sleepCondition, NULL);
+
+	/***** Queues and workers *****/
+	result = memory_region_map(poolHandle->m_threadCount*sizeof(TaskQueue), MEMORY_FLAG_PREFAULT, &poolHandle->m_queueRegion);
+	if(result != R_SUCCESS)
+	{
+		goto end;
+	}
+	poolHandle->m_queues = (TaskQueue *)poolHandle->m_queueRegion.m_memory;
+	poolHandle->m_workers = (TaskWorker *)calloc(poolHandle->m_threadCount, sizeof(TaskWorker));
+	if(poolHandle->m_workers == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	for(threadIndex=0; threadIndex<poolHandle->m_threadCount; ++threadIndex)
+	{
+		pthread_mutex_init(&poolHandle->m_queues[threadIndex].m_lock, NULL);
+		poolHandle->m_queues[threadIndex].m_head = 0;
+		poolHandle->m_queues[threadIndex].m_tail = 0;
+		poolHandle->m_workers[threadIndex].m_pool = poolHandle;
+		poolHandle->m_workers[threadIndex].m_index = threadIndex;
+		poolHandle->m_workers[threadIndex].m_random = (uint32_t)threadIndex*2654435761u + 1;
+	}
+	for(threadIndex=0; threadIndex<poolHandle->m_threadCount; ++threadIndex)
+	{
+		if(pthread_create(&poolHandle->m_workers[threadIndex].m_thread, NULL, task_pool_worker, &poolHandle->m_workers[threadIndex]) != 0)
+		{
+			CARL_ERROR("Unable to create worker thread %zu.", threadIndex);
+
+			result = R_FAILURE;
+			goto end;
+		}
+		poolHandle->m_workers[threadIndex].m_threadCreated = 1;
+	}
+
+	if(o_poolHandle != NULL)
+	{
+		(*o_poolHandle) = poolHandle;
+	}
+	else
+	{
+		task_pool_destroy(&poolHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("task_pool_create(%zu, %p, %p)", i_threadCount, i_config, o_poolHandle);
+	task_pool_destroy(&poolHandle);
+
+	return result;
+}
+
+Result task_pool_destroy(TaskPool ** const io_poolHandle)
+{
+	TaskPool *poolHandle = NULL;
+	size_t threadIndex = 0;
+
+	/***** Input Validation *****/
+	if(io_poolHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	poolHandle = (*io_poolHandle);
+	if(poolHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Stop workers; queued tasks are dropped *****/
+	pthread_mutex_lock(&poolHandle->m_sleepLock);
+	__atomic_store_n(&poolHandle->m_stop, 1, __ATOMIC_SEQ_CST);
+	pthread_cond_broadcast(&poolHandle->m_sleepCondition);
+	pthread_mutex_unlock(&poolHandle->m_sleepLock);
+	if(poolHandle->m_workers != NULL)
+	{
+		for(threadIndex=0; threadIndex<poolHandle->m_threadCount; ++threadIndex)
+		{
+			if(poolHandle->m_workers[threadIndex].m_threadCreated)
+			{
+				pthread_join(poolHandle->m_workers[threadIndex].m_thread, NULL);
+			}
+		}
+		free(poolHandle->m_workers);
+	}
+	if(poolHandle->m_queues != NULL)
+	{
+		for(threadIndex=0; threadIndex<poolHandle->m_threadCount; ++threadIndex)
+		{
+			pthread_mutex_destroy(&poolHandle->m_queues[threadIndex].m_lock);
+		}
+		memory_region_unmap(&poolHandle->m_queueRegion);
+	}
+	pthread_cond_destroy(&poolHandle->m_sleepCondition);
+	pthread_mutex_destroy(&poolHandle->m_sleepLock);
+	free(poolHandle);
+	(*io_poolHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result task_pool_parallel_for(	size_t const i_count,
+											size_t const i_grain,
+											TaskRangeFunction i_function,
+											void * const i_taskData,
+											TaskPool * const io_poolHandle)
+{
+	TaskRange range;
+	TaskGroup group;
+	size_t helperIndex = 0;
+	size_t helperCount = 0;
+
+	if(i_function == NULL)
+	{
+		CARL_ERROR("parallel_for needs a function.");
+		return R_INPUTBAD;
+	}
+	if(i_count == 0)
+	{
+		return R_SUCCESS;
+	}
+
+	range.m_count = i_count;
+	range.m_grain = (i_grain > 0) ? i_grain : 1;
+	range.m_chunkCount = (i_count + range.m_grain - 1)/range.m_grain;
+	range.m_chunkNext = 0;
+	range.m_function = i_function;
+	range.m_taskData = i_taskData;
+
+	/***** One helper per other worker; chunks are claimed dynamically *****/
+	CARL_TRACE_BEGIN("task_pool.parallel_for");
+	task_group_init(&group);
+	if(io_poolHandle != NULL)
+	{
+		helperCount = MIN(io_poolHandle->m_threadCount, range.m_chunkCount - 1);
+		for(helperIndex=0; helperIndex<helperCount; ++helperIndex)
+		{
+			task_pool_submit(task_range_run, &range, &group, io_poolHandle);
+		}
+	}
+	task_range_run(&range);
+	task_group_wait(&group, io_poolHandle);
+	CARL_TRACE_END("task_pool.parallel_for");
+
+	return R_SUCCESS;
+}
+
+Result task_pool_parallel_for_tiles(	size_t const i_sizeX,
+													size_t const i_sizeY,
+													size_t const i_tileX,
+													size_t const i_tileY,
+													TaskTileFunction i_function,
+													void * const i_taskData,
+													TaskPool * const io_poolHandle)
+{
+	TaskTiles tiles;
+	size_t tileRows = 0;
+
+	if(i_function == NULL || i_tileX == 0 || i_tileY == 0)
+	{
+		CARL_ERROR("parallel_for_tiles needs a function and a non-0 tile size.");
+		return R_INPUTBAD;
+	}
+	if(i_sizeX == 0 || i_sizeY == 0)
+	{
+		return R_SUCCESS;
+	}
+
+	tiles.m_sizeX = i_sizeX;
+	tiles.m_sizeY = i_sizeY;
+	tiles.m_tileX = i_tileX;
+	tiles.m_tileY = i_tileY;
+	tiles.m_tilesPerRow = (i_sizeX + i_tileX - 1)/i_tileX;
+	tiles.m_function = i_function;
+	tiles.m_taskData = i_taskData;
+	tileRows = (i_sizeY + i_tileY - 1)/i_tileY;
+
+	return task_pool_parallel_for(tiles.m_tilesPerRow*tileRows, 1, task_tiles_run, &tiles, io_poolHandle);
+}
+
+Result task_pool_submit(	TaskFunction i_function,
+									void * const i_taskData,
+									TaskGroup * const io_group,
+									TaskPool * const io_poolHandle)
+{
+	Task task;
+	size_t queueIndex = 0;
+
+	if(i_function == NULL)
+	{
+		CARL_ERROR("Task needs a function.");
+		return R_INPUTBAD;
+	}
+
+	task.m_function = i_function;
+	task.m_taskData = i_taskData;
+	task.m_group = io_group;
+	if(io_group != NULL)
+	{
+		__atomic_add_fetch(&io_group->m_pending, 1, __ATOMIC_RELAXED);
+	}
+
+	/***** No pool, or a full queue, runs the task right here *****/
+	if(io_poolHandle == NULL)
+	{
+		task_run(&task);
+		return R_SUCCESS;
+	}
+	if(t_taskWorker != NULL && t_taskWorker->m_pool == io_poolHandle)
+	{
+		queueIndex = t_taskWorker->m_index;
+	}
+	else
+	{
+		queueIndex = (size_t)(__atomic_fetch_add(&io_poolHandle->m_submitNext, 1, __ATOMIC_RELAXED) % io_poolHandle->m_threadCount);
+	}
+	__atomic_add_fetch(&io_poolHandle->m_queued, 1, __ATOMIC_SEQ_CST);
+	if(!task_queue_push(&task, &io_poolHandle->m_queues[queueIndex]))
+	{
+		__atomic_sub_fetch(&io_poolHandle->m_queued, 1, __ATOMIC_SEQ_CST);
+		task_run(&task);
+		return R_SUCCESS;
+	}
+
+	if(__atomic_load_n(&io_poolHandle->m_sleepers, __ATOMIC_SEQ_CST) > 0)
+	{
+		pthread_mutex_lock(&io_poolHandle->m_sleepLock);
+		pthread_cond_signal(&io_poolHandle->m_sleepCondition);
+		pthread_mutex_unlock(&io_poolHandle->m_sleepLock);
+	}
+
+	return R_SUCCESS;
+}
+
+size_t task_pool_thread_count(TaskPool const * const i_poolHandle)
+{
+	return (i_poolHandle != NULL) ? i_poolHandle->m_threadCount : 1;
+}
+
+void task_group_init(TaskGroup * const o_group)
+{
+	if(o_group != NULL)
+	{
+		o_group->m_pending = 0;
+	}
+}
+
+Result task_group_wait(TaskGroup * const io_group, TaskPool * const io_poolHandle)
+{
+	if(io_group == NULL)
+	{
+		CARL_ERROR("Task group not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	/***** Help out instead of blocking, so nested waits cannot starve the pool *****/
+	while(__atomic_load_n(&io_group->m_pending, __ATOMIC_ACQUIRE) > 0)
+	{
+		if(io_poolHandle == NULL || !task_pool_help(io_poolHandle))
+		{
+			sched_yield();
+		}
+	}
+
+	return R_SUCCESS;
+}
+
+Result task_graph_create(	size_t const i_inFlightMax,
+									int const i_ordered,
+									TaskGraphCompletion i_completion,
+									void * const i_completionData,
+									TaskGraph ** const o_graphHandle)
+{
+	TaskGraph *graphHandle = NULL;
+	size_t runIndex = 0;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_inFlightMax == 0)
+	{
+		CARL_ERROR("Task graph needs at least 1 frame in flight.");
+
+		result = R_INPUTBAD;
+		goto end;
+	}
+
+	/***** Create graph structure *****/
+	graphHandle = (TaskGraph *)calloc(1, sizeof(TaskGraph));
+	if(graphHandle == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	graphHandle->m_inFlightMax = i_inFlightMax;
+	graphHandle->m_ordered = i_ordered;
+	graphHandle->m_completion = i_completion;
+	graphHandle->m_completionData = i_completionData;
+	pthread_mutex_init(&graphHandle->m_deliverLock, NULL);
+
+	/***** Per-frame state, reused round robin *****/
+	graphHandle->m_runs = (TaskGraphRun *)calloc(i_inFlightMax, sizeof(TaskGraphRun));
+	if(graphHandle->m_runs == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	for(runIndex=0; runIndex<i_inFlightMax; ++runIndex)
+	{
+		graphHandle->m_runs[runIndex].m_graph = graphHandle;
+	}
+
+	if(o_graphHandle != NULL)
+	{
+		(*o_graphHandle) = graphHandle;
+	}
+	else
+	{
+		task_graph_destroy(&graphHandle);
+	}
+
+	return R_SUCCESS;
+
+end:
+	CARL_ERROR("task_graph_create(%zu, %d, %p, %p, %p)", i_inFlightMax, i_ordered, i_completion, i_completionData, o_graphHandle);
+	task_graph_destroy(&graphHandle);
+
+	return result;
+}
+
+Result task_graph_dependency_add(	size_t const i_stageBefore,
+												size_t const i_stageAfter,
+												TaskGraph * const io_graphHandle)
+{
+	TaskGraphStage *stage = NULL;
+	uint32_t successor = 0;
+
+	if(io_graphHandle == NULL)
+	{
+		CARL_ERROR("Task graph not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_stageBefore >= i_stageAfter || i_stageAfter >= io_graphHandle->m_stageCount)
+	{
+		CARL_ERROR("Dependency %zu -> %zu must point at a later, existing stage.", i_stageBefore, i_stageAfter);
+		return R_INPUTBAD;
+	}
+
+	stage = &io_graphHandle->m_stages[i_stageBefore];
+	for(successor=0; successor<stage->m_successorCount; ++successor)
+	{
+		if(stage->m_successors[successor] == i_stageAfter)
+		{
+			CARL_ERROR("Dependency %zu -> %zu already added.", i_stageBefore, i_stageAfter);
+			return R_INPUTBAD;
+		}
+	}
+	if(stage->m_successorCount >= TASK_GRAPH_STAGE_COUNT_MAX)
+	{
+		CARL_ERROR("Stage %zu already has %d successors.", i_stageBefore, TASK_GRAPH_STAGE_COUNT_MAX);
+		return R_BUFFERFULL;
+	}
+	stage->m_successors[stage->m_successorCount] = (uint8_t)i_stageAfter;
+	++stage->m_successorCount;
+	++io_graphHandle->m_stages[i_stageAfter].m_dependencyCount;
+
+	return R_SUCCESS;
+}
+
+Result task_graph_destroy(TaskGraph ** const io_graphHandle)
+{
+	TaskGraph *graphHandle = NULL;
+
+	/***** Input Validation *****/
+	if(io_graphHandle == NULL)
+	{
+		return R_INPUTBAD;
+	}
+
+	/***** Check if already destroyed *****/
+	graphHandle = (*io_graphHandle);
+	if(graphHandle == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Frames still in flight must be waited for first *****/
+	free(graphHandle->m_runs);
+	pthread_mutex_destroy(&graphHandle->m_deliverLock);
+	free(graphHandle);
+	(*io_graphHandle) = NULL;
+
+	return R_SUCCESS;
+}
+
+Result task_graph_stage_add(	TaskStageFunction i_function,
+										void * const i_stageData,
+										size_t * const o_stage,
+										TaskGraph * const io_graphHandle)
+{
+	TaskGraphStage *stage = NULL;
+
+	if(io_graphHandle == NULL)
+	{
+		CARL_ERROR("Task graph not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(i_function == NULL || io_graphHandle->m_stageCount >= TASK_GRAPH_STAGE_COUNT_MAX)
+	{
+		CARL_ERROR("Stage needs a function and the graph holds at most %d stages.", TASK_GRAPH_STAGE_COUNT_MAX);
+		return R_INPUTBAD;
+	}
+
+	stage = &io_graphHandle->m_stages[io_graphHandle->m_stageCount];
+	stage->m_function = i_function;
+	stage->m_stageData = i_stageData;
+	stage->m_dependencyCount = 0;
+	stage->m_successorCount = 0;
+	if(o_stage != NULL)
+	{
+		(*o_stage) = io_graphHandle->m_stageCount;
+	}
+	++io_graphHandle->m_stageCount;
+
+	return R_SUCCESS;
+}
+
+Result task_graph_submit(	void * const i_frameData,
+									TaskPool * const io_poolHandle,
+									TaskGraph * const io_graphHandle)
+{
+	TaskGraphRun *run = NULL;
+	size_t stageIndex = 0;
+
+	if(io_graphHandle == NULL)
+	{
+		CARL_ERROR("Task graph not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+	if(io_graphHandle->m_stageCount == 0)
+	{
+		CARL_ERROR("Task graph has no stages.");
+		return R_INPUTBAD;
+	}
+
+	/***** Wait for this frame's slot to be delivered *****/
+	run = &io_graphHandle->m_runs[io_graphHandle->m_sequenceNext % io_graphHandle->m_inFlightMax];
+	while(__atomic_load_n(&run->m_busy, __ATOMIC_ACQUIRE))
+	{
+		if(io_poolHandle == NULL || !task_pool_help(io_poolHandle))
+		{
+			sched_yield();
+		}
+	}
+
+	run->m_pool = io_poolHandle;
+	run->m_frameData = i_frameData;
+	run->m_sequence = io_graphHandle->m_sequenceNext++;
+	run->m_done = 0;
+	run->m_stagesRemaining = (uint32_t)io_graphHandle->m_stageCount;
+	for(stageIndex=0; stageIndex<io_graphHandle->m_stageCount; ++stageIndex)
+	{
+		run->m_dependenciesRemaining[stageIndex] = io_graphHandle->m_stages[stageIndex].m_dependencyCount;
+		run->m_stageTasks[stageIndex].m_run = run;
+		run->m_stageTasks[stageIndex].m_stage = stageIndex;
+	}
+	__atomic_store_n(&run->m_busy, 1, __ATOMIC_RELEASE);
+
+	/***** Roots start now, the rest as their dependencies finish *****/
+	for(stageIndex=0; stageIndex<io_graphHandle->m_stageCount; ++stageIndex)
+	{
+		if(io_graphHandle->m_stages[stageIndex].m_dependencyCount == 0)
+		{
+			task_pool_submit(task_graph_stage_run, &run->m_stageTasks[stageIndex], NULL, io_poolHandle);
+		}
+	}
+
+	return R_SUCCESS;
+}
+
+Result task_graph_wait(TaskPool * const io_poolHandle, TaskGraph * const io_graphHandle)
+{
+	size_t runIndex = 0;
+
+	if(io_graphHandle == NULL)
+	{
+		CARL_ERROR("Task graph not created.");
+		return R_OBJECTNOTEXTANT;
+	}
+
+	for(runIndex=0; runIndex<io_graphHandle->m_inFlightMax; ++runIndex)
+	{
+		while(__atomic_load_n(&io_graphHandle->m_runs[runIndex].m_busy, __ATOMIC_ACQUIRE))
+		{
+			if(io_poolHandle == NULL || !task_pool_help(io_poolHandle))
+			{
+				sched_yield();
+			}
+		}
+	}
+
+	return R_SUCCESS;
+}
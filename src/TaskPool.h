@@ -0,0 +1,96 @@
+#ifndef _TASKPOOL_H_
+#define _TASKPOOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+#include "Realtime.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TASK_GRAPH_STAGE_COUNT_MAX 32
+
+/********************----- STRUCT: TaskPool -----********************/
+struct TaskPool_s;
+typedef struct TaskPool_s TaskPool;
+/**************************************************/
+
+/********************----- STRUCT: TaskGroup -----********************/
+/* Caller-owned completion counter; initialize with task_group_init */
+struct TaskGroup_s
+{
+	uint64_t m_pending;
+};
+typedef struct TaskGroup_s TaskGroup;
+/**************************************************/
+
+/********************----- STRUCT: TaskGraph -----********************/
+struct TaskGraph_s;
+typedef struct TaskGraph_s TaskGraph;
+/**************************************************/
+
+typedef void (*TaskFunction)(void * const i_taskData);
+typedef void (*TaskRangeFunction)(size_t const i_begin, size_t const i_end, void * const i_taskData);
+typedef void (*TaskTileFunction)(	size_t const i_beginX,
+												size_t const i_beginY,
+												size_t const i_endX,
+												size_t const i_endY,
+												void * const i_taskData);
+typedef void (*TaskStageFunction)(void * const i_frameData, void * const i_stageData);
+typedef void (*TaskGraphCompletion)(void * const i_frameData, uint64_t const i_sequence, void * const i_completionData);
+
+/* 0 threads uses every online CPU; a config with m_cpu >= 0 pins worker n to CPU (m_cpu+n) modulo the online CPU count, and a failed setup is logged */
+Result task_pool_create(	size_t const i_threadCount,
+									RealtimeConfig const * const i_config,
+									TaskPool ** const o_poolHandle);
+Result task_pool_destroy(TaskPool ** const io_poolHandle);
+/* A NULL pool runs the whole range on the calling thread */
+Result task_pool_parallel_for(	size_t const i_count,
+											size_t const i_grain,
+											TaskRangeFunction i_function,
+											void * const i_taskData,
+											TaskPool * const io_poolHandle);
+Result task_pool_parallel_for_tiles(	size_t const i_sizeX,
+													size_t const i_sizeY,
+													size_t const i_tileX,
+													size_t const i_tileY,
+													TaskTileFunction i_function,
+													void * const i_taskData,
+													TaskPool * const io_poolHandle);
+Result task_pool_submit(	TaskFunction i_function,
+									void * const i_taskData,
+									TaskGroup * const io_group,
+									TaskPool * const io_poolHandle);
+size_t task_pool_thread_count(TaskPool const * const i_poolHandle);
+
+void task_group_init(TaskGroup * const o_group);
+Result task_group_wait(TaskGroup * const io_group, TaskPool * const io_poolHandle);
+
+/* Stages are added in dependency order; frames are submitted from one thread */
+Result task_graph_create(	size_t const i_inFlightMax,
+									int const i_ordered,
+									TaskGraphCompletion i_completion,
+									void * const i_completionData,
+									TaskGraph ** const o_graphHandle);
+/* Each edge once; R_INPUTBAD for a repeat */
+Result task_graph_dependency_add(	size_t const i_stageBefore,
+												size_t const i_stageAfter,
+												TaskGraph * const io_graphHandle);
+Result task_graph_destroy(TaskGraph ** const io_graphHandle);
+Result task_graph_stage_add(	TaskStageFunction i_function,
+										void * const i_stageData,
+										size_t * const o_stage,
+										TaskGraph * const io_graphHandle);
+Result task_graph_submit(	void * const i_frameData,
+									TaskPool * const io_poolHandle,
+									TaskGraph * const io_graphHandle);
+Result task_graph_wait(TaskPool * const io_poolHandle, TaskGraph * const io_graphHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _TASKPOOL_H_ */
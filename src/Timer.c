@@ -1,22 +1,28 @@
 #include "Timer.h"
 #include "carl.h"
 
+#include <errno.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include <unistd.h>
-#include <sys/types.h>
+#include <time.h>
 
 void timer_sleep(double const i_seconds)
 {
-	int const seconds = (int)floor(i_seconds);
-	if(seconds > 0)
+	struct timespec timeWake;
+	int sleepResult = 0;
+
+	if(!(i_seconds > 0.0))
 	{
-		sleep((int)i_seconds);
+		return;
 	}
 
-	__useconds_t const microseconds = ((i_seconds-((double)seconds))*1000000.0);
-	usleep(microseconds);
+	/***** Absolute deadline so EINTR restarts do not stretch the sleep *****/
+	timestamp_to_timespec(timestamp_read(TIMESTAMP_SOURCE_MONOTONIC) + (Timestamp)(i_seconds*((double)TIMESTAMP_NS_PER_SECOND)), &timeWake);
+	do
+	{
+		sleepResult = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &timeWake, NULL);
+	} while(sleepResult == EINTR);
 }
 
 void timer_start(Timer * const o_timerHandle)
@@ -26,23 +32,20 @@ void timer_start(Timer * const o_timerHandle)
 		return;
 	}
 
-	o_timerHandle->m_timeTotalSeconds = NAN;
-	gettimeofday(&o_timerHandle->m_timeStart, NULL);
+	o_timerHandle->m_timeStop = 0;
+	o_timerHandle->m_running = 1;
+	o_timerHandle->m_timeStart = timestamp_now();
 }
 
 void timer_stop(Timer * const io_timerHandle)
 {
-	double timeTotalMicroseconds = 0.0;
-
 	if(io_timerHandle == NULL)
 	{
 		return;
 	}
 
-	gettimeofday(&io_timerHandle->m_timeStop, NULL);
-	timeTotalMicroseconds = ((double)(io_timerHandle->m_timeStop.tv_sec - io_timerHandle->m_timeStart.tv_sec))*1000000.0;
-	timeTotalMicroseconds +=((double)(io_timerHandle->m_timeStop.tv_usec - io_timerHandle->m_timeStart.tv_usec));
-	io_timerHandle->m_timeTotalSeconds = timeTotalMicroseconds / 1000000.0;
+	io_timerHandle->m_timeStop = timestamp_now();
+	io_timerHandle->m_running = 0;
 }
 
 double timer_total_seconds(Timer const * const i_timerHandle)
@@ -52,18 +55,21 @@ double timer_total_seconds(Timer const * const i_timerHandle)
 		return NAN;
 	}
 
-	if(i_timerHandle->m_timeTotalSeconds == NAN)
-   {
-		struct timeval timeCurrent;
-		double timeTotalMicroseconds = 0.0;
+	return ((double)timer_total_nanoseconds(i_timerHandle)) / ((double)TIMESTAMP_NS_PER_SECOND);
+}
 
-		gettimeofday(&timeCurrent, NULL);
-		timeTotalMicroseconds = ((double)(timeCurrent.tv_sec - i_timerHandle->m_timeStart.tv_sec))*1000000.0;
-		timeTotalMicroseconds +=((double)(timeCurrent.tv_usec - i_timerHandle->m_timeStart.tv_usec));
+Timestamp timer_total_nanoseconds(Timer const * const i_timerHandle)
+{
+	if(i_timerHandle == NULL)
+	{
+		return 0;
+	}
 
-		return (timeTotalMicroseconds / 1000000.0);
-   }
+	/***** Still running, measure up to now *****/
+	if(i_timerHandle->m_running)
+	{
+		return timestamp_now() - i_timerHandle->m_timeStart;
+	}
 
-	return i_timerHandle->m_timeTotalSeconds;
+	return i_timerHandle->m_timeStop - i_timerHandle->m_timeStart;
 }
-
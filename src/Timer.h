@@ -5,14 +5,16 @@
 extern "C" {
 #endif
 
-#include <sys/time.h>
+#include "Timestamp.h"
+
+#include <stdint.h>
 
 /********************----- STRUCT: Timer -----********************/
 struct Timer_s
 {
-   struct timeval m_timeStart;
-   struct timeval m_timeStop;
-   double m_timeTotalSeconds;
+	Timestamp m_timeStart;
+	Timestamp m_timeStop;
+	int m_running;
 };
 typedef struct Timer_s Timer;
 /**************************************************/
@@ -22,6 +24,7 @@ void timer_sleep(double const i_seconds);
 void timer_start(Timer * const o_timerHandle);
 void timer_stop(Timer * const io_timerHandle);
 double timer_total_seconds(Timer const * const i_timerHandle);
+Timestamp timer_total_nanoseconds(Timer const * const i_timerHandle);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,343 @@
+#include "Timestamp.h"
+
+#include <sys/time.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIMESTAMP_HAVE_TSC 1
+#endif
+
+static uint64_t const TSC_CALIBRATION_NS = 20000000;
+static uint64_t const TSC_ANCHOR_NS = 1000000000;
+
+/********************----- STRUCT: TscCalibration -----********************/
+/* Two segments: ns = base + ((tsc - tscBase) * multiplier) >> 32 until the switch, then the same from the switch point */
+struct TscCalibration_s
+{
+	uint64_t m_tscBase;
+	Timestamp m_timestampBase;
+	uint64_t m_multiplier;
+	uint64_t m_tscSwitch;
+	Timestamp m_timestampSwitch;
+	uint64_t m_multiplierSwitch;
+};
+typedef struct TscCalibration_s TscCalibration;
+/**************************************************/
+
+/********************----- Global Variables -----********************/
+#ifdef TIMESTAMP_HAVE_TSC
+/* Two copies: readers use the one g_tscSequence points at while the thread holding g_tscAnchoring rewrites the other */
+static TscCalibration g_tscCalibration[2];
+static uint64_t g_tscSequence = 0;
+static int g_tscAnchoring = 0;
+static uint64_t g_tscAnchorTicks = 0;
+static uint64_t g_tscOrigin = 0;
+static Timestamp g_timestampOrigin = 0;
+static int g_tscCalibrated = 0;
+static Result g_tscCalibrateResult = R_FAILURE;
+static pthread_once_t g_tscCalibrateOnce = PTHREAD_ONCE_INIT;
+#endif
+static TimestampSource g_timestampSource = TIMESTAMP_SOURCE_MONOTONIC;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+static inline Timestamp timestamp_read_clock(clockid_t const i_clock)
+{
+	struct timespec timeCurrent;
+
+	clock_gettime(i_clock, &timeCurrent);
+	return timestamp_from_timespec(&timeCurrent);
+}
+
+#ifdef TIMESTAMP_HAVE_TSC
+__extension__ typedef unsigned __int128 uint128_t;
+
+static inline uint64_t timestamp_read_tsc(void)
+{
+	unsigned int processorID = 0;
+
+	return __rdtscp(&processorID);
+}
+
+static inline void timestamp_tsc_load(TscCalibration * const o_calibration)
+{
+	TscCalibration const *calibration = NULL;
+	uint64_t sequence = 0;
+
+	do
+	{
+		sequence = __atomic_load_n(&g_tscSequence, __ATOMIC_ACQUIRE);
+		calibration = &g_tscCalibration[sequence & 1];
+		o_calibration->m_tscBase = __atomic_load_n(&calibration->m_tscBase, __ATOMIC_RELAXED);
+		o_calibration->m_timestampBase = __atomic_load_n(&calibration->m_timestampBase, __ATOMIC_RELAXED);
+		o_calibration->m_multiplier = __atomic_load_n(&calibration->m_multiplier, __ATOMIC_RELAXED);
+		o_calibration->m_tscSwitch = __atomic_load_n(&calibration->m_tscSwitch, __ATOMIC_RELAXED);
+		o_calibration->m_timestampSwitch = __atomic_load_n(&calibration->m_timestampSwitch, __ATOMIC_RELAXED);
+		o_calibration->m_multiplierSwitch = __atomic_load_n(&calibration->m_multiplierSwitch, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while(__atomic_load_n(&g_tscSequence, __ATOMIC_RELAXED) != sequence);
+}
+
+/* Writes the copy readers are not using, then points them at it; a writer stalled mid-store never blocks a reader */
+static void timestamp_tsc_store(TscCalibration const * const i_calibration)
+{
+	uint64_t const sequence = __atomic_load_n(&g_tscSequence, __ATOMIC_RELAXED);
+	TscCalibration * const calibration = &g_tscCalibration[(sequence + 1) & 1];
+
+	__atomic_store_n(&calibration->m_tscBase, i_calibration->m_tscBase, __ATOMIC_RELAXED);
+	__atomic_store_n(&calibration->m_timestampBase, i_calibration->m_timestampBase, __ATOMIC_RELAXED);
+	__atomic_store_n(&calibration->m_multiplier, i_calibration->m_multiplier, __ATOMIC_RELAXED);
+	__atomic_store_n(&calibration->m_tscSwitch, i_calibration->m_tscSwitch, __ATOMIC_RELAXED);
+	__atomic_store_n(&calibration->m_timestampSwitch, i_calibration->m_timestampSwitch, __ATOMIC_RELAXED);
+	__atomic_store_n(&calibration->m_multiplierSwitch, i_calibration->m_multiplierSwitch, __ATOMIC_RELAXED);
+	__atomic_store_n(&g_tscSequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+static inline Timestamp timestamp_tsc_convert(uint64_t const i_tsc, TscCalibration const * const i_calibration)
+{
+	if(i_tsc >= i_calibration->m_tscSwitch)
+	{
+		return i_calibration->m_timestampSwitch + (Timestamp)(((uint128_t)(i_tsc - i_calibration->m_tscSwitch) * i_calibration->m_multiplierSwitch) >> 32);
+	}
+	if(i_tsc < i_calibration->m_tscBase)
+	{
+		return i_calibration->m_timestampBase - (Timestamp)(((uint128_t)(i_calibration->m_tscBase - i_tsc) * i_calibration->m_multiplier) >> 32);
+	}
+
+	return i_calibration->m_timestampBase + (Timestamp)(((uint128_t)(i_tsc - i_calibration->m_tscBase) * i_calibration->m_multiplier) >> 32);
+}
+
+/* TSC and CLOCK_MONOTONIC read as close together as possible: the TSC is taken either side and averaged */
+static void timestamp_tsc_pair(uint64_t * const o_tsc, Timestamp * const o_timestamp)
+{
+	uint64_t const tscBefore = timestamp_read_tsc();
+
+	(*o_timestamp) = timestamp_read_clock(CLOCK_MONOTONIC);
+	(*o_tsc) = tscBefore + (timestamp_read_tsc() - tscBefore)/2;
+}
+
+/*
+ * Slews rather than steps. The new rate only takes over at a switch point half a period ahead, and both copies agree on
+ * every TSC before it, so a reader holding either copy gets the same answer and the clock never goes back.
+ */
+static void timestamp_tsc_anchor(void)
+{
+	TscCalibration calibration;
+	TscCalibration anchored;
+	uint64_t const leadTicks = g_tscAnchorTicks/2;
+	uint64_t tsc = 0;
+	Timestamp timestamp = 0;
+	uint64_t rateMultiplier = 0;
+	uint64_t horizonTicks = 0;
+	Timestamp nominal = 0;
+	Timestamp target = 0;
+	int64_t span = 0;
+	int expected = 0;
+
+	if(!__atomic_compare_exchange_n(&g_tscAnchoring, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		return;
+	}
+
+	timestamp_tsc_load(&calibration);
+	timestamp_tsc_pair(&tsc, &timestamp);
+	if(tsc < calibration.m_tscSwitch || tsc - calibration.m_tscSwitch < g_tscAnchorTicks || tsc <= g_tscOrigin || timestamp <= g_timestampOrigin)
+	{
+		__atomic_store_n(&g_tscAnchoring, 0, __ATOMIC_RELEASE);
+		return;
+	}
+
+	/***** Rate over everything since calibration; the error is spread over twice the time since the last switch, which keeps the slew from overshooting when reads are sparse *****/
+	rateMultiplier = (uint64_t)((((uint128_t)(timestamp - g_timestampOrigin)) << 32) / (tsc - g_tscOrigin));
+	horizonTicks = 2*MAX(g_tscAnchorTicks, tsc - calibration.m_tscSwitch);
+	anchored.m_tscBase = calibration.m_tscSwitch;
+	anchored.m_timestampBase = calibration.m_timestampSwitch;
+	anchored.m_multiplier = calibration.m_multiplierSwitch;
+	anchored.m_tscSwitch = tsc + leadTicks;
+	anchored.m_timestampSwitch = timestamp_tsc_convert(anchored.m_tscSwitch, &calibration);
+	nominal = (Timestamp)(((uint128_t)horizonTicks * rateMultiplier) >> 32);
+	target = timestamp + (Timestamp)(((uint128_t)(leadTicks + horizonTicks) * rateMultiplier) >> 32);
+	span = (int64_t)(target - anchored.m_timestampSwitch);
+	span = MAX(span, (int64_t)nominal - (int64_t)TSC_ANCHOR_NS/2);
+	span = MIN(span, (int64_t)nominal + (int64_t)TSC_ANCHOR_NS/2);
+	anchored.m_multiplierSwitch = (uint64_t)((((uint128_t)span) << 32) / horizonTicks);
+
+	/***** Readers may already be past a switch point this late, so leave it to the next read *****/
+	if(timestamp_read_tsc() < anchored.m_tscSwitch - leadTicks/2)
+	{
+		timestamp_tsc_store(&anchored);
+	}
+
+	__atomic_store_n(&g_tscAnchoring, 0, __ATOMIC_RELEASE);
+}
+
+static inline Timestamp timestamp_tsc_to_ns(uint64_t const i_tsc)
+{
+	TscCalibration calibration;
+
+	timestamp_tsc_load(&calibration);
+	if(i_tsc >= calibration.m_tscSwitch && i_tsc - calibration.m_tscSwitch >= g_tscAnchorTicks)
+	{
+		timestamp_tsc_anchor();
+	}
+
+	return timestamp_tsc_convert(i_tsc, &calibration);
+}
+
+static void timestamp_tsc_calibrate(void)
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	uint64_t tscStart = 0, tscStop = 0;
+	Timestamp timeStart = 0, timeStop = 0;
+	struct timespec timeSleep;
+	TscCalibration calibration;
+
+	/***** Require an invariant TSC *****/
+	if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+	{
+		CARL_ERROR("Processor does not provide an invariant TSC.");
+		g_tscCalibrateResult = R_CLOCKUNAVAILABLE;
+		return;
+	}
+
+	/***** Measure TSC rate against CLOCK_MONOTONIC *****/
+	timestamp_tsc_pair(&tscStart, &timeStart);
+	timestamp_to_timespec(TSC_CALIBRATION_NS, &timeSleep);
+	while(nanosleep(&timeSleep, &timeSleep) == -1 && errno == EINTR)
+	{
+	}
+	timestamp_tsc_pair(&tscStop, &timeStop);
+	if(tscStop <= tscStart || timeStop <= timeStart)
+	{
+		CARL_ERROR("TSC calibration failed.");
+		g_tscCalibrateResult = R_CLOCKUNAVAILABLE;
+		return;
+	}
+
+	/***** First anchor; later ones refine the rate over a growing baseline *****/
+	calibration.m_multiplier = (uint64_t)((((uint128_t)(timeStop - timeStart)) << 32) / (tscStop - tscStart));
+	calibration.m_tscBase = tscStop;
+	calibration.m_timestampBase = timeStop;
+	calibration.m_tscSwitch = tscStop;
+	calibration.m_timestampSwitch = timeStop;
+	calibration.m_multiplierSwitch = calibration.m_multiplier;
+	g_tscAnchorTicks = (uint64_t)((((uint128_t)TSC_ANCHOR_NS) << 32) / calibration.m_multiplier);
+	g_tscOrigin = tscStart;
+	g_timestampOrigin = timeStart;
+	timestamp_tsc_store(&calibration);
+
+	g_tscCalibrateResult = R_SUCCESS;
+	__atomic_store_n(&g_tscCalibrated, 1, __ATOMIC_RELEASE);
+}
+#endif
+/**************************************************/
+
+Timestamp timestamp_now(void)
+{
+	switch(__atomic_load_n(&g_timestampSource, __ATOMIC_ACQUIRE))
+	{
+#ifdef TIMESTAMP_HAVE_TSC
+		case TIMESTAMP_SOURCE_TSC:
+			return timestamp_tsc_to_ns(timestamp_read_tsc());
+#endif
+		case TIMESTAMP_SOURCE_MONOTONIC_COARSE:
+			return timestamp_read_clock(CLOCK_MONOTONIC_COARSE);
+		case TIMESTAMP_SOURCE_MONOTONIC:
+		default:
+			return timestamp_read_clock(CLOCK_MONOTONIC);
+	}
+}
+
+Timestamp timestamp_read(TimestampSource const i_source)
+{
+	switch(i_source)
+	{
+#ifdef TIMESTAMP_HAVE_TSC
+		case TIMESTAMP_SOURCE_TSC:
+			if(__atomic_load_n(&g_tscCalibrated, __ATOMIC_ACQUIRE))
+			{
+				return timestamp_tsc_to_ns(timestamp_read_tsc());
+			}
+			return timestamp_read_clock(CLOCK_MONOTONIC);
+#endif
+		case TIMESTAMP_SOURCE_MONOTONIC_COARSE:
+			return timestamp_read_clock(CLOCK_MONOTONIC_COARSE);
+		case TIMESTAMP_SOURCE_MONOTONIC:
+		default:
+			return timestamp_read_clock(CLOCK_MONOTONIC);
+	}
+}
+
+Timestamp timestamp_from_timespec(struct timespec const * const i_time)
+{
+	if(i_time == NULL)
+	{
+		return 0;
+	}
+
+	return ((Timestamp)i_time->tv_sec)*TIMESTAMP_NS_PER_SECOND + (Timestamp)i_time->tv_nsec;
+}
+
+Timestamp timestamp_from_timeval(struct timeval const * const i_time)
+{
+	if(i_time == NULL)
+	{
+		return 0;
+	}
+
+	return ((Timestamp)i_time->tv_sec)*TIMESTAMP_NS_PER_SECOND + ((Timestamp)i_time->tv_usec)*TIMESTAMP_NS_PER_US;
+}
+
+void timestamp_to_timespec(Timestamp const i_timestamp, struct timespec * const o_time)
+{
+	if(o_time == NULL)
+	{
+		return;
+	}
+
+	o_time->tv_sec = (time_t)(i_timestamp / TIMESTAMP_NS_PER_SECOND);
+	o_time->tv_nsec = (long)(i_timestamp % TIMESTAMP_NS_PER_SECOND);
+}
+
+TimestampSource timestamp_source_get(void)
+{
+	return __atomic_load_n(&g_timestampSource, __ATOMIC_ACQUIRE);
+}
+
+Result timestamp_source_set(TimestampSource const i_source)
+{
+	Result result = R_FAILURE;
+
+	switch(i_source)
+	{
+		case TIMESTAMP_SOURCE_MONOTONIC:
+		case TIMESTAMP_SOURCE_MONOTONIC_COARSE:
+			break;
+		case TIMESTAMP_SOURCE_TSC:
+#ifdef TIMESTAMP_HAVE_TSC
+			/***** Calibrate once, whichever thread gets here first, before anyone reads it *****/
+			pthread_once(&g_tscCalibrateOnce, timestamp_tsc_calibrate);
+			result = g_tscCalibrateResult;
+			if(result != R_SUCCESS)
+			{
+				return result;
+			}
+			break;
+#else
+			CARL_ERROR("TSC not available on this architecture.");
+			return R_CLOCKUNAVAILABLE;
+#endif
+		default:
+			CARL_ERROR("Invalid timestamp source (%d).", i_source);
+			return R_INPUTBAD;
+	}
+
+	__atomic_store_n(&g_timestampSource, i_source, __ATOMIC_RELEASE);
+	return R_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#ifndef _TIMESTAMP_H_
+#define _TIMESTAMP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stdint.h>
+
+struct timespec;
+struct timeval;
+
+/********************----- TYPE: Timestamp -----********************/
+/* Nanoseconds on the CLOCK_MONOTONIC time base, whatever the source */
+typedef uint64_t Timestamp;
+
+#define TIMESTAMP_NS_PER_US ((Timestamp)1000)
+#define TIMESTAMP_NS_PER_MS ((Timestamp)1000000)
+#define TIMESTAMP_NS_PER_SECOND ((Timestamp)1000000000)
+/**************************************************/
+
+/********************----- ENUM: TimestampSource -----********************/
+enum TimestampSource_e
+{
+	TIMESTAMP_SOURCE_MONOTONIC,
+	TIMESTAMP_SOURCE_MONOTONIC_COARSE,
+	/* Re-anchored to CLOCK_MONOTONIC every second, slewing so it never steps back */
+	TIMESTAMP_SOURCE_TSC
+};
+typedef enum TimestampSource_e TimestampSource;
+/**************************************************/
+
+Timestamp timestamp_now(void);
+Timestamp timestamp_read(TimestampSource const i_source);
+Timestamp timestamp_from_timespec(struct timespec const * const i_time);
+Timestamp timestamp_from_timeval(struct timeval const * const i_time);
+void timestamp_to_timespec(Timestamp const i_timestamp, struct timespec * const o_time);
+TimestampSource timestamp_source_get(void);
+Result timestamp_source_set(TimestampSource const i_source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _TIMESTAMP_H_ */
@@ -0,0 +1,328 @@
+#include "Trace.h"
+#include "Memory.h"
+#include "Timestamp.h"
+
+#include <sys/syscall.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_BUFFER_EVENT_COUNT ((uint64_t)1 << 16)
+#define TRACE_THREAD_NAME_LENGTH 32
+
+/********************----- STRUCT: TraceRecord -----********************/
+struct TraceRecord_s
+{
+	Timestamp m_timestamp;
+	char const *m_name;
+	TraceEventType m_type;
+};
+typedef struct TraceRecord_s TraceRecord;
+/**************************************************/
+
+/********************----- STRUCT: TraceBuffer -----********************/
+/* Single producer ring; the owning thread is the only writer, and once it exits the buffer is retired for reuse */
+struct TraceBuffer_s
+{
+	uint64_t m_head;
+	uint64_t m_tail;
+	int m_retired;
+	long m_threadID;
+	char m_threadName[TRACE_THREAD_NAME_LENGTH];
+	struct TraceBuffer_s *m_next;
+	TraceRecord m_records[TRACE_BUFFER_EVENT_COUNT];
+};
+typedef struct TraceBuffer_s TraceBuffer;
+/**************************************************/
+
+/********************----- STRUCT: TraceThread -----********************/
+/* What trace_flush copies out of one buffer under the lock, so the file is written without holding it */
+struct TraceThread_s
+{
+	long m_threadID;
+	char m_threadName[TRACE_THREAD_NAME_LENGTH];
+	uint64_t m_begin;
+	uint64_t m_head;
+	size_t m_recordCount;
+};
+typedef struct TraceThread_s TraceThread;
+/**************************************************/
+
+/********************----- Global Variables -----********************/
+static TraceBuffer *g_traceBuffers = NULL;
+static pthread_mutex_t g_traceBuffersLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_traceKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t g_traceKey;
+static __thread TraceBuffer *t_traceBuffer = NULL;
+/**************************************************/
+
+/********************----- Internal Functions -----********************/
+/* Thread exit; the events stay until flushed, then the buffer goes to the next new thread */
+static void trace_buffer_retire(void * const i_traceBuffer)
+{
+	TraceBuffer * const traceBuffer = (TraceBuffer *)i_traceBuffer;
+
+	pthread_mutex_lock(&g_traceBuffersLock);
+	traceBuffer->m_retired = 1;
+	pthread_mutex_unlock(&g_traceBuffersLock);
+}
+
+static void trace_key_create(void)
+{
+	pthread_key_create(&g_traceKey, trace_buffer_retire);
+}
+
+static TraceBuffer *trace_buffer_get(void)
+{
+	TraceBuffer *traceBuffer = t_traceBuffer;
+	MemoryRegion region;
+
+	if(traceBuffer != NULL)
+	{
+		return traceBuffer;
+	}
+	pthread_once(&g_traceKeyOnce, trace_key_create);
+
+	/***** First event on this thread; a retired buffer whose events were all flushed is reused *****/
+	pthread_mutex_lock(&g_traceBuffersLock);
+	for(traceBuffer=g_traceBuffers; traceBuffer!=NULL; traceBuffer=traceBuffer->m_next)
+	{
+		if(traceBuffer->m_retired && traceBuffer->m_tail == traceBuffer->m_head)
+		{
+			break;
+		}
+	}
+	if(traceBuffer == NULL)
+	{
+		/***** Prefaulted so later events never page fault *****/
+		if(memory_region_map(sizeof(TraceBuffer), MEMORY_FLAG_HUGEPAGE | MEMORY_FLAG_PREFAULT, &region) != R_SUCCESS)
+		{
+			pthread_mutex_unlock(&g_traceBuffersLock);
+			return NULL;
+		}
+		traceBuffer = (TraceBuffer *)region.m_memory;
+		traceBuffer->m_next = g_traceBuffers;
+		g_traceBuffers = traceBuffer;
+	}
+	traceBuffer->m_head = 0;
+	traceBuffer->m_tail = 0;
+	traceBuffer->m_retired = 0;
+	traceBuffer->m_threadID = (long)syscall(SYS_gettid);
+	traceBuffer->m_threadName[0] = '\0';
+	pthread_mutex_unlock(&g_traceBuffersLock);
+
+	pthread_setspecific(g_traceKey, traceBuffer);
+	t_traceBuffer = traceBuffer;
+	return traceBuffer;
+}
+
+static void trace_print_string(FILE * const i_fileHandle, char const * i_string)
+{
+	fputc('"', i_fileHandle);
+	for(; *i_string != '\0'; ++i_string)
+	{
+		if(*i_string == '"' || *i_string == '\\')
+		{
+			fputc('\\', i_fileHandle);
+		}
+		if((unsigned char)*i_string >= 0x20)
+		{
+			fputc(*i_string, i_fileHandle);
+		}
+	}
+	fputc('"', i_fileHandle);
+}
+/**************************************************/
+
+void trace_event(TraceEventType const i_type, char const * const i_name)
+{
+	TraceBuffer * const traceBuffer = trace_buffer_get();
+	TraceRecord *record = NULL;
+	uint64_t head = 0;
+
+	if(traceBuffer == NULL)
+	{
+		return;
+	}
+
+	head = traceBuffer->m_head;
+	record = &traceBuffer->m_records[head & (TRACE_BUFFER_EVENT_COUNT-1)];
+	record->m_timestamp = timestamp_now();
+	record->m_name = i_name;
+	record->m_type = i_type;
+	__atomic_store_n(&traceBuffer->m_head, head+1, __ATOMIC_RELEASE);
+
+	/***** The next event's record writes must not become visible before this head, or a flush could miss the lap *****/
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+Result trace_flush(char const * const i_pathname)
+{
+	static char const * const sc_phases[] = {"B", "E", "i"};
+	FILE *fileHandle = NULL;
+	int first = 1;
+	uint64_t headAfter = 0;
+	uint64_t index = 0;
+	long const processID = (long)getpid();
+	TraceRecord record;
+	TraceBuffer *traceBuffer = NULL;
+	TraceThread *threads = NULL;
+	TraceThread *thread = NULL;
+	TraceRecord *records = NULL;
+	TraceRecord *recordCopy = NULL;
+	size_t threadCount = 0;
+	size_t recordCount = 0;
+	size_t threadIndex = 0;
+	size_t recordIndex = 0;
+	Result result = R_SUCCESS;
+
+	if(i_pathname == NULL)
+	{
+		CARL_ERROR("No trace file given.");
+		return R_INPUTBAD;
+	}
+
+	fileHandle = fopen(i_pathname, "w");
+	if(fileHandle == NULL)
+	{
+		CARL_ERRORNO("Unable to open trace file \"%s\".", i_pathname);
+		return R_DEVICEOPENFAILED;
+	}
+
+	/***** Copy out under the lock; the file is written once it is released *****/
+	pthread_mutex_lock(&g_traceBuffersLock);
+	for(traceBuffer=g_traceBuffers; traceBuffer!=NULL; traceBuffer=traceBuffer->m_next)
+	{
+		++threadCount;
+	}
+	threads = (TraceThread *)calloc(MAX(threadCount, 1), sizeof(TraceThread));
+	if(threads == NULL)
+	{
+		pthread_mutex_unlock(&g_traceBuffersLock);
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+
+	/***** Events written since the last flush that are still in the ring *****/
+	for(traceBuffer=g_traceBuffers, thread=threads; traceBuffer!=NULL; traceBuffer=traceBuffer->m_next, ++thread)
+	{
+		thread->m_threadID = traceBuffer->m_threadID;
+		memcpy(thread->m_threadName, traceBuffer->m_threadName, sizeof(thread->m_threadName));
+		thread->m_threadName[sizeof(thread->m_threadName)-1] = '\0';
+		thread->m_head = __atomic_load_n(&traceBuffer->m_head, __ATOMIC_ACQUIRE);
+		thread->m_begin = MAX(traceBuffer->m_tail, (thread->m_head > TRACE_BUFFER_EVENT_COUNT) ? thread->m_head-TRACE_BUFFER_EVENT_COUNT : 0);
+		recordCount += (size_t)(thread->m_head - thread->m_begin);
+	}
+	records = (TraceRecord *)malloc(MAX(recordCount, 1)*sizeof(TraceRecord));
+	if(records == NULL)
+	{
+		pthread_mutex_unlock(&g_traceBuffersLock);
+		CARL_ERROR("Unable to allocate memory.");
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+
+	recordCopy = records;
+	for(traceBuffer=g_traceBuffers, thread=threads; traceBuffer!=NULL; traceBuffer=traceBuffer->m_next, ++thread)
+	{
+		for(index=thread->m_begin; index<thread->m_head; ++index)
+		{
+			record = traceBuffer->m_records[index & (TRACE_BUFFER_EVENT_COUNT-1)];
+
+			/***** Skip slots the writer lapped while we copied; at head == index + count it is already rewriting this one *****/
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			headAfter = __atomic_load_n(&traceBuffer->m_head, __ATOMIC_ACQUIRE);
+			if(headAfter - index >= TRACE_BUFFER_EVENT_COUNT || record.m_name == NULL)
+			{
+				continue;
+			}
+
+			(*recordCopy++) = record;
+			++thread->m_recordCount;
+		}
+		traceBuffer->m_tail = thread->m_head;
+	}
+	pthread_mutex_unlock(&g_traceBuffersLock);
+
+	/***** Write *****/
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", fileHandle);
+	recordCopy = records;
+	for(threadIndex=0; threadIndex<threadCount; ++threadIndex)
+	{
+		thread = &threads[threadIndex];
+
+		/***** Thread metadata *****/
+		if(thread->m_threadName[0] != '\0')
+		{
+			fprintf(fileHandle, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":", first ? "" : ",", processID, thread->m_threadID);
+			trace_print_string(fileHandle, thread->m_threadName);
+			fputs("}}", fileHandle);
+			first = 0;
+		}
+
+		for(recordIndex=0; recordIndex<thread->m_recordCount; ++recordIndex, ++recordCopy)
+		{
+			fprintf(fileHandle, "%s\n{\"name\":", first ? "" : ",");
+			trace_print_string(fileHandle, recordCopy->m_name);
+			fprintf(fileHandle, ",\"ph\":\"%s\",\"ts\":%llu.%03llu,\"pid\":%ld,\"tid\":%ld%s}",
+				sc_phases[recordCopy->m_type],
+				(unsigned long long)(recordCopy->m_timestamp/TIMESTAMP_NS_PER_US),
+				(unsigned long long)(recordCopy->m_timestamp%TIMESTAMP_NS_PER_US),
+				processID,
+				thread->m_threadID,
+				(recordCopy->m_type == TRACE_EVENT_INSTANT) ? ",\"s\":\"t\"" : "");
+			first = 0;
+		}
+	}
+	fputs("\n]}\n", fileHandle);
+
+end:
+	free(records);
+	free(threads);
+	if(fclose(fileHandle) != 0 && result == R_SUCCESS)
+	{
+		CARL_ERRORNO("Unable to write trace file \"%s\".", i_pathname);
+		result = R_DEVICEWRITEFAILED;
+	}
+
+	return result;
+}
+
+Result trace_thread_name(char const * const i_name)
+{
+	TraceBuffer * const traceBuffer = trace_buffer_get();
+
+	if(traceBuffer == NULL)
+	{
+		CARL_ERROR("Unable to allocate trace buffer.");
+		return R_MEMORYALLOCATIONERROR;
+	}
+
+	if(i_name == NULL)
+	{
+		traceBuffer->m_threadName[0] = '\0';
+		return R_SUCCESS;
+	}
+
+	strncpy(traceBuffer->m_threadName, i_name, sizeof(traceBuffer->m_threadName)-1);
+	traceBuffer->m_threadName[sizeof(traceBuffer->m_threadName)-1] = '\0';
+
+	return R_SUCCESS;
+}
+
+char const *trace_scope_begin(char const * const i_name)
+{
+	trace_event(TRACE_EVENT_BEGIN, i_name);
+	return i_name;
+}
+
+void trace_scope_end(char const * const * const i_name)
+{
+	trace_event(TRACE_EVENT_END, *i_name);
+}
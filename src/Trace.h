@@ -0,0 +1,49 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "carl.h"
+
+#include <stdint.h>
+
+/********************----- ENUM: TraceEventType -----********************/
+enum TraceEventType_e
+{
+	TRACE_EVENT_BEGIN,
+	TRACE_EVENT_END,
+	TRACE_EVENT_INSTANT
+};
+typedef enum TraceEventType_e TraceEventType;
+/**************************************************/
+
+/* Names must be string literals (or otherwise outlive the trace) */
+void trace_event(TraceEventType const i_type, char const * const i_name);
+Result trace_flush(char const * const i_pathname);
+Result trace_thread_name(char const * const i_name);
+char const *trace_scope_begin(char const * const i_name);
+void trace_scope_end(char const * const * const i_name);
+
+/********************----- Tracing Macros -----********************/
+#ifdef CARL_TRACE
+#define CARL_TRACE_CONCAT_(a,b) a##b
+#define CARL_TRACE_CONCAT(a,b) CARL_TRACE_CONCAT_(a,b)
+#define CARL_TRACE_BEGIN(name) trace_event(TRACE_EVENT_BEGIN, (name))
+#define CARL_TRACE_END(name) trace_event(TRACE_EVENT_END, (name))
+#define CARL_TRACE_INSTANT(name) trace_event(TRACE_EVENT_INSTANT, (name))
+#define CARL_TRACE_SCOPE(name) char const * const CARL_TRACE_CONCAT(carl_trace_scope_, __LINE__) __attribute__((cleanup(trace_scope_end))) = trace_scope_begin(name)
+#else
+#define CARL_TRACE_BEGIN(name) ((void)0)
+#define CARL_TRACE_END(name) ((void)0)
+#define CARL_TRACE_INSTANT(name) ((void)0)
+#define CARL_TRACE_SCOPE(name) ((void)0)
+#endif
+/**************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _TRACE_H_ */
@@ -1,174 +1,1123 @@
 #include "carl.h"
+#include "BinaryLog.h"
+#include "Memory.h"
+#include "Timestamp.h"
+#include "Trace.h"
 
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#define LOG_MESSAGE_LENGTH 256
+#define LOG_LINE_LENGTH 512
+#define LOG_BATCH_BYTES 65536
+#define LOG_TIME_PREFIX_LENGTH 32
+#define LOG_BATCH_BINARY 2
+#define BINARYLOG_FORMAT_COUNT 4096
+
+static struct timespec const LOG_IDLE_WAIT = {0, 100000000};
+static Timestamp const LOG_SITE_WINDOW = 1000000000;
+
+/********************----- STRUCT: LogRecord -----********************/
+struct LogRecord_s
+{
+	uint64_t m_sequence;
+	time_t m_time;
+	char const *m_functionName;
+	int m_errorNumber;
+	LogStream m_stream;
+	size_t m_binarySizeBytes;
+	char m_message[LOG_MESSAGE_LENGTH];
+};
+typedef struct LogRecord_s LogRecord;
+/**************************************************/
+
+/********************----- STRUCT: LogTimePrefix -----********************/
+struct LogTimePrefix_s
+{
+	time_t m_time;
+	char m_text[LOG_TIME_PREFIX_LENGTH];
+};
+typedef struct LogTimePrefix_s LogTimePrefix;
+/**************************************************/
+
+/********************----- STRUCT: LogBatch -----********************/
+struct LogBatch_s
+{
+	FILE *m_fileHandle;
+	size_t m_sizeBytes;
+	char m_data[LOG_BATCH_BYTES];
+};
+typedef struct LogBatch_s LogBatch;
+/**************************************************/
+
+/********************----- STRUCT: Logger -----********************/
+/* Bounded MPSC ring (per-slot sequence numbers) drained by one thread */
+struct Logger_s
+{
+	MemoryRegion m_recordRegion;
+	LogRecord *m_records;
+	size_t m_recordMask;
+	uint64_t m_enqueuePosition;
+	uint64_t m_dequeuePosition;
+	uint64_t m_dropped;
+	LogOverflow m_overflowPolicy;
+	int m_running;
+	int m_consumerWaiting;
+	pthread_t m_thread;
+	pthread_mutex_t m_wakeLock;
+	pthread_cond_t m_wake;
+	LogBatch m_batches[3];
+};
+typedef struct Logger_s Logger;
+/**************************************************/
+
+/********************----- STRUCT: BinaryFormat -----********************/
+/* Keyed by the (function, format) literal pair of a call site */
+struct BinaryFormat_s
+{
+	char const *m_functionName;
+	char const *m_format;
+	uint32_t m_id;
+	uint8_t m_argumentCount;
+	char m_argumentTypes[BINARYLOG_ARGUMENTS_MAX];
+	int m_ready;
+};
+typedef struct BinaryFormat_s BinaryFormat;
+/**************************************************/
+
+/********************----- STRUCT: ProgramName -----********************/
+/* Replaced names stay allocated until exit; the logger thread may still be formatting a line with one */
+struct ProgramName_s
+{
+	struct ProgramName_s *m_previous;
+	char m_name[];
+};
+typedef struct ProgramName_s ProgramName;
+/**************************************************/
+
 /********************----- Global Variables -----********************/
 uint64_t const g_nanU64 = 0x7ff0000000000000;
 
 char * g_programName = "carl";
-int g_programNameAllocated = 0;
+static ProgramName *g_programNames = NULL;
+
+LogLevel g_logLevel = LOG_LEVEL_INFO;
+static uint32_t g_logRateLimit = 20;
+
+static Logger *g_logger = NULL;
+/* carl_log() calls in flight per epoch; stopping flips the epoch and waits out the old one so nothing touches a retired ring */
+static uint32_t g_logEpoch = 0;
+static uint64_t g_logProducers[2] = {0, 0};
+static int g_loggerExitRegistered = 0;
+static FILE *g_binaryLogFile = NULL;
+static int g_binaryLogEnabled = 0;
+static BinaryFormat g_binaryFormats[BINARYLOG_FORMAT_COUNT];
+static uint32_t g_binaryFormatCount = 0;
+static pthread_mutex_t g_binaryFormatsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread LogTimePrefix t_logTimePrefix = {(time_t)-1, ""};
 /**************************************************/
 
 /********************----- Internal Functions -----********************/
 static void carl_free_program_name(void)
 {
-	if(!g_programNameAllocated || g_programName == NULL)
+	ProgramName *programName = g_programNames;
+
+	/***** Nothing may still be formatting with a name once they are freed *****/
+	carl_log_stop();
+	__atomic_store_n(&g_programName, NULL, __ATOMIC_RELEASE);
+	while(programName != NULL)
+	{
+		ProgramName * const previous = programName->m_previous;
+
+		free(programName);
+		programName = previous;
+	}
+	g_programNames = NULL;
+}
+
+static char const *carl_time_prefix(time_t const i_time, LogTimePrefix * const io_prefix)
+{
+	static char const * const sc_strEmpty="[\?\?\?\?-\?\?-\?\? \?\?:\?\?:\?\?] ";
+	struct tm timeLocal;
+
+	/***** Reformat at most once per second *****/
+	if(i_time == io_prefix->m_time)
+	{
+		return io_prefix->m_text;
+	}
+
+	if(localtime_r(&i_time, &timeLocal) == NULL || strftime(io_prefix->m_text, sizeof(io_prefix->m_text), "%Y-%m-%d %H:%M:%S ", &timeLocal) == 0)
 	{
+		return sc_strEmpty;
+	}
+	io_prefix->m_time = i_time;
+
+	return io_prefix->m_text;
+}
+
+static time_t carl_time_now(void)
+{
+	struct timespec timeCurrent;
+
+	clock_gettime(CLOCK_REALTIME_COARSE, &timeCurrent);
+	return timeCurrent.tv_sec;
+}
+
+static FILE *carl_stream_file(LogStream const i_stream)
+{
+	return (i_stream == LOG_STREAM_STDOUT) ? stdout : stderr;
+}
+
+static size_t carl_format_line(	LogRecord const * const i_record,
+											LogTimePrefix * const io_prefix,
+											char * const o_line)
+{
+	char const * const programName = __atomic_load_n(&g_programName, __ATOMIC_ACQUIRE);
+	int printResult = 0;
+
+	printResult = snprintf(o_line, LOG_LINE_LENGTH, "%s%s%s%s%s%s%s%s%s",
+		(programName != NULL) ? programName : "",
+		(programName != NULL) ? ": " : "",
+		carl_time_prefix(i_record->m_time, io_prefix),
+		(i_record->m_functionName != NULL) ? i_record->m_functionName : "",
+		(i_record->m_functionName != NULL) ? " - " : "",
+		i_record->m_message,
+		(i_record->m_errorNumber >= 0) ? " - \"" : "",
+		(i_record->m_errorNumber >= 0) ? strerror(i_record->m_errorNumber) : "",
+		(i_record->m_errorNumber >= 0) ? "\"\n" : "\n");
+	if(printResult < 0)
+	{
+		return 0;
+	}
+	if(printResult >= LOG_LINE_LENGTH)
+	{
+		o_line[LOG_LINE_LENGTH-2] = '\n';
+		return LOG_LINE_LENGTH-1;
+	}
+
+	return (size_t)printResult;
+}
+
+static void carl_write_synchronous(LogRecord const * const i_record)
+{
+	FILE *binaryLogFile = NULL;
+
+	/***** Lock keeps carl_log_binary_stop() from closing underneath us *****/
+	if(i_record->m_binarySizeBytes > 0)
+	{
+		pthread_mutex_lock(&g_binaryFormatsLock);
+		binaryLogFile = __atomic_load_n(&g_binaryLogFile, __ATOMIC_ACQUIRE);
+		if(binaryLogFile != NULL)
+		{
+			fwrite(i_record->m_message, 1, i_record->m_binarySizeBytes, binaryLogFile);
+		}
+		pthread_mutex_unlock(&g_binaryFormatsLock);
 		return;
 	}
 
-	free(g_programName);
-	g_programName = NULL;
-	g_programNameAllocated = 0;
+	char line[LOG_LINE_LENGTH];
+	size_t const lineSizeBytes = carl_format_line(i_record, &t_logTimePrefix, line);
+
+	/***** One stdio call keeps concurrent lines whole *****/
+	fwrite(line, 1, lineSizeBytes, carl_stream_file(i_record->m_stream));
 }
 
+static void carl_batch_flush(LogBatch * const io_batch)
+{
+	if(io_batch->m_sizeBytes == 0 || io_batch->m_fileHandle == NULL)
+	{
+		return;
+	}
+
+	fwrite(io_batch->m_data, 1, io_batch->m_sizeBytes, io_batch->m_fileHandle);
+	fflush(io_batch->m_fileHandle);
+	__atomic_store_n(&io_batch->m_sizeBytes, 0, __ATOMIC_RELEASE);
+}
 
-static Result carl_print_time(FILE * const i_fileHandle)
+static int carl_logger_enqueue(LogRecord const * const i_record, Logger * const io_logger)
 {
-	static char const * const sc_strEmpty="[\?\?\?\?-\?\?-\?\? \?\?:\?\?:\?\?] ";
-	size_t strResult=0;
-	char timeBuf[32];
-	time_t timeUnix;
-	struct tm *timeLocal;
+	LogRecord *slot = NULL;
+	uint64_t position = __atomic_load_n(&io_logger->m_enqueuePosition, __ATOMIC_RELAXED);
+	uint64_t sequence = 0;
+	int64_t difference = 0;
 
-	timeUnix = time(NULL);
-	timeLocal=localtime(&timeUnix);
-	if(timeLocal == NULL)
+	for(;;)
 	{
-		fputs(sc_strEmpty, i_fileHandle);
-		return R_LOCALTIMEFAILED;
+		slot = &io_logger->m_records[position & io_logger->m_recordMask];
+		sequence = __atomic_load_n(&slot->m_sequence, __ATOMIC_ACQUIRE);
+		difference = (int64_t)(sequence - position);
+		if(difference == 0)
+		{
+			if(__atomic_compare_exchange_n(&io_logger->m_enqueuePosition, &position, position+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+		else if(difference < 0)
+		{
+			return 0;
+		}
+		else
+		{
+			position = __atomic_load_n(&io_logger->m_enqueuePosition, __ATOMIC_RELAXED);
+		}
 	}
 
-	strResult=strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", timeLocal);
-	if(strResult == 0)
+	slot->m_time = i_record->m_time;
+	slot->m_functionName = i_record->m_functionName;
+	slot->m_errorNumber = i_record->m_errorNumber;
+	slot->m_stream = i_record->m_stream;
+	slot->m_binarySizeBytes = i_record->m_binarySizeBytes;
+	memcpy(slot->m_message, i_record->m_message, sizeof(slot->m_message));
+	__atomic_store_n(&slot->m_sequence, position+1, __ATOMIC_RELEASE);
+
+	/***** Only pay for a wakeup when the consumer is parked *****/
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&io_logger->m_consumerWaiting, __ATOMIC_RELAXED))
 	{
-		fputs(sc_strEmpty, i_fileHandle);
-		return R_STRINGFORMATFAILED;
+		pthread_mutex_lock(&io_logger->m_wakeLock);
+		pthread_cond_signal(&io_logger->m_wake);
+		pthread_mutex_unlock(&io_logger->m_wakeLock);
 	}
 
-	fputs(timeBuf, i_fileHandle);
-	fputc(' ', i_fileHandle);
+	return 1;
+}
 
-	return R_SUCCESS;
+static int carl_logger_empty(Logger const * const i_logger)
+{
+	uint64_t const position = i_logger->m_dequeuePosition;
+
+	return __atomic_load_n(&i_logger->m_records[position & i_logger->m_recordMask].m_sequence, __ATOMIC_SEQ_CST) != position+1;
 }
-/**************************************************/
 
-/********************----- Error Handling -----********************/
-void carl_error(char const * const i_functionName, ...)
+static int carl_logger_dequeue(Logger * const io_logger, LogTimePrefix * const io_prefix)
 {
-	if(g_programName != NULL)
+	char line[LOG_LINE_LENGTH];
+	size_t lineSizeBytes = 0;
+	LogBatch *batch = NULL;
+	uint64_t const position = io_logger->m_dequeuePosition;
+	LogRecord * const slot = &io_logger->m_records[position & io_logger->m_recordMask];
+
+	if(__atomic_load_n(&slot->m_sequence, __ATOMIC_ACQUIRE) != position+1)
 	{
-		fputs(g_programName, stderr);
-		fputs(": ", stderr);
+		return 0;
 	}
-	carl_print_time(stderr);
-	if(i_functionName != NULL)
+
+	if(slot->m_binarySizeBytes > 0)
 	{
-		fputs(i_functionName, stderr);
-		fputs(" - ", stderr);
+		lineSizeBytes = slot->m_binarySizeBytes;
+		memcpy(line, slot->m_message, lineSizeBytes);
+		batch = &io_logger->m_batches[LOG_BATCH_BINARY];
+		batch->m_fileHandle = __atomic_load_n(&g_binaryLogFile, __ATOMIC_ACQUIRE);
+
+		/***** Binary log stopped while this was queued *****/
+		if(batch->m_fileHandle == NULL)
+		{
+			lineSizeBytes = 0;
+		}
 	}
+	else
+	{
+		lineSizeBytes = carl_format_line(slot, io_prefix, line);
+		batch = &io_logger->m_batches[slot->m_stream];
+	}
+	__atomic_store_n(&slot->m_sequence, position+io_logger->m_recordMask+1, __ATOMIC_RELEASE);
 
-	va_list argumentList;
-	va_start(argumentList, i_functionName);
-	char const *format = va_arg(argumentList, char const *);
-	vfprintf(stderr, format, argumentList);
-	va_end(argumentList);
+	if(batch->m_sizeBytes + lineSizeBytes > sizeof(batch->m_data))
+	{
+		carl_batch_flush(batch);
+	}
+	memcpy(batch->m_data + batch->m_sizeBytes, line, lineSizeBytes);
+	__atomic_store_n(&batch->m_sizeBytes, batch->m_sizeBytes + lineSizeBytes, __ATOMIC_RELEASE);
+	__atomic_store_n(&io_logger->m_dequeuePosition, position+1, __ATOMIC_RELEASE);
 
-	fprintf(stderr, "\n");
+	return 1;
 }
 
-void carl_errorno(char const * const i_functionName, ...)
+static void *carl_logger_thread(void * const i_logger)
 {
-	int const savedErrorNo = errno;
+	Logger * const logger = (Logger *)i_logger;
+	LogTimePrefix prefix = {(time_t)-1, ""};
+	struct timespec timeWake;
+
+	for(;;)
+	{
+		/***** Drain everything available *****/
+		while(carl_logger_dequeue(logger, &prefix))
+		{
+		}
+		carl_batch_flush(&logger->m_batches[LOG_STREAM_STDERR]);
+		carl_batch_flush(&logger->m_batches[LOG_STREAM_STDOUT]);
+		carl_batch_flush(&logger->m_batches[LOG_BATCH_BINARY]);
+
+		if(!__atomic_load_n(&logger->m_running, __ATOMIC_ACQUIRE))
+		{
+			if(!carl_logger_dequeue(logger, &prefix))
+			{
+				break;
+			}
+			continue;
+		}
+
+		/***** Park until a producer signals *****/
+		pthread_mutex_lock(&logger->m_wakeLock);
+		__atomic_store_n(&logger->m_consumerWaiting, 1, __ATOMIC_SEQ_CST);
+		if(carl_logger_empty(logger) && __atomic_load_n(&logger->m_running, __ATOMIC_ACQUIRE))
+		{
+			clock_gettime(CLOCK_REALTIME, &timeWake);
+			timeWake.tv_nsec += LOG_IDLE_WAIT.tv_nsec;
+			timeWake.tv_sec += LOG_IDLE_WAIT.tv_sec + timeWake.tv_nsec/1000000000;
+			timeWake.tv_nsec %= 1000000000;
+			pthread_cond_timedwait(&logger->m_wake, &logger->m_wakeLock, &timeWake);
+		}
+		__atomic_store_n(&logger->m_consumerWaiting, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&logger->m_wakeLock);
+	}
+
+	carl_batch_flush(&logger->m_batches[LOG_STREAM_STDERR]);
+	carl_batch_flush(&logger->m_batches[LOG_STREAM_STDOUT]);
+	carl_batch_flush(&logger->m_batches[LOG_BATCH_BINARY]);
+
+	return NULL;
+}
+
+static size_t carl_binary_put(void const * const i_data, size_t const i_sizeBytes, size_t const i_offset, char * const io_buffer, size_t const i_bufferSizeBytes)
+{
+	if(i_offset + i_sizeBytes > i_bufferSizeBytes)
+	{
+		return i_bufferSizeBytes+1;
+	}
+
+	memcpy(io_buffer + i_offset, i_data, i_sizeBytes);
+	return i_offset + i_sizeBytes;
+}
+
+static uint8_t carl_binary_parse(char const * i_format, char * const o_argumentTypes)
+{
+	uint8_t argumentCount = 0;
+	int lengthLong = 0;
+	char lengthModifier = '\0';
+
+	for(; *i_format != '\0'; ++i_format)
+	{
+		if(*i_format != '%')
+		{
+			continue;
+		}
+		++i_format;
+		if(*i_format == '%')
+		{
+			continue;
+		}
+
+		/***** Flags, width and precision; '*' consumes an int *****/
+		while(*i_format != '\0' && strchr("-+ #0'", *i_format) != NULL)
+		{
+			++i_format;
+		}
+		for(; *i_format == '*' || *i_format == '.' || (*i_format >= '0' && *i_format <= '9'); ++i_format)
+		{
+			if(*i_format == '*' && argumentCount < BINARYLOG_ARGUMENTS_MAX)
+			{
+				o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_INT;
+			}
+		}
+
+		/***** Length modifier *****/
+		lengthLong = 0;
+		lengthModifier = '\0';
+		for(; *i_format != '\0' && strchr("hlLqjzt", *i_format) != NULL; ++i_format)
+		{
+			lengthLong += (*i_format == 'l');
+			lengthModifier = *i_format;
+		}
+		if(*i_format == '\0')
+		{
+			break;
+		}
+		if(argumentCount >= BINARYLOG_ARGUMENTS_MAX)
+		{
+			return BINARYLOG_ARGUMENTS_MAX+1;
+		}
+
+		/***** Conversion *****/
+		switch(*i_format)
+		{
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+				if(lengthLong >= 2 || lengthModifier == 'q' || lengthModifier == 'L')
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_LONGLONG;
+				}
+				else if(lengthLong == 1)
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_LONG;
+				}
+				else if(lengthModifier == 'z')
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_SIZE;
+				}
+				else if(lengthModifier == 'j')
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_INTMAX;
+				}
+				else if(lengthModifier == 't')
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_PTRDIFF;
+				}
+				else
+				{
+					o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_INT;
+				}
+				break;
+			case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+				o_argumentTypes[argumentCount++] = (lengthModifier == 'L') ? BINARYLOG_ARGUMENT_LONGDOUBLE : BINARYLOG_ARGUMENT_DOUBLE;
+				break;
+			case 's':
+				o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_STRING;
+				break;
+			case 'p':
+				o_argumentTypes[argumentCount++] = BINARYLOG_ARGUMENT_POINTER;
+				break;
+			default:
+				/***** %n and friends are not supported *****/
+				return BINARYLOG_ARGUMENTS_MAX+1;
+		}
+	}
+
+	return argumentCount;
+}
+
+static BinaryFormat const *carl_binary_format(LogStream const i_stream, char const * const i_functionName, char const * const i_format)
+{
+	size_t const hash = (((uintptr_t)i_functionName >> 3) ^ ((uintptr_t)i_format * 0x9E3779B97F4A7C15ull)) % BINARYLOG_FORMAT_COUNT;
+	BinaryFormat *format = NULL;
+	char buffer[LOG_MESSAGE_LENGTH + 2*BINARYLOG_NAME_LENGTH];
+	size_t index = 0;
+	size_t offset = 0;
+	uint8_t recordType = BINARYLOG_RECORD_FORMAT;
+	uint8_t stream = (uint8_t)i_stream;
+	uint16_t length = 0;
+	FILE *binaryLogFile = NULL;
+
+	/***** Lock-free lookup of known call sites *****/
+	for(index=0; index<BINARYLOG_FORMAT_COUNT; ++index)
+	{
+		format = &g_binaryFormats[(hash+index) % BINARYLOG_FORMAT_COUNT];
+		if(!__atomic_load_n(&format->m_ready, __ATOMIC_ACQUIRE))
+		{
+			break;
+		}
+		if(format->m_format == i_format && format->m_functionName == i_functionName)
+		{
+			return format;
+		}
+	}
+
+	/***** First use: register and emit the definition *****/
+	pthread_mutex_lock(&g_binaryFormatsLock);
+	for(index=0; index<BINARYLOG_FORMAT_COUNT; ++index)
+	{
+		format = &g_binaryFormats[(hash+index) % BINARYLOG_FORMAT_COUNT];
+		if(!format->m_ready)
+		{
+			break;
+		}
+		if(format->m_format == i_format && format->m_functionName == i_functionName)
+		{
+			pthread_mutex_unlock(&g_binaryFormatsLock);
+			return format;
+		}
+	}
+	binaryLogFile = __atomic_load_n(&g_binaryLogFile, __ATOMIC_ACQUIRE);
+	if(index == BINARYLOG_FORMAT_COUNT || binaryLogFile == NULL)
+	{
+		pthread_mutex_unlock(&g_binaryFormatsLock);
+		return NULL;
+	}
+	format->m_argumentCount = carl_binary_parse(i_format, format->m_argumentTypes);
+	if(format->m_argumentCount > BINARYLOG_ARGUMENTS_MAX)
+	{
+		pthread_mutex_unlock(&g_binaryFormatsLock);
+		return NULL;
+	}
+	format->m_functionName = i_functionName;
+	format->m_format = i_format;
+	format->m_id = g_binaryFormatCount++;
+
+	offset = carl_binary_put(&recordType, sizeof(recordType), offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(&format->m_id, sizeof(format->m_id), offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(&stream, sizeof(stream), offset, buffer, sizeof(buffer));
+	length = (uint16_t)MIN(strlen(i_functionName), BINARYLOG_NAME_LENGTH);
+	offset = carl_binary_put(&length, sizeof(length), offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(i_functionName, length, offset, buffer, sizeof(buffer));
+	length = (uint16_t)MIN(strlen(i_format), LOG_MESSAGE_LENGTH);
+	offset = carl_binary_put(&length, sizeof(length), offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(i_format, length, offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(&format->m_argumentCount, sizeof(format->m_argumentCount), offset, buffer, sizeof(buffer));
+	offset = carl_binary_put(format->m_argumentTypes, format->m_argumentCount, offset, buffer, sizeof(buffer));
+	fwrite(buffer, 1, offset, binaryLogFile);
+
+	__atomic_store_n(&format->m_ready, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_binaryFormatsLock);
+
+	return format;
+}
+
+static size_t carl_binary_encode(	BinaryFormat const * const i_format,
+												int const i_errorNumber,
+												va_list i_argumentList,
+												char * const o_buffer)
+{
+	uint8_t const recordType = BINARYLOG_RECORD_MESSAGE;
+	Timestamp const timeCurrent = timestamp_now();
+	int32_t const errorNumber = i_errorNumber;
+	size_t argumentIndex = 0;
+	size_t offset = 0;
+	size_t payloadOffset = 0;
+	uint16_t length = 0;
+	uint64_t valueInteger = 0;
+	double valueDouble = 0.0;
+	char const *valueString = NULL;
+
+	offset = carl_binary_put(&recordType, sizeof(recordType), offset, o_buffer, LOG_MESSAGE_LENGTH);
+	offset = carl_binary_put(&i_format->m_id, sizeof(i_format->m_id), offset, o_buffer, LOG_MESSAGE_LENGTH);
+	offset = carl_binary_put(&timeCurrent, sizeof(timeCurrent), offset, o_buffer, LOG_MESSAGE_LENGTH);
+	offset = carl_binary_put(&errorNumber, sizeof(errorNumber), offset, o_buffer, LOG_MESSAGE_LENGTH);
+	payloadOffset = offset;
+	offset += sizeof(length);
+
+	/***** Raw arguments, no formatting *****/
+	for(argumentIndex=0; argumentIndex<i_format->m_argumentCount; ++argumentIndex)
+	{
+		switch(i_format->m_argumentTypes[argumentIndex])
+		{
+			case BINARYLOG_ARGUMENT_INT:
+				valueInteger = (uint64_t)(int64_t)va_arg(i_argumentList, int);
+				break;
+			case BINARYLOG_ARGUMENT_LONG:
+				valueInteger = (uint64_t)va_arg(i_argumentList, long);
+				break;
+			case BINARYLOG_ARGUMENT_LONGLONG:
+				valueInteger = (uint64_t)va_arg(i_argumentList, long long);
+				break;
+			case BINARYLOG_ARGUMENT_SIZE:
+				valueInteger = (uint64_t)va_arg(i_argumentList, size_t);
+				break;
+			case BINARYLOG_ARGUMENT_INTMAX:
+				valueInteger = (uint64_t)va_arg(i_argumentList, intmax_t);
+				break;
+			case BINARYLOG_ARGUMENT_PTRDIFF:
+				valueInteger = (uint64_t)va_arg(i_argumentList, ptrdiff_t);
+				break;
+			case BINARYLOG_ARGUMENT_POINTER:
+				valueInteger = (uint64_t)(uintptr_t)va_arg(i_argumentList, void *);
+				break;
+			case BINARYLOG_ARGUMENT_DOUBLE:
+				valueDouble = va_arg(i_argumentList, double);
+				offset = carl_binary_put(&valueDouble, sizeof(valueDouble), offset, o_buffer, LOG_MESSAGE_LENGTH);
+				continue;
+			case BINARYLOG_ARGUMENT_LONGDOUBLE:
+				valueDouble = (double)va_arg(i_argumentList, long double);
+				offset = carl_binary_put(&valueDouble, sizeof(valueDouble), offset, o_buffer, LOG_MESSAGE_LENGTH);
+				continue;
+			case BINARYLOG_ARGUMENT_STRING:
+			default:
+				valueString = va_arg(i_argumentList, char const *);
+				valueString = (valueString != NULL) ? valueString : "(null)";
+				length = (uint16_t)strnlen(valueString, BINARYLOG_STRING_LENGTH);
+				offset = carl_binary_put(&length, sizeof(length), offset, o_buffer, LOG_MESSAGE_LENGTH);
+				offset = carl_binary_put(valueString, length, offset, o_buffer, LOG_MESSAGE_LENGTH);
+				continue;
+		}
+		offset = carl_binary_put(&valueInteger, sizeof(valueInteger), offset, o_buffer, LOG_MESSAGE_LENGTH);
+	}
+	if(offset > LOG_MESSAGE_LENGTH)
+	{
+		return 0;
+	}
+
+	length = (uint16_t)(offset - payloadOffset - sizeof(length));
+	memcpy(o_buffer + payloadOffset, &length, sizeof(length));
+
+	return offset;
+}
+
+/* Returns the epoch to hand back to carl_log_leave(); loads of g_logger after this are safe to use until then */
+static uint32_t carl_log_enter(void)
+{
+	uint32_t const epoch = __atomic_load_n(&g_logEpoch, __ATOMIC_SEQ_CST) & 1;
+
+	__atomic_add_fetch(&g_logProducers[epoch], 1, __ATOMIC_SEQ_CST);
+
+	return epoch;
+}
+
+static void carl_log_leave(uint32_t const i_epoch)
+{
+	__atomic_sub_fetch(&g_logProducers[i_epoch], 1, __ATOMIC_RELEASE);
+}
+
+/* Caller has already unpublished what it is retiring; callers entering after the flip cannot see it, so the wait is bounded */
+static void carl_log_quiesce(void)
+{
+	uint32_t const epoch = __atomic_fetch_add(&g_logEpoch, 1, __ATOMIC_SEQ_CST) & 1;
+
+	while(__atomic_load_n(&g_logProducers[epoch], __ATOMIC_SEQ_CST) != 0)
+	{
+		sched_yield();
+	}
+}
+
+static void carl_log_exit(void)
+{
+	carl_log_stop();
+}
+
+static void carl_log(	LogStream const i_stream,
+							int const i_errorNumber,
+							char const * const i_functionName,
+							char const * const i_format,
+							va_list i_argumentList)
+{
+	uint32_t const epoch = carl_log_enter();
+	Logger * const logger = __atomic_load_n(&g_logger, __ATOMIC_SEQ_CST);
+	BinaryFormat const *binaryFormat = NULL;
+	LogRecord record;
+
+	record.m_time = 0;
+	record.m_functionName = i_functionName;
+	record.m_errorNumber = i_errorNumber;
+	record.m_stream = i_stream;
+	record.m_binarySizeBytes = 0;
+
+	/***** Binary mode records the call site ID and raw arguments *****/
+	if(__atomic_load_n(&g_binaryLogEnabled, __ATOMIC_SEQ_CST) && i_functionName != NULL && i_format != NULL)
+	{
+		binaryFormat = carl_binary_format(i_stream, i_functionName, i_format);
+		if(binaryFormat != NULL)
+		{
+			/***** Encoding consumes its list; the text fallback below still needs the original *****/
+			va_list argumentList;
+
+			va_copy(argumentList, i_argumentList);
+			record.m_binarySizeBytes = carl_binary_encode(binaryFormat, i_errorNumber, argumentList, record.m_message);
+			va_end(argumentList);
+		}
+	}
+
+	if(record.m_binarySizeBytes == 0)
+	{
+		record.m_time = carl_time_now();
+		if(vsnprintf(record.m_message, sizeof(record.m_message), (i_format != NULL) ? i_format : "", i_argumentList) < 0)
+		{
+			record.m_message[0] = '\0';
+		}
+	}
 
-	if(g_programName != NULL)
+	if(logger == NULL)
 	{
-		fputs(g_programName, stderr);
-		fputs(": ", stderr);
+		carl_write_synchronous(&record);
+		goto end;
 	}
-	carl_print_time(stderr);
-	if(i_functionName != NULL)
+
+	/***** Ring full *****/
+	while(!carl_logger_enqueue(&record, logger))
 	{
-		fputs(i_functionName, stderr);
-		fputs(" - ", stderr);
+		switch(logger->m_overflowPolicy)
+		{
+			case LOG_OVERFLOW_BLOCK:
+				sched_yield();
+				continue;
+			case LOG_OVERFLOW_SYNCHRONOUS:
+				carl_write_synchronous(&record);
+				goto end;
+			case LOG_OVERFLOW_DROP:
+			default:
+				__atomic_fetch_add(&logger->m_dropped, 1, __ATOMIC_RELAXED);
+				goto end;
+		}
 	}
 
+end:
+	carl_log_leave(epoch);
+}
+/**************************************************/
+
+/********************----- Error Handling -----********************/
+void carl_error(char const * const i_functionName, ...)
+{
+	CARL_TRACE_SCOPE("carl.error");
 	va_list argumentList;
 	va_start(argumentList, i_functionName);
 	char const *format = va_arg(argumentList, char const *);
-	vfprintf(stderr, format, argumentList);
+	carl_log(LOG_STREAM_STDERR, -1, i_functionName, format, argumentList);
 	va_end(argumentList);
+}
 
-	fprintf(stderr, " - \"%s\"\n", strerror(savedErrorNo));
+void carl_errorno(char const * const i_functionName, ...)
+{
+	int const savedErrorNo = errno;
+	CARL_TRACE_SCOPE("carl.errorno");
+
+	va_list argumentList;
+	va_start(argumentList, i_functionName);
+	char const *format = va_arg(argumentList, char const *);
+	carl_log(LOG_STREAM_STDERR, savedErrorNo, i_functionName, format, argumentList);
+	va_end(argumentList);
 }
 
 void carl_info(char const * const i_functionName, ...)
 {
-	if(g_programName != NULL)
-	{
-		fputs(g_programName, stdout);
-		fputs(": ", stdout);
-	}
-	carl_print_time(stdout);
-	if(i_functionName != NULL)
-	{
-		fputs(i_functionName, stdout);
-		fputs(" - ", stdout);
-	}
+	CARL_TRACE_SCOPE("carl.info");
+	va_list argumentList;
+	va_start(argumentList, i_functionName);
+	char const *format = va_arg(argumentList, char const *);
+	carl_log(LOG_STREAM_STDOUT, -1, i_functionName, format, argumentList);
+	va_end(argumentList);
+}
 
+void carl_warning(char const * const i_functionName, ...)
+{
+	CARL_TRACE_SCOPE("carl.warning");
 	va_list argumentList;
 	va_start(argumentList, i_functionName);
 	char const *format = va_arg(argumentList, char const *);
-	vfprintf(stderr, format, argumentList);
+	carl_log(LOG_STREAM_STDERR, -1, i_functionName, format, argumentList);
 	va_end(argumentList);
+}
 
-	fprintf(stdout, "\n");
+void carl_debug(char const * const i_functionName, ...)
+{
+	CARL_TRACE_SCOPE("carl.debug");
+	va_list argumentList;
+	va_start(argumentList, i_functionName);
+	char const *format = va_arg(argumentList, char const *);
+	carl_log(LOG_STREAM_STDOUT, -1, i_functionName, format, argumentList);
+	va_end(argumentList);
 }
 
-Result carl_set_program_name(char const * const i_programName)
+int carl_log_site_allow(LogLevel const i_level, char const * const i_functionName, LogSite * const io_site)
 {
-	char *nextProgramName = NULL;
-	if(i_programName == NULL)
+	int const savedErrorNo = errno;
+	uint32_t const rateLimit = __atomic_load_n(&g_logRateLimit, __ATOMIC_RELAXED);
+	uint32_t suppressed = 0;
+	Timestamp const timeCurrent = timestamp_read(TIMESTAMP_SOURCE_MONOTONIC_COARSE);
+	uint64_t windowStart = __atomic_load_n(&io_site->m_windowStart, __ATOMIC_RELAXED);
+
+	if(rateLimit == 0)
 	{
-		/***** Set to blank *****/
-		nextProgramName = NULL;
+		return 1;
 	}
-	else
+
+	/***** New window, report what the last one swallowed *****/
+	if(timeCurrent - windowStart >= LOG_SITE_WINDOW && __atomic_compare_exchange_n(&io_site->m_windowStart, &windowStart, timeCurrent, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
 	{
-		/***** Set to input name *****/
-		size_t const nextProgramNameLength = strlen(i_programName);
-		size_t const nextProgramNameSizeBytes = (nextProgramNameLength+1)*sizeof(char);
-		nextProgramName = (char *)malloc(nextProgramNameSizeBytes);
-		if(nextProgramName == NULL)
+		__atomic_store_n(&io_site->m_count, 0, __ATOMIC_RELAXED);
+		suppressed = __atomic_exchange_n(&io_site->m_suppressed, 0, __ATOMIC_RELAXED);
+		if(suppressed > 0)
 		{
-			CARL_ERROR("Not enough memory to copy program name.");
-			return R_MEMORYALLOCATIONERROR;
+			((i_level <= LOG_LEVEL_WARNING) ? carl_warning : carl_info)(i_functionName, "suppressed %u messages", suppressed);
 		}
+	}
 
-		memcpy(nextProgramName, i_programName, nextProgramNameSizeBytes);
+	if(__atomic_fetch_add(&io_site->m_count, 1, __ATOMIC_RELAXED) < rateLimit)
+	{
+		errno = savedErrorNo;
+		return 1;
 	}
 
-	if(g_programNameAllocated)
+	__atomic_fetch_add(&io_site->m_suppressed, 1, __ATOMIC_RELAXED);
+	errno = savedErrorNo;
+	return 0;
+}
+
+LogLevel carl_log_level_get(void)
+{
+	return __atomic_load_n(&g_logLevel, __ATOMIC_RELAXED);
+}
+
+Result carl_log_level_set(LogLevel const i_level)
+{
+	if(i_level < LOG_LEVEL_NONE || i_level > LOG_LEVEL_DEBUG)
 	{
-		char * const oldProgramName = g_programName;
-		g_programName = nextProgramName;
-		free(oldProgramName);
+		CARL_ERROR("Invalid log level (%d).", i_level);
+		return R_INPUTBAD;
 	}
-	else
+
+	__atomic_store_n(&g_logLevel, i_level, __ATOMIC_RELAXED);
+	return R_SUCCESS;
+}
+
+Result carl_log_rate_limit_set(uint32_t const i_messagesPerSecond)
+{
+	__atomic_store_n(&g_logRateLimit, i_messagesPerSecond, __ATOMIC_RELAXED);
+	return R_SUCCESS;
+}
+
+Result carl_log_binary_start(char const * const i_pathname)
+{
+	BinaryLogHeader header;
+	FILE *fileHandle = NULL;
+	char const * const programName = __atomic_load_n(&g_programName, __ATOMIC_ACQUIRE);
+	struct timespec timeCurrent;
+
+	if(i_pathname == NULL)
+	{
+		CARL_ERROR("No binary log file given.");
+		return R_INPUTBAD;
+	}
+	if(__atomic_load_n(&g_binaryLogEnabled, __ATOMIC_ACQUIRE) || __atomic_load_n(&g_binaryLogFile, __ATOMIC_ACQUIRE) != NULL)
 	{
-		g_programName = nextProgramName;
-		if(!g_programNameAllocated)
+		CARL_ERROR("Binary log already started.");
+		return R_FAILURE;
+	}
+
+	fileHandle = fopen(i_pathname, "wb");
+	if(fileHandle == NULL)
+	{
+		CARL_ERRORNO("Unable to open binary log \"%s\".", i_pathname);
+		return R_DEVICEOPENFAILED;
+	}
+
+	/***** Anchor the monotonic clock to wall time for the decoder *****/
+	CLEAR(header);
+	memcpy(header.m_magic, BINARYLOG_MAGIC, sizeof(header.m_magic));
+	header.m_version = BINARYLOG_VERSION;
+	header.m_monotonicAnchor = timestamp_now();
+	clock_gettime(CLOCK_REALTIME, &timeCurrent);
+	header.m_realtimeAnchor = timestamp_from_timespec(&timeCurrent);
+	if(programName != NULL)
+	{
+		strncpy(header.m_programName, programName, sizeof(header.m_programName)-1);
+	}
+	if(fwrite(&header, sizeof(header), 1, fileHandle) != 1)
+	{
+		CARL_ERRORNO("Unable to write binary log \"%s\".", i_pathname);
+		fclose(fileHandle);
+		return R_DEVICEWRITEFAILED;
+	}
+
+	/***** Every call site is redefined in the new file *****/
+	pthread_mutex_lock(&g_binaryFormatsLock);
+	memset(g_binaryFormats, 0, sizeof(g_binaryFormats));
+	g_binaryFormatCount = 0;
+	__atomic_store_n(&g_binaryLogFile, fileHandle, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_binaryLogEnabled, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g_binaryFormatsLock);
+
+	return R_SUCCESS;
+}
+
+Result carl_log_binary_stop(void)
+{
+	FILE *fileHandle = NULL;
+	Logger *logger = NULL;
+	uint64_t position = 0;
+
+	/***** New messages go back to text *****/
+	if(!__atomic_exchange_n(&g_binaryLogEnabled, 0, __ATOMIC_SEQ_CST))
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Producers that saw binary mode finish enqueueing; no binary record is queued after this *****/
+	carl_log_quiesce();
+
+	/***** Let the logger write out everything queued so far, binary batch included *****/
+	logger = __atomic_load_n(&g_logger, __ATOMIC_ACQUIRE);
+	if(logger != NULL)
+	{
+		position = __atomic_load_n(&logger->m_enqueuePosition, __ATOMIC_ACQUIRE);
+		while((int64_t)(__atomic_load_n(&logger->m_dequeuePosition, __ATOMIC_ACQUIRE) - position) < 0
+			|| __atomic_load_n(&logger->m_batches[LOG_BATCH_BINARY].m_sizeBytes, __ATOMIC_ACQUIRE) != 0)
 		{
-			g_programNameAllocated = 1;
-			atexit(carl_free_program_name);
+			sched_yield();
 		}
 	}
 
+	pthread_mutex_lock(&g_binaryFormatsLock);
+	fileHandle = __atomic_exchange_n(&g_binaryLogFile, NULL, __ATOMIC_ACQ_REL);
+	pthread_mutex_unlock(&g_binaryFormatsLock);
+
+	if(fclose(fileHandle) != 0)
+	{
+		CARL_ERRORNO("Unable to close binary log.");
+		return R_DEVICECLOSEFAILED;
+	}
+
+	return R_SUCCESS;
+}
+
+uint64_t carl_log_dropped(void)
+{
+	uint32_t const epoch = carl_log_enter();
+	Logger * const logger = __atomic_load_n(&g_logger, __ATOMIC_SEQ_CST);
+	uint64_t dropped = 0;
+
+	if(logger != NULL)
+	{
+		dropped = __atomic_load_n(&logger->m_dropped, __ATOMIC_RELAXED);
+	}
+	carl_log_leave(epoch);
+
+	return dropped;
+}
+
+Result carl_log_start(size_t const i_recordCount, LogOverflow const i_overflowPolicy)
+{
+	size_t recordCount = 1;
+	size_t recordIndex = 0;
+	Logger *logger = NULL;
+	Result result = R_FAILURE;
+
+	/***** Input Validation *****/
+	if(i_recordCount == 0)
+	{
+		CARL_ERROR("Record count must be non-0.");
+		return R_INPUTBAD;
+	}
+	if(i_overflowPolicy != LOG_OVERFLOW_DROP && i_overflowPolicy != LOG_OVERFLOW_BLOCK && i_overflowPolicy != LOG_OVERFLOW_SYNCHRONOUS)
+	{
+		CARL_ERROR("Invalid overflow policy (%d).", i_overflowPolicy);
+		return R_INPUTBAD;
+	}
+	if(__atomic_load_n(&g_logger, __ATOMIC_ACQUIRE) != NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Round up to a power of two *****/
+	while(recordCount < i_recordCount)
+	{
+		recordCount <<= 1;
+	}
+
+	/***** Create logger *****/
+	logger = (Logger *)malloc(sizeof(Logger));
+	if(logger == NULL)
+	{
+		CARL_ERROR("Unable to allocate memory.");
+		return R_MEMORYALLOCATIONERROR;
+	}
+	logger->m_recordRegion.m_memory = NULL;
+	if(memory_region_map(recordCount*sizeof(LogRecord), MEMORY_FLAG_HUGEPAGE | MEMORY_FLAG_PREFAULT, &logger->m_recordRegion) != R_SUCCESS)
+	{
+		CARL_ERROR("Unable to allocate memory for %zu log records.", recordCount);
+
+		result = R_MEMORYALLOCATIONERROR;
+		goto end;
+	}
+	logger->m_records = (LogRecord *)logger->m_recordRegion.m_memory;
+	for(recordIndex=0; recordIndex<recordCount; ++recordIndex)
+	{
+		logger->m_records[recordIndex].m_sequence = recordIndex;
+	}
+	logger->m_recordMask = recordCount-1;
+	logger->m_enqueuePosition = 0;
+	logger->m_dequeuePosition = 0;
+	logger->m_dropped = 0;
+	logger->m_overflowPolicy = i_overflowPolicy;
+	logger->m_running = 1;
+	logger->m_consumerWaiting = 0;
+	logger->m_batches[LOG_STREAM_STDERR].m_fileHandle = stderr;
+	logger->m_batches[LOG_STREAM_STDERR].m_sizeBytes = 0;
+	logger->m_batches[LOG_STREAM_STDOUT].m_fileHandle = stdout;
+	logger->m_batches[LOG_STREAM_STDOUT].m_sizeBytes = 0;
+	logger->m_batches[LOG_BATCH_BINARY].m_fileHandle = NULL;
+	logger->m_batches[LOG_BATCH_BINARY].m_sizeBytes = 0;
+	pthread_mutex_init(&logger->m_wakeLock, NULL);
+	pthread_cond_init(&logger->m_wake, NULL);
+
+	if(pthread_create(&logger->m_thread, NULL, carl_logger_thread, logger) != 0)
+	{
+		CARL_ERROR("Unable to start logger thread.");
+
+		pthread_cond_destroy(&logger->m_wake);
+		pthread_mutex_destroy(&logger->m_wakeLock);
+		result = R_FAILURE;
+		goto end;
+	}
+
+	/***** Publish *****/
+	__atomic_store_n(&g_logger, logger, __ATOMIC_RELEASE);
+	if(!g_loggerExitRegistered)
+	{
+		g_loggerExitRegistered = 1;
+		atexit(carl_log_exit);
+	}
+
+	return R_SUCCESS;
+
+end:
+	memory_region_unmap(&logger->m_recordRegion);
+	free(logger);
+
+	return result;
+}
+
+Result carl_log_stop(void)
+{
+	Logger * const logger = __atomic_exchange_n(&g_logger, NULL, __ATOMIC_SEQ_CST);
+
+	if(logger == NULL)
+	{
+		return R_SUCCESS;
+	}
+
+	/***** Producers that loaded the logger before the swap finish enqueueing; later ones write synchronously *****/
+	carl_log_quiesce();
+
+	/***** Drain and join; the consumer's last pass sees every record *****/
+	__atomic_store_n(&logger->m_running, 0, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&logger->m_wakeLock);
+	pthread_cond_signal(&logger->m_wake);
+	pthread_mutex_unlock(&logger->m_wakeLock);
+	pthread_join(logger->m_thread, NULL);
+
+	pthread_cond_destroy(&logger->m_wake);
+	pthread_mutex_destroy(&logger->m_wakeLock);
+	memory_region_unmap(&logger->m_recordRegion);
+	free(logger);
+
+	return R_SUCCESS;
+}
+
+Result carl_set_program_name(char const * const i_programName)
+{
+	ProgramName *programName = NULL;
+
+	/***** Set to blank *****/
+	if(i_programName == NULL)
+	{
+		__atomic_store_n(&g_programName, NULL, __ATOMIC_RELEASE);
+		return R_SUCCESS;
+	}
+
+	/***** Set to input name *****/
+	programName = (ProgramName *)malloc(sizeof(ProgramName) + strlen(i_programName) + 1);
+	if(programName == NULL)
+	{
+		CARL_ERROR("Not enough memory to copy program name.");
+		return R_MEMORYALLOCATIONERROR;
+	}
+	strcpy(programName->m_name, i_programName);
+
+	/***** Readers load the pointer once per line, so the old name is retired rather than freed *****/
+	programName->m_previous = g_programNames;
+	if(g_programNames == NULL)
+	{
+		atexit(carl_free_program_name);
+	}
+	g_programNames = programName;
+	__atomic_store_n(&g_programName, programName->m_name, __ATOMIC_RELEASE);
+
 	return R_SUCCESS;
 }
 /**************************************************/
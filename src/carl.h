@@ -1,5 +1,6 @@
 #ifndef _GLOBAL_H_
 #define _GLOBAL_H_
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -39,12 +40,41 @@ enum Result_e
 	R_DEVICEPRIORITYFAILED=-28,
 	R_DEVICECONTROLSETFAILED=-29,
 	R_LOCALTIMEFAILED=-30,
-	R_STRINGFORMATFAILED=-31
+	R_STRINGFORMATFAILED=-31,
+	R_CLOCKUNAVAILABLE=-32,
+	R_TIMERFAILED=-33,
+	R_SCHEDULERSETFAILED=-34,
+	R_AFFINITYSETFAILED=-35,
+	R_MEMORYLOCKFAILED=-36,
+	R_DEVICENOTREADY=-37,
+	R_EVENTLOOPFAILED=-38,
+	R_BUFFERFULL=-39,
+	R_OUTOFRANGE=-40,
+	R_OBJECTINUSE=-41
 };
 
 typedef enum Result_e Result;
 /**************************************************/
 
+/********************----- ENUM: LogOverflow -----********************/
+enum LogOverflow_e
+{
+	LOG_OVERFLOW_DROP,
+	LOG_OVERFLOW_BLOCK,
+	LOG_OVERFLOW_SYNCHRONOUS
+};
+typedef enum LogOverflow_e LogOverflow;
+/**************************************************/
+
+/********************----- ENUM: LogStream -----********************/
+enum LogStream_e
+{
+	LOG_STREAM_STDERR=0,
+	LOG_STREAM_STDOUT=1
+};
+typedef enum LogStream_e LogStream;
+/**************************************************/
+
 /********************----- Internal Constants -----********************/
 extern uint64_t const g_nanU64;
 /**************************************************/
@@ -67,17 +97,71 @@ extern uint64_t const g_nanU64;
 #endif
 /**************************************************/
 
+/********************----- ENUM: LogLevel -----********************/
+enum LogLevel_e
+{
+	LOG_LEVEL_NONE=0,
+	LOG_LEVEL_ERROR=1,
+	LOG_LEVEL_WARNING=2,
+	LOG_LEVEL_INFO=3,
+	LOG_LEVEL_DEBUG=4
+};
+typedef enum LogLevel_e LogLevel;
+/**************************************************/
+
+/********************----- STRUCT: LogSite -----********************/
+/* One per CARL_* call site, zero initialized */
+struct LogSite_s
+{
+	uint64_t m_windowStart;
+	uint32_t m_count;
+	uint32_t m_suppressed;
+};
+typedef struct LogSite_s LogSite;
+/**************************************************/
+
 /********************----- Internal Error Handling -----********************/
+extern LogLevel g_logLevel;
+
+void carl_debug(char const * const i_functionName, ...);
 void carl_error(char const * const i_functionName, ...);
 void carl_errorno(char const * const i_functionName, ...);
 void carl_info(char const * const i_functionName, ...);
+void carl_warning(char const * const i_functionName, ...);
+int carl_log_site_allow(LogLevel const i_level, char const * const i_functionName, LogSite * const io_site);
 /**************************************************/
 
 /********************----- Error Handling -----********************/
-#define CARL_ERROR(...) carl_error(__func__, __VA_ARGS__)
-#define CARL_ERRORNO(...) carl_errorno(__func__, __VA_ARGS__)
-#define CARL_INFO(...) carl_info(__func__, __VA_ARGS__)
+/* Levels above CARL_LOG_LEVEL_COMPILED are removed by the compiler */
+#ifndef CARL_LOG_LEVEL_COMPILED
+#define CARL_LOG_LEVEL_COMPILED 4
+#endif
+
+#define CARL_LOG(i_level, i_function, ...) \
+	do \
+	{ \
+		if((i_level) <= CARL_LOG_LEVEL_COMPILED && (i_level) <= g_logLevel) \
+		{ \
+			static LogSite s_logSite; \
+			if(carl_log_site_allow((i_level), __func__, &s_logSite)) \
+			{ \
+				i_function(__func__, __VA_ARGS__); \
+			} \
+		} \
+	} while(0)
+
+#define CARL_ERROR(...) CARL_LOG(LOG_LEVEL_ERROR, carl_error, __VA_ARGS__)
+#define CARL_ERRORNO(...) CARL_LOG(LOG_LEVEL_ERROR, carl_errorno, __VA_ARGS__)
+#define CARL_WARNING(...) CARL_LOG(LOG_LEVEL_WARNING, carl_warning, __VA_ARGS__)
+#define CARL_INFO(...) CARL_LOG(LOG_LEVEL_INFO, carl_info, __VA_ARGS__)
+#define CARL_DEBUG(...) CARL_LOG(LOG_LEVEL_DEBUG, carl_debug, __VA_ARGS__)
 Result carl_set_program_name(char const * const i_programName);
+Result carl_log_start(size_t const i_recordCount, LogOverflow const i_overflowPolicy);
+Result carl_log_stop(void);
+uint64_t carl_log_dropped(void);
+LogLevel carl_log_level_get(void);
+Result carl_log_level_set(LogLevel const i_level);
+Result carl_log_rate_limit_set(uint32_t const i_messagesPerSecond);
 /**************************************************/
 
 #endif	/* _GLOBAL_H_ */
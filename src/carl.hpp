@@ -0,0 +1,306 @@
+#ifndef _CARL_HPP_
+#define _CARL_HPP_
+
+/* C++17 layer over the C API: move-only owners, borrowed spans, and callbacks the compiler can inline; nothing here allocates or throws */
+
+#include "carl.h"
+#include "Camera.h"
+#include "CameraCache.h"
+#include "Serial.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace carl
+{
+
+/********************----- CLASS: Span -----********************/
+/* Pointer and length over memory owned elsewhere; the subset of std::span this API needs, convertible to it through data() and size() */
+template<typename Type>
+class Span
+{
+public:
+	constexpr Span() noexcept : m_data(nullptr), m_size(0) {}
+	constexpr Span(Type * const i_data, size_t const i_size) noexcept : m_data(i_data), m_size(i_size) {}
+	template<size_t Size>
+	constexpr Span(Type (&i_array)[Size]) noexcept : m_data(i_array), m_size(Size) {}
+	/* Any container with contiguous data() and size() */
+	template<typename Container, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<Container &>().data()), Type *>>>
+	constexpr Span(Container &i_container) noexcept : m_data(i_container.data()), m_size(i_container.size()) {}
+	/* Span<T> to Span<T const> */
+	template<typename Other, typename = std::enable_if_t<std::is_convertible_v<Other (*)[], Type (*)[]>>>
+	constexpr Span(Span<Other> const &i_other) noexcept : m_data(i_other.data()), m_size(i_other.size()) {}
+
+	constexpr Type *data() const noexcept { return m_data; }
+	constexpr size_t size() const noexcept { return m_size; }
+	constexpr size_t size_bytes() const noexcept { return m_size*sizeof(Type); }
+	constexpr bool empty() const noexcept { return m_size == 0; }
+	constexpr Type &operator[](size_t const i_index) const noexcept { return m_data[i_index]; }
+	constexpr Type *begin() const noexcept { return m_data; }
+	constexpr Type *end() const noexcept { return m_data + m_size; }
+	constexpr Span first(size_t const i_count) const noexcept { return Span(m_data, i_count); }
+	constexpr Span subspan(size_t const i_offset, size_t const i_count) const noexcept { return Span(m_data + i_offset, i_count); }
+
+private:
+	Type *m_data;
+	size_t m_size;
+};
+
+typedef Span<uint8_t const> ByteView;
+/**************************************************/
+
+/********************----- CLASS: Handle -----********************/
+/* Sole owner of a C handle; destroyed through the module's own _destroy on scope exit or reassignment */
+template<typename Type, Result (*Destroy)(Type ** const)>
+class Handle
+{
+public:
+	constexpr Handle() noexcept : m_handle(nullptr) {}
+	explicit Handle(Type * const i_handle) noexcept : m_handle(i_handle) {}
+	Handle(Handle const &) = delete;
+	Handle(Handle &&io_other) noexcept : m_handle(io_other.release()) {}
+	~Handle() { reset(); }
+
+	Handle &operator=(Handle const &) = delete;
+	Handle &operator=(Handle &&io_other) noexcept
+	{
+		if(this != &io_other)
+		{
+			reset(io_other.release());
+		}
+		return *this;
+	}
+
+	Type *get() const noexcept { return m_handle; }
+	explicit operator bool() const noexcept { return m_handle != nullptr; }
+	/* For the C create functions: drops any current handle and hands out the slot */
+	Type **out() noexcept
+	{
+		reset();
+		return &m_handle;
+	}
+	Type *release() noexcept
+	{
+		Type * const handle = m_handle;
+
+		m_handle = nullptr;
+		return handle;
+	}
+	void reset(Type * const i_handle = nullptr) noexcept
+	{
+		Type *handle = m_handle;
+
+		m_handle = i_handle;
+		if(handle != nullptr)
+		{
+			Destroy(&handle);
+		}
+	}
+
+private:
+	Type *m_handle;
+};
+/**************************************************/
+
+/********************----- CLASS: Frame -----********************/
+/* Borrows the mmap'd capture buffer; valid only until the capture callback returns */
+class Frame
+{
+public:
+	Frame(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, CameraFrameLayout const * const i_layout) noexcept : m_bytes(i_frameData, i_frameSizeBytes), m_layout(i_layout) {}
+
+	ByteView bytes() const noexcept { return m_bytes; }
+	uint8_t const *data() const noexcept { return m_bytes.data(); }
+	size_t size() const noexcept { return m_bytes.size(); }
+	/* NULL for MJPEG, which has no fixed layout */
+	CameraFrameLayout const *layout() const noexcept { return m_layout; }
+
+	/* Empty if the plane does not exist or the frame is short */
+	ByteView plane(size_t const i_plane) const noexcept
+	{
+		size_t begin = 0;
+		size_t end = 0;
+
+		if(m_layout == nullptr || i_plane >= m_layout->m_planeCount || i_plane >= CAMERA_PLANE_COUNT_MAX)
+		{
+			return ByteView();
+		}
+		begin = m_layout->m_planeOffset[i_plane];
+		end = (i_plane + 1 < m_layout->m_planeCount && i_plane + 1 < CAMERA_PLANE_COUNT_MAX) ? m_layout->m_planeOffset[i_plane + 1] : m_layout->m_sizeBytes;
+		return (end <= m_bytes.size()) ? m_bytes.subspan(begin, end - begin) : ByteView();
+	}
+
+	/* One stride of a plane, padding included; plane 1 of NV12/NV21 has a row per two luma rows */
+	ByteView row(uint32_t const i_y, size_t const i_plane = 0) const noexcept
+	{
+		ByteView const planeBytes = plane(i_plane);
+		size_t const strideBytes = (planeBytes.empty()) ? 0 : m_layout->m_strideBytes[i_plane];
+
+		return (strideBytes != 0 && (i_y + 1)*strideBytes <= planeBytes.size()) ? planeBytes.subspan(i_y*strideBytes, strideBytes) : ByteView();
+	}
+
+private:
+	ByteView m_bytes;
+	CameraFrameLayout const *m_layout;
+};
+/**************************************************/
+
+/********************----- CLASS: CameraCache -----********************/
+class CameraCache
+{
+public:
+	static Result create(char const * const i_pathname, CameraCache &o_cache) noexcept
+	{
+		return camera_cache_create(i_pathname, o_cache.m_handle.out());
+	}
+
+	Result save() noexcept { return camera_cache_save(m_handle.get()); }
+	::CameraCache *get() const noexcept { return m_handle.get(); }
+	explicit operator bool() const noexcept { return static_cast<bool>(m_handle); }
+
+private:
+	Handle<::CameraCache, camera_cache_destroy> m_handle;
+};
+/**************************************************/
+
+/********************----- CLASS: Camera -----********************/
+class Camera
+{
+public:
+	Camera() noexcept : m_layout() {}
+	/* Takes ownership of a handle from the C API, e.g. one filled in by camera_create_many */
+	explicit Camera(::Camera * const i_handle) noexcept : m_handle(i_handle), m_layout()
+	{
+		layout_load();
+	}
+
+	static Result create(	int32_t const i_deviceID,
+									PixelFormat const i_pixelFormat,
+									uint32_t const i_sizeX,
+									uint32_t const i_sizeY,
+									Camera &o_camera,
+									CameraCache * const io_cache = nullptr) noexcept
+	{
+		Result const result = camera_create_cached(i_deviceID, i_pixelFormat, i_sizeX, i_sizeY, (io_cache != nullptr) ? io_cache->get() : nullptr, o_camera.m_handle.out());
+
+		o_camera.layout_load();
+		return result;
+	}
+
+	static Result create_replay(	char const * const i_pathname,
+											PixelFormat const i_pixelFormat,
+											uint32_t const i_sizeX,
+											uint32_t const i_sizeY,
+											Camera &o_camera) noexcept
+	{
+		Result const result = camera_create_replay(i_pathname, i_pixelFormat, i_sizeX, i_sizeY, o_camera.m_handle.out());
+
+		o_camera.layout_load();
+		return result;
+	}
+
+	/* i_function(Frame const &) runs on this thread before the buffer is requeued; it is called directly, never through a stored pointer */
+	template<typename Function>
+	Result capture(Function &&i_function) noexcept
+	{
+		CaptureContext<std::remove_reference_t<Function>> context = {&i_function, layout()};
+
+		return camera_capture_callback(capture_trampoline<std::remove_reference_t<Function>>, &context, m_handle.get());
+	}
+
+	/* As capture, but R_DEVICENOTREADY instead of waiting when no frame is ready */
+	template<typename Function>
+	Result capture_try(Function &&i_function) noexcept
+	{
+		CaptureContext<std::remove_reference_t<Function>> context = {&i_function, layout()};
+
+		return camera_capture_try(capture_trampoline<std::remove_reference_t<Function>>, &context, m_handle.get());
+	}
+
+	Result capture_copy(Span<uint8_t> const o_output) noexcept { return camera_capture_copy(o_output.size(), o_output.data(), m_handle.get()); }
+	Result start() noexcept { return camera_start(m_handle.get()); }
+	Result stop() noexcept { return camera_stop(m_handle.get()); }
+	Result fd(int &o_fd) const noexcept { return camera_fd(m_handle.get(), &o_fd); }
+	Result metrics(CameraMetrics &o_metrics) const noexcept { return camera_metrics(&o_metrics, m_handle.get()); }
+	Result timestamp(Timestamp &o_timestamp) const noexcept { return camera_timestamp(m_handle.get(), &o_timestamp); }
+	CameraFrameLayout const *layout() const noexcept { return (m_layout.m_planeCount != 0) ? &m_layout : nullptr; }
+
+	::Camera *get() const noexcept { return m_handle.get(); }
+	::Camera *release() noexcept { return m_handle.release(); }
+	explicit operator bool() const noexcept { return static_cast<bool>(m_handle); }
+
+private:
+	template<typename Function>
+	struct CaptureContext
+	{
+		Function *m_function;
+		CameraFrameLayout const *m_layout;
+	};
+
+	/* One instantiation per callable type, so the call into it is direct and inlinable */
+	template<typename Function>
+	static void capture_trampoline(uint8_t const * const i_frameData, size_t const i_frameSizeBytes, void * const i_callbackData)
+	{
+		CaptureContext<Function> const * const context = static_cast<CaptureContext<Function> const *>(i_callbackData);
+
+		(*context->m_function)(Frame(i_frameData, i_frameSizeBytes, context->m_layout));
+	}
+
+	void layout_load() noexcept
+	{
+		m_layout = CameraFrameLayout();
+		if(m_handle)
+		{
+			camera_layout(m_handle.get(), &m_layout);
+		}
+	}
+
+	Handle<::Camera, camera_destroy> m_handle;
+	CameraFrameLayout m_layout;
+};
+/**************************************************/
+
+/********************----- CLASS: Serial -----********************/
+class Serial
+{
+public:
+	Serial() noexcept = default;
+	explicit Serial(::Serial * const i_handle) noexcept : m_handle(i_handle) {}
+
+	static Result create(	int const i_deviceID,
+									BaudRate const i_baudRate,
+									SerialMode const i_serialMode,
+									Serial &o_serial) noexcept
+	{
+		return serial_create(i_deviceID, i_baudRate, i_serialMode, o_serial.m_handle.out());
+	}
+
+	static Result create_path(	char const * const i_pathname,
+										BaudRate const i_baudRate,
+										SerialMode const i_serialMode,
+										Serial &o_serial) noexcept
+	{
+		return serial_create_path(i_pathname, i_baudRate, i_serialMode, o_serial.m_handle.out());
+	}
+
+	Result read(Span<uint8_t> const o_buffer, size_t &o_bytesRead) noexcept { return serial_read(o_buffer.size(), o_buffer.data(), &o_bytesRead, m_handle.get()); }
+	Result write(ByteView const i_data, size_t &o_bytesWritten) noexcept { return serial_write(i_data.size(), i_data.data(), &o_bytesWritten, m_handle.get()); }
+	Result fd(int &o_fd) const noexcept { return serial_fd(m_handle.get(), &o_fd); }
+	Result metrics(SerialMetrics &o_metrics) const noexcept { return serial_metrics(&o_metrics, m_handle.get()); }
+	Result timestamp_read(Timestamp &o_timestamp) const noexcept { return serial_timestamp_read(m_handle.get(), &o_timestamp); }
+	Result timestamp_write(Timestamp &o_timestamp) const noexcept { return serial_timestamp_write(m_handle.get(), &o_timestamp); }
+
+	::Serial *get() const noexcept { return m_handle.get(); }
+	::Serial *release() noexcept { return m_handle.release(); }
+	explicit operator bool() const noexcept { return static_cast<bool>(m_handle); }
+
+private:
+	Handle<::Serial, serial_destroy> m_handle;
+};
+/**************************************************/
+
+}	/* namespace carl */
+
+#endif	/* _CARL_HPP_ */
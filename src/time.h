@@ -1,14 +0,0 @@
-#ifndef TIME_H_
-#define TIME_H_
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-void timer_sleep(double const i_seconds);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif	/* TIME_H_ */
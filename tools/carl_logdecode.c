@@ -0,0 +1,304 @@
+#include "../src/BinaryLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FORMAT_LENGTH_MAX 1024
+
+/********************----- STRUCT: DecodeFormat -----********************/
+struct DecodeFormat_s
+{
+	int m_stream;
+	char m_functionName[BINARYLOG_NAME_LENGTH+1];
+	char m_format[FORMAT_LENGTH_MAX+1];
+	uint8_t m_argumentCount;
+	char m_argumentTypes[BINARYLOG_ARGUMENTS_MAX];
+};
+typedef struct DecodeFormat_s DecodeFormat;
+/**************************************************/
+
+static DecodeFormat *g_formats = NULL;
+static size_t g_formatCount = 0;
+
+static int read_exact(void * const o_data, size_t const i_sizeBytes, FILE * const i_fileHandle)
+{
+	return fread(o_data, 1, i_sizeBytes, i_fileHandle) == i_sizeBytes;
+}
+
+static int read_string(char * const o_string, size_t const i_sizeMax, FILE * const i_fileHandle)
+{
+	uint16_t length = 0;
+
+	if(!read_exact(&length, sizeof(length), i_fileHandle) || length > i_sizeMax)
+	{
+		return 0;
+	}
+	if(!read_exact(o_string, length, i_fileHandle))
+	{
+		return 0;
+	}
+	o_string[length] = '\0';
+
+	return 1;
+}
+
+/* Render one conversion at a time with the argument's original C type */
+static void render_message(DecodeFormat const * const i_format, uint8_t const * i_payload, size_t i_payloadSizeBytes, FILE * const o_fileHandle)
+{
+	char const *cursor = i_format->m_format;
+	char specifier[64];
+	char text[256];
+	size_t argumentIndex = 0;
+	size_t specifierLength = 0;
+	int starValues[2];
+	size_t starCount = 0;
+	uint64_t valueInteger = 0;
+	double valueDouble = 0.0;
+	uint16_t stringLength = 0;
+	char stringValue[BINARYLOG_STRING_LENGTH+1];
+	char const *conversion = NULL;
+
+	while(*cursor != '\0')
+	{
+		if(*cursor != '%')
+		{
+			fputc(*cursor++, o_fileHandle);
+			continue;
+		}
+		if(cursor[1] == '%')
+		{
+			fputc('%', o_fileHandle);
+			cursor += 2;
+			continue;
+		}
+
+		/***** Copy the conversion specifier *****/
+		conversion = cursor+1;
+		while(*conversion != '\0' && strchr("diouxXceEfFgGaAsp", *conversion) == NULL)
+		{
+			++conversion;
+		}
+		if(*conversion == '\0')
+		{
+			fputs(cursor, o_fileHandle);
+			return;
+		}
+		specifierLength = MIN((size_t)(conversion - cursor + 1), sizeof(specifier)-1);
+		memcpy(specifier, cursor, specifierLength);
+		specifier[specifierLength] = '\0';
+		cursor = conversion+1;
+
+		/***** Fetch '*' widths, then the value itself *****/
+		starCount = 0;
+		for(conversion=specifier; *conversion != '\0'; ++conversion)
+		{
+			if(*conversion == '*' && starCount < 2 && argumentIndex < i_format->m_argumentCount && i_payloadSizeBytes >= 8)
+			{
+				memcpy(&valueInteger, i_payload, 8);
+				i_payload += 8;
+				i_payloadSizeBytes -= 8;
+				starValues[starCount++] = (int)(int64_t)valueInteger;
+				++argumentIndex;
+			}
+		}
+		if(argumentIndex >= i_format->m_argumentCount)
+		{
+			fputs(specifier, o_fileHandle);
+			continue;
+		}
+
+		text[0] = '\0';
+		switch(i_format->m_argumentTypes[argumentIndex++])
+		{
+			case BINARYLOG_ARGUMENT_STRING:
+				if(i_payloadSizeBytes < sizeof(stringLength))
+				{
+					return;
+				}
+				memcpy(&stringLength, i_payload, sizeof(stringLength));
+				i_payload += sizeof(stringLength);
+				i_payloadSizeBytes -= sizeof(stringLength);
+				stringLength = MIN(stringLength, MIN(i_payloadSizeBytes, BINARYLOG_STRING_LENGTH));
+				memcpy(stringValue, i_payload, stringLength);
+				stringValue[stringLength] = '\0';
+				i_payload += stringLength;
+				i_payloadSizeBytes -= stringLength;
+				if(starCount == 2) snprintf(text, sizeof(text), specifier, starValues[0], starValues[1], stringValue);
+				else if(starCount == 1) snprintf(text, sizeof(text), specifier, starValues[0], stringValue);
+				else snprintf(text, sizeof(text), specifier, stringValue);
+				break;
+			case BINARYLOG_ARGUMENT_DOUBLE:
+			case BINARYLOG_ARGUMENT_LONGDOUBLE:
+				if(i_payloadSizeBytes < 8)
+				{
+					return;
+				}
+				memcpy(&valueDouble, i_payload, 8);
+				i_payload += 8;
+				i_payloadSizeBytes -= 8;
+				if(i_format->m_argumentTypes[argumentIndex-1] == BINARYLOG_ARGUMENT_LONGDOUBLE)
+				{
+					if(starCount == 2) snprintf(text, sizeof(text), specifier, starValues[0], starValues[1], (long double)valueDouble);
+					else if(starCount == 1) snprintf(text, sizeof(text), specifier, starValues[0], (long double)valueDouble);
+					else snprintf(text, sizeof(text), specifier, (long double)valueDouble);
+				}
+				else
+				{
+					if(starCount == 2) snprintf(text, sizeof(text), specifier, starValues[0], starValues[1], valueDouble);
+					else if(starCount == 1) snprintf(text, sizeof(text), specifier, starValues[0], valueDouble);
+					else snprintf(text, sizeof(text), specifier, valueDouble);
+				}
+				break;
+			case BINARYLOG_ARGUMENT_INT:
+				if(i_payloadSizeBytes < 8)
+				{
+					return;
+				}
+				memcpy(&valueInteger, i_payload, 8);
+				i_payload += 8;
+				i_payloadSizeBytes -= 8;
+				if(starCount == 2) snprintf(text, sizeof(text), specifier, starValues[0], starValues[1], (int)(int64_t)valueInteger);
+				else if(starCount == 1) snprintf(text, sizeof(text), specifier, starValues[0], (int)(int64_t)valueInteger);
+				else snprintf(text, sizeof(text), specifier, (int)(int64_t)valueInteger);
+				break;
+			case BINARYLOG_ARGUMENT_POINTER:
+				if(i_payloadSizeBytes < 8)
+				{
+					return;
+				}
+				memcpy(&valueInteger, i_payload, 8);
+				i_payload += 8;
+				i_payloadSizeBytes -= 8;
+				snprintf(text, sizeof(text), specifier, (void *)(uintptr_t)valueInteger);
+				break;
+			default:
+				/***** long, long long, size_t, intmax_t, ptrdiff_t are all 8 bytes here *****/
+				if(i_payloadSizeBytes < 8)
+				{
+					return;
+				}
+				memcpy(&valueInteger, i_payload, 8);
+				i_payload += 8;
+				i_payloadSizeBytes -= 8;
+				if(starCount == 2) snprintf(text, sizeof(text), specifier, starValues[0], starValues[1], (long long)valueInteger);
+				else if(starCount == 1) snprintf(text, sizeof(text), specifier, starValues[0], (long long)valueInteger);
+				else snprintf(text, sizeof(text), specifier, (long long)valueInteger);
+				break;
+		}
+		fputs(text, o_fileHandle);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *fileHandle = NULL;
+	BinaryLogHeader header;
+	uint8_t recordType = 0;
+	uint32_t formatID = 0;
+	uint8_t stream = 0;
+	uint64_t timestamp = 0;
+	int32_t errorNumber = 0;
+	uint16_t payloadSizeBytes = 0;
+	uint8_t payload[65536];
+	DecodeFormat *format = NULL;
+	uint64_t timeWallNs = 0;
+	time_t timeWall;
+	struct tm timeLocal;
+	char timeText[32];
+
+	if(argc != 2)
+	{
+		fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fileHandle = fopen(argv[1], "rb");
+	if(fileHandle == NULL)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	if(!read_exact(&header, sizeof(header), fileHandle) || memcmp(header.m_magic, BINARYLOG_MAGIC, sizeof(header.m_magic)) != 0 || header.m_version != BINARYLOG_VERSION)
+	{
+		fprintf(stderr, "%s: not a version %d carl binary log\n", argv[1], BINARYLOG_VERSION);
+		return EXIT_FAILURE;
+	}
+	header.m_programName[sizeof(header.m_programName)-1] = '\0';
+
+	while(read_exact(&recordType, sizeof(recordType), fileHandle))
+	{
+		if(recordType == BINARYLOG_RECORD_FORMAT)
+		{
+			/***** Definition of a call site *****/
+			if(!read_exact(&formatID, sizeof(formatID), fileHandle) || !read_exact(&stream, sizeof(stream), fileHandle))
+			{
+				break;
+			}
+			if(formatID >= g_formatCount)
+			{
+				g_formats = (DecodeFormat *)realloc(g_formats, (formatID+1)*sizeof(DecodeFormat));
+				if(g_formats == NULL)
+				{
+					fprintf(stderr, "out of memory\n");
+					return EXIT_FAILURE;
+				}
+				memset(g_formats + g_formatCount, 0, (formatID+1-g_formatCount)*sizeof(DecodeFormat));
+				g_formatCount = formatID+1;
+			}
+			format = &g_formats[formatID];
+			format->m_stream = stream;
+			if(!read_string(format->m_functionName, BINARYLOG_NAME_LENGTH, fileHandle)
+				|| !read_string(format->m_format, FORMAT_LENGTH_MAX, fileHandle)
+				|| !read_exact(&format->m_argumentCount, sizeof(format->m_argumentCount), fileHandle)
+				|| format->m_argumentCount > BINARYLOG_ARGUMENTS_MAX
+				|| !read_exact(format->m_argumentTypes, format->m_argumentCount, fileHandle))
+			{
+				break;
+			}
+		}
+		else if(recordType == BINARYLOG_RECORD_MESSAGE)
+		{
+			/***** A logged message *****/
+			if(!read_exact(&formatID, sizeof(formatID), fileHandle)
+				|| !read_exact(&timestamp, sizeof(timestamp), fileHandle)
+				|| !read_exact(&errorNumber, sizeof(errorNumber), fileHandle)
+				|| !read_exact(&payloadSizeBytes, sizeof(payloadSizeBytes), fileHandle)
+				|| !read_exact(payload, payloadSizeBytes, fileHandle))
+			{
+				break;
+			}
+			if(formatID >= g_formatCount)
+			{
+				fprintf(stderr, "unknown format %u\n", formatID);
+				continue;
+			}
+			format = &g_formats[formatID];
+
+			timeWallNs = header.m_realtimeAnchor + (timestamp - header.m_monotonicAnchor);
+			timeWall = (time_t)(timeWallNs / 1000000000ull);
+			if(localtime_r(&timeWall, &timeLocal) == NULL || strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &timeLocal) == 0)
+			{
+				strcpy(timeText, "\?\?\?\?-\?\?-\?\? \?\?:\?\?:\?\?");
+			}
+			printf("%s%s%s.%06llu %s - ", header.m_programName, (header.m_programName[0] != '\0') ? ": " : "", timeText, (unsigned long long)((timeWallNs % 1000000000ull) / 1000ull), format->m_functionName);
+			render_message(format, payload, payloadSizeBytes, stdout);
+			if(errorNumber >= 0)
+			{
+				printf(" - \"%s\"", strerror(errorNumber));
+			}
+			putchar('\n');
+		}
+		else
+		{
+			fprintf(stderr, "corrupt record type %u\n", recordType);
+			break;
+		}
+	}
+
+	fclose(fileHandle);
+	free(g_formats);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include "../src/Metrics.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(int argc, char **argv)
+{
+	int fileHandle = -1;
+	struct stat fileStat;
+	void *map = MAP_FAILED;
+	MetricsPageHeader const *header = NULL;
+	MetricsSlot const *slots = NULL;
+	uint32_t slotIndex = 0;
+	uint32_t slotUsed = 0;
+	uint32_t fieldIndex = 0;
+
+	if(argc != 2)
+	{
+		fprintf(stderr, "usage: %s </metrics page name>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fileHandle = shm_open(argv[1], O_RDONLY, 0);
+	if(fileHandle < 0 || fstat(fileHandle, &fileStat) == -1)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	if((size_t)fileStat.st_size < sizeof(MetricsPageHeader))
+	{
+		fprintf(stderr, "%s: too short\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	map = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fileHandle, 0);
+	if(map == MAP_FAILED)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	/***** Validate header *****/
+	header = (MetricsPageHeader const *)map;
+	if(memcmp(header->m_magic, METRICS_MAGIC, sizeof(header->m_magic)) != 0 || header->m_version != METRICS_VERSION || header->m_slotSizeBytes != sizeof(MetricsSlot))
+	{
+		fprintf(stderr, "%s: not a carl metrics page\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	slots = (MetricsSlot const *)(header + 1);
+	slotUsed = __atomic_load_n(&header->m_slotUsed, __ATOMIC_ACQUIRE);
+	if(slotUsed > header->m_slotCount || sizeof(MetricsPageHeader) + (size_t)header->m_slotCount*sizeof(MetricsSlot) > (size_t)fileStat.st_size)
+	{
+		fprintf(stderr, "%s: slot table truncated\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	/***** One line per counter *****/
+	for(slotIndex=0; slotIndex<slotUsed; ++slotIndex)
+	{
+		MetricsSlot const * const slot = &slots[slotIndex];
+
+		/***** Released by a destroyed handle *****/
+		if(!__atomic_load_n(&slot->m_inUse, __ATOMIC_ACQUIRE))
+		{
+			continue;
+		}
+		for(fieldIndex=0; fieldIndex<slot->m_fieldCount && fieldIndex<METRICS_FIELD_COUNT_MAX; ++fieldIndex)
+		{
+			printf("%.*s.%.*s.%.*s %llu\n", METRICS_FIELD_NAME_LENGTH, slot->m_kind, METRICS_NAME_LENGTH, slot->m_name, METRICS_FIELD_NAME_LENGTH, slot->m_fieldNames[fieldIndex], (unsigned long long)__atomic_load_n(&slot->m_values[fieldIndex], __ATOMIC_RELAXED));
+		}
+	}
+
+	munmap(map, (size_t)fileStat.st_size);
+	close(fileHandle);
+
+	return EXIT_SUCCESS;
+}
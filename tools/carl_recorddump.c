@@ -0,0 +1,130 @@
+#include "../src/Recorder.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int record_compare(void const * const i_left, void const * const i_right)
+{
+	uint64_t const left = ((RecorderRecord const *)i_left)->m_sequence;
+	uint64_t const right = ((RecorderRecord const *)i_right)->m_sequence;
+
+	return (left > right) - (left < right);
+}
+
+static char const *record_event_name(uint16_t const i_event)
+{
+	switch(i_event)
+	{
+		case RECORDER_EVENT_FRAME_DEQUEUED:
+			return "frame";
+		case RECORDER_EVENT_SEQUENCE_GAP:
+			return "gap";
+		case RECORDER_EVENT_BYTES_READ:
+			return "read";
+		case RECORDER_EVENT_BYTES_WRITTEN:
+			return "write";
+		case RECORDER_EVENT_ERROR:
+			return "error";
+		default:
+			return (i_event >= RECORDER_EVENT_USER) ? "user" : "unknown";
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int fileHandle = -1;
+	struct stat fileStat;
+	void *map = MAP_FAILED;
+	RecorderHeader const *header = NULL;
+	RecorderRecord const *records = NULL;
+	RecorderRecord *sorted = NULL;
+	size_t recordIndex = 0;
+	size_t recordCount = 0;
+	size_t validCount = 0;
+	uint64_t timeWallNs = 0;
+	time_t timeWall;
+	struct tm timeLocal;
+	char timeText[32];
+
+	if(argc != 2)
+	{
+		fprintf(stderr, "usage: %s <recorder file>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fileHandle = open(argv[1], O_RDONLY);
+	if(fileHandle < 0 || fstat(fileHandle, &fileStat) == -1)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	if((size_t)fileStat.st_size < sizeof(RecorderHeader))
+	{
+		fprintf(stderr, "%s: too short\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	map = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fileHandle, 0);
+	if(map == MAP_FAILED)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	/***** Validate header *****/
+	header = (RecorderHeader const *)map;
+	if(memcmp(header->m_magic, RECORDER_MAGIC, sizeof(header->m_magic)) != 0 || header->m_version != RECORDER_VERSION || header->m_recordSizeBytes != sizeof(RecorderRecord))
+	{
+		fprintf(stderr, "%s: not a version %d carl flight recorder\n", argv[1], RECORDER_VERSION);
+		return EXIT_FAILURE;
+	}
+	recordCount = MIN((size_t)header->m_recordCount, ((size_t)fileStat.st_size - sizeof(RecorderHeader))/sizeof(RecorderRecord));
+	records = (RecorderRecord const *)(header + 1);
+
+	/***** Keep committed records that belong to their slot *****/
+	sorted = (RecorderRecord *)malloc(MAX(recordCount, 1)*sizeof(RecorderRecord));
+	if(sorted == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+	for(recordIndex=0; recordIndex<recordCount; ++recordIndex)
+	{
+		if(records[recordIndex].m_sequence != 0 && (records[recordIndex].m_sequence-1) % recordCount == recordIndex)
+		{
+			sorted[validCount++] = records[recordIndex];
+		}
+	}
+	qsort(sorted, validCount, sizeof(RecorderRecord), record_compare);
+
+	printf("# %zu of %llu records, head %llu\n", validCount, (unsigned long long)header->m_recordCount, (unsigned long long)header->m_head);
+	for(recordIndex=0; recordIndex<validCount; ++recordIndex)
+	{
+		timeWallNs = header->m_realtimeAnchor + (sorted[recordIndex].m_timestamp - header->m_monotonicAnchor);
+		timeWall = (time_t)(timeWallNs / 1000000000ull);
+		if(localtime_r(&timeWall, &timeLocal) == NULL || strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &timeLocal) == 0)
+		{
+			strcpy(timeText, "\?\?\?\?-\?\?-\?\? \?\?:\?\?:\?\?");
+		}
+		printf("%llu %s.%09llu %-7s source=%u value32=%u value64=%llu\n",
+			(unsigned long long)(sorted[recordIndex].m_sequence-1),
+			timeText,
+			(unsigned long long)(timeWallNs % 1000000000ull),
+			record_event_name(sorted[recordIndex].m_event),
+			sorted[recordIndex].m_source,
+			sorted[recordIndex].m_value32,
+			(unsigned long long)sorted[recordIndex].m_value64);
+	}
+
+	free(sorted);
+	munmap(map, (size_t)fileStat.st_size);
+	close(fileHandle);
+
+	return EXIT_SUCCESS;
+}